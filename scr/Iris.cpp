@@ -1,12 +1,236 @@
 #include "graphics/Engine.hpp"
+#include "utilities/Ppm.hpp"
+#include "utilities/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
 
 
 using namespace iris::graphics;
 
-int main() {
-    Engine engine{};
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-transforms") == 0) {
+        for (size_t count : {10000, 100000, 1000000}) {
+            TransformStore::benchmark(count, 20);
+        }
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-entities") == 0) {
+        for (size_t count : {100000, 250000, 500000, 1000000}) {
+            EntityStore::benchmark(count, 20);
+        }
+        return 0;
+    }
+
+    // times the CPU light assignment for each light count, then renders that many lights with the clustered forward
+    // renderer and prints the average GPU time of its passes, the lights are shaded in the forward pass
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-lights") == 0) {
+        for (uint32_t count : {1024u, 4096u, 8192u, 16384u}) {
+            LightClusters::benchmark(count, 20);
+            Engine engine{RendererType::Forward, count, 0, LatencyProfile::Benchmark};
+            engine.run(500);
+        }
+        return 0;
+    }
+
+    // renders a fixed number of frames per light count with every renderer and prints their average GPU pass timings
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-deferred") == 0) {
+        for (uint32_t count : {100u, 1000u, 10000u}) {
+            for (RendererType type : {RendererType::Forward, RendererType::Deferred, RendererType::DeferredSubpass,
+                                      RendererType::DeferredLightVolumes, RendererType::Visibility}) {
+                const char* name = type == RendererType::Forward ? "forward"
+                                 : type == RendererType::Deferred ? "deferred"
+                                 : type == RendererType::DeferredSubpass ? "deferred subpass"
+                                 : type == RendererType::DeferredLightVolumes ? "deferred light volumes" : "visibility";
+                std::cout << name << ", " << count << " lights" << std::endl;
+                Engine engine{type, count};
+                engine.run(500);
+            }
+        }
+        return 0;
+    }
+
+    // renders an overdraw heavy scene with and without the depth pre-pass, then with the visibility renderer, and
+    // prints the average frame time, GPU pass timings and fragment shader invocations of each
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-depth-prepass") == 0) {
+        for (uint32_t layers : {8u, 32u}) {
+            for (bool depthPrePass : {false, true}) {
+                std::cout << layers << " overdraw layers, depth pre-pass " << (depthPrePass ? "on" : "off") << std::endl;
+                Engine engine{RendererType::Forward, 0, layers};
+                engine.setDepthPrePass(depthPrePass);
+                engine.run(500);
+            }
+            std::cout << layers << " overdraw layers, visibility" << std::endl;
+            Engine engine{RendererType::Visibility, 0, layers};
+            engine.run(500);
+        }
+        return 0;
+    }
+
+    // records a stress scene of 100000 stars with 1, 2, 4 and every recording thread and prints the average CPU time
+    // spent recording the entities next to the GPU pass timings
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-recording") == 0) {
+        const unsigned int allThreads = iris::utils::ThreadPool::instance().getConcurrency();
+        for (uint32_t threads : {1u, 2u, 4u, allThreads}) {
+            std::cout << "100000 entities, " << threads << " recording threads" << std::endl;
+            Engine engine{RendererType::Forward, 0, 4000, LatencyProfile::Benchmark};
+            engine.setRecordingThreads(threads);
+            engine.run(500);
+        }
+        return 0;
+    }
+
+    // --deferred renders with the deferred renderer, --deferred-subpass with its subpass lighting,
+    // --deferred-volumes with its light volumes and --visibility with the visibility buffer renderer, they can be
+    // followed by the other options
+    RendererType rendererType = RendererType::Forward;
+    int argument = 1;
+    if (argc > argument && std::strcmp(argv[argument], "--deferred") == 0) {
+        rendererType = RendererType::Deferred;
+        argument++;
+    }
+    else if (argc > argument && std::strcmp(argv[argument], "--deferred-subpass") == 0) {
+        rendererType = RendererType::DeferredSubpass;
+        argument++;
+    }
+    else if (argc > argument && std::strcmp(argv[argument], "--deferred-volumes") == 0) {
+        rendererType = RendererType::DeferredLightVolumes;
+        argument++;
+    }
+    else if (argc > argument && std::strcmp(argv[argument], "--visibility") == 0) {
+        rendererType = RendererType::Visibility;
+        argument++;
+    }
+
+    // --lights <count> adds random lights to the scene, the printed frame stats then show the frame time for that
+    // many lights. --overdraw <layers> adds layers of stars drawn back to front and --depth-prepass starts the
+    // forward renderer with its depth pre-pass, P switches it while running. --dynamic-resolution <ms> scales the
+    // render resolution to hit that GPU frame time, R switches it while running. --latency <profile> picks the frames
+    // in flight and present mode: low (1 frame, FIFO), balanced (the default), throughput (3 frames, MAILBOX) or
+    // benchmark (3 frames, IMMEDIATE). --latency-log <file> writes the time of each stage of every frame, from the
+    // input to the presentation, as CSV when the window is closed. --no-late-latch updates the camera when the frame
+    // is recorded instead of right before it is submitted. --headless <frames> renders that many frames offscreen
+    // without opening a window and --output <file.ppm> then saves the last one, it fails when the frame is a single
+    // color. --reference <file.ppm> compares it with that image and fails when more than --max-difference <fraction>
+    // of their channels differ, a tenth of a percent by default. --max-lights <count> shades at most that many lights
+    // per fragment and --fog <density> adds fog, both in the forward renderer's Default.frag. --stats prints the frame
+    // stats once per second
+    uint32_t extraLightCount = 0;
+    uint32_t overdrawLayers = 0;
+    bool depthPrePass = false;
+    bool dynamicResolution = false;
+    float targetFrameMs = 1000.f / 60.f;
+    LatencyProfile latencyProfile = LatencyProfile::Balanced;
+    std::string latencyLogPath;
+    bool lateLatch = true;
+    bool printStats = false;
+    bool headless = false;
+    uint32_t headlessFrames = 0;
+    std::string outputPath;
+    std::string referencePath;
+    // a channel off by a few steps is rounding, a tenth of a percent of them is the GPU's own
+    double maxDifference = 0.001;
+    ShaderPermutation shaderPermutation{};
+    for (; argument < argc; argument++) {
+        if (argc > argument + 1 && std::strcmp(argv[argument], "--lights") == 0) {
+            extraLightCount = static_cast<uint32_t>(std::strtoul(argv[++argument], nullptr, 10));
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--overdraw") == 0) {
+            overdrawLayers = static_cast<uint32_t>(std::strtoul(argv[++argument], nullptr, 10));
+        }
+        else if (std::strcmp(argv[argument], "--depth-prepass") == 0) {
+            depthPrePass = true;
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--dynamic-resolution") == 0) {
+            dynamicResolution = true;
+            targetFrameMs = std::strtof(argv[++argument], nullptr);
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--latency") == 0) {
+            const char* profile = argv[++argument];
+            latencyProfile = std::strcmp(profile, "low") == 0 ? LatencyProfile::LowLatency
+                           : std::strcmp(profile, "throughput") == 0 ? LatencyProfile::Throughput
+                           : std::strcmp(profile, "benchmark") == 0 ? LatencyProfile::Benchmark : LatencyProfile::Balanced;
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--latency-log") == 0) {
+            latencyLogPath = argv[++argument];
+        }
+        else if (std::strcmp(argv[argument], "--no-late-latch") == 0) {
+            lateLatch = false;
+        }
+        else if (std::strcmp(argv[argument], "--stats") == 0) {
+            printStats = true;
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--headless") == 0) {
+            headless = true;
+            headlessFrames = static_cast<uint32_t>(std::strtoul(argv[++argument], nullptr, 10));
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--output") == 0) {
+            outputPath = argv[++argument];
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--reference") == 0) {
+            referencePath = argv[++argument];
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--max-difference") == 0) {
+            maxDifference = std::strtod(argv[++argument], nullptr);
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--max-lights") == 0) {
+            shaderPermutation.m_maxLights = static_cast<uint32_t>(std::strtoul(argv[++argument], nullptr, 10));
+        }
+        else if (argc > argument + 1 && std::strcmp(argv[argument], "--fog") == 0) {
+            shaderPermutation.m_fog = true;
+            shaderPermutation.m_fogDensity = std::strtof(argv[++argument], nullptr);
+        }
+    }
+
+    Engine engine{rendererType, extraLightCount, overdrawLayers, latencyProfile, headless, shaderPermutation};
+    engine.setDepthPrePass(depthPrePass);
+    engine.setDynamicResolution(dynamicResolution, targetFrameMs);
+    engine.setLatencyLog(latencyLogPath);
+    engine.setLateLatch(lateLatch);
+    engine.setPrintStats(printStats);
+
+    if (!headless) {
+        engine.run();
+        return 0;
+    }
+
+    // nothing closes a headless run, at least one frame is rendered
+    engine.run(std::max(headlessFrames, 1u));
+    if (outputPath.empty()) {
+        return 0;
+    }
+    const SaveFrameResult result = engine.saveFrame(outputPath);
+    if (result != SaveFrameResult::Saved) {
+        std::cout << "Failed to save the frame to " << outputPath << ": "
+                  << (result == SaveFrameResult::NotHeadless ? "the renderer is not headless"
+                    : result == SaveFrameResult::NoFrame ? "no frame was rendered" : "the file cannot be written")
+                  << std::endl;
+        return 1;
+    }
+
+    // a frame of the clear color alone drew nothing, whatever the reference
+    iris::utils::Ppm frame{};
+    if (!iris::utils::Ppm::read(outputPath, frame) || iris::utils::Ppm::isUniform(frame)) {
+        std::cout << outputPath << " is a single color, nothing was drawn" << std::endl;
+        return 1;
+    }
 
-    engine.run();
+    if (!referencePath.empty()) {
+        iris::utils::Ppm reference{};
+        if (!iris::utils::Ppm::read(referencePath, reference)) {
+            std::cout << "No reference image at " << referencePath << std::endl;
+            return 1;
+        }
+        const double difference = iris::utils::Ppm::difference(frame, reference, 4);
+        if (difference > maxDifference) {
+            std::cout << outputPath << " differs from " << referencePath << " in " << difference * 100.0
+                      << "% of its channels" << std::endl;
+            return 1;
+        }
+    }
 
     return 0;
 }
@@ -1,70 +1,173 @@
 #include "AssetsManager.hpp"
 #include "Initializers.hpp"
 
+#include <iostream>
 
 namespace iris::graphics{
-    std::unordered_map<std::string, std::shared_ptr<Model>> AssetsManager::m_sModels = std::unordered_map<std::string, std::shared_ptr<Model>>{};
-    std::unordered_map<std::string, std::shared_ptr<Material>> AssetsManager::m_sMaterials = std::unordered_map<std::string, std::shared_ptr<Material>>{};
-    std::unordered_map<std::string, std::shared_ptr<Texture>> AssetsManager::m_sTextures = std::unordered_map<std::string, std::shared_ptr<Texture>>{};
+    utils::SlotMap<Model> AssetsManager::m_sModels{};
+    utils::SlotMap<Material> AssetsManager::m_sMaterials{};
+    utils::SlotMap<Texture> AssetsManager::m_sTextures{};
+
+    std::unordered_map<std::string, ModelHandle> AssetsManager::m_sModelNames{};
+    std::unordered_map<std::string, MaterialHandle> AssetsManager::m_sMaterialNames{};
+    std::unordered_map<std::string, TextureHandle> AssetsManager::m_sTextureNames{};
+
+    std::unordered_map<uint32_t, std::array<TextureHandle, 3>> AssetsManager::m_sMaterialTextures{};
+    std::unordered_map<uint32_t, uint32_t> AssetsManager::m_sTextureUsers{};
+
+    std::unique_ptr<GeometryPool> AssetsManager::m_sGeometryPool{};
+    std::unordered_map<uint32_t, MeshRange> AssetsManager::m_sMeshRanges{};
+
+    namespace {
+        // a single lookup, the handle of a missing name is null
+        template<typename HandleType>
+        HandleType findHandle(const std::unordered_map<std::string, HandleType>& names, const std::string& name,
+                              const char* assetType) {
+            auto it = names.find(name);
+            if(it == names.end()){
+                std::cout << assetType << " " << name << " does not exists" << std::endl;
+                return HandleType{};
+            }
+            return it->second;
+        }
+    }
 
     void AssetsManager::clear(Device& device) {
         m_sModels.clear();
-        for(auto & material : m_sMaterials){
-            vkDestroyPipelineLayout(device.getDevice(), material.second->getPipeLineLayout(), nullptr);
-        }
+        m_sModelNames.clear();
+        m_sMeshRanges.clear();
+        m_sGeometryPool.reset();
 
+        m_sMaterials.forEach([&device](Material& material){ destroyMaterial(device, material); });
         m_sMaterials.clear();
+        m_sMaterialNames.clear();
+        m_sMaterialTextures.clear();
+        m_sTextureUsers.clear();
 
-        for(auto & texture : m_sTextures){
-            vkDestroyImageView(device.getDevice(), texture.second->m_imageView, nullptr);
-            device.destroyImage(texture.second->m_allocatedImage);
-        }
+        m_sTextures.forEach([&device](Texture& texture){ destroyTexture(device, texture); });
         m_sTextures.clear();
+        m_sTextureNames.clear();
     }
 
-    void AssetsManager::loadModel(Device& device, const std::string& name, const std::string& path){
-        if(m_sModels.find(name) != m_sModels.end()){
+    ModelHandle AssetsManager::loadModel(Device& device, const std::string& name, const std::string& path){
+        auto it = m_sModelNames.find(name);
+        if(it != m_sModelNames.end()){
             std::cout << "Model " << name << " already loaded!" << std::endl;
-            return;
+            return it->second;
         }
 
-        m_sModels[name] = Model::createModelFromFile(device, path);
+        ModelHandle handle = m_sModels.insert(Model::createModelFromFile(device, path));
+        m_sModelNames.emplace(name, handle);
+        if(m_sGeometryPool){
+            m_sMeshRanges.emplace(handle.getValue(), m_sGeometryPool->add(*m_sModels.get(handle)));
+        }
+        return handle;
     }
 
-    std::shared_ptr<Model> AssetsManager::getModel(const std::string &name) {
-        if(m_sModels.find(name) == m_sModels.end()){
-            std::cout << "Model " << name << " does not exists" << std::endl;
-            return nullptr;
+    void AssetsManager::enableGeometryPool(Device &device, uint32_t maxVertices, uint32_t maxIndices) {
+        if(m_sGeometryPool){
+            return;
+        }
+        m_sGeometryPool = std::make_unique<GeometryPool>(device, maxVertices, maxIndices);
+        for(const auto& [name, handle] : m_sModelNames){
+            m_sMeshRanges.emplace(handle.getValue(), m_sGeometryPool->add(*m_sModels.get(handle)));
         }
+    }
 
-        return m_sModels[name];
+    const MeshRange* AssetsManager::getMeshRange(ModelHandle handle) {
+        auto it = m_sMeshRanges.find(handle.getValue());
+        return it != m_sMeshRanges.end() ? &it->second : nullptr;
     }
 
-    void AssetsManager::loadMaterial(Device& device, const std::string &name, const std::shared_ptr<Pipeline>& pipeline, VkPipelineLayout layout,
-                                     VkDescriptorSet texture) {
-        if(m_sMaterials.find(name) != m_sMaterials.end()){
+    ModelHandle AssetsManager::findModel(const std::string &name) {
+        return findHandle(m_sModelNames, name, "Model");
+    }
+
+    void AssetsManager::unloadModel(ModelHandle handle) {
+        for(auto it = m_sModelNames.begin(); it != m_sModelNames.end(); ++it){
+            if(it->second == handle){
+                m_sModelNames.erase(it);
+                break;
+            }
+        }
+        m_sMeshRanges.erase(handle.getValue());
+        m_sModels.remove(handle);
+    }
+
+    MaterialHandle AssetsManager::loadMaterial(Device& device, const std::string &name, const std::shared_ptr<Pipeline>& pipeline, VkPipelineLayout layout,
+                                               VkDescriptorSet texture) {
+        auto it = m_sMaterialNames.find(name);
+        if(it != m_sMaterialNames.end()){
             std::cout << "Material " << name << " already loaded!" << std::endl;
+            return it->second;
+        }
+
+        MaterialHandle handle = m_sMaterials.insert(std::make_unique<Material>(device, name, pipeline, layout, texture));
+        m_sMaterialNames.emplace(name, handle);
+        return handle;
+    }
+
+    MaterialHandle AssetsManager::findMaterial(const std::string &name) {
+        return findHandle(m_sMaterialNames, name, "Material");
+    }
+
+    void AssetsManager::unloadMaterial(Device &device, MaterialHandle handle) {
+        Material* pMaterial = m_sMaterials.get(handle);
+        if(pMaterial == nullptr){
             return;
         }
-        m_sMaterials[name] = std::make_shared<Material>(device, name, pipeline, layout, texture);
+
+        m_sMaterialNames.erase(pMaterial->getName());
+        releaseMaterialTextures(handle);
+        destroyMaterial(device, *pMaterial);
+        m_sMaterials.remove(handle);
     }
 
-    std::shared_ptr<Material> AssetsManager::getMaterial(const std::string &name) {
-        if(m_sMaterials.find(name) == m_sMaterials.end()){
-            std::cout << "Material " << name << " does not exists" << std::endl;
-            return nullptr;
+    bool AssetsManager::setMaterialTextures(MaterialHandle material, TextureHandle ambient, TextureHandle diffuse,
+                                            TextureHandle specular, const DescriptorPool &pool,
+                                            const DescriptorSetLayout &layout) {
+        Material* pMaterial = m_sMaterials.get(material);
+        Texture* pAmbient = m_sTextures.get(ambient);
+        Texture* pDiffuse = m_sTextures.get(diffuse);
+        Texture* pSpecular = m_sTextures.get(specular);
+        if(pMaterial == nullptr || pAmbient == nullptr || pDiffuse == nullptr || pSpecular == nullptr){
+            std::cout << "Cannot set the textures of a material, a handle is stale" << std::endl;
+            return false;
         }
 
-        return m_sMaterials[name];
+        releaseMaterialTextures(material);
+        pMaterial->setTexture(*pAmbient, *pDiffuse, *pSpecular, pool, layout);
+        const std::array<TextureHandle, 3> textures{ambient, diffuse, specular};
+        for(TextureHandle texture : textures){
+            m_sTextureUsers[texture.getValue()]++;
+        }
+        m_sMaterialTextures[material.getValue()] = textures;
+        return true;
     }
 
-    void AssetsManager::loadTexture(Device &device, const std::string &name, const std::string &path) {
-        if(m_sTextures.find(name) != m_sTextures.end()){
-            std::cout << "Texture " << name << " already loaded!" << std::endl;
+    void AssetsManager::releaseMaterialTextures(MaterialHandle material) {
+        auto it = m_sMaterialTextures.find(material.getValue());
+        if(it == m_sMaterialTextures.end()){
             return;
         }
+        for(TextureHandle texture : it->second){
+            m_sTextureUsers[texture.getValue()]--;
+        }
+        m_sMaterialTextures.erase(it);
+    }
+
+    void AssetsManager::destroyMaterial(Device &device, Material &material) {
+        vkDestroyPipelineLayout(device.getDevice(), material.getPipeLineLayout(), nullptr);
+    }
+
+    TextureHandle AssetsManager::loadTexture(Device &device, const std::string &name, const std::string &path) {
+        auto it = m_sTextureNames.find(name);
+        if(it != m_sTextureNames.end()){
+            std::cout << "Texture " << name << " already loaded!" << std::endl;
+            return it->second;
+        }
 
-        std::shared_ptr<Texture> textureToLoad = std::make_shared<Texture>();
+        auto textureToLoad = std::make_unique<Texture>();
         AllocatedImage image = device.loadTexture(path);
 
         // setting up the texture
@@ -73,15 +176,35 @@ namespace iris::graphics{
         VkImageViewCreateInfo imageInfo = Initializers::createImageViewInfo(VK_FORMAT_R8G8B8A8_SRGB, textureToLoad->m_allocatedImage.m_image, VK_IMAGE_ASPECT_COLOR_BIT);
         vkCreateImageView(device.getDevice(), &imageInfo, nullptr, &textureToLoad->m_imageView);
 
-        m_sTextures[name] = textureToLoad;
+        TextureHandle handle = m_sTextures.insert(std::move(textureToLoad));
+        m_sTextureNames.emplace(name, handle);
+        return handle;
     }
 
-    std::shared_ptr<Texture> AssetsManager::getTexture(const std::string &name) {
-        if(m_sTextures.find(name) == m_sTextures.end()){
-            std::cout << "Texture " << name << " does not exists" << std::endl;
-            return nullptr;
+    TextureHandle AssetsManager::findTexture(const std::string &name) {
+        return findHandle(m_sTextureNames, name, "Texture");
+    }
+
+    void AssetsManager::unloadTexture(Device &device, TextureHandle handle) {
+        Texture* pTexture = m_sTextures.get(handle);
+        if(pTexture == nullptr){
+            return;
         }
+        // the materials' descriptor sets still point at its view
+        auto users = m_sTextureUsers.find(handle.getValue());
+        if(users != m_sTextureUsers.end() && users->second > 0){
+            std::cout << "Texture " << pTexture->m_name << " is still used by " << users->second << " materials!" << std::endl;
+            return;
+        }
+
+        m_sTextureUsers.erase(handle.getValue());
+        m_sTextureNames.erase(pTexture->m_name);
+        destroyTexture(device, *pTexture);
+        m_sTextures.remove(handle);
+    }
 
-        return m_sTextures[name];
+    void AssetsManager::destroyTexture(Device &device, Texture &texture) {
+        vkDestroyImageView(device.getDevice(), texture.m_imageView, nullptr);
+        device.destroyImage(texture.m_allocatedImage);
     }
-}
\ No newline at end of file
+}
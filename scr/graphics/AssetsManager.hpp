@@ -3,31 +3,76 @@
 
 #include "Model.hpp"
 #include "Material.hpp"
+#include "GeometryPool.hpp"
+#include "../utilities/SlotMap.hpp"
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 #include <string>
 
 namespace iris::graphics{
+    using ModelHandle = utils::Handle<Model>;
+    using MaterialHandle = utils::Handle<Material>;
+    using TextureHandle = utils::Handle<Texture>;
+
+    // assets are looked up by name once when loading, everything else goes through handles. Getting the asset of a
+    // stale handle, whose asset was unloaded, returns nullptr
     class AssetsManager {
     public:
         AssetsManager(const AssetsManager&) = delete;
         AssetsManager& operator=(const AssetsManager&) = delete;
 
-        static void loadModel(Device& device, const std::string& name, const std::string& path);
-        static std::shared_ptr<Model> getModel(const std::string& name);
+        static ModelHandle loadModel(Device& device, const std::string& name, const std::string& path);
+        static ModelHandle findModel(const std::string& name);
+        static Model* getModel(ModelHandle handle) { return m_sModels.get(handle); }
+        // the device must not be using the model anymore
+        static void unloadModel(ModelHandle handle);
+
+        // from then on every loaded model is also appended to the pool, the models already loaded are added now
+        static void enableGeometryPool(Device& device, uint32_t maxVertices, uint32_t maxIndices);
+        // nullptr until enabled
+        static GeometryPool* getGeometryPool() { return m_sGeometryPool.get(); }
+        // nullptr for a stale handle or without a pool
+        static const MeshRange* getMeshRange(ModelHandle handle);
 
-        static void loadMaterial(Device& device, const std::string& name, const std::shared_ptr<Pipeline>& pipeline, VkPipelineLayout layout, VkDescriptorSet texture = VK_NULL_HANDLE);
-        static std::shared_ptr<Material> getMaterial(const std::string& name);
+        static MaterialHandle loadMaterial(Device& device, const std::string& name, const std::shared_ptr<Pipeline>& pipeline, VkPipelineLayout layout, VkDescriptorSet texture = VK_NULL_HANDLE);
+        static MaterialHandle findMaterial(const std::string& name);
+        static Material* getMaterial(MaterialHandle handle) { return m_sMaterials.get(handle); }
+        // the device must not be using the material anymore
+        static void unloadMaterial(Device& device, MaterialHandle handle);
+        // writes the material's texture set. The textures cannot be unloaded while a material uses them, false when a
+        // handle is stale and the material keeps its previous textures
+        static bool setMaterialTextures(MaterialHandle material, TextureHandle ambient, TextureHandle diffuse,
+                                        TextureHandle specular, const DescriptorPool& pool, const DescriptorSetLayout& layout);
 
-        static void loadTexture(Device& device, const std::string& name, const std::string& path);
-        static std::shared_ptr<Texture> getTexture(const std::string& name);
+        static TextureHandle loadTexture(Device& device, const std::string& name, const std::string& path);
+        static TextureHandle findTexture(const std::string& name);
+        static Texture* getTexture(TextureHandle handle) { return m_sTextures.get(handle); }
+        // the device must not be using the texture anymore, a texture still used by a material is kept
+        static void unloadTexture(Device& device, TextureHandle handle);
 
         static void clear(Device& device);
     private:
-        static std::unordered_map<std::string, std::shared_ptr<Model>> m_sModels;
-        static std::unordered_map<std::string, std::shared_ptr<Material>> m_sMaterials;
-        static std::unordered_map<std::string, std::shared_ptr<Texture>> m_sTextures;
+        static utils::SlotMap<Model> m_sModels;
+        static utils::SlotMap<Material> m_sMaterials;
+        static utils::SlotMap<Texture> m_sTextures;
+
+        static std::unordered_map<std::string, ModelHandle> m_sModelNames;
+        static std::unordered_map<std::string, MaterialHandle> m_sMaterialNames;
+        static std::unordered_map<std::string, TextureHandle> m_sTextureNames;
+
+        // by MaterialHandle value the textures of the material's set, by TextureHandle value the materials using it
+        static std::unordered_map<uint32_t, std::array<TextureHandle, 3>> m_sMaterialTextures;
+        static std::unordered_map<uint32_t, uint32_t> m_sTextureUsers;
+        static void releaseMaterialTextures(MaterialHandle material);
+
+        static std::unique_ptr<GeometryPool> m_sGeometryPool;
+        // by ModelHandle value, a stale handle never matches a reloaded model
+        static std::unordered_map<uint32_t, MeshRange> m_sMeshRanges;
+
+        static void destroyMaterial(Device& device, Material& material);
+        static void destroyTexture(Device& device, Texture& texture);
     };
 }
 
@@ -0,0 +1,44 @@
+#ifndef IRIS_BOUNDINGBOX_HPP
+#define IRIS_BOUNDINGBOX_HPP
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace iris::graphics{
+    // axis aligned, starts empty until a point is added
+    struct BoundingBox{
+        glm::vec3 m_min{std::numeric_limits<float>::max()};
+        glm::vec3 m_max{std::numeric_limits<float>::lowest()};
+
+        [[nodiscard]] bool isValid() const { return m_min.x <= m_max.x; }
+
+        void expand(const glm::vec3& point){
+            m_min = glm::min(m_min, point);
+            m_max = glm::max(m_max, point);
+        }
+
+        // box enclosing this box once transformed, from Arvo's "Transforming Axis-Aligned Bounding Boxes"
+        [[nodiscard]] BoundingBox transformed(const glm::mat4& matrix) const {
+            if (!isValid()) {
+                return *this;
+            }
+
+            BoundingBox result{};
+            result.m_min = glm::vec3{matrix[3]};
+            result.m_max = glm::vec3{matrix[3]};
+            for (int column = 0; column < 3; column++) {
+                for (int row = 0; row < 3; row++) {
+                    const float a = matrix[column][row] * m_min[column];
+                    const float b = matrix[column][row] * m_max[column];
+                    result.m_min[row] += std::min(a, b);
+                    result.m_max[row] += std::max(a, b);
+                }
+            }
+            return result;
+        }
+    };
+}
+
+#endif //IRIS_BOUNDINGBOX_HPP
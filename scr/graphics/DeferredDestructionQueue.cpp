@@ -0,0 +1,32 @@
+#include "DeferredDestructionQueue.hpp"
+
+#include <cassert>
+
+namespace iris::graphics{
+
+    DeferredDestructionQueue::~DeferredDestructionQueue() {
+        flush();
+    }
+
+    void DeferredDestructionQueue::push(uint64_t frameCount, std::function<void()> destroy) {
+        assert((m_retired.empty() || m_retired.back().m_frameCount <= frameCount) && "Resources are retired in frame order");
+        m_retired.push_back({frameCount, std::move(destroy)});
+    }
+
+    void DeferredDestructionQueue::collect(uint64_t completedFrameCount) {
+        while (!m_retired.empty() && m_retired.front().m_frameCount <= completedFrameCount) {
+            // popped first, a destruction may retire more resources
+            std::function<void()> destroy = std::move(m_retired.front().m_destroy);
+            m_retired.pop_front();
+            destroy();
+        }
+    }
+
+    void DeferredDestructionQueue::flush() {
+        while (!m_retired.empty()) {
+            std::function<void()> destroy = std::move(m_retired.front().m_destroy);
+            m_retired.pop_front();
+            destroy();
+        }
+    }
+}
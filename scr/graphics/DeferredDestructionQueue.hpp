@@ -0,0 +1,39 @@
+#ifndef IRIS_DEFERREDDESTRUCTIONQUEUE_HPP
+#define IRIS_DEFERREDDESTRUCTIONQUEUE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace iris::graphics{
+    // resources replaced while the frames in flight may still use them, like the swapchain and the attachments sized
+    // after it. They are destroyed once every frame recorded before their retirement finished on the GPU, nothing
+    // waits for the device to idle
+    class DeferredDestructionQueue {
+    public:
+        DeferredDestructionQueue() = default;
+        // runs what is left, the device must be idle
+        ~DeferredDestructionQueue();
+
+        DeferredDestructionQueue(const DeferredDestructionQueue &) = delete;
+        DeferredDestructionQueue &operator=(const DeferredDestructionQueue &) = delete;
+
+        // frameCount is the number of frames recorded when the resources were retired, destroy releases them
+        void push(uint64_t frameCount, std::function<void()> destroy);
+        // destroys the resources retired before the first completedFrameCount frames finished
+        void collect(uint64_t completedFrameCount);
+        // destroys everything, the device must be idle
+        void flush();
+
+        [[nodiscard]] size_t size() const { return m_retired.size(); }
+    private:
+        struct Retired{
+            uint64_t m_frameCount{};
+            std::function<void()> m_destroy{};
+        };
+        // in retirement order, the frame counts never decrease
+        std::deque<Retired> m_retired{};
+    };
+}
+
+#endif //IRIS_DEFERREDDESTRUCTIONQUEUE_HPP
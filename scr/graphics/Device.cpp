@@ -4,6 +4,8 @@
 
 #include <vector>
 #include <set>
+#include <cstring>
+#include <fstream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -22,6 +24,7 @@ namespace iris::graphics{
         chosePhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createPipelineCache();
 
         initiateUploadContext();
 
@@ -33,6 +36,9 @@ namespace iris::graphics{
     }
 
     Device::~Device() {
+        savePipelineCache();
+        vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+
         vmaDestroyAllocator(m_allocator);
 
         vkDestroyFence(m_device, m_uploadContext.m_uploadFence, nullptr);
@@ -43,7 +49,9 @@ namespace iris::graphics{
         if (m_cEnableValidationLayers) {
             Debugger::freeDebugCallback(m_instance);
         }
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        if (m_surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        }
         vkDestroyInstance(m_instance, nullptr);
     }
 
@@ -64,7 +72,9 @@ namespace iris::graphics{
     }
 
     void Device::createSurface() {
-        m_rWindow.createWindowSurface(m_instance, &m_surface);
+        if (!isHeadless()) {
+            m_rWindow.createWindowSurface(m_instance, &m_surface);
+        }
     }
 
     void Device::chosePhysicalDevice() {
@@ -110,10 +120,19 @@ namespace iris::graphics{
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures{}; // used to specify features we will use
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(m_chosenGpu, &supportedFeatures);
+        // pipeline statistics count the fragment shader invocations of a frame, the query stays active while the
+        // secondary command buffers execute so they have to inherit it
+        m_enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        m_enabledFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+        // gl_PrimitiveID in a fragment shader needs the geometry shader capability, the visibility renderer writes it
+        m_enabledFeatures.geometryShader = supportedFeatures.geometryShader;
+        // nothing is presented without a surface, software implementations may not even expose the extension
+        const std::vector<const char*> deviceExtensions = isHeadless() ? std::vector<const char*>{} : m_cDeviceExtensions;
         VkDeviceCreateInfo createInfo = Initializers::createDeviceInfo(queueCreateInfos,
-                                                                       m_cDeviceExtensions,
-                                                                       m_cValidationLayers, deviceFeatures,
+                                                                       deviceExtensions,
+                                                                       m_cValidationLayers, m_enabledFeatures,
                                                                        m_cEnableValidationLayers);
 
         Debugger::vkCheck(vkCreateDevice(m_chosenGpu, &createInfo, nullptr, &m_device), "failed to create logical device");
@@ -129,6 +148,57 @@ namespace iris::graphics{
                 , "failed to create command pool");
     }
 
+    void Device::createPipelineCache() {
+        std::vector<char> data{};
+        std::ifstream file{m_cPipelineCachePath, std::ios::ate | std::ios::binary};
+        if (file.is_open()) {
+            data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+
+        // the header is written by the driver: its size and version, then the vendor, the device and the cache UUID
+        // that changes with the driver version
+        VkPipelineCacheHeaderVersionOne header{};
+        bool valid = data.size() >= sizeof(header);
+        if (valid) {
+            std::memcpy(&header, data.data(), sizeof(header));
+            valid = header.headerSize >= sizeof(header) &&
+                    header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                    header.vendorID == m_chosenGpuProperties.vendorID &&
+                    header.deviceID == m_chosenGpuProperties.deviceID &&
+                    std::memcmp(header.pipelineCacheUUID, m_chosenGpuProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = valid ? data.size() : 0;
+        cacheInfo.pInitialData = valid ? data.data() : nullptr;
+        Debugger::vkCheck(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_pipelineCache),
+                          "failed to create pipeline cache");
+
+        m_pipelineCacheStats.m_warm = valid;
+        m_pipelineCacheStats.m_ignored = !data.empty() && !valid;
+        m_pipelineCacheStats.m_loadedBytes = valid ? data.size() : 0;
+    }
+
+    void Device::savePipelineCache() {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(m_device, m_pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+            return;
+        }
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(m_device, m_pipelineCache, &size, data.data()) != VK_SUCCESS) {
+            return;
+        }
+
+        std::ofstream file{m_cPipelineCachePath, std::ios::binary | std::ios::trunc};
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        m_pipelineCacheStats.m_savedBytes = size;
+    }
 
     void Device::initiateUploadContext() {
         VkFenceCreateInfo fenceInfo = {};
@@ -149,11 +219,14 @@ namespace iris::graphics{
     }
 
     std::vector<const char *> Device::getRequiredInstanceExtensions() const {
-        uint32_t glfwExtensionCount = 0;
-        const char **glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        std::vector<const char *> extensions;
+        // the surface extensions are GLFW's, it is never initialised without a window
+        if (!isHeadless()) {
+            uint32_t glfwExtensionCount = 0;
+            const char **glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (m_cEnableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -179,7 +252,13 @@ namespace iris::graphics{
             }
 
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(m_chosenGpu, i, m_surface, &presentSupport); // check if the queue family has the capability of presenting to our window surface
+            if (isHeadless()) {
+                // nothing is presented, the graphics queue stands in for the present one
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            }
+            else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(m_chosenGpu, i, m_surface, &presentSupport); // check if the queue family has the capability of presenting to our window surface
+            }
 
             if (presentSupport) {
                 m_queueFamilyIndices.m_presentFamily = i;
@@ -289,7 +368,8 @@ namespace iris::graphics{
                           "failed to bind image memory");
     }
 
-    AllocatedBuffer Device::createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+    AllocatedBuffer Device::createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+                                         VmaAllocationCreateFlags allocationFlags) {
         //allocate vertex buffer
         VkBufferCreateInfo bufferInfo = {};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -301,18 +381,34 @@ namespace iris::graphics{
 
         VmaAllocationCreateInfo vmaAllocInfo = {};
         vmaAllocInfo.usage = memoryUsage;
+        vmaAllocInfo.flags = allocationFlags;
 
         AllocatedBuffer newBuffer{};
+        VmaAllocationInfo allocationInfo{};
 
         //allocate the buffer
         Debugger::vkCheck(vmaCreateBuffer(m_allocator, &bufferInfo, &vmaAllocInfo,
                                           &newBuffer.m_buffer,
                                           &newBuffer.m_allocation,
-                                          nullptr), "Failed to allocate vertex buffer");
+                                          &allocationInfo), "Failed to allocate vertex buffer");
+
+        // persistently mapped buffers keep their pointer for their whole lifetime
+        newBuffer.m_pMappedData = allocationInfo.pMappedData;
 
         return newBuffer;
     }
 
+    void Device::addPipelineCreationTime(double milliseconds) {
+        std::lock_guard<std::mutex> lock(m_pipelineStatsMutex);
+        m_pipelineCacheStats.m_pipelinesCreated++;
+        m_pipelineCacheStats.m_creationTimeMs += milliseconds;
+    }
+
+    void Device::addPipelineBuildTime(double milliseconds) {
+        std::lock_guard<std::mutex> lock(m_pipelineStatsMutex);
+        m_pipelineCacheStats.m_buildTimeMs += milliseconds;
+    }
+
     void Device::destroyBuffer(AllocatedBuffer &buffer) {
         vmaDestroyBuffer(m_allocator, buffer.m_buffer, buffer.m_allocation);
     }
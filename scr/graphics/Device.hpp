@@ -11,11 +11,14 @@
 #include <vk_mem_alloc.h>
 #include <functional>
 #include <memory>
+#include <mutex>
 
 namespace iris::graphics{
     struct AllocatedBuffer {
         VkBuffer m_buffer;
         VmaAllocation m_allocation;
+        // only set for buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT, stays valid until the buffer is destroyed
+        void* m_pMappedData{nullptr};
     };
 
     struct AllocatedImage {
@@ -53,6 +56,20 @@ namespace iris::graphics{
 
     class Device {
     public:
+        struct PipelineCacheStats{
+            // the cache file was found and was written by this GPU and driver
+            bool m_warm{};
+            // a cache file written by another GPU or driver was found and left unused
+            bool m_ignored{};
+            size_t m_loadedBytes{};
+            size_t m_savedBytes{};
+            uint32_t m_pipelinesCreated{};
+            // summed over the pipelines, above the build time when build queues created them in parallel
+            double m_creationTimeMs{};
+            // wall time of the build queues
+            double m_buildTimeMs{};
+        };
+
 #ifdef NDEBUG
         const bool m_EnableValidationLayers = false;
 #else
@@ -71,7 +88,10 @@ namespace iris::graphics{
         [[nodiscard]] VkCommandPool getCommandPool() const { return m_commandPool; }
         [[nodiscard]] VkDevice getDevice() const { return m_device; }
         [[nodiscard]] VkPhysicalDevice getPhysicalDevice() const { return m_chosenGpu; }
+        // VK_NULL_HANDLE when headless
         [[nodiscard]] VkSurfaceKHR getSurface() const { return m_surface; }
+        // created for a headless window: no surface, no swapchain extension and the frames are rendered offscreen
+        [[nodiscard]] bool isHeadless() const { return m_rWindow.isHeadless(); }
         [[nodiscard]] VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
         [[nodiscard]] VkQueue getPresentQueue() const { return m_presentQueue; }
         [[nodiscard]] VkInstance getInstance() const { return m_instance; }
@@ -79,6 +99,8 @@ namespace iris::graphics{
         [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
         [[nodiscard]] VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
         [[nodiscard]] VkPhysicalDeviceProperties getPhysicalDeviceProperties() const { return m_chosenGpuProperties; }
+        // the optional features the logical device was created with, the ones the GPU lacks are left off
+        [[nodiscard]] const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return m_enabledFeatures; }
         [[nodiscard]] VkSampleCountFlagBits getMaxUsableSampleCount() const;
 
         [[nodiscard]] QueueFamilyIndices getQueueFamilyIndices() const { return m_queueFamilyIndices; }
@@ -89,7 +111,8 @@ namespace iris::graphics{
                                                VkImage &image,
                                                VkDeviceMemory &imageMemory);
 
-        AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+        AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+                                     VmaAllocationCreateFlags allocationFlags = 0);
         void destroyBuffer(AllocatedBuffer& buffer);
         void destroyImage(AllocatedImage& image);
         void copyToBuffer(void * src, AllocatedBuffer& dst, size_t size);
@@ -98,6 +121,13 @@ namespace iris::graphics{
         AllocatedImage loadTexture(const std::string& filePath);
 
         VmaAllocator& getAllocator() { return m_allocator; }
+
+        // every pipeline is created through it, it is kept on disk between runs
+        [[nodiscard]] VkPipelineCache getPipelineCache() const { return m_pipelineCache; }
+        [[nodiscard]] const PipelineCacheStats& getPipelineCacheStats() const { return m_pipelineCacheStats; }
+        // the pipelines time their creation, from any thread
+        void addPipelineCreationTime(double milliseconds);
+        void addPipelineBuildTime(double milliseconds);
     private:
         Window& m_rWindow;
 
@@ -111,6 +141,7 @@ namespace iris::graphics{
         // physical device
         VkPhysicalDevice m_chosenGpu{};
         VkPhysicalDeviceProperties m_chosenGpuProperties{};
+        VkPhysicalDeviceFeatures m_enabledFeatures{};
 
         // logical device
         VkDevice m_device{};
@@ -120,11 +151,21 @@ namespace iris::graphics{
 
         VkCommandPool m_commandPool{};
 
+        // relative to the working directory like the shaders and assets
+        const char* m_cPipelineCachePath = "pipeline_cache.bin";
+        VkPipelineCache m_pipelineCache{};
+        PipelineCacheStats m_pipelineCacheStats{};
+        std::mutex m_pipelineStatsMutex{};
+
         void createInstance();
         void createSurface();
         void chosePhysicalDevice();
         void createLogicalDevice();
         void createCommandPool();
+        // the file's data is only given to the driver when its header matches the chosen GPU, another GPU or driver
+        // version starts from an empty cache
+        void createPipelineCache();
+        void savePipelineCache();
 
         void initiateUploadContext();
 
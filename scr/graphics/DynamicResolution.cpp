@@ -0,0 +1,64 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace iris::graphics{
+
+    DynamicResolution::DynamicResolution(float targetFrameMs) : m_targetMs{targetFrameMs} {
+        reset();
+    }
+
+    float DynamicResolution::update(float frameMs) {
+        m_filteredMs = m_hasSample ? m_filteredMs + (frameMs - m_filteredMs) * m_cSmoothing : frameMs;
+        m_hasSample = true;
+
+        const float error = (m_targetMs - m_filteredMs) / m_targetMs;
+        const float delta = error - m_previousError;
+
+        m_stats.m_proportional = m_kp * delta;
+        m_stats.m_integral = m_ki * error;
+        m_stats.m_derivative = m_kd * (delta - m_previousDelta);
+        m_previousError = error;
+        m_previousDelta = delta;
+
+        // the step is applied relative to the current fraction, halving a small fraction is as fast as a large one.
+        // Clamping the fraction is enough against windup, the velocity form keeps no accumulated error
+        const float step = m_stats.m_proportional + m_stats.m_integral + m_stats.m_derivative;
+        m_pixelFraction = std::clamp(m_pixelFraction * (1.f + step), m_minScale * m_minScale, m_maxScale * m_maxScale);
+        m_scale = std::clamp(std::round(std::sqrt(m_pixelFraction) * m_cScaleSteps) / m_cScaleSteps, m_minScale, m_maxScale);
+
+        m_stats.m_scale = m_scale;
+        m_stats.m_targetMs = m_targetMs;
+        m_stats.m_frameMs = m_filteredMs;
+        m_stats.m_error = error;
+        return m_scale;
+    }
+
+    void DynamicResolution::reset() {
+        m_pixelFraction = m_maxScale * m_maxScale;
+        m_scale = m_maxScale;
+        m_filteredMs = 0.f;
+        m_previousError = 0.f;
+        m_previousDelta = 0.f;
+        m_hasSample = false;
+        m_stats = Stats{};
+        m_stats.m_scale = m_scale;
+        m_stats.m_targetMs = m_targetMs;
+    }
+
+    void DynamicResolution::setGains(float proportional, float integral, float derivative) {
+        m_kp = proportional;
+        m_ki = integral;
+        m_kd = derivative;
+    }
+
+    void DynamicResolution::setScaleRange(float minScale, float maxScale) {
+        assert(minScale > 0.f && minScale <= maxScale && maxScale <= 1.f && "Invalid render scale range");
+        m_minScale = minScale;
+        m_maxScale = maxScale;
+        m_pixelFraction = std::clamp(m_pixelFraction, m_minScale * m_minScale, m_maxScale * m_maxScale);
+        m_scale = std::clamp(m_scale, m_minScale, m_maxScale);
+    }
+}
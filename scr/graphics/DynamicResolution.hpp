@@ -0,0 +1,65 @@
+#ifndef IRIS_DYNAMICRESOLUTION_HPP
+#define IRIS_DYNAMICRESOLUTION_HPP
+
+namespace iris::graphics{
+    // picks the scale of the render resolution from the measured frame times so the frames take the target time.
+    // The controlled value is the fraction of the pixels rendered, the cost of a frame is roughly proportional to it.
+    // A PID controller in velocity form moves it by a step every frame: the proportional term reacts to the change of
+    // the error, the integral term to the error itself and the derivative term to its acceleration. The frame times
+    // lag the scale they were rendered at by the frames in flight, the gains are kept low and the times filtered so
+    // the lag does not make it oscillate
+    class DynamicResolution {
+    public:
+        struct Stats{
+            float m_scale{1.f};
+            float m_targetMs{};
+            // exponentially filtered measured frame time
+            float m_frameMs{};
+            // relative headroom, positive when the frames are faster than the target
+            float m_error{};
+            // contributions of the last step to the pixel fraction
+            float m_proportional{};
+            float m_integral{};
+            float m_derivative{};
+        };
+
+        explicit DynamicResolution(float targetFrameMs = 1000.f / 60.f);
+
+        // feeds the measured time of a frame and returns the scale of the next frames
+        float update(float frameMs);
+        // back to full resolution, the filtered time and the errors are forgotten
+        void reset();
+
+        void setTargetFrameTime(float milliseconds) { m_targetMs = milliseconds; }
+        void setGains(float proportional, float integral, float derivative);
+        // the scale stays in [minScale, maxScale], maxScale 1 is the swapchain resolution
+        void setScaleRange(float minScale, float maxScale);
+
+        [[nodiscard]] float getScale() const { return m_scale; }
+        [[nodiscard]] float getTargetFrameTime() const { return m_targetMs; }
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+    private:
+        // weight of a new sample in the filtered frame time
+        static constexpr float m_cSmoothing = 0.2f;
+        // the scale is rounded to steps of 1 / m_cScaleSteps so the resolution does not change on every frame
+        static constexpr float m_cScaleSteps = 64.f;
+
+        float m_targetMs{};
+        float m_kp{0.4f};
+        float m_ki{0.08f};
+        float m_kd{0.05f};
+        float m_minScale{0.5f};
+        float m_maxScale{1.f};
+
+        float m_pixelFraction{1.f};
+        float m_scale{1.f};
+        float m_filteredMs{};
+        float m_previousError{};
+        float m_previousDelta{};
+        bool m_hasSample{};
+
+        Stats m_stats{};
+    };
+}
+
+#endif //IRIS_DYNAMICRESOLUTION_HPP
@@ -1,31 +1,112 @@
 #include "Engine.hpp"
 #include "AssetsManager.hpp"
+#include "../utilities/Timer.hpp"
+
+#include <iostream>
 
 namespace iris::graphics {
 
-    Engine::Engine() {
+    namespace {
+        std::unique_ptr<Renderer> createRenderer(RendererType type, Device& device, Window& window,
+                                                 LatencyProfile latencyProfile) {
+            if (type == RendererType::Deferred) {
+                return std::make_unique<DeferredRenderer>(device, window, DeferredRenderer::LightingMode::TiledCompute, latencyProfile);
+            }
+            if (type == RendererType::DeferredSubpass) {
+                return std::make_unique<DeferredRenderer>(device, window, DeferredRenderer::LightingMode::Subpass, latencyProfile);
+            }
+            if (type == RendererType::DeferredLightVolumes) {
+                return std::make_unique<DeferredRenderer>(device, window, DeferredRenderer::LightingMode::LightVolumes, latencyProfile);
+            }
+            if (type == RendererType::Visibility) {
+                return std::make_unique<VisibilityRenderer>(device, window, latencyProfile);
+            }
+            return std::make_unique<ForwardRenderer>(device, window, latencyProfile);
+        }
+    }
+
+    Engine::Engine(RendererType rendererType, uint32_t extraLightCount, uint32_t overdrawLayers,
+                   LatencyProfile latencyProfile, bool headless, const ShaderPermutation& shaderPermutation)
+    : m_window{800, 600, "Iris Engine", headless}, m_pRenderer{createRenderer(rendererType, m_device, m_window, latencyProfile)} {
         loadModels();
         loadImages();
-        m_renderer.loadRenderer();
+        if (auto* pForwardRenderer = dynamic_cast<ForwardRenderer*>(m_pRenderer.get())) {
+            pForwardRenderer->setShaderPermutation(shaderPermutation);
+        }
+        m_pRenderer->loadRenderer();
         m_scene.loadScene();
+        m_scene.createRandomLights(extraLightCount);
+        m_scene.createOverdrawLayers(overdrawLayers);
+        printPipelineCacheStats();
+        // the late latch samples the events again right before the frame is submitted
+        m_pRenderer->setInputSampler([this]() { m_window.pollWindowEvents(); });
+        // a frame being drawn recreates the swapchain itself, the callback can come from the events it waits on
+        m_window.setResizeCallback([this]() {
+            if (!m_drawingFrame) {
+                drawFrame();
+            }
+        });
     }
 
 
     Engine::~Engine() {
-
+        m_window.setResizeCallback(nullptr);
+        m_pRenderer->setInputSampler(nullptr);
     }
 
-    void Engine::run() {
-        while(!m_window.shouldCloseWindow()){
+    void Engine::run(uint32_t maxFrames) {
+        while(!m_window.shouldCloseWindow() && (maxFrames == 0 || m_frameIndex < maxFrames)){
             m_window.pollWindowEvents();
-
-            m_scene.draw();
+            handleInput();
+            drawFrame();
         }
 
-        m_renderer.postRender();
+        printGpuTimingAverages();
+        m_pRenderer->postRender();
+        printLatencyStats();
         AssetsManager::clear(m_device);
     }
 
+    void Engine::drawFrame() {
+        m_drawingFrame = true;
+        // the events were just polled, the frame reads the input state they left
+        m_pRenderer->markLatency(LatencyTracker::Stage::InputSampled);
+        m_scene.draw();
+        accumulateGpuTimings();
+        printFrameStats();
+        m_frameIndex++;
+        m_drawingFrame = false;
+    }
+
+    void Engine::setDepthPrePass(bool enabled) {
+        if (auto* pForwardRenderer = dynamic_cast<ForwardRenderer*>(m_pRenderer.get())) {
+            pForwardRenderer->setDepthPrePass(enabled);
+        }
+    }
+
+    void Engine::setDynamicResolution(bool enabled, float targetFrameMs) {
+        m_pRenderer->getResolutionController().setTargetFrameTime(targetFrameMs);
+        m_pRenderer->setDynamicResolution(enabled);
+    }
+
+    void Engine::handleInput() {
+        if (Window::m_sKeyInfo.m_key == GLFW_KEY_P && Window::m_sKeyInfo.m_action == GLFW_PRESS) {
+            // the key stays in the key info until another one is pressed, the press is consumed
+            Window::m_sKeyInfo.m_action = GLFW_RELEASE;
+            if (auto* pForwardRenderer = dynamic_cast<ForwardRenderer*>(m_pRenderer.get())) {
+                pForwardRenderer->setDepthPrePass(!pForwardRenderer->isDepthPrePassEnabled());
+                std::cout << "depth pre-pass " << (pForwardRenderer->isDepthPrePassEnabled() ? "on" : "off") << std::endl;
+            }
+        }
+        if (Window::m_sKeyInfo.m_key == GLFW_KEY_R && Window::m_sKeyInfo.m_action == GLFW_PRESS) {
+            Window::m_sKeyInfo.m_action = GLFW_RELEASE;
+            if (m_pRenderer->isDynamicResolutionSupported()) {
+                m_pRenderer->setDynamicResolution(!m_pRenderer->isDynamicResolutionEnabled());
+                std::cout << "dynamic resolution " << (m_pRenderer->isDynamicResolutionEnabled() ? "on" : "off") << std::endl;
+            }
+        }
+    }
+
     void Engine::loadModels() {
         AssetsManager::loadModel(m_device, "Star", "../assets/models/Star/Star.obj");
         AssetsManager::loadModel(m_device, "Plane", "../assets/models/Plane/Plane.obj");
@@ -36,4 +117,173 @@ namespace iris::graphics {
         AssetsManager::loadTexture(m_device, "StarDiffuse", "../assets/models/Star/Diffuse.png");
         AssetsManager::loadTexture(m_device, "StarSpecular", "../assets/models/Star/Specular.png");
     }
+
+    void Engine::printPipelineCacheStats() {
+        const Device::PipelineCacheStats& stats = m_device.getPipelineCacheStats();
+        // the pipelines built outside a build queue are only in the creation time
+        std::cout << "pipelines: " << stats.m_pipelinesCreated << " created, " << stats.m_creationTimeMs
+                  << " ms of creation, " << stats.m_buildTimeMs << " ms of parallel builds, "
+                  << (stats.m_warm ? "warm" : "cold") << " cache";
+        if (stats.m_warm) {
+            std::cout << " of " << stats.m_loadedBytes / 1024 << " KB";
+        }
+        else if (stats.m_ignored) {
+            std::cout << ", the cache file was written by another GPU or driver";
+        }
+        std::cout << std::endl;
+    }
+
+    void Engine::printFrameStats() {
+        m_framesSinceStatsPrint++;
+        const float time = utils::Timer::getElapsedTime();
+        if (!m_printStats || time - m_lastStatsPrintTime < 1.0f) {
+            return;
+        }
+        const float averageFrameMs = (time - m_lastStatsPrintTime) * 1000.0f / static_cast<float>(m_framesSinceStatsPrint);
+        m_lastStatsPrintTime = time;
+        m_framesSinceStatsPrint = 0;
+
+        // one section per line, the optional ones only when the renderer uses them
+        const FrameStats& stats = m_pRenderer->getFrameStats();
+        const TransformStore::Stats& transformStats = m_scene.getTransforms().getStats();
+        std::cout << "frame " << m_frameIndex << " stats"
+                  << "\n  frame: " << averageFrameMs << " ms, gpu " << m_pRenderer->getGpuFrameMilliseconds() << " ms, "
+                  << m_pRenderer->getMaximumFramesInFlight() << " frames in flight, cpu wait " << stats.m_cpuWaitMs
+                  << " ms, gpu idle " << stats.m_gpuIdleMs << " ms"
+                  << "\n  draws: " << stats.m_drawCount << ", recorded in " << stats.m_recordingTimeMs << " ms"
+                  << "\n  transforms: " << transformStats.m_matricesBuilt << " local and "
+                  << transformStats.m_worldMatricesUpdated << " world matrices built"
+                  << "\n  lights: " << stats.m_lightClusters.m_lightCount << ", "
+                  << stats.m_lightClusters.m_lightIndexCount << " cluster entries, at most "
+                  << stats.m_lightClusters.m_maxLightsPerCluster << " per cluster, assigned in "
+                  << stats.m_lightClusters.m_assignmentTimeMs << " ms"
+                  << "\n  frame ring: " << stats.m_frameRing.m_bytesUsed / 1024 << " KB used, "
+                  << stats.m_frameRing.m_peakBytesUsed / 1024 << " KB peak of "
+                  << stats.m_frameRing.m_bytesPerFrame / 1024 << " KB per frame"
+                  << "\n  shadows: " << stats.m_shadows.m_staticCasters << " static and "
+                  << stats.m_shadows.m_dynamicCasters << " dynamic casters, "
+                  << stats.m_shadows.m_staticSlicesRendered << " static slices rendered with "
+                  << stats.m_shadows.m_staticDraws << " draws, " << stats.m_shadows.m_slicesRestored
+                  << " slices restored, " << stats.m_shadows.m_dynamicDraws << " dynamic draws, "
+                  << stats.m_shadows.m_shadowedPointLights << " shadowed point lights";
+        const LatencyTracker::Stats latency = m_pRenderer->getLatencyTracker().getStats();
+        if (latency.m_frames > 0) {
+            std::cout << "\n  latency: input to photon p50 " << latency.m_inputToPhoton.m_p50
+                      << " p99 " << latency.m_inputToPhoton.m_p99 << " ms";
+        }
+        if (stats.m_fragmentInvocations > 0) {
+            std::cout << "\n  fragments: " << stats.m_fragmentInvocations
+                      << (stats.m_depthPrePass ? ", depth pre-pass" : "");
+        }
+        if (stats.m_dynamicResolution) {
+            std::cout << "\n  dynamic resolution: " << stats.m_renderExtent.width << "x" << stats.m_renderExtent.height
+                      << ", scale " << stats.m_resolution.m_scale
+                      << ", frame " << stats.m_resolution.m_frameMs << " of " << stats.m_resolution.m_targetMs << " ms"
+                      << ", error " << stats.m_resolution.m_error
+                      << ", p " << stats.m_resolution.m_proportional
+                      << " i " << stats.m_resolution.m_integral
+                      << " d " << stats.m_resolution.m_derivative;
+        }
+        if (stats.m_renderGraph.m_passes > 0) {
+            std::cout << "\n  render graph: " << stats.m_renderGraph.m_passes << " passes, "
+                      << stats.m_renderGraph.m_culledPasses << " culled, "
+                      << stats.m_renderGraph.m_barriers << " barriers, "
+                      << stats.m_renderGraph.m_images << " images in " << stats.m_renderGraph.m_memoryBlocks << " blocks, "
+                      << stats.m_renderGraph.m_transientImages << " transient, "
+                      << stats.m_renderGraph.m_bytesAllocated / 1024 << " KB aliased from "
+                      << stats.m_renderGraph.m_bytesWithoutAliasing / 1024 << " KB";
+        }
+        if (stats.m_attachmentBytesAllocated > 0) {
+            std::cout << "\n  attachments: " << stats.m_attachmentBytesAllocated / 1024 << " KB allocated, "
+                      << stats.m_attachmentBytesCommitted / 1024 << " KB committed";
+        }
+        if (stats.m_pipelineStates.m_pipelines + stats.m_pipelineStates.m_pending > 0) {
+            std::cout << "\n  pipeline states: " << stats.m_pipelineStates.m_pipelines << " created, "
+                      << stats.m_pipelineStates.m_pending << " pending, " << stats.m_pipelineStates.m_hits << " hits, "
+                      << stats.m_pipelineStates.m_misses << " misses";
+        }
+        if (stats.m_swapchainRecreations > 0) {
+            std::cout << "\n  swapchain: recreated " << stats.m_swapchainRecreations << " times, "
+                      << stats.m_retiredResources << " retired resources pending";
+        }
+        if (!m_pRenderer->getGpuTimings().empty()) {
+            std::cout << "\n  gpu passes:";
+            for (const auto& timing : m_pRenderer->getGpuTimings()) {
+                std::cout << " " << timing.m_name << " " << timing.m_milliseconds << " ms,";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    void Engine::printLatencyStats() {
+        // the last frames in flight never read their GPU end back, they are left out
+        const LatencyTracker& tracker = m_pRenderer->getLatencyTracker();
+        const LatencyTracker::Stats stats = tracker.getStats();
+        if (stats.m_frames > 0) {
+            const auto print = [](const char* name, const LatencyTracker::Percentiles& percentiles) {
+                std::cout << " | " << name << " p50 " << percentiles.m_p50 << ", p90 " << percentiles.m_p90
+                          << ", p99 " << percentiles.m_p99 << ", max " << percentiles.m_max << " ms";
+            };
+            std::cout << "latency of the last " << stats.m_frames << " frames";
+            print("input to submit", stats.m_inputToSubmit);
+            print("input to gpu done", stats.m_inputToGpuDone);
+            print("input to photon", stats.m_inputToPhoton);
+            std::cout << std::endl;
+        }
+        if (m_latencyLogPath.empty()) {
+            return;
+        }
+        if (tracker.exportCsv(m_latencyLogPath)) {
+            std::cout << tracker.getRecords().size() << " frame latencies written to " << m_latencyLogPath << std::endl;
+        }
+        else {
+            std::cout << "failed to write the frame latencies to " << m_latencyLogPath << std::endl;
+        }
+    }
+
+    void Engine::accumulateGpuTimings() {
+        if (m_frameIndex < m_cGpuTimingWarmUpFrames) {
+            return;
+        }
+        const auto& timings = m_pRenderer->getGpuTimings();
+        if (timings.empty()) {
+            return;
+        }
+        // the passes of a renderer are the same every frame
+        if (m_gpuTimingSums.size() != timings.size()) {
+            m_gpuTimingSums.assign(timings.size(), {});
+            m_gpuTimingFrames = 0;
+            m_fragmentInvocationSum = 0;
+            m_recordingTimeSum = 0.0;
+            m_gpuFrameTimeSum = 0.0;
+            m_gpuTimingStartTime = utils::Timer::getElapsedTime();
+        }
+        for (size_t i = 0; i < timings.size(); i++) {
+            m_gpuTimingSums[i].m_name = timings[i].m_name;
+            m_gpuTimingSums[i].m_milliseconds += timings[i].m_milliseconds;
+        }
+        m_fragmentInvocationSum += m_pRenderer->getFrameStats().m_fragmentInvocations;
+        m_recordingTimeSum += m_pRenderer->getFrameStats().m_recordingTimeMs;
+        m_gpuFrameTimeSum += m_pRenderer->getGpuFrameMilliseconds();
+        m_gpuTimingFrames++;
+    }
+
+    void Engine::printGpuTimingAverages() {
+        if (m_gpuTimingFrames == 0) {
+            return;
+        }
+        const FrameStats& stats = m_pRenderer->getFrameStats();
+        std::cout << "gpu passes, " << stats.m_lightClusters.m_lightCount << " lights, average of "
+                  << m_gpuTimingFrames << " frames:";
+        for (const auto& timing : m_gpuTimingSums) {
+            std::cout << " " << timing.m_name << " " << timing.m_milliseconds / m_gpuTimingFrames << " ms,";
+        }
+        std::cout << " gpu frame " << m_gpuFrameTimeSum / m_gpuTimingFrames << " ms";
+        const float frameMs = (utils::Timer::getElapsedTime() - m_gpuTimingStartTime) * 1000.0f / static_cast<float>(m_gpuTimingFrames);
+        std::cout << " | frame " << frameMs << " ms | recording " << m_recordingTimeSum / m_gpuTimingFrames << " ms";
+        if (m_fragmentInvocationSum > 0) {
+            std::cout << " | " << m_fragmentInvocationSum / m_gpuTimingFrames << " fragment invocations";
+        }
+        std::cout << std::endl;
+    }
 }
@@ -4,27 +4,94 @@
 #include "Device.hpp"
 #include "Renderers/ForwardRenderer.hpp"
 #include "Renderers/DeferredRenderer.hpp"
+#include "Renderers/VisibilityRenderer.hpp"
 #include "Scene.hpp"
 
 namespace iris::graphics {
+    enum class RendererType{
+        Forward,
+        Deferred,
+        // deferred lighting in a subpass reading transient G-buffer attachments
+        DeferredSubpass,
+        // the same subpass drawing a volume per point light
+        DeferredLightVolumes,
+        // triangle ids and depth, then a single shading pass fetching the vertices
+        Visibility
+    };
+
     class Engine {
     public:
-        Engine();
+        // extraLightCount random lights are added to the scene on top of its own, overdrawLayers layers of stars
+        // drawn back to front. A headless engine opens no window, it renders into offscreen images until run's
+        // frame count is reached. The forward renderer's materials are built with shaderPermutation, see
+        // ForwardRenderer::setShaderPermutation
+        explicit Engine(RendererType rendererType = RendererType::Forward, uint32_t extraLightCount = 0,
+                        uint32_t overdrawLayers = 0, LatencyProfile latencyProfile = LatencyProfile::Balanced,
+                        bool headless = false, const ShaderPermutation& shaderPermutation = {});
         ~Engine();
 
         Engine(const Engine &) = delete;
         Engine &operator=(const Engine &) = delete;
 
-        void run();
+        // renders until the window is closed, or for maxFrames frames when it is not 0
+        void run(uint32_t maxFrames = 0);
+
+        // forward renderer only, P switches it while running
+        void setDepthPrePass(bool enabled);
+        // forward and tiled deferred renderers, the render scale follows the GPU frame time to keep it at
+        // targetFrameMs. R switches it while running
+        void setDynamicResolution(bool enabled, float targetFrameMs = 1000.f / 60.f);
+        // see Renderer::setLateLatch
+        void setLateLatch(bool enabled) { m_pRenderer->setLateLatch(enabled); }
+        // see Renderer::setRecordingThreads
+        void setRecordingThreads(uint32_t threads) { m_pRenderer->setRecordingThreads(threads); }
+        // the latency of every frame is written to filePath as CSV when the run ends, empty writes nothing
+        void setLatencyLog(std::string filePath) { m_latencyLogPath = std::move(filePath); }
+        // prints every frame stat once per second, grouped by what they measure
+        void setPrintStats(bool enabled) { m_printStats = enabled; }
+        // see Renderer::saveLastFrame
+        SaveFrameResult saveFrame(const std::string& filePath) { return m_pRenderer->saveLastFrame(filePath); }
     private:
-        Window m_window{800, 600, "Iris Engine"};
+        Window m_window;
         Device m_device{m_window};
-        ForwardRenderer m_renderer{m_device, m_window};
+        // declared before the scene, which initialises it
+        std::unique_ptr<Renderer> m_pRenderer;
 
-        Scene m_scene{m_renderer};
+        Scene m_scene{*m_pRenderer};
 
         void loadModels();
         void loadImages();
+
+        // draws the scene and updates the stats. Also called from the window's resize callback, some platforms
+        // block the event polling for as long as the window is being resized and the frames would stop
+        void drawFrame();
+        bool m_drawingFrame{};
+
+        // prints the renderer's frame stats once per second when enabled
+        bool m_printStats{};
+        float m_lastStatsPrintTime{};
+        uint32_t m_framesSinceStatsPrint{};
+        void printFrameStats();
+        // once loaded, the time the pipelines took with or without the cache of the previous run
+        void printPipelineCacheStats();
+        void handleInput();
+
+        // GPU pass timings summed over the run, printed as averages when it ends. The first frames are skipped, they
+        // time pipeline warm up
+        static constexpr uint32_t m_cGpuTimingWarmUpFrames = 10;
+        uint32_t m_frameIndex{};
+        uint32_t m_gpuTimingFrames{};
+        std::vector<GpuProfiler::ScopeTiming> m_gpuTimingSums{};
+        uint64_t m_fragmentInvocationSum{};
+        double m_recordingTimeSum{};
+        double m_gpuFrameTimeSum{};
+        float m_gpuTimingStartTime{};
+        void accumulateGpuTimings();
+        void printGpuTimingAverages();
+
+        std::string m_latencyLogPath{};
+        // the percentiles of the run's last frames, and the per frame records into the log
+        void printLatencyStats();
     };
 }
 
@@ -0,0 +1,205 @@
+#include "EntityStore.hpp"
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace iris::graphics{
+
+    EntityId EntityStore::create(ModelHandle model, MaterialHandle material, TransformId transformId) {
+        uint32_t index;
+        if (!m_freeIndices.empty()) {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(m_generations.size());
+            m_generations.push_back(0);
+            m_denseIndices.push_back(0);
+        }
+
+        const EntityId entity{index, m_generations[index]};
+        m_denseIndices[index] = static_cast<uint32_t>(m_entities.size());
+
+        m_entities.push_back(entity);
+        m_transformIds.push_back(transformId);
+        m_models.push_back(model);
+        m_materials.push_back(material);
+        return entity;
+    }
+
+    void EntityStore::destroy(EntityId entity) {
+        const uint32_t dense = denseIndex(entity);
+        const uint32_t last = static_cast<uint32_t>(m_entities.size() - 1);
+
+        if (dense != last) {
+            m_entities[dense] = m_entities[last];
+            m_transformIds[dense] = m_transformIds[last];
+            m_models[dense] = m_models[last];
+            m_materials[dense] = m_materials[last];
+            m_denseIndices[m_entities[dense].m_index] = dense;
+        }
+        m_entities.pop_back();
+        m_transformIds.pop_back();
+        m_models.pop_back();
+        m_materials.pop_back();
+
+        // ids still pointing at this index are stale from now on
+        m_generations[entity.m_index]++;
+        m_freeIndices.push_back(entity.m_index);
+    }
+
+    bool EntityStore::isAlive(EntityId entity) const {
+        return entity.m_index < m_generations.size() && m_generations[entity.m_index] == entity.m_generation;
+    }
+
+    uint32_t EntityStore::denseIndex(EntityId entity) const {
+        assert(isAlive(entity) && "Entity was destroyed");
+        return m_denseIndices[entity.m_index];
+    }
+
+    namespace {
+        // layout of the RenderObject array the entity store replaced, only kept to compare against
+        struct LegacyRenderObject {
+            GpuObjectData m_gpuObjectData{};
+            std::shared_ptr<Model> m_pModel{};
+            std::shared_ptr<Material> m_pMaterial{};
+            Transform m_transform{};
+        };
+
+        template<typename Function>
+        double nanosecondsPerEntity(size_t entityCount, int iterations, Function&& function) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                function();
+            }
+            const double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+            return nanoseconds / (static_cast<double>(entityCount) * iterations);
+        }
+    }
+
+    void EntityStore::benchmark(size_t entityCount, int iterations) {
+        // both layouts are filled from the same seeded scene: the same transforms and the same model and material of
+        // each entity, so both loops see the same state changes and upload the same matrices
+        constexpr uint32_t assetCount = 8;
+        std::mt19937 generator{42};
+        std::uniform_real_distribution<float> distribution{-10.f, 10.f};
+        std::uniform_int_distribution<uint32_t> assetDistribution{0, assetCount - 1};
+
+        // distinct model and material pointers for the RenderObjects, they are only compared and never dereferenced
+        const auto pAssetStorage = std::make_shared<std::array<char, assetCount>>();
+        std::array<std::shared_ptr<Model>, assetCount> legacyModels{};
+        std::array<std::shared_ptr<Material>, assetCount> legacyMaterials{};
+        for (uint32_t i = 0; i < assetCount; i++) {
+            legacyModels[i] = std::shared_ptr<Model>(pAssetStorage, reinterpret_cast<Model*>(pAssetStorage->data() + i));
+            legacyMaterials[i] = std::shared_ptr<Material>(pAssetStorage, reinterpret_cast<Material*>(pAssetStorage->data() + i));
+        }
+
+        std::vector<LegacyRenderObject> legacyObjects(entityCount);
+        TransformStore transforms{};
+        EntityStore entities{};
+        BoundingBox unitBox{};
+        unitBox.expand(glm::vec3{-1.f});
+        unitBox.expand(glm::vec3{1.f});
+        for (size_t i = 0; i < entityCount; i++) {
+            Transform transform{};
+            transform.m_translation = {distribution(generator), distribution(generator), distribution(generator)};
+            const uint32_t model = assetDistribution(generator);
+            const uint32_t material = assetDistribution(generator);
+
+            legacyObjects[i].m_transform = transform;
+            legacyObjects[i].m_pModel = legacyModels[model];
+            legacyObjects[i].m_pMaterial = legacyMaterials[material];
+
+            const TransformId transformId = transforms.create(transform);
+            transforms.setLocalBounds(transformId, unitBox);
+            entities.create(ModelHandle{model + 1, 0}, MaterialHandle{material + 1, 0}, transformId);
+        }
+        transforms.update();
+        for (size_t i = 0; i < entityCount; i++) {
+            legacyObjects[i].m_gpuObjectData = transforms.getObjectData()[entities.getTransformIds()[i]];
+        }
+
+        volatile size_t sink = 0;
+        std::vector<GpuObjectData> upload(entityCount);
+
+        // draw list walk: state changes and per object matrices gathered for the upload
+        const double legacyDraw = nanosecondsPerEntity(entityCount, iterations, [&]() {
+            size_t stateChanges = 0;
+            const Model* pLastModel = nullptr;
+            const Material* pLastMaterial = nullptr;
+            for (size_t i = 0; i < legacyObjects.size(); i++) {
+                const auto& object = legacyObjects[i];
+                stateChanges += object.m_pModel.get() != pLastModel;
+                stateChanges += object.m_pMaterial.get() != pLastMaterial;
+                pLastModel = object.m_pModel.get();
+                pLastMaterial = object.m_pMaterial.get();
+                upload[i] = object.m_gpuObjectData;
+            }
+            sink = sink + stateChanges;
+        });
+        const double storeDraw = nanosecondsPerEntity(entityCount, iterations, [&]() {
+            size_t stateChanges = 0;
+            size_t firstInstances = 0;
+            ModelHandle lastModel{};
+            MaterialHandle lastMaterial{};
+            const auto& models = entities.getModels();
+            const auto& materials = entities.getMaterials();
+            const auto& transformIds = entities.getTransformIds();
+            for (size_t i = 0; i < entities.size(); i++) {
+                stateChanges += models[i] != lastModel;
+                stateChanges += materials[i] != lastMaterial;
+                lastModel = models[i];
+                lastMaterial = materials[i];
+                firstInstances += transformIds[i];
+            }
+            std::memcpy(upload.data(), transforms.getObjectData().data(), entityCount * sizeof(GpuObjectData));
+            sink = sink + stateChanges + firstInstances;
+        });
+
+        // culling like pass reading positions only, both count the same entities
+        size_t legacyVisible = 0;
+        size_t storeVisible = 0;
+        const double legacyBounds = nanosecondsPerEntity(entityCount, iterations, [&]() {
+            size_t visible = 0;
+            for (const auto& object : legacyObjects) {
+                visible += object.m_transform.m_translation.x > 0.f;
+            }
+            legacyVisible = visible;
+        });
+        const double storeBounds = nanosecondsPerEntity(entityCount, iterations, [&]() {
+            size_t visible = 0;
+            for (TransformId transformId : entities.getTransformIds()) {
+                visible += transforms.getTranslation(transformId).x > 0.f;
+            }
+            storeVisible = visible;
+        });
+        assert(legacyVisible == storeVisible && "The layouts were filled with different scenes");
+        sink = sink + legacyVisible + storeVisible;
+
+        // removes and re-adds a tenth of the entities
+        std::vector<EntityId> toDestroy{};
+        for (size_t i = 0; i < entityCount; i += 10) {
+            toDestroy.push_back(entities.getEntities()[i]);
+        }
+        const auto churnStart = std::chrono::high_resolution_clock::now();
+        for (EntityId entity : toDestroy) {
+            const TransformId transformId = entities.getTransformId(entity);
+            entities.destroy(entity);
+            entities.create(ModelHandle{}, MaterialHandle{}, transformId);
+        }
+        const double churnNanoseconds = std::chrono::duration<double, std::nano>(
+                std::chrono::high_resolution_clock::now() - churnStart).count() / static_cast<double>(toDestroy.size());
+
+        std::cout << "entity benchmark: " << entityCount << " entities, " << iterations << " iterations"
+                  << "\n  draw list walk: " << legacyDraw << " ns/entity with RenderObjects, "
+                  << storeDraw << " ns/entity with the entity store"
+                  << "\n  bounds pass:    " << legacyBounds << " ns/entity with RenderObjects, "
+                  << storeBounds << " ns/entity with the entity store"
+                  << "\n  destroy + create: " << churnNanoseconds << " ns" << std::endl;
+    }
+}
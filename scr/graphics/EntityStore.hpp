@@ -0,0 +1,58 @@
+#ifndef IRIS_ENTITYSTORE_HPP
+#define IRIS_ENTITYSTORE_HPP
+
+#include "AssetsManager.hpp"
+#include "TransformStore.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace iris::graphics{
+    // stays valid while the entity lives, the generation tells a destroyed entity from the one reusing its index
+    struct EntityId{
+        uint32_t m_index{UINT32_MAX};
+        uint32_t m_generation{};
+
+        bool operator==(const EntityId& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+        bool operator!=(const EntityId& other) const { return !(*this == other); }
+    };
+
+    // renderable entities stored as one tightly packed array per component, entry i of every array belongs to the same
+    // entity. Destroying an entity moves the last one into its place so the arrays never have holes, the entity ids map
+    // to the moving dense index. World matrices and bounds live in the TransformStore, indexed by the transform ids, models
+    // and materials are handles into the AssetsManager
+    class EntityStore {
+    public:
+        EntityId create(ModelHandle model, MaterialHandle material, TransformId transformId);
+        // O(1), changes the dense index of the last entity
+        void destroy(EntityId entity);
+        [[nodiscard]] bool isAlive(EntityId entity) const;
+
+        [[nodiscard]] size_t size() const { return m_entities.size(); }
+        [[nodiscard]] TransformId getTransformId(EntityId entity) const { return m_transformIds[denseIndex(entity)]; }
+        void setMaterial(EntityId entity, MaterialHandle material) { m_materials[denseIndex(entity)] = material; }
+
+        [[nodiscard]] const std::vector<EntityId>& getEntities() const { return m_entities; }
+        [[nodiscard]] const std::vector<TransformId>& getTransformIds() const { return m_transformIds; }
+        [[nodiscard]] const std::vector<ModelHandle>& getModels() const { return m_models; }
+        [[nodiscard]] const std::vector<MaterialHandle>& getMaterials() const { return m_materials; }
+
+        // times the hot loops over entityCount entities with this layout and with the former array of RenderObjects
+        static void benchmark(size_t entityCount, int iterations);
+    private:
+        // dense arrays
+        std::vector<EntityId> m_entities{};
+        std::vector<TransformId> m_transformIds{};
+        std::vector<ModelHandle> m_models{};
+        std::vector<MaterialHandle> m_materials{};
+
+        // indexed by EntityId::m_index
+        std::vector<uint32_t> m_denseIndices{};
+        std::vector<uint32_t> m_generations{};
+        std::vector<uint32_t> m_freeIndices{};
+
+        [[nodiscard]] uint32_t denseIndex(EntityId entity) const;
+    };
+}
+
+#endif //IRIS_ENTITYSTORE_HPP
@@ -0,0 +1,59 @@
+#include "FrameRingBuffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace iris::graphics{
+
+    FrameRingBuffer::FrameRingBuffer(Device &device, uint32_t frameCount, VkDeviceSize bytesPerFrame)
+    : m_rDevice{device} {
+        const VkPhysicalDeviceLimits limits = m_rDevice.getPhysicalDeviceProperties().limits;
+        m_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+        // keeps every frame region starting on an aligned offset
+        m_bytesPerFrame = (bytesPerFrame + m_alignment - 1) / m_alignment * m_alignment;
+        m_stats.m_bytesPerFrame = m_bytesPerFrame;
+
+        m_buffer = m_rDevice.createBuffer(m_bytesPerFrame * frameCount,
+                                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                          VMA_MEMORY_USAGE_CPU_TO_GPU,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    }
+
+    FrameRingBuffer::~FrameRingBuffer() {
+        m_rDevice.destroyBuffer(m_buffer);
+    }
+
+    void FrameRingBuffer::beginFrame(uint32_t frameIndex) {
+        m_frameBegin = m_bytesPerFrame * frameIndex;
+        m_frameHead = 0;
+    }
+
+    void FrameRingBuffer::flush() {
+        const VkDeviceSize bytesUsed = m_frameHead.load();
+        m_stats.m_bytesUsed = bytesUsed;
+        m_stats.m_peakBytesUsed = std::max(m_stats.m_peakBytesUsed, bytesUsed);
+
+        if (bytesUsed > 0) {
+            vmaFlushAllocation(m_rDevice.getAllocator(), m_buffer.m_allocation, m_frameBegin, bytesUsed);
+        }
+    }
+
+    void FrameRingBuffer::flush(const RingAllocation &allocation, VkDeviceSize size) {
+        vmaFlushAllocation(m_rDevice.getAllocator(), m_buffer.m_allocation, allocation.m_offset, size);
+    }
+
+    RingAllocation FrameRingBuffer::allocate(VkDeviceSize size) {
+        const VkDeviceSize alignedSize = (size + m_alignment - 1) / m_alignment * m_alignment;
+        const VkDeviceSize offset = m_frameHead.fetch_add(alignedSize);
+
+        if (offset + alignedSize > m_bytesPerFrame) {
+            throw std::runtime_error("frame ring buffer is full, increase its size per frame");
+        }
+
+        RingAllocation allocation{};
+        allocation.m_offset = static_cast<uint32_t>(m_frameBegin + offset);
+        allocation.m_pData = static_cast<char*>(m_buffer.m_pMappedData) + m_frameBegin + offset;
+        return allocation;
+    }
+}
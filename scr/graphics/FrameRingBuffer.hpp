@@ -0,0 +1,66 @@
+#ifndef IRIS_FRAMERINGBUFFER_HPP
+#define IRIS_FRAMERINGBUFFER_HPP
+
+#include "Device.hpp"
+
+#include <atomic>
+
+namespace iris::graphics{
+    struct RingAllocation{
+        // offset from the start of the ring buffer, used as the dynamic offset when binding
+        uint32_t m_offset{};
+        void* m_pData{nullptr};
+    };
+
+    // persistently mapped host visible buffer split in one region per frame in flight, transient data of a frame is
+    // bump allocated in its region and the whole region is rewound once the GPU is done with that frame
+    class FrameRingBuffer {
+    public:
+        struct Stats{
+            // allocated in the region of the frame last flushed, each allocation rounded up to the alignment. The
+            // count starts over when the region is rewound for its next frame
+            VkDeviceSize m_bytesUsed{};
+            VkDeviceSize m_peakBytesUsed{}; // highest m_bytesUsed so far
+            VkDeviceSize m_bytesPerFrame{};
+        };
+
+        FrameRingBuffer(Device& device, uint32_t frameCount, VkDeviceSize bytesPerFrame);
+        ~FrameRingBuffer();
+
+        FrameRingBuffer(const FrameRingBuffer &) = delete;
+        FrameRingBuffer &operator=(const FrameRingBuffer &) = delete;
+
+        // rewinds the region of the frame, the frame's fence must have been waited on
+        void beginFrame(uint32_t frameIndex);
+        // makes the writes of the current frame visible to the device, a no-op on host coherent memory
+        void flush();
+        // makes a write to an allocation of the current frame made after flush visible
+        void flush(const RingAllocation& allocation, VkDeviceSize size);
+
+        // thread safe, the returned memory is only valid until the frame region is rewound
+        RingAllocation allocate(VkDeviceSize size);
+        template<typename T>
+        T* allocate(size_t count, RingAllocation& allocation){
+            allocation = allocate(sizeof(T) * count);
+            return static_cast<T*>(allocation.m_pData);
+        }
+
+        [[nodiscard]] VkBuffer getBuffer() const { return m_buffer.m_buffer; }
+        [[nodiscard]] VkDeviceSize getBytesPerFrame() const { return m_bytesPerFrame; }
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+    private:
+        Device& m_rDevice;
+
+        AllocatedBuffer m_buffer{};
+        VkDeviceSize m_bytesPerFrame{};
+        // every allocation is aligned so it can be bound as a uniform or a storage buffer
+        VkDeviceSize m_alignment{};
+
+        VkDeviceSize m_frameBegin{};
+        std::atomic<VkDeviceSize> m_frameHead{0};
+
+        Stats m_stats{};
+    };
+}
+
+#endif //IRIS_FRAMERINGBUFFER_HPP
@@ -0,0 +1,60 @@
+#include "GeometryPool.hpp"
+
+#include <numeric>
+#include <stdexcept>
+
+namespace iris::graphics{
+
+    GeometryPool::GeometryPool(Device &device, uint32_t maxVertices, uint32_t maxIndices)
+    : m_rDevice{device}, m_maxVertices{maxVertices}, m_maxIndices{maxIndices} {
+        // read as plain arrays by the shaders, filled with copies from the models' own buffers
+        m_vertexBuffer = m_rDevice.createBuffer(sizeof(Model::Vertex) * m_maxVertices,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY);
+        m_indexBuffer = m_rDevice.createBuffer(sizeof(uint32_t) * m_maxIndices,
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                               VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+
+    GeometryPool::~GeometryPool() {
+        m_rDevice.destroyBuffer(m_vertexBuffer);
+        m_rDevice.destroyBuffer(m_indexBuffer);
+    }
+
+    MeshRange GeometryPool::add(const Model &model) {
+        const uint32_t vertexCount = model.getVertexCount();
+        const uint32_t indexCount = model.hasIndexBuffer() ? model.getIndexCount() : vertexCount;
+        if (m_vertexCount + vertexCount > m_maxVertices || m_indexCount + indexCount > m_maxIndices) {
+            throw std::runtime_error("The geometry pool is full!");
+        }
+
+        const MeshRange range{m_indexCount, m_vertexCount};
+        const VkDeviceSize vertexBytes = sizeof(Model::Vertex) * vertexCount;
+        const VkDeviceSize indexBytes = sizeof(uint32_t) * indexCount;
+
+        AllocatedBuffer stagingBuffer{};
+        if (!model.hasIndexBuffer()) {
+            std::vector<uint32_t> indices(indexCount);
+            std::iota(indices.begin(), indices.end(), 0u);
+            stagingBuffer = m_rDevice.createBuffer(indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+            m_rDevice.copyToBuffer(indices.data(), stagingBuffer, indexBytes);
+        }
+
+        m_rDevice.immediateSubmit([&](VkCommandBuffer cmd) {
+            VkBufferCopy vertexCopy{0, sizeof(Model::Vertex) * range.m_vertexOffset, vertexBytes};
+            vkCmdCopyBuffer(cmd, model.getVertexBuffer(), m_vertexBuffer.m_buffer, 1, &vertexCopy);
+
+            VkBufferCopy indexCopy{0, sizeof(uint32_t) * range.m_firstIndex, indexBytes};
+            vkCmdCopyBuffer(cmd, model.hasIndexBuffer() ? model.getIndexBuffer() : stagingBuffer.m_buffer,
+                            m_indexBuffer.m_buffer, 1, &indexCopy);
+        });
+
+        if (!model.hasIndexBuffer()) {
+            m_rDevice.destroyBuffer(stagingBuffer);
+        }
+
+        m_vertexCount += vertexCount;
+        m_indexCount += indexCount;
+        return range;
+    }
+}
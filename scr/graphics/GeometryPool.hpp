@@ -0,0 +1,41 @@
+#ifndef IRIS_GEOMETRYPOOL_HPP
+#define IRIS_GEOMETRYPOOL_HPP
+
+#include "Model.hpp"
+
+namespace iris::graphics{
+    // where a model's vertices and indices start in the pool's buffers
+    struct MeshRange{
+        uint32_t m_firstIndex{};
+        uint32_t m_vertexOffset{};
+    };
+
+    // two device local buffers every model's vertices and indices are appended to when it is loaded, for the passes
+    // fetching vertices by hand instead of binding a model. The space of an unloaded model is not reclaimed
+    class GeometryPool {
+    public:
+        GeometryPool(Device& device, uint32_t maxVertices, uint32_t maxIndices);
+        ~GeometryPool();
+
+        GeometryPool(const GeometryPool &) = delete;
+        GeometryPool &operator=(const GeometryPool &) = delete;
+
+        // copies the model's vertices and indices at the end of the buffers and waits for the copy, a model without an
+        // index buffer gets a 0..n-1 list so every triangle is found the same way
+        MeshRange add(const Model& model);
+
+        [[nodiscard]] VkBuffer getVertexBuffer() const { return m_vertexBuffer.m_buffer; }
+        [[nodiscard]] VkBuffer getIndexBuffer() const { return m_indexBuffer.m_buffer; }
+    private:
+        Device& m_rDevice;
+
+        AllocatedBuffer m_vertexBuffer{};
+        AllocatedBuffer m_indexBuffer{};
+        uint32_t m_maxVertices{};
+        uint32_t m_maxIndices{};
+        uint32_t m_vertexCount{};
+        uint32_t m_indexCount{};
+    };
+}
+
+#endif //IRIS_GEOMETRYPOOL_HPP
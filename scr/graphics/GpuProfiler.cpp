@@ -0,0 +1,177 @@
+#include "GpuProfiler.hpp"
+#include "Debugger.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace iris::graphics{
+
+    GpuProfiler::GpuProfiler(Device &device, uint32_t frameCount, uint32_t maxScopesPerFrame)
+    : m_rDevice{device}, m_maxScopesPerFrame{maxScopesPerFrame} {
+        const VkPhysicalDeviceLimits limits = m_rDevice.getPhysicalDeviceProperties().limits;
+        // timestamps are given in ticks of timestampPeriod nanoseconds
+        m_millisecondsPerTick = static_cast<double>(limits.timestampPeriod) / 1e6;
+        m_supported = limits.timestampComputeAndGraphics == VK_TRUE;
+        m_frameScopes.resize(frameCount);
+        m_timestamps.resize(m_maxScopesPerFrame * 2);
+        m_frameStatistics.resize(frameCount, false);
+
+        const VkPhysicalDeviceFeatures& features = m_rDevice.getEnabledFeatures();
+        m_statisticsSupported = features.pipelineStatisticsQuery == VK_TRUE && features.inheritedQueries == VK_TRUE;
+        if (m_statisticsSupported) {
+            VkQueryPoolCreateInfo statisticsPoolInfo{};
+            statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsPoolInfo.queryCount = frameCount;
+            statisticsPoolInfo.pipelineStatistics = m_cStatisticFlags;
+            Debugger::vkCheck(vkCreateQueryPool(m_rDevice.getDevice(), &statisticsPoolInfo, nullptr, &m_statisticsQueryPool),
+                              "Failed to create pipeline statistics query pool!");
+        }
+        else {
+            std::cout << "Pipeline statistics queries are not supported, fragment invocations are not counted" << std::endl;
+        }
+
+        if (!m_supported) {
+            std::cout << "GPU timestamps are not supported, GPU timings are disabled" << std::endl;
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = frameCount * m_maxScopesPerFrame * 2;
+        Debugger::vkCheck(vkCreateQueryPool(m_rDevice.getDevice(), &queryPoolInfo, nullptr, &m_queryPool),
+                          "Failed to create timestamp query pool!");
+        calibrate();
+    }
+
+    void GpuProfiler::calibrate() {
+        double smallestOffsetMs = 0.0;
+        for (uint32_t i = 0; i < m_cCalibrationTries; i++) {
+            std::chrono::steady_clock::time_point submitTime{};
+            // the queries are reset by the frames, the first one is borrowed before any frame is recorded
+            m_rDevice.immediateSubmit([&](VkCommandBuffer cmd) {
+                vkCmdResetQueryPool(cmd, m_queryPool, 0, 1);
+                vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 0);
+                submitTime = std::chrono::steady_clock::now();
+            });
+            uint64_t timestamp = 0;
+            Debugger::vkCheck(vkGetQueryPoolResults(m_rDevice.getDevice(), m_queryPool, 0, 1, sizeof(uint64_t), &timestamp,
+                                                    sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT),
+                              "Failed to read calibration timestamp!");
+            const double gpuMs = static_cast<double>(timestamp) * m_millisecondsPerTick;
+            const double cpuMs = std::chrono::duration<double, std::milli>(submitTime.time_since_epoch()).count();
+            // the timestamp is written after the clock was read, the offset is at most this
+            const double offsetMs = gpuMs - cpuMs;
+            smallestOffsetMs = i == 0 ? offsetMs : std::min(smallestOffsetMs, offsetMs);
+        }
+        m_gpuToCpuOffsetMs = smallestOffsetMs;
+    }
+
+    bool GpuProfiler::getFrameEndTime(std::chrono::steady_clock::time_point &time) const {
+        if (!m_frameEndRead) {
+            return false;
+        }
+        const double cpuMs = static_cast<double>(m_previousFrameEnd) * m_millisecondsPerTick - m_gpuToCpuOffsetMs;
+        time = std::chrono::steady_clock::time_point{std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(cpuMs))};
+        return true;
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        vkDestroyQueryPool(m_rDevice.getDevice(), m_queryPool, nullptr);
+        vkDestroyQueryPool(m_rDevice.getDevice(), m_statisticsQueryPool, nullptr);
+    }
+
+    void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+        m_currentFrame = frameIndex;
+        m_frameEndRead = false;
+        if (m_statisticsSupported) {
+            if (m_frameStatistics[frameIndex]) {
+                uint64_t fragmentInvocations = 0;
+                const VkResult result = vkGetQueryPoolResults(m_rDevice.getDevice(), m_statisticsQueryPool, frameIndex, 1,
+                                                              sizeof(uint64_t), &fragmentInvocations, sizeof(uint64_t),
+                                                              VK_QUERY_RESULT_64_BIT);
+                if (result == VK_SUCCESS) {
+                    m_fragmentInvocations = fragmentInvocations;
+                }
+            }
+            m_frameStatistics[frameIndex] = false;
+            vkCmdResetQueryPool(cmd, m_statisticsQueryPool, frameIndex, 1);
+        }
+
+        if (!m_supported) {
+            return;
+        }
+
+        auto& scopes = m_frameScopes[frameIndex];
+        if (!scopes.empty()) {
+            const auto queryCount = static_cast<uint32_t>(scopes.size() * 2);
+            // the frame's fence was signaled, the results are available and reading them does not wait
+            const VkResult result = vkGetQueryPoolResults(m_rDevice.getDevice(), m_queryPool, firstQuery(frameIndex), queryCount,
+                                                          queryCount * sizeof(uint64_t), m_timestamps.data(), sizeof(uint64_t),
+                                                          VK_QUERY_RESULT_64_BIT);
+            if (result == VK_SUCCESS) {
+                const uint64_t frameBegin = m_timestamps[2 * m_cFrameScope];
+                const uint64_t frameEnd = m_timestamps[2 * m_cFrameScope + 1];
+                m_frameMilliseconds = static_cast<double>(frameEnd - frameBegin) * m_millisecondsPerTick;
+                m_timings.resize(scopes.size() - 1);
+                for (size_t i = 1; i < scopes.size(); i++) {
+                    m_timings[i - 1].m_name = scopes[i];
+                    m_timings[i - 1].m_milliseconds = static_cast<double>(m_timestamps[2 * i + 1] - m_timestamps[2 * i]) * m_millisecondsPerTick;
+                }
+                // with several frames in flight the next frame can begin before the previous one ends
+                if (m_previousFrameEnd != 0) {
+                    m_idleMilliseconds = frameBegin > m_previousFrameEnd
+                                       ? static_cast<double>(frameBegin - m_previousFrameEnd) * m_millisecondsPerTick : 0.0;
+                }
+                m_previousFrameEnd = frameEnd;
+                m_frameEndRead = true;
+            }
+        }
+
+        scopes.clear();
+        vkCmdResetQueryPool(cmd, m_queryPool, firstQuery(frameIndex), m_maxScopesPerFrame * 2);
+        beginScope(cmd, "frame");
+    }
+
+    void GpuProfiler::endFrame(VkCommandBuffer cmd) {
+        if (m_supported) {
+            assert(!m_frameScopes[m_currentFrame].empty() && "The frame was not begun");
+            endScope(cmd, m_cFrameScope);
+        }
+    }
+
+    uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char *name) {
+        auto& scopes = m_frameScopes[m_currentFrame];
+        assert(scopes.size() < m_maxScopesPerFrame && "Too many GPU scopes in a frame");
+        const auto scope = static_cast<uint32_t>(scopes.size());
+        scopes.push_back(name);
+        if (m_supported) {
+            vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, firstQuery(m_currentFrame) + 2 * scope);
+        }
+        return scope;
+    }
+
+    void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope) {
+        if (m_supported) {
+            // written once every command before it has completed
+            vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, firstQuery(m_currentFrame) + 2 * scope + 1);
+        }
+    }
+
+    void GpuProfiler::beginStatistics(VkCommandBuffer cmd) {
+        if (m_statisticsSupported) {
+            assert(!m_frameStatistics[m_currentFrame] && "Pipeline statistics are counted once per frame");
+            vkCmdBeginQuery(cmd, m_statisticsQueryPool, m_currentFrame, 0);
+            m_frameStatistics[m_currentFrame] = true;
+        }
+    }
+
+    void GpuProfiler::endStatistics(VkCommandBuffer cmd) {
+        if (m_statisticsSupported) {
+            vkCmdEndQuery(cmd, m_statisticsQueryPool, m_currentFrame);
+        }
+    }
+}
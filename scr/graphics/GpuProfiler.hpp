@@ -0,0 +1,97 @@
+#ifndef IRIS_GPUPROFILER_HPP
+#define IRIS_GPUPROFILER_HPP
+
+#include "Device.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace iris::graphics{
+    // measures the GPU time of scopes of a frame with timestamp queries. Every frame in flight owns its queries, their
+    // results are read back when the frame comes around again, so the timings lag the recorded frame by the number of
+    // frames in flight and reading them never stalls
+    class GpuProfiler {
+    public:
+        struct ScopeTiming{
+            const char* m_name{};
+            double m_milliseconds{};
+        };
+
+        GpuProfiler(Device& device, uint32_t frameCount, uint32_t maxScopesPerFrame = 16);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+        // reads the timings the frame's queries hold and resets them, the frame's fence must have been waited on. The
+        // frame is timed as a whole from here to endFrame, which is recorded last in the command buffer
+        void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+        void endFrame(VkCommandBuffer cmd);
+        // timestamps cannot be written inside a subpass recorded with secondary command buffers, scopes are put
+        // around render passes. name must outlive the profiler, string literals are expected
+        uint32_t beginScope(VkCommandBuffer cmd, const char* name);
+        void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+        // counts the fragment shader invocations between the two calls, at most once per frame. Like timestamps the
+        // query is begun and ended outside render passes, the secondary command buffers executed meanwhile must
+        // inherit getStatisticFlags()
+        void beginStatistics(VkCommandBuffer cmd);
+        void endStatistics(VkCommandBuffer cmd);
+        [[nodiscard]] VkQueryPipelineStatisticFlags getStatisticFlags() const { return m_statisticsSupported ? m_cStatisticFlags : 0; }
+
+        // timings of the last frame that finished on the GPU, in the order its scopes began. Scopes can be nested,
+        // their sum is not the frame time
+        [[nodiscard]] const std::vector<ScopeTiming>& getTimings() const { return m_timings; }
+        // GPU time of that frame from beginFrame to endFrame, 0 until a frame came back or without timestamps
+        [[nodiscard]] double getFrameMilliseconds() const { return m_frameMilliseconds; }
+        // time the GPU spent between the end of a frame and the beginning of the next one, for the last two frames
+        // that finished. 0 until two frames came back
+        [[nodiscard]] double getIdleMilliseconds() const { return m_idleMilliseconds; }
+        // when the frame read back by the last beginFrame ended on the GPU, on the steady clock. False when that frame
+        // had no scopes or without timestamps
+        bool getFrameEndTime(std::chrono::steady_clock::time_point& time) const;
+        [[nodiscard]] bool isSupported() const { return m_supported; }
+        // fragment shader invocations of the last finished frame that counted them, 0 without statistics support
+        [[nodiscard]] uint64_t getFragmentInvocations() const { return m_fragmentInvocations; }
+        [[nodiscard]] bool isStatisticsSupported() const { return m_statisticsSupported; }
+    private:
+        Device& m_rDevice;
+
+        VkQueryPool m_queryPool{VK_NULL_HANDLE};
+        uint32_t m_maxScopesPerFrame{};
+        double m_millisecondsPerTick{};
+        bool m_supported{};
+
+        // scopes recorded in each frame, the two queries of scope i are at 2 * i and 2 * i + 1 of the frame's range.
+        // Scope 0 is the whole frame
+        std::vector<std::vector<const char*>> m_frameScopes{};
+        uint32_t m_currentFrame{};
+        static constexpr uint32_t m_cFrameScope = 0;
+
+        std::vector<ScopeTiming> m_timings{};
+        double m_frameMilliseconds{};
+        std::vector<uint64_t> m_timestamps{};
+        // the frames are read back in submission order, the end of the previous one is kept for the next
+        uint64_t m_previousFrameEnd{};
+        double m_idleMilliseconds{};
+        bool m_frameEndRead{};
+
+        // the GPU timestamps are moved to the steady clock by this offset. Without calibrated timestamps it is
+        // measured by submitting a timestamp right after reading the clock, the smallest difference of a few tries
+        // is the closest to the submission overhead being 0
+        static constexpr uint32_t m_cCalibrationTries = 5;
+        double m_gpuToCpuOffsetMs{};
+        void calibrate();
+
+        static constexpr VkQueryPipelineStatisticFlags m_cStatisticFlags = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        // one statistics query per frame, whether the frame recorded it
+        VkQueryPool m_statisticsQueryPool{VK_NULL_HANDLE};
+        std::vector<bool> m_frameStatistics{};
+        uint64_t m_fragmentInvocations{};
+        bool m_statisticsSupported{};
+
+        [[nodiscard]] uint32_t firstQuery(uint32_t frameIndex) const { return frameIndex * m_maxScopesPerFrame * 2; }
+    };
+}
+
+#endif //IRIS_GPUPROFILER_HPP
@@ -73,15 +73,27 @@ namespace iris::graphics{
     }
 
     VkCommandBufferAllocateInfo
-    Initializers::createCommandBufferAllocateInfo(VkCommandPool commandPool, uint32_t commandBufferCount) {
+    Initializers::createCommandBufferAllocateInfo(VkCommandPool commandPool, uint32_t commandBufferCount,
+                                                  VkCommandBufferLevel level) {
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = commandPool; // the command pool to allocate the command buffers from
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // the type of command buffer we want to allocate
+        allocInfo.level = level; // the type of command buffer we want to allocate
         allocInfo.commandBufferCount = commandBufferCount; // the number of command buffers to allocate
         return allocInfo;
     }
 
+    VkCommandBufferInheritanceInfo
+    Initializers::createCommandBufferInheritanceInfo(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer) {
+        VkCommandBufferInheritanceInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        info.pNext = nullptr;
+        info.renderPass = renderPass; // render pass the secondary command buffer will be executed in
+        info.subpass = subpass; // subpass the secondary command buffer will be executed in
+        info.framebuffer = framebuffer; // optional, knowing it lets the driver optimize the recorded commands
+        return info;
+    }
+
     VkCommandBufferBeginInfo Initializers::createCommandBufferBeginInfo(VkCommandBufferUsageFlags flags){
         VkCommandBufferBeginInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
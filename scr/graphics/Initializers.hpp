@@ -20,7 +20,9 @@ namespace iris::graphics{
                                                                  VkPhysicalDeviceFeatures& deviceFeatures,
                                                                  bool enableValidationLayers);
         [[nodiscard]] static VkCommandPoolCreateInfo createCommandPoolInfo(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags);
-        [[nodiscard]] static VkCommandBufferAllocateInfo createCommandBufferAllocateInfo(VkCommandPool commandPool, uint32_t commandBufferCount);
+        [[nodiscard]] static VkCommandBufferAllocateInfo createCommandBufferAllocateInfo(VkCommandPool commandPool, uint32_t commandBufferCount,
+                                                                                           VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        [[nodiscard]] static VkCommandBufferInheritanceInfo createCommandBufferInheritanceInfo(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer);
         [[nodiscard]] static VkCommandBufferBeginInfo createCommandBufferBeginInfo(VkCommandBufferUsageFlags flags = 0);
         [[nodiscard]] static VkRenderPassCreateInfo createRenderPassInfo(const std::vector<VkAttachmentDescription>& attachments,
                                                                          const std::vector<VkSubpassDescription>& subpasses,
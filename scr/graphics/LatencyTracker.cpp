@@ -0,0 +1,144 @@
+#include "LatencyTracker.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace iris::graphics{
+
+    double LatencyTracker::FrameRecord::getInputToPhotonMs() const {
+        const double input = get(Stage::InputSampled);
+        const double photon = std::max(get(Stage::GpuDone), get(Stage::Presented));
+        if (input < 0.0 || get(Stage::Presented) < 0.0) {
+            return -1.0;
+        }
+        return photon - input;
+    }
+
+    LatencyTracker::LatencyTracker(size_t windowSize)
+    : m_start{std::chrono::steady_clock::now()}, m_windowSize{windowSize} {}
+
+    void LatencyTracker::mark(uint64_t frameId, Stage stage) {
+        mark(frameId, stage, std::chrono::steady_clock::now());
+    }
+
+    void LatencyTracker::mark(uint64_t frameId, Stage stage, std::chrono::steady_clock::time_point time) {
+        FrameRecord* pRecord = getPending(frameId);
+        if (pRecord == nullptr) {
+            return;
+        }
+        pRecord->m_ms[static_cast<size_t>(stage)] = std::chrono::duration<double, std::milli>(time - m_start).count();
+        completeFrames(frameId);
+    }
+
+    LatencyTracker::FrameRecord* LatencyTracker::getPending(uint64_t frameId) {
+        if (!m_records.empty() && frameId <= m_records.back().m_frameId) {
+            return nullptr;
+        }
+        // few frames are pending, the newest is usually the one marked
+        for (auto it = m_pending.rbegin(); it != m_pending.rend(); ++it) {
+            if (it->m_frameId == frameId) {
+                return &*it;
+            }
+            if (it->m_frameId < frameId) {
+                break;
+            }
+        }
+        FrameRecord record{};
+        record.m_frameId = frameId;
+        record.m_ms.fill(-1.0);
+        // the frame ids only grow, a frame marked late is inserted at its place
+        auto position = std::find_if(m_pending.begin(), m_pending.end(),
+                                     [frameId](const FrameRecord& pending) { return pending.m_frameId > frameId; });
+        return &*m_pending.insert(position, record);
+    }
+
+    void LatencyTracker::completeFrames(uint64_t latestFrameId) {
+        while (!m_pending.empty()) {
+            const FrameRecord& front = m_pending.front();
+            const bool presented = front.get(Stage::Presented) >= 0.0;
+            const bool gpuDone = front.get(Stage::GpuDone) >= 0.0 || !m_gpuTimestamps;
+            const bool stale = front.m_frameId + m_cMaxPendingFrames < latestFrameId;
+            if (!(presented && gpuDone) && !stale) {
+                break;
+            }
+            m_records.push_back(front);
+            m_pending.pop_front();
+            if (m_records.size() > m_cMaxRecords) {
+                m_records.pop_front();
+            }
+        }
+    }
+
+    LatencyTracker::Stats LatencyTracker::getStats() const {
+        Stats stats{};
+        std::vector<double> inputToSubmit;
+        std::vector<double> inputToGpuDone;
+        std::vector<double> inputToPhoton;
+        const size_t first = m_records.size() > m_windowSize ? m_records.size() - m_windowSize : 0;
+        for (size_t i = first; i < m_records.size(); i++) {
+            const FrameRecord& record = m_records[i];
+            const double input = record.get(Stage::InputSampled);
+            if (input < 0.0) {
+                continue;
+            }
+            if (record.get(Stage::Submitted) >= 0.0) {
+                inputToSubmit.push_back(record.get(Stage::Submitted) - input);
+            }
+            if (record.get(Stage::GpuDone) >= 0.0) {
+                inputToGpuDone.push_back(record.get(Stage::GpuDone) - input);
+            }
+            const double photon = record.getInputToPhotonMs();
+            if (photon >= 0.0) {
+                inputToPhoton.push_back(photon);
+            }
+            stats.m_frames++;
+        }
+        stats.m_inputToSubmit = computePercentiles(inputToSubmit);
+        stats.m_inputToGpuDone = computePercentiles(inputToGpuDone);
+        stats.m_inputToPhoton = computePercentiles(inputToPhoton);
+        return stats;
+    }
+
+    LatencyTracker::Percentiles LatencyTracker::computePercentiles(std::vector<double> &samples) {
+        Percentiles percentiles{};
+        if (samples.empty()) {
+            return percentiles;
+        }
+        // nearest rank, the window is small enough to be sorted
+        std::sort(samples.begin(), samples.end());
+        const auto rank = [&samples](double percentile) {
+            const auto index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1) + 0.5);
+            return samples[index];
+        };
+        percentiles.m_p50 = rank(0.5);
+        percentiles.m_p90 = rank(0.9);
+        percentiles.m_p99 = rank(0.99);
+        percentiles.m_max = samples.back();
+        return percentiles;
+    }
+
+    bool LatencyTracker::exportCsv(const std::string &filePath) const {
+        std::ofstream file{filePath};
+        if (!file) {
+            return false;
+        }
+        file << "frame,input_sampled_ms,simulation_done_ms,recording_done_ms,submitted_ms,gpu_done_ms,presented_ms,"
+                "input_to_photon_ms\n";
+        for (const FrameRecord& record : m_records) {
+            file << record.m_frameId;
+            for (double ms : record.m_ms) {
+                file << ',';
+                // an empty field for the stages that were not measured
+                if (ms >= 0.0) {
+                    file << ms;
+                }
+            }
+            file << ',';
+            if (record.getInputToPhotonMs() >= 0.0) {
+                file << record.getInputToPhotonMs();
+            }
+            file << '\n';
+        }
+        return static_cast<bool>(file);
+    }
+}
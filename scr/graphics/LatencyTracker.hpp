@@ -0,0 +1,89 @@
+#ifndef IRIS_LATENCYTRACKER_HPP
+#define IRIS_LATENCYTRACKER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace iris::graphics{
+    // times the stages of every frame on the steady clock, from the moment its input was polled to its presentation,
+    // correlated by frame id. The GPU end of a frame is only read back with its timestamps once the frame's slot
+    // comes around again, a frame is complete once it is known. Percentiles are taken over the last completed frames
+    class LatencyTracker {
+    public:
+        // in the order a frame goes through them
+        enum class Stage{
+            InputSampled,
+            SimulationDone,
+            RecordingDone,
+            Submitted,
+            GpuDone,
+            // vkQueuePresentKHR returned. The scan out is not observable without a present timing extension, the image
+            // cannot be shown before the GPU finished it nor before it was queued
+            Presented
+        };
+        static constexpr size_t m_cStageCount = 6;
+
+        struct FrameRecord{
+            uint64_t m_frameId{};
+            // milliseconds since the tracker was created, negative when the stage was not measured
+            std::array<double, m_cStageCount> m_ms{};
+
+            [[nodiscard]] double get(Stage stage) const { return m_ms[static_cast<size_t>(stage)]; }
+            // from the input to the latest of the GPU end and the presentation, negative when unknown
+            [[nodiscard]] double getInputToPhotonMs() const;
+        };
+
+        struct Percentiles{
+            double m_p50{};
+            double m_p90{};
+            double m_p99{};
+            double m_max{};
+        };
+
+        struct Stats{
+            // completed frames the percentiles are taken over
+            size_t m_frames{};
+            Percentiles m_inputToSubmit{};
+            Percentiles m_inputToGpuDone{};
+            Percentiles m_inputToPhoton{};
+        };
+
+        explicit LatencyTracker(size_t windowSize = 512);
+
+        // the stage of frameId happens now
+        void mark(uint64_t frameId, Stage stage);
+        void mark(uint64_t frameId, Stage stage, std::chrono::steady_clock::time_point time);
+        // without GPU timestamps the frames are complete once presented
+        void setGpuTimestampsAvailable(bool available) { m_gpuTimestamps = available; }
+
+        // computed over the window when asked, the stats are printed about once per second
+        [[nodiscard]] Stats getStats() const;
+        // the completed frames, the oldest are dropped past m_cMaxRecords
+        [[nodiscard]] const std::deque<FrameRecord>& getRecords() const { return m_records; }
+        // one line per completed frame with the time of each stage, false when the file cannot be written
+        bool exportCsv(const std::string& filePath) const;
+    private:
+        static constexpr size_t m_cMaxRecords = 1 << 16;
+        // a frame whose GPU end never comes back, one without timestamp scopes, is completed after this many frames
+        static constexpr uint64_t m_cMaxPendingFrames = 16;
+
+        std::chrono::steady_clock::time_point m_start{};
+        size_t m_windowSize{};
+        bool m_gpuTimestamps{true};
+
+        // in frame id order
+        std::deque<FrameRecord> m_pending{};
+        std::deque<FrameRecord> m_records{};
+        // null when the frame was already completed
+        FrameRecord* getPending(uint64_t frameId);
+        void completeFrames(uint64_t latestFrameId);
+
+        [[nodiscard]] static Percentiles computePercentiles(std::vector<double>& samples);
+    };
+}
+
+#endif //IRIS_LATENCYTRACKER_HPP
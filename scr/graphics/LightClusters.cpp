@@ -0,0 +1,279 @@
+#include "LightClusters.hpp"
+#include "../utilities/ThreadPool.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define IRIS_LIGHT_CLUSTERS_SIMD
+#include <xmmintrin.h>
+#endif
+
+namespace iris::graphics{
+    // rows are loaded four clusters at a time
+    static_assert(LightClusters::m_cTilesX % 4 == 0, "Tile count in x must be a multiple of 4");
+
+    void LightClusters::setProjection(const glm::mat4 &projection, float near, float far) {
+        if (projection == m_projection && near == m_near && far == m_far) {
+            return;
+        }
+        m_projection = projection;
+        m_near = near;
+        m_far = far;
+
+        const float logDepthRange = std::log(far / near);
+        m_sliceScale = static_cast<float>(m_cSlices) / logDepthRange;
+        m_sliceBias = -static_cast<float>(m_cSlices) * std::log(near) / logDepthRange;
+
+        m_minX.resize(m_cClusterCount); m_minY.resize(m_cClusterCount); m_minZ.resize(m_cClusterCount);
+        m_maxX.resize(m_cClusterCount); m_maxY.resize(m_cClusterCount); m_maxZ.resize(m_cClusterCount);
+
+        // a view position at depth d lands on ndc * d / scale, the scales are taken from the projection so a flipped
+        // axis is handled too
+        const float scaleX = projection[0][0];
+        const float scaleY = projection[1][1];
+        for (uint32_t z = 0; z < m_cSlices; z++) {
+            const float nearDepth = near * std::pow(far / near, static_cast<float>(z) / m_cSlices);
+            const float farDepth = near * std::pow(far / near, static_cast<float>(z + 1) / m_cSlices);
+            for (uint32_t y = 0; y < m_cTilesY; y++) {
+                const float ndcY[] = { 2.f * y / m_cTilesY - 1.f, 2.f * (y + 1) / m_cTilesY - 1.f };
+                for (uint32_t x = 0; x < m_cTilesX; x++) {
+                    const float ndcX[] = { 2.f * x / m_cTilesX - 1.f, 2.f * (x + 1) / m_cTilesX - 1.f };
+                    const uint32_t cluster = clusterIndex(x, y, z);
+
+                    m_minX[cluster] = m_minY[cluster] = std::numeric_limits<float>::max();
+                    m_maxX[cluster] = m_maxY[cluster] = std::numeric_limits<float>::lowest();
+                    for (float depth : {nearDepth, farDepth}) {
+                        for (int corner = 0; corner < 2; corner++) {
+                            const float viewX = ndcX[corner] * depth / scaleX;
+                            const float viewY = ndcY[corner] * depth / scaleY;
+                            m_minX[cluster] = std::min(m_minX[cluster], viewX);
+                            m_maxX[cluster] = std::max(m_maxX[cluster], viewX);
+                            m_minY[cluster] = std::min(m_minY[cluster], viewY);
+                            m_maxY[cluster] = std::max(m_maxY[cluster], viewY);
+                        }
+                    }
+                    // the camera looks down -z
+                    m_minZ[cluster] = -farDepth;
+                    m_maxZ[cluster] = -nearDepth;
+                }
+            }
+        }
+    }
+
+    uint32_t LightClusters::sliceOf(float depth) const {
+        const float slice = std::log(std::max(depth, m_near)) * m_sliceScale + m_sliceBias;
+        return std::min(static_cast<uint32_t>(std::max(slice, 0.f)), m_cSlices - 1);
+    }
+
+    uint32_t LightClusters::tileOf(float ndc, uint32_t tileCount) const {
+        const float tile = (ndc * 0.5f + 0.5f) * static_cast<float>(tileCount);
+        return std::min(static_cast<uint32_t>(std::max(tile, 0.f)), tileCount - 1);
+    }
+
+    void LightClusters::computeLightBounds(const PointLight &light, const glm::mat4 &view, LightBounds &bounds) const {
+        const auto& data = light.m_gpuLightData;
+        bounds.m_center = glm::vec3(view * glm::vec4(data.m_lightPosition, 1.f));
+        bounds.m_radius = data.m_radius;
+
+        const float depth = -bounds.m_center.z;
+        const float radius = data.m_radius;
+        // empty range
+        bounds.m_minZ = 1;
+        bounds.m_maxZ = 0;
+        if (depth + radius < m_near || depth - radius > m_far) {
+            return;
+        }
+
+        // the sphere is inside the view space box around it, x / depth and y / depth over that box are extreme at its
+        // corners. Only the part past the near plane is visible
+        const float nearDepth = std::max(depth - radius, m_near);
+        const float farDepth = depth + radius;
+        float minNdc[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float maxNdc[2] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        for (int axis = 0; axis < 2; axis++) {
+            const float scale = m_projection[axis][axis];
+            for (float position : {bounds.m_center[axis] - radius, bounds.m_center[axis] + radius}) {
+                for (float cornerDepth : {nearDepth, farDepth}) {
+                    const float ndc = scale * position / cornerDepth;
+                    minNdc[axis] = std::min(minNdc[axis], ndc);
+                    maxNdc[axis] = std::max(maxNdc[axis], ndc);
+                }
+            }
+            if (maxNdc[axis] < -1.f || minNdc[axis] > 1.f) {
+                return;
+            }
+        }
+
+        bounds.m_minX = tileOf(minNdc[0], m_cTilesX);
+        bounds.m_maxX = tileOf(maxNdc[0], m_cTilesX);
+        bounds.m_minY = tileOf(minNdc[1], m_cTilesY);
+        bounds.m_maxY = tileOf(maxNdc[1], m_cTilesY);
+        bounds.m_minZ = sliceOf(nearDepth);
+        bounds.m_maxZ = sliceOf(farDepth);
+    }
+
+    void LightClusters::assignRow(uint32_t y, uint32_t z) {
+        // y and z bounds are shared by the whole row, only the distance along x changes from cluster to cluster
+        const uint32_t rowBegin = clusterIndex(0, y, z);
+        for (uint32_t lightIndex : m_rowLights[y + m_cTilesY * z]) {
+            const LightBounds& bounds = m_lightBounds[lightIndex];
+            const glm::vec3& center = bounds.m_center;
+            const float dy = std::max(m_minY[rowBegin] - center.y, 0.f) + std::max(center.y - m_maxY[rowBegin], 0.f);
+            const float dz = std::max(m_minZ[rowBegin] - center.z, 0.f) + std::max(center.z - m_maxZ[rowBegin], 0.f);
+            const float remaining = bounds.m_radius * bounds.m_radius - dy * dy - dz * dz;
+            if (remaining < 0.f) {
+                continue;
+            }
+
+#ifdef IRIS_LIGHT_CLUSTERS_SIMD
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 centerX = _mm_set1_ps(center.x);
+            const __m128 limit = _mm_set1_ps(remaining);
+            for (uint32_t x = bounds.m_minX & ~3u; x <= bounds.m_maxX; x += 4) {
+                const uint32_t cluster = rowBegin + x;
+                const __m128 minX = _mm_loadu_ps(&m_minX[cluster]);
+                const __m128 maxX = _mm_loadu_ps(&m_maxX[cluster]);
+                const __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, centerX), zero),
+                                             _mm_max_ps(_mm_sub_ps(centerX, maxX), zero));
+                const int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), limit));
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    if ((mask & (1 << lane)) && x + lane >= bounds.m_minX && x + lane <= bounds.m_maxX) {
+                        m_clusterLights[cluster + lane].push_back(lightIndex);
+                    }
+                }
+            }
+#else
+            for (uint32_t x = bounds.m_minX; x <= bounds.m_maxX; x++) {
+                const uint32_t cluster = rowBegin + x;
+                const float dx = std::max(m_minX[cluster] - center.x, 0.f) + std::max(center.x - m_maxX[cluster], 0.f);
+                if (dx * dx <= remaining) {
+                    m_clusterLights[cluster].push_back(lightIndex);
+                }
+            }
+#endif
+        }
+    }
+
+    void LightClusters::assign(const std::vector<PointLight> &lights, const glm::mat4 &view) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto& threadPool = utils::ThreadPool::instance();
+
+        m_lightBounds.resize(lights.size());
+        threadPool.parallelFor(lights.size(), 1024, [&](size_t first, size_t last, size_t) {
+            for (size_t i = first; i < last; i++) {
+                computeLightBounds(lights[i], view, m_lightBounds[i]);
+            }
+        });
+
+        // the containers keep their capacity from frame to frame
+        m_rowLights.resize(m_cTilesY * m_cSlices);
+        for (auto& rowLights : m_rowLights) {
+            rowLights.clear();
+        }
+        for (uint32_t i = 0; i < m_lightBounds.size(); i++) {
+            const LightBounds& bounds = m_lightBounds[i];
+            for (uint32_t z = bounds.m_minZ; z <= bounds.m_maxZ; z++) {
+                for (uint32_t y = bounds.m_minY; y <= bounds.m_maxY; y++) {
+                    m_rowLights[y + m_cTilesY * z].push_back(i);
+                }
+            }
+        }
+
+        m_clusterLights.resize(m_cClusterCount);
+        for (auto& clusterLights : m_clusterLights) {
+            clusterLights.clear();
+        }
+        // every row writes its own clusters only. Lights crowd the first slices, rows spread the work better than slices
+        threadPool.parallelFor(m_cTilesY * m_cSlices, 4, [&](size_t first, size_t last, size_t) {
+            for (size_t row = first; row < last; row++) {
+                assignRow(static_cast<uint32_t>(row % m_cTilesY), static_cast<uint32_t>(row / m_cTilesY));
+            }
+        });
+
+        m_clusters.resize(m_cClusterCount);
+        m_stats = Stats{};
+        m_stats.m_lightCount = static_cast<uint32_t>(lights.size());
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < m_cClusterCount; i++) {
+            const auto count = static_cast<uint32_t>(m_clusterLights[i].size());
+            const uint32_t kept = std::min(count, m_cMaxLightIndices - offset);
+            m_clusters[i] = GpuLightCluster{offset, kept};
+            offset += kept;
+            m_stats.m_maxLightsPerCluster = std::max(m_stats.m_maxLightsPerCluster, count);
+            m_stats.m_droppedLightIndices += count - kept;
+        }
+        m_stats.m_lightIndexCount = offset;
+        m_stats.m_assignmentTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void LightClusters::writeLightIndices(uint32_t *pLightIndices) const {
+        utils::ThreadPool::instance().parallelFor(m_clusters.size(), 256, [&](size_t first, size_t last, size_t) {
+            for (size_t i = first; i < last; i++) {
+                std::memcpy(pLightIndices + m_clusters[i].m_offset, m_clusterLights[i].data(),
+                            m_clusters[i].m_count * sizeof(uint32_t));
+            }
+        });
+    }
+
+    void LightClusters::benchmark(size_t lightCount, int iterations) {
+        constexpr float near = 0.1f;
+        constexpr float far = 100.f;
+        const glm::mat4 projection = glm::perspective(glm::radians(45.f), 16.f / 9.f, near, far);
+        const glm::mat4 view{1.f};
+
+        // small lights spread through the frustum, the camera looks down -z from the origin
+        std::mt19937 generator{42};
+        std::uniform_real_distribution<float> depthDistribution{1.f, far};
+        std::uniform_real_distribution<float> unitDistribution{-1.f, 1.f};
+        std::uniform_real_distribution<float> intensityDistribution{0.001f, 0.01f};
+        std::vector<PointLight> lights{};
+        lights.reserve(lightCount);
+        for (size_t i = 0; i < lightCount; i++) {
+            const float depth = depthDistribution(generator);
+            const glm::vec3 position{unitDistribution(generator) * depth / projection[0][0],
+                                     unitDistribution(generator) * depth / projection[1][1],
+                                     -depth};
+            lights.emplace_back(position, glm::vec3{1.f}, intensityDistribution(generator));
+        }
+
+        LightClusters clusters{};
+        clusters.setProjection(projection, near, far);
+        std::vector<uint32_t> lightIndices(m_cMaxLightIndices);
+        double assignMs = 0.0;
+        double writeMs = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            clusters.assign(lights, view);
+            assignMs += clusters.getStats().m_assignmentTimeMs;
+
+            const auto writeStart = std::chrono::high_resolution_clock::now();
+            clusters.writeLightIndices(lightIndices.data());
+            writeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - writeStart).count();
+        }
+
+        const Stats& stats = clusters.getStats();
+        uint32_t usedClusters = 0;
+        for (const auto& cluster : clusters.getClusters()) {
+            usedClusters += cluster.m_count > 0;
+        }
+        std::cout << "light cluster benchmark: " << lightCount << " lights, " << iterations << " iterations, "
+                  << utils::ThreadPool::instance().getConcurrency() << " threads"
+#ifdef IRIS_LIGHT_CLUSTERS_SIMD
+                  << " (simd)"
+#endif
+                  << "\n  assignment: " << assignMs / iterations << " ms, index upload: " << writeMs / iterations << " ms"
+                  << "\n  " << stats.m_lightIndexCount << " light indices, " << usedClusters << " of " << m_cClusterCount
+                  << " clusters lit, at most " << stats.m_maxLightsPerCluster << " lights per cluster"
+                  << "\n  lights shaded per fragment: "
+                  << (usedClusters > 0 ? static_cast<double>(stats.m_lightIndexCount) / usedClusters : 0.0)
+                  << " on average in a lit cluster instead of " << lightCount << std::endl;
+    }
+}
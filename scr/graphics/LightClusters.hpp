@@ -0,0 +1,91 @@
+#ifndef IRIS_LIGHTCLUSTERS_HPP
+#define IRIS_LIGHTCLUSTERS_HPP
+
+#include "Objects.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace iris::graphics{
+    // range of a cluster in the light index list
+    struct GpuLightCluster{
+        uint32_t m_offset{};
+        uint32_t m_count{};
+    };
+
+    // splits the view frustum in a 3d grid of clusters, screen tiles in x and y and exponential depth slices in z, and
+    // lists the point lights whose bounding sphere touches each cluster. The fragment shaders find their cluster from
+    // the pixel position and the view depth and only loop over the lights listed there
+    class LightClusters {
+    public:
+        static constexpr uint32_t m_cTilesX = 16;
+        static constexpr uint32_t m_cTilesY = 9;
+        static constexpr uint32_t m_cSlices = 24;
+        static constexpr uint32_t m_cClusterCount = m_cTilesX * m_cTilesY * m_cSlices;
+        // lights past this many indices are dropped from the clusters, keeps the frame ring usage bounded
+        static constexpr uint32_t m_cMaxLightIndices = 1024 * 1024;
+
+        struct Stats{
+            uint32_t m_lightCount{};
+            uint32_t m_lightIndexCount{};    // total entries of the light index list
+            uint32_t m_maxLightsPerCluster{};
+            uint32_t m_droppedLightIndices{};
+            double m_assignmentTimeMs{};
+        };
+
+        // rebuilds the view space bounds of the clusters when the projection or the depth range changed
+        void setProjection(const glm::mat4& projection, float near, float far);
+        // lists the lights touching each cluster, the lights are indexed like in the given vector
+        void assign(const std::vector<PointLight>& lights, const glm::mat4& view);
+
+        [[nodiscard]] const std::vector<GpuLightCluster>& getClusters() const { return m_clusters; }
+        [[nodiscard]] uint32_t getLightIndexCount() const { return m_stats.m_lightIndexCount; }
+        // copies the light index list of the last assign, pLightIndices must hold getLightIndexCount() entries
+        void writeLightIndices(uint32_t* pLightIndices) const;
+
+        // the shaders map a view depth d to the slice log(d) * scale + bias
+        [[nodiscard]] float getSliceScale() const { return m_sliceScale; }
+        [[nodiscard]] float getSliceBias() const { return m_sliceBias; }
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+
+        // times the assignment of lightCount lights spread in front of the camera
+        static void benchmark(size_t lightCount, int iterations);
+    private:
+        glm::mat4 m_projection{0.f};
+        float m_near{};
+        float m_far{};
+        float m_sliceScale{};
+        float m_sliceBias{};
+
+        // view space bounds of the clusters, one array per component so four clusters of a row are tested at once
+        std::vector<float> m_minX{}, m_minY{}, m_minZ{};
+        std::vector<float> m_maxX{}, m_maxY{}, m_maxZ{};
+
+        // view space sphere and cluster range of each light, an empty range when it is outside the frustum
+        struct LightBounds{
+            glm::vec3 m_center{};
+            float m_radius{};
+            uint32_t m_minX{}, m_maxX{}, m_minY{}, m_maxY{}, m_minZ{}, m_maxZ{};
+        };
+        std::vector<LightBounds> m_lightBounds{};
+        // lights overlapping each row of clusters, a row being the clusters of one tile row in one depth slice
+        std::vector<std::vector<uint32_t>> m_rowLights{};
+        // lights of each cluster, flattened by writeLightIndices
+        std::vector<std::vector<uint32_t>> m_clusterLights{};
+        std::vector<GpuLightCluster> m_clusters{};
+
+        Stats m_stats{};
+
+        [[nodiscard]] uint32_t sliceOf(float depth) const;
+        [[nodiscard]] uint32_t tileOf(float ndc, uint32_t tileCount) const;
+        void computeLightBounds(const PointLight& light, const glm::mat4& view, LightBounds& bounds) const;
+        // tests the lights of the row against its clusters
+        void assignRow(uint32_t y, uint32_t z);
+
+        [[nodiscard]] static uint32_t clusterIndex(uint32_t x, uint32_t y, uint32_t z) { return x + m_cTilesX * (y + m_cTilesY * z); }
+    };
+}
+
+#endif //IRIS_LIGHTCLUSTERS_HPP
@@ -24,31 +24,29 @@ namespace iris::graphics{
         vkDestroySampler(m_rDevice.getDevice(), m_sampler, nullptr);
     }
 
-    void Material::setTexture(const std::shared_ptr<Texture>& ambientTexture,
-                              const std::shared_ptr<Texture>& diffuseTexture,
-                              const std::shared_ptr<Texture>& specularTexture,
+    void Material::setTexture(const Texture& ambientTexture,
+                              const Texture& diffuseTexture,
+                              const Texture& specularTexture,
                               const DescriptorPool &pool, const DescriptorSetLayout &layout) {
 
-        pool.allocateDescriptor(layout.getDescriptorSetLayout(),
-                                m_textureSet);
-
-        m_pAmbientTexture = ambientTexture;
-        m_pDiffuseTexture = diffuseTexture;
-        m_pSpecularTexture = specularTexture;
+        // the set is allocated on the first call only, the later ones rewrite it
+        if (m_textureSet == VK_NULL_HANDLE) {
+            pool.allocateDescriptor(layout.getDescriptorSetLayout(), m_textureSet);
+        }
 
         VkDescriptorImageInfo ambientImageBufferInfo;
         ambientImageBufferInfo.sampler = m_sampler;
-        ambientImageBufferInfo.imageView = ambientTexture->m_imageView;
+        ambientImageBufferInfo.imageView = ambientTexture.m_imageView;
         ambientImageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkDescriptorImageInfo diffuseImageBufferInfo;
         diffuseImageBufferInfo.sampler = m_sampler;
-        diffuseImageBufferInfo.imageView = diffuseTexture->m_imageView;
+        diffuseImageBufferInfo.imageView = diffuseTexture.m_imageView;
         diffuseImageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkDescriptorImageInfo specularImageBufferInfo;
         specularImageBufferInfo.sampler = m_sampler;
-        specularImageBufferInfo.imageView = specularTexture->m_imageView;
+        specularImageBufferInfo.imageView = specularTexture.m_imageView;
         specularImageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkWriteDescriptorSet texture1 = Initializers::writeDescriptorImage(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_textureSet, &ambientImageBufferInfo, 0);
@@ -7,6 +7,7 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <memory>
+#include <utility>
 
 namespace iris::graphics{
     class Material {
@@ -16,15 +17,21 @@ namespace iris::graphics{
                  VkPipelineLayout layout, VkDescriptorSet texture = VK_NULL_HANDLE);
         ~Material();
 
-        void setTexture(const std::shared_ptr<Texture>& ambientTexture,
-                        const std::shared_ptr<Texture>& diffuseTexture,
-                        const std::shared_ptr<Texture>& specularTexture,
+        // the views are written in the set, AssetsManager::setMaterialTextures keeps the textures loaded while the
+        // material uses them. The set is allocated from pool on the first call and rewritten by the next ones, no
+        // frame in flight may be reading it
+        void setTexture(const Texture& ambientTexture,
+                        const Texture& diffuseTexture,
+                        const Texture& specularTexture,
                         const DescriptorPool& pool, const DescriptorSetLayout& layout);
 
         [[nodiscard]] const std::string& getName() const { return m_name; }
         [[nodiscard]] const VkDescriptorSet& getTextureSet() const { return m_textureSet; }
         [[nodiscard]] const std::shared_ptr<Pipeline>& getPipeline() const { return m_pipeline; }
         [[nodiscard]] const VkPipelineLayout& getPipeLineLayout() const { return m_pipeLineLayout; }
+        // same shaders and layout with an equal depth test and no depth writes, drawn after a depth pre-pass
+        void setDepthEqualPipeline(std::shared_ptr<Pipeline> pipeline) { m_depthEqualPipeline = std::move(pipeline); }
+        [[nodiscard]] const std::shared_ptr<Pipeline>& getDepthEqualPipeline() const { return m_depthEqualPipeline; }
     private:
         Device& m_rDevice;
 
@@ -32,13 +39,10 @@ namespace iris::graphics{
 
         VkSampler m_sampler{};
 
-        std::shared_ptr<Texture> m_pAmbientTexture;
-        std::shared_ptr<Texture> m_pDiffuseTexture;
-        std::shared_ptr<Texture> m_pSpecularTexture;
-
         VkDescriptorSet m_textureSet{VK_NULL_HANDLE}; //texture defaulted to null
 
         std::shared_ptr<Pipeline> m_pipeline;
+        std::shared_ptr<Pipeline> m_depthEqualPipeline{};
         VkPipelineLayout m_pipeLineLayout{};
     };
 }
@@ -83,6 +83,10 @@ namespace iris::graphics{
     {
         createVertexBuffers(builder.m_vertices);
         createIndexBuffers(builder.m_indices);
+
+        for (const auto& vertex : builder.m_vertices) {
+            m_bounds.expand(vertex.m_position);
+        }
     }
 
     Model::~Model(){
@@ -110,13 +114,13 @@ namespace iris::graphics{
         }
     }
 
-    void Model::draw(VkCommandBuffer commandBuffer)
+    void Model::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance)
     {
         if (m_hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, m_indexCount, 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, m_indexCount, 1, 0, 0, firstInstance);
         }
         else {
-            vkCmdDraw(commandBuffer, m_vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, m_vertexCount, 1, 0, firstInstance);
         }
     }
 
@@ -133,7 +137,7 @@ namespace iris::graphics{
         m_rDevice.copyToBuffer((void*)vertices.data(), stagingBuffer, bufferSize);
 
         m_vertexBuffer = m_rDevice.createBuffer(bufferSize,
-                                                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                                 VMA_MEMORY_USAGE_GPU_ONLY);
 
         m_rDevice.immediateSubmit([=](VkCommandBuffer cmd) {
@@ -165,7 +169,7 @@ namespace iris::graphics{
         m_rDevice.copyToBuffer((void*)indices.data(), stagingBuffer, bufferSize);
 
         m_indexBuffer = m_rDevice.createBuffer(bufferSize,
-                                                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                                VMA_MEMORY_USAGE_GPU_ONLY);
 
         m_rDevice.immediateSubmit([=](VkCommandBuffer cmd) {
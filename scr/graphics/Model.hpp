@@ -3,6 +3,7 @@
 
 #include <memory>
 #include "Device.hpp"
+#include "BoundingBox.hpp"
 
 namespace iris::utils{
     // from: https://stackoverflow.com/a/57595105
@@ -49,7 +50,17 @@ namespace iris::graphics{
         static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filePath);
 
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0);
+
+        // object space bounds of the vertices
+        [[nodiscard]] const BoundingBox& getBounds() const { return m_bounds; }
+
+        // the buffers can be copied from, the visibility renderer gathers every model in shared geometry buffers
+        [[nodiscard]] VkBuffer getVertexBuffer() const { return m_vertexBuffer.m_buffer; }
+        [[nodiscard]] uint32_t getVertexCount() const { return m_vertexCount; }
+        [[nodiscard]] bool hasIndexBuffer() const { return m_hasIndexBuffer; }
+        [[nodiscard]] VkBuffer getIndexBuffer() const { return m_indexBuffer.m_buffer; }
+        [[nodiscard]] uint32_t getIndexCount() const { return m_indexCount; }
     private:
         void createVertexBuffers(const std::vector<Vertex>& vertices);
         void createIndexBuffers(const std::vector<uint32_t>& indices);
@@ -62,6 +73,8 @@ namespace iris::graphics{
         bool m_hasIndexBuffer = false;
         AllocatedBuffer m_indexBuffer{};
         uint32_t m_indexCount{};
+
+        BoundingBox m_bounds{};
     };
 }
 
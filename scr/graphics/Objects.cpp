@@ -7,65 +7,6 @@
 
 namespace iris::graphics{
 
-    glm::mat4 RenderObject::modelMatrix() {
-        const float c3 = glm::cos(m_transform.m_rotation.z);
-        const float s3 = glm::sin(m_transform.m_rotation.z);
-        const float c2 = glm::cos(m_transform.m_rotation.x);
-        const float s2 = glm::sin(m_transform.m_rotation.x);
-        const float c1 = glm::cos(m_transform.m_rotation.y);
-        const float s1 = glm::sin(m_transform.m_rotation.y);
-        return glm::mat4{
-                {
-                        m_transform.m_scale.x * (c1 * c3 + s1 * s2 * s3),
-                                                     m_transform.m_scale.x * (c2 * s3),
-                                                                                  m_transform.m_scale.x * (c1 * s2 * s3 - c3 * s1),
-                                                                                                               0.0f,
-                },
-                {
-                        m_transform.m_scale.y * (c3 * s1 * s2 - c1 * s3),
-                                                     m_transform.m_scale.y * (c2 * c3),
-                                                                                  m_transform.m_scale.y * (c1 * c3 * s2 + s1 * s3),
-                                                                                                               0.0f,
-                },
-                {
-                        m_transform.m_scale.z * (c2 * s1),
-                                                     m_transform.m_scale.z * (-s2),
-                                                                                  m_transform.m_scale.z * (c1 * c2),
-                                                                                                               0.0f,
-                },
-                {       m_transform.m_translation.x, m_transform.m_translation.y, m_transform.m_translation.z, 1.0f}};
-    }
-
-    glm::mat3 RenderObject::normalMatrix() {
-        const float c3 = glm::cos(m_transform.m_rotation.z);
-        const float s3 = glm::sin(m_transform.m_rotation.z);
-        const float c2 = glm::cos(m_transform.m_rotation.x);
-        const float s2 = glm::sin(m_transform.m_rotation.x);
-        const float c1 = glm::cos(m_transform.m_rotation.y);
-        const float s1 = glm::sin(m_transform.m_rotation.y);
-        const glm::vec3 invScale = 1.0f / m_transform.m_scale;
-
-        return glm::mat3{
-                {
-                        invScale.x * (c1 * c3 + s1 * s2 * s3),
-                        invScale.x * (c2 * s3),
-                        invScale.x * (c1 * s2 * s3 - c3 * s1),
-                },
-                {
-                        invScale.y * (c3 * s1 * s2 - c1 * s3),
-                        invScale.y * (c2 * c3),
-                        invScale.y * (c1 * c3 * s2 + s1 * s3),
-                },
-                {
-                        invScale.z * (c2 * s1),
-                        invScale.z * (-s2),
-                        invScale.z * (c1 * c2),
-                },
-        };
-    }
-
-    ////////////////////////////////////////////////////////////////////////////
-
     Camera::Camera() {
         m_transform.m_translation = {1, 2, 1};
     }
@@ -89,11 +30,17 @@ namespace iris::graphics{
         m_viewMatrix = glm::lookAt(m_transform.m_translation,
                                    glm::vec3(0,0,0),
                                    m_up);
-        m_projectionMatrix = glm::perspective(glm::radians(45.0f), (float)windowExtent.width / (float)windowExtent.height, 0.1f, 100.0f);
+        m_projectionMatrix = glm::perspective(glm::radians(m_cFieldOfView), (float)windowExtent.width / (float)windowExtent.height, m_cNear, m_cFar);
     }
 
-    PointLight::PointLight(glm::vec3 position, glm::vec3 color) {
+    PointLight::PointLight(glm::vec3 position, glm::vec3 color, float intensity) {
         m_gpuLightData.m_lightPosition = position;
-        m_gpuLightData.m_lightColor = glm::vec4(color, 1.0f);
+        m_gpuLightData.m_radius = computeRadius(color, intensity);
+        m_gpuLightData.m_lightColor = glm::vec4(color, intensity);
+    }
+
+    float PointLight::computeRadius(glm::vec3 color, float intensity) {
+        const float brightest = glm::max(color.r, glm::max(color.g, color.b)) * intensity;
+        return glm::sqrt(brightest / m_cAttenuationCutoff);
     }
 }
\ No newline at end of file
@@ -3,36 +3,11 @@
 
 #include "Model.hpp"
 #include "Material.hpp"
+#include "TransformStore.hpp"
 
 #include <memory>
 
 namespace iris::graphics{
-    struct Transform{
-        glm::vec3 m_translation{};
-        glm::vec3 m_scale{1.f, 1.f, 1.f};
-        glm::vec3 m_rotation{};
-    };
-
-    class RenderObject {
-    public:
-        struct GpuObjectData{
-            glm::mat4 m_modelMatrix{1.f };
-            glm::mat4 m_normalMatrix{1.f };
-        } m_gpuObjectData;
-
-        std::shared_ptr<Model> m_pModel{};
-        std::shared_ptr<Material> m_pMaterial{};
-        Transform m_transform{};
-
-        void updateInfo(){
-            m_gpuObjectData.m_modelMatrix = modelMatrix();
-            m_gpuObjectData.m_normalMatrix = normalMatrix();
-        }
-    private:
-        glm::mat4 modelMatrix();
-        glm::mat3 normalMatrix();
-    };
-
     class Camera{
     public:
         struct GpuCameraData{
@@ -43,6 +18,10 @@ namespace iris::graphics{
 
         Camera();
 
+        static constexpr float m_cFieldOfView = 45.0f; // vertical, in degrees
+        static constexpr float m_cNear = 0.1f;
+        static constexpr float m_cFar = 100.0f;
+
         Transform m_transform{};
 
         glm::mat4 m_viewMatrix = glm::mat4(1.0f);
@@ -59,20 +38,31 @@ namespace iris::graphics{
 
     class PointLight{
     public:
-        PointLight(glm::vec3 position, glm::vec3 color);
+        PointLight(glm::vec3 position, glm::vec3 color, float intensity = 1.0f);
+
+        // the light is cut off where its contribution falls under this
+        static constexpr float m_cAttenuationCutoff = 1.0f / 256.0f;
+        // distance at which the inverse square falloff of the brightest channel reaches the cutoff
+        static float computeRadius(glm::vec3 color, float intensity);
 
         struct GpuPointLightData{
             glm::vec3 m_lightPosition;
-            alignas(16) glm::vec4 m_lightColor;
+            float m_radius;
+            glm::vec4 m_lightColor; // w is intensity
         }m_gpuLightData;
     };
 
+    // the lights themselves are in storage buffers, see LightClusters
     struct GpuSceneData{
         glm::mat4 m_projectionMatrix;
         glm::mat4 m_viewMatrix;
         glm::vec4 m_ambientLightColor; // w is intesity
-        int m_numLights;
-        PointLight::GpuPointLightData m_lights[50];
+        glm::uvec4 m_clusterCounts;    // clusters in x, y and z, w is the number of lights
+        glm::vec4 m_clusterParams;     // xy is the size of a cluster tile in pixels, z and w map a view depth to its slice
+        glm::mat4 m_inverseViewProjection; // rebuilds world positions from the depth buffer
+        glm::vec4 m_sunDirection;      // xyz towards the sun, shadowed by the cascades of ShadowMaps
+        glm::vec4 m_sunColor;          // w is intensity
+        glm::mat4 m_recordedViewMatrix; // the view the light clusters and shadow cascades were built with, never latched
     };
 }
 
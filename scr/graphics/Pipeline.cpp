@@ -3,6 +3,8 @@
 
 #include <fstream>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 
 namespace iris::graphics{
     Pipeline::Pipeline(Device& device,
@@ -13,16 +15,24 @@ namespace iris::graphics{
         createGraphicPipeline(vertFilePath, fragFilePath, configInfo);
     }
 
+    Pipeline::Pipeline(Device& device,
+                       const std::string& compFilePath,
+                       VkPipelineLayout pipelineLayout) : m_rDevice{device}, m_bindPoint{VK_PIPELINE_BIND_POINT_COMPUTE}
+    {
+        createComputePipeline(compFilePath, pipelineLayout);
+    }
+
     Pipeline::~Pipeline()
     {
         vkDestroyShaderModule(m_rDevice.getDevice(), m_vertShaderModule, nullptr);
         vkDestroyShaderModule(m_rDevice.getDevice(), m_fragShaderModule, nullptr);
+        vkDestroyShaderModule(m_rDevice.getDevice(), m_compShaderModule, nullptr);
         vkDestroyPipeline(m_rDevice.getDevice(), m_graphicsPipeline, nullptr);
     }
 
     void Pipeline::bind(VkCommandBuffer commandBuffer)
     {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        vkCmdBindPipeline(commandBuffer, m_bindPoint, m_graphicsPipeline);
     }
 
     void Pipeline::defaultPipelineConfig(PipelineConfigInfo& configInfo)
@@ -72,7 +82,6 @@ namespace iris::graphics{
         configInfo.m_colorBlendInfo.logicOpEnable = VK_FALSE;
         configInfo.m_colorBlendInfo.logicOp = VK_LOGIC_OP_COPY;  // Optional
         configInfo.m_colorBlendInfo.attachmentCount = 1;
-        configInfo.m_colorBlendInfo.pAttachments = &configInfo.m_colorBlendAttachment;
         configInfo.m_colorBlendInfo.blendConstants[0] = 0.0f;  // Optional
         configInfo.m_colorBlendInfo.blendConstants[1] = 0.0f;  // Optional
         configInfo.m_colorBlendInfo.blendConstants[2] = 0.0f;  // Optional
@@ -91,15 +100,41 @@ namespace iris::graphics{
 
         configInfo.m_dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
         configInfo.m_dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        configInfo.m_dynamicStateInfo.pDynamicStates = configInfo.m_dynamicStateEnables.data();
-        configInfo.m_dynamicStateInfo.dynamicStateCount =
-                static_cast<uint32_t>(configInfo.m_dynamicStateEnables.size());
         configInfo.m_dynamicStateInfo.flags = 0;
 
         configInfo.m_bindingDescriptions = Model::Vertex::getBindingDescriptions();
         configInfo.m_attributeDescriptions = Model::Vertex::getAttributeDescriptions();
     }
 
+    void Pipeline::setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value)
+    {
+        setSpecializationData(configInfo, constantId, &value, sizeof(value));
+    }
+
+    void Pipeline::setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, float value)
+    {
+        setSpecializationData(configInfo, constantId, &value, sizeof(value));
+    }
+
+    void Pipeline::setSpecializationData(PipelineConfigInfo& configInfo, uint32_t constantId,
+                                         const void* pData, size_t size)
+    {
+        for (const auto& entry : configInfo.m_specializationEntries) {
+            if (entry.constantID == constantId) {
+                assert(entry.size == size && "The specialization constant was set with another type");
+                std::memcpy(configInfo.m_specializationData.data() + entry.offset, pData, size);
+                return;
+            }
+        }
+        VkSpecializationMapEntry entry{};
+        entry.constantID = constantId;
+        entry.offset = static_cast<uint32_t>(configInfo.m_specializationData.size());
+        entry.size = size;
+        configInfo.m_specializationEntries.push_back(entry);
+        configInfo.m_specializationData.resize(entry.offset + size);
+        std::memcpy(configInfo.m_specializationData.data() + entry.offset, pData, size);
+    }
+
     std::vector<char> Pipeline::readFile(const std::string& filePath)
     {
         std::ifstream file{ filePath, std::ios::ate | std::ios::binary };
@@ -131,10 +166,22 @@ namespace iris::graphics{
                 "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
         auto vertCode = readFile(vertFilePath);
-        auto fragCode = readFile(fragFilePath);
-
         createShaderModule(vertCode, &m_vertShaderModule);
-        createShaderModule(fragCode, &m_fragShaderModule);
+        // without a fragment shader the rasterized fragments only go through the depth test
+        const bool hasFragmentStage = !fragFilePath.empty();
+        if (hasFragmentStage) {
+            auto fragCode = readFile(fragFilePath);
+            createShaderModule(fragCode, &m_fragShaderModule);
+        }
+
+        // the same constants for both stages, each one only reads the ids it declares
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.m_specializationEntries.size());
+        specializationInfo.pMapEntries = configInfo.m_specializationEntries.data();
+        specializationInfo.dataSize = configInfo.m_specializationData.size();
+        specializationInfo.pData = configInfo.m_specializationData.data();
+        const VkSpecializationInfo* pSpecializationInfo =
+                configInfo.m_specializationEntries.empty() ? nullptr : &specializationInfo;
 
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -143,14 +190,14 @@ namespace iris::graphics{
         shaderStages[0].pName = "main";
         shaderStages[0].flags = 0;
         shaderStages[0].pNext = nullptr;
-        shaderStages[0].pSpecializationInfo = nullptr;
+        shaderStages[0].pSpecializationInfo = pSpecializationInfo;
         shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         shaderStages[1].module = m_fragShaderModule;
         shaderStages[1].pName = "main";
         shaderStages[1].flags = 0;
         shaderStages[1].pNext = nullptr;
-        shaderStages[1].pSpecializationInfo = nullptr;
+        shaderStages[1].pSpecializationInfo = pSpecializationInfo;
 
         auto& bindingDescriptions = configInfo.m_bindingDescriptions;
         auto& attributeDescriptions = configInfo.m_attributeDescriptions;
@@ -161,18 +208,28 @@ namespace iris::graphics{
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
         vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+        // the config holds no pointers into itself, they are set on copies of its create infos
+        const std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(configInfo.m_colorBlendInfo.attachmentCount,
+                                                                                configInfo.m_colorBlendAttachment);
+        VkPipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.m_colorBlendInfo;
+        colorBlendInfo.pAttachments = blendAttachments.data();
+
+        VkPipelineDynamicStateCreateInfo dynamicStateInfo = configInfo.m_dynamicStateInfo;
+        dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.m_dynamicStateEnables.size());
+        dynamicStateInfo.pDynamicStates = configInfo.m_dynamicStateEnables.data();
+
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
+        pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &configInfo.m_inputAssemblyInfo;
         pipelineInfo.pViewportState = &configInfo.m_viewportInfo;
         pipelineInfo.pRasterizationState = &configInfo.m_rasterizationInfo;
         pipelineInfo.pMultisampleState = &configInfo.m_multisampleInfo;
-        pipelineInfo.pColorBlendState = &configInfo.m_colorBlendInfo;
+        pipelineInfo.pColorBlendState = &colorBlendInfo;
         pipelineInfo.pDepthStencilState = &configInfo.m_depthStencilInfo;
-        pipelineInfo.pDynamicState = &configInfo.m_dynamicStateInfo;
+        pipelineInfo.pDynamicState = &dynamicStateInfo;
 
         pipelineInfo.layout = configInfo.m_pipelineLayout;
         pipelineInfo.renderPass = configInfo.m_renderPass;
@@ -181,15 +238,55 @@ namespace iris::graphics{
         pipelineInfo.basePipelineIndex = -1;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+        // a warm cache skips the driver's shader compilation, the creation time shows it
+        const auto start = std::chrono::steady_clock::now();
         if (vkCreateGraphicsPipelines(
                 m_rDevice.getDevice(),
-                VK_NULL_HANDLE,
+                m_rDevice.getPipelineCache(),
                 1,
                 &pipelineInfo,
                 nullptr,
                 &m_graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline");
         }
+        m_rDevice.addPipelineCreationTime(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void Pipeline::createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+    {
+        assert(
+                pipelineLayout != VK_NULL_HANDLE &&
+                "Cannot create compute pipeline: no pipelineLayout provided");
+
+        auto compCode = readFile(compFilePath);
+        createShaderModule(compCode, &m_compShaderModule);
+
+        VkPipelineShaderStageCreateInfo shaderStage{};
+        shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStage.module = m_compShaderModule;
+        shaderStage.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = shaderStage;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        const auto start = std::chrono::steady_clock::now();
+        if (vkCreateComputePipelines(
+                m_rDevice.getDevice(),
+                m_rDevice.getPipelineCache(),
+                1,
+                &pipelineInfo,
+                nullptr,
+                &m_graphicsPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline");
+        }
+        m_rDevice.addPipelineCreationTime(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     }
 
     void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
@@ -4,10 +4,10 @@
 #include "Device.hpp"
 
 namespace iris::graphics{
+    // only values, copies stay valid: the pointers of the create infos are set when the pipeline is created.
+    // Every color attachment of the subpass blends with m_colorBlendAttachment, m_colorBlendInfo.attachmentCount
+    // gives their number, and m_dynamicStateEnables are the dynamic states
     struct PipelineConfigInfo{
-        PipelineConfigInfo(const PipelineConfigInfo&) = delete;
-        PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
-
         std::vector<VkVertexInputBindingDescription> m_bindingDescriptions{};
         std::vector<VkVertexInputAttributeDescription> m_attributeDescriptions{};
         VkPipelineViewportStateCreateInfo m_viewportInfo;
@@ -22,15 +22,23 @@ namespace iris::graphics{
         VkPipelineLayout m_pipelineLayout = nullptr;
         VkRenderPass m_renderPass = nullptr;
         uint32_t m_subpass = 0;
+        // values of the specialization constants, given to every stage. A stage ignores the ids it does not declare
+        std::vector<VkSpecializationMapEntry> m_specializationEntries{};
+        std::vector<uint8_t> m_specializationData{};
     };
     class Pipeline
     {
     public:
         Pipeline() = delete;
+        // an empty fragFilePath builds a vertex only pipeline, for depth only passes
         Pipeline(Device& device,
                  const std::string& vertFilePath,
                  const std::string& fragFilePath,
                  const PipelineConfigInfo& configInfo);
+        // compute pipeline
+        Pipeline(Device& device,
+                 const std::string& compFilePath,
+                 VkPipelineLayout pipelineLayout);
         ~Pipeline();
         Pipeline(const Pipeline&) = delete;
         Pipeline& operator=(const Pipeline&) = delete;
@@ -38,19 +46,27 @@ namespace iris::graphics{
         void bind(VkCommandBuffer commandBuffer);
 
         static void defaultPipelineConfig(PipelineConfigInfo& configInfo);
+        // the value of the specialization constant constantId, a bool is set as 0 or 1
+        static void setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value);
+        static void setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, float value);
     private:
         Device& m_rDevice;
-        VkPipeline m_graphicsPipeline;
-        VkShaderModule m_vertShaderModule;
-        VkShaderModule m_fragShaderModule;
+        VkPipeline m_graphicsPipeline{VK_NULL_HANDLE};
+        VkPipelineBindPoint m_bindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS};
+        VkShaderModule m_vertShaderModule{VK_NULL_HANDLE};
+        VkShaderModule m_fragShaderModule{VK_NULL_HANDLE};
+        VkShaderModule m_compShaderModule{VK_NULL_HANDLE};
 
         static std::vector<char> readFile(const std::string& filePath);
 
         void createGraphicPipeline(const std::string& vertFilePath,
                                    const std::string& fragFilePath,
                                    const PipelineConfigInfo& configInfo);
+        void createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 
         void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+        static void setSpecializationData(PipelineConfigInfo& configInfo, uint32_t constantId,
+                                          const void* pData, size_t size);
     };
 }
 
@@ -0,0 +1,42 @@
+#include "PipelineBuildQueue.hpp"
+#include "../utilities/ThreadPool.hpp"
+
+#include <chrono>
+
+namespace iris::graphics{
+
+    void PipelineBuildQueue::add(CreateFunction create, ReadyFunction ready) {
+        m_requests.push_back({std::move(create), std::move(ready)});
+    }
+
+    void PipelineBuildQueue::build() {
+        const auto start = std::chrono::steady_clock::now();
+
+        // one pipeline per chunk, their compile times vary too much to group them
+        utils::ThreadPool::instance().parallelFor(m_requests.size(), 1, [this](size_t first, size_t last, size_t) {
+            for (size_t i = first; i < last; i++) {
+                try {
+                    m_requests[i].m_pipeline = m_requests[i].m_create();
+                }
+                catch (...) {
+                    m_requests[i].m_error = std::current_exception();
+                }
+            }
+        });
+
+        m_rDevice.addPipelineBuildTime(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        // taken out first so a ready function can queue the pipelines depending on it for another build
+        std::vector<Request> requests = std::move(m_requests);
+        m_requests.clear();
+        for (auto& request : requests) {
+            if (request.m_error) {
+                std::rethrow_exception(request.m_error);
+            }
+        }
+        for (auto& request : requests) {
+            request.m_ready(std::move(request.m_pipeline));
+        }
+    }
+}
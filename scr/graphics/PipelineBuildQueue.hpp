@@ -0,0 +1,46 @@
+#ifndef IRIS_PIPELINEBUILDQUEUE_HPP
+#define IRIS_PIPELINEBUILDQUEUE_HPP
+
+#include "Pipeline.hpp"
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace iris::graphics{
+    // pipelines created together on the engine's worker threads. Reading the SPIR-V, creating the shader modules and
+    // the driver's compilation of independent pipelines do not depend on each other, the build takes about as long
+    // as the slowest pipeline instead of the sum of all of them. The device's pipeline cache is internally
+    // synchronized, the workers share it
+    class PipelineBuildQueue {
+    public:
+        // runs on a worker thread, builds its config then the pipeline. Everything it captures must stay valid until
+        // build returns
+        using CreateFunction = std::function<std::unique_ptr<Pipeline>()>;
+        // runs on the thread calling build once every pipeline is created, in the order they were added
+        using ReadyFunction = std::function<void(std::unique_ptr<Pipeline>)>;
+
+        explicit PipelineBuildQueue(Device& device) : m_rDevice{device} {}
+
+        PipelineBuildQueue(const PipelineBuildQueue &) = delete;
+        PipelineBuildQueue &operator=(const PipelineBuildQueue &) = delete;
+
+        void add(CreateFunction create, ReadyFunction ready);
+        // creates the queued pipelines then hands them back, the queue is empty afterwards. The first exception thrown
+        // by a creation is rethrown once the others are done
+        void build();
+    private:
+        struct Request{
+            CreateFunction m_create{};
+            ReadyFunction m_ready{};
+            std::unique_ptr<Pipeline> m_pipeline{};
+            std::exception_ptr m_error{};
+        };
+
+        Device& m_rDevice;
+        std::vector<Request> m_requests{};
+    };
+}
+
+#endif //IRIS_PIPELINEBUILDQUEUE_HPP
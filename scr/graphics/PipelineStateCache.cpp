@@ -0,0 +1,215 @@
+#include "PipelineStateCache.hpp"
+#include "../utilities/ThreadPool.hpp"
+
+#include <cstring>
+
+namespace iris::graphics{
+
+    PipelineStateCache::~PipelineStateCache() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_created.wait(lock, [this] { return m_stats.m_pending == 0; });
+    }
+
+    std::shared_ptr<Pipeline> PipelineStateCache::get(const PipelineDesc &desc) {
+        Key key = makeKey(desc);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_entries.try_emplace(std::move(key));
+        // the references to the values of an unordered map survive rehashing
+        Entry& entry = it->second;
+        if (inserted) {
+            m_stats.m_misses++;
+            entry.m_pending = true;
+            // the other threads asking for it wait, the ones asking for other pipelines do not
+            lock.unlock();
+            std::shared_ptr<Pipeline> pipeline{};
+            std::exception_ptr error{};
+            try {
+                pipeline = std::make_shared<Pipeline>(m_rDevice, desc.m_vertFilePath, desc.m_fragFilePath, desc.m_config);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            entry.m_pipeline = std::move(pipeline);
+            entry.m_error = error;
+            entry.m_pending = false;
+            m_stats.m_pipelines += entry.m_pipeline != nullptr ? 1 : 0;
+            m_created.notify_all();
+        }
+        else {
+            m_stats.m_hits++;
+            m_created.wait(lock, [&entry] { return !entry.m_pending; });
+        }
+        return takeResult(entry);
+    }
+
+    std::shared_ptr<Pipeline> PipelineStateCache::getAsync(const PipelineDesc &desc) {
+        Key key = makeKey(desc);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_entries.try_emplace(std::move(key));
+        Entry& entry = it->second;
+        if (!inserted) {
+            // polling a pipeline still being created is not a hit
+            if (entry.m_pending) {
+                return nullptr;
+            }
+            m_stats.m_hits++;
+            return takeResult(entry);
+        }
+
+        m_stats.m_misses++;
+        m_stats.m_pending++;
+        entry.m_pending = true;
+        // a pool without workers runs the task right away, it takes the lock itself
+        lock.unlock();
+        // the description is copied, the caller's may be gone by the time a worker picks it up
+        utils::ThreadPool::instance().enqueue([this, &entry, desc]() {
+            std::shared_ptr<Pipeline> pipeline{};
+            std::exception_ptr error{};
+            try {
+                pipeline = std::make_shared<Pipeline>(m_rDevice, desc.m_vertFilePath, desc.m_fragFilePath, desc.m_config);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> workerLock(m_mutex);
+            entry.m_pipeline = std::move(pipeline);
+            entry.m_error = error;
+            entry.m_pending = false;
+            m_stats.m_pipelines += entry.m_pipeline != nullptr ? 1 : 0;
+            m_stats.m_pending--;
+            m_created.notify_all();
+        });
+        // null even when it was created inline, the caller picks it up on its next call like any other
+        return nullptr;
+    }
+
+    PipelineStateCache::Stats PipelineStateCache::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    std::shared_ptr<Pipeline> PipelineStateCache::takeResult(Entry &entry) {
+        if (entry.m_error) {
+            std::rethrow_exception(entry.m_error);
+        }
+        return entry.m_pipeline;
+    }
+
+    size_t PipelineStateCache::KeyHash::operator()(const Key &key) const {
+        size_t hash = std::hash<std::string>{}(key.m_vertFilePath);
+        auto combine = [&hash](size_t value) {
+            hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        };
+        combine(std::hash<std::string>{}(key.m_fragFilePath));
+        for (uint64_t word : key.m_state) {
+            combine(std::hash<uint64_t>{}(word));
+        }
+        return hash;
+    }
+
+    PipelineStateCache::Key PipelineStateCache::makeKey(const PipelineDesc &desc) {
+        Key key{desc.m_vertFilePath, desc.m_fragFilePath};
+        std::vector<uint64_t>& state = key.m_state;
+        auto add = [&state](uint64_t value) { state.push_back(value); };
+        auto addFloat = [&state](float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            state.push_back(bits);
+        };
+        auto addStencil = [&add](const VkStencilOpState& stencil) {
+            add(stencil.failOp);
+            add(stencil.passOp);
+            add(stencil.depthFailOp);
+            add(stencil.compareOp);
+            add(stencil.compareMask);
+            add(stencil.writeMask);
+            add(stencil.reference);
+        };
+        const PipelineConfigInfo& config = desc.m_config;
+
+        add(config.m_bindingDescriptions.size());
+        for (const auto& binding : config.m_bindingDescriptions) {
+            add(binding.binding);
+            add(binding.stride);
+            add(binding.inputRate);
+        }
+        add(config.m_attributeDescriptions.size());
+        for (const auto& attribute : config.m_attributeDescriptions) {
+            add(attribute.location);
+            add(attribute.binding);
+            add(attribute.format);
+            add(attribute.offset);
+        }
+
+        add(config.m_inputAssemblyInfo.topology);
+        add(config.m_inputAssemblyInfo.primitiveRestartEnable);
+
+        const auto& rasterization = config.m_rasterizationInfo;
+        add(rasterization.depthClampEnable);
+        add(rasterization.rasterizerDiscardEnable);
+        add(rasterization.polygonMode);
+        add(rasterization.cullMode);
+        add(rasterization.frontFace);
+        add(rasterization.depthBiasEnable);
+        addFloat(rasterization.depthBiasConstantFactor);
+        addFloat(rasterization.depthBiasClamp);
+        addFloat(rasterization.depthBiasSlopeFactor);
+        addFloat(rasterization.lineWidth);
+
+        const auto& multisample = config.m_multisampleInfo;
+        add(multisample.rasterizationSamples);
+        add(multisample.sampleShadingEnable);
+        addFloat(multisample.minSampleShading);
+        add(multisample.alphaToCoverageEnable);
+        add(multisample.alphaToOneEnable);
+
+        const auto& blend = config.m_colorBlendAttachment;
+        add(config.m_colorBlendInfo.attachmentCount);
+        add(config.m_colorBlendInfo.logicOpEnable);
+        add(config.m_colorBlendInfo.logicOp);
+        for (float constant : config.m_colorBlendInfo.blendConstants) {
+            addFloat(constant);
+        }
+        add(blend.blendEnable);
+        add(blend.srcColorBlendFactor);
+        add(blend.dstColorBlendFactor);
+        add(blend.colorBlendOp);
+        add(blend.srcAlphaBlendFactor);
+        add(blend.dstAlphaBlendFactor);
+        add(blend.alphaBlendOp);
+        add(blend.colorWriteMask);
+
+        const auto& depthStencil = config.m_depthStencilInfo;
+        add(depthStencil.depthTestEnable);
+        add(depthStencil.depthWriteEnable);
+        add(depthStencil.depthCompareOp);
+        add(depthStencil.depthBoundsTestEnable);
+        addFloat(depthStencil.minDepthBounds);
+        addFloat(depthStencil.maxDepthBounds);
+        add(depthStencil.stencilTestEnable);
+        addStencil(depthStencil.front);
+        addStencil(depthStencil.back);
+
+        add(config.m_dynamicStateEnables.size());
+        for (VkDynamicState dynamicState : config.m_dynamicStateEnables) {
+            add(dynamicState);
+        }
+
+        add(config.m_specializationEntries.size());
+        for (const auto& entry : config.m_specializationEntries) {
+            add(entry.constantID);
+            add(entry.offset);
+            add(entry.size);
+        }
+        add(config.m_specializationData.size());
+        for (uint8_t byte : config.m_specializationData) {
+            add(byte);
+        }
+
+        add(reinterpret_cast<uint64_t>(config.m_pipelineLayout));
+        add(reinterpret_cast<uint64_t>(config.m_renderPass));
+        add(config.m_subpass);
+        return key;
+    }
+}
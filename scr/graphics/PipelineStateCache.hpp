@@ -0,0 +1,87 @@
+#ifndef IRIS_PIPELINESTATECACHE_HPP
+#define IRIS_PIPELINESTATECACHE_HPP
+
+#include "Pipeline.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace iris::graphics{
+    // everything a graphics pipeline is created from
+    struct PipelineDesc{
+        std::string m_vertFilePath{};
+        // empty for a vertex only pipeline
+        std::string m_fragFilePath{};
+        PipelineConfigInfo m_config{};
+    };
+
+    // graphics pipelines created the first time their description is asked for, so only the permutations a scene
+    // draws with are compiled. The descriptions are hashed on their shaders, vertex layout, input assembly,
+    // rasterization, multisampling, blending, depth and stencil, dynamic states, specialization constants, layout,
+    // render pass and subpass. Safe to use from the recording threads
+    class PipelineStateCache {
+    public:
+        struct Stats{
+            uint32_t m_pipelines{};
+            // pipelines asked for with getAsync that a worker thread is still creating
+            uint32_t m_pending{};
+            // an existing pipeline was returned, polling one still pending is neither
+            uint64_t m_hits{};
+            uint64_t m_misses{};
+        };
+
+        explicit PipelineStateCache(Device& device) : m_rDevice{device} {}
+        // waits for the pipelines still created in the background
+        ~PipelineStateCache();
+
+        PipelineStateCache(const PipelineStateCache &) = delete;
+        PipelineStateCache &operator=(const PipelineStateCache &) = delete;
+
+        // created on the calling thread on a miss, waits for it if getAsync already started it
+        std::shared_ptr<Pipeline> get(const PipelineDesc& desc);
+        // null until a worker thread created it, the caller draws with a fallback meanwhile. An exception thrown by
+        // the creation is rethrown by the next call asking for it
+        std::shared_ptr<Pipeline> getAsync(const PipelineDesc& desc);
+
+        [[nodiscard]] Stats getStats() const;
+    private:
+        // the description flattened to the values the pipeline depends on, handles and floats included bitwise
+        struct Key{
+            std::string m_vertFilePath{};
+            std::string m_fragFilePath{};
+            std::vector<uint64_t> m_state{};
+
+            bool operator==(const Key& other) const {
+                return m_state == other.m_state && m_vertFilePath == other.m_vertFilePath &&
+                       m_fragFilePath == other.m_fragFilePath;
+            }
+        };
+        struct KeyHash{
+            size_t operator()(const Key& key) const;
+        };
+        struct Entry{
+            std::shared_ptr<Pipeline> m_pipeline{};
+            bool m_pending{};
+            std::exception_ptr m_error{};
+        };
+
+        Device& m_rDevice;
+
+        mutable std::mutex m_mutex{};
+        // signaled when a background creation is done
+        std::condition_variable m_created{};
+        std::unordered_map<Key, Entry, KeyHash> m_entries{};
+        Stats m_stats{};
+
+        static Key makeKey(const PipelineDesc& desc);
+        // takes the entry's pipeline or error, m_mutex held
+        static std::shared_ptr<Pipeline> takeResult(Entry& entry);
+    };
+}
+
+#endif //IRIS_PIPELINESTATECACHE_HPP
@@ -0,0 +1,590 @@
+#include "RenderGraph.hpp"
+#include "Initializers.hpp"
+#include "Debugger.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+namespace iris::graphics{
+
+    namespace {
+        bool isDepthFormat(VkFormat format) {
+            switch (format) {
+                case VK_FORMAT_D16_UNORM:
+                case VK_FORMAT_X8_D24_UNORM_PACK32:
+                case VK_FORMAT_D32_SFLOAT:
+                case VK_FORMAT_D16_UNORM_S8_UINT:
+                case VK_FORMAT_D24_UNORM_S8_UINT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool hasStencil(VkFormat format) {
+            return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+                   format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+        }
+
+        constexpr VkAccessFlags writeAccesses = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                   VK_ACCESS_SHADER_WRITE_BIT;
+    }
+
+    RenderResource RenderGraph::PassBuilder::createImage(const char *name, const ImageDesc &desc) {
+        assert(!m_rGraph.m_compiled && "The graph cannot change once compiled");
+        Image image{};
+        image.m_name = name;
+        image.m_desc = desc;
+        m_rGraph.m_images.push_back(image);
+        return static_cast<RenderResource>(m_rGraph.m_images.size() - 1);
+    }
+
+    void RenderGraph::PassBuilder::writeColor(RenderResource image) {
+        m_rGraph.addAccess(m_pass, {image, ImageAccess::ColorAttachment});
+    }
+
+    void RenderGraph::PassBuilder::writeColor(RenderResource image, const VkClearColorValue &clearValue) {
+        Access access{image, ImageAccess::ColorAttachment, true};
+        access.m_clearValue.color = clearValue;
+        m_rGraph.addAccess(m_pass, access);
+    }
+
+    void RenderGraph::PassBuilder::writeDepth(RenderResource image) {
+        m_rGraph.addAccess(m_pass, {image, ImageAccess::DepthAttachment});
+    }
+
+    void RenderGraph::PassBuilder::writeDepth(RenderResource image, float clearDepth) {
+        Access access{image, ImageAccess::DepthAttachment, true};
+        access.m_clearValue.depthStencil = {clearDepth, 0};
+        m_rGraph.addAccess(m_pass, access);
+    }
+
+    void RenderGraph::PassBuilder::readSampled(RenderResource image) {
+        m_rGraph.addAccess(m_pass, {image, ImageAccess::Sampled});
+    }
+
+    void RenderGraph::PassBuilder::writeStorage(RenderResource image) {
+        m_rGraph.addAccess(m_pass, {image, ImageAccess::Storage});
+    }
+
+    void RenderGraph::PassBuilder::setRenderArea(std::function<VkExtent2D()> renderArea) {
+        m_rGraph.m_passes[m_pass].m_renderArea = std::move(renderArea);
+    }
+
+    void RenderGraph::PassBuilder::useSecondaryCommandBuffers() {
+        m_rGraph.m_passes[m_pass].m_secondaryCommandBuffers = true;
+    }
+
+    void RenderGraph::PassBuilder::countFragments() {
+        m_rGraph.m_passes[m_pass].m_countFragments = true;
+    }
+
+    void RenderGraph::PassBuilder::setSideEffects() {
+        m_rGraph.m_passes[m_pass].m_sideEffects = true;
+    }
+
+    RenderGraph::RenderGraph(Device &device, GpuProfiler *pProfiler) : m_rDevice{device}, m_pProfiler{pProfiler} {}
+
+    RenderGraph::~RenderGraph() {
+        for (auto& pass : m_passes) {
+            for (auto framebuffer : pass.m_framebuffers) {
+                vkDestroyFramebuffer(m_rDevice.getDevice(), framebuffer, nullptr);
+            }
+            vkDestroyRenderPass(m_rDevice.getDevice(), pass.m_renderPass, nullptr);
+        }
+        for (auto& image : m_images) {
+            if (image.m_imported) {
+                continue;
+            }
+            for (auto view : image.m_views) {
+                vkDestroyImageView(m_rDevice.getDevice(), view, nullptr);
+            }
+            for (auto vkImage : image.m_images) {
+                if (image.m_allocation != nullptr) {
+                    vmaDestroyImage(m_rDevice.getAllocator(), vkImage, image.m_allocation);
+                }
+                else {
+                    vkDestroyImage(m_rDevice.getDevice(), vkImage, nullptr);
+                }
+            }
+        }
+        for (auto& block : m_blocks) {
+            vmaFreeMemory(m_rDevice.getAllocator(), block.m_allocation);
+        }
+    }
+
+    RenderResource RenderGraph::importImage(const char *name, const ImageDesc &desc, const std::vector<VkImage> &images,
+                                            const std::vector<VkImageView> &views, VkImageLayout finalLayout) {
+        assert(!m_compiled && "The graph cannot change once compiled");
+        assert(!images.empty() && images.size() == views.size() && "An imported image needs a view per image");
+        Image image{};
+        image.m_name = name;
+        image.m_desc = desc;
+        image.m_imported = true;
+        image.m_finalLayout = finalLayout;
+        image.m_images = images;
+        image.m_views = views;
+        m_images.push_back(image);
+        return static_cast<RenderResource>(m_images.size() - 1);
+    }
+
+    void RenderGraph::addPass(const char *name, PassType type, const std::function<void(PassBuilder &)> &setup,
+                              std::function<void(const PassContext &)> execute) {
+        assert(!m_compiled && "The graph cannot change once compiled");
+        Pass pass{};
+        pass.m_name = name;
+        pass.m_type = type;
+        pass.m_execute = std::move(execute);
+        m_passes.push_back(std::move(pass));
+
+        PassBuilder builder{*this, static_cast<uint32_t>(m_passes.size() - 1)};
+        setup(builder);
+    }
+
+    void RenderGraph::addAccess(uint32_t pass, const Access &access) {
+        assert(access.m_image < m_images.size() && "Unknown render graph image");
+        auto& accesses = m_passes[pass].m_accesses;
+        assert(std::none_of(accesses.begin(), accesses.end(),
+                            [&](const Access& other) { return other.m_image == access.m_image; })
+               && "An image can only be used once per pass");
+        assert((m_passes[pass].m_type == PassType::Graphics ||
+                (access.m_access != ImageAccess::ColorAttachment && access.m_access != ImageAccess::DepthAttachment))
+               && "A compute pass has no attachments");
+        accesses.push_back(access);
+    }
+
+    void RenderGraph::compile() {
+        assert(!m_compiled && "The graph is already compiled");
+        for (auto& image : m_images) {
+            const bool depth = isDepthFormat(image.m_desc.m_format);
+            image.m_viewAspect = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            image.m_barrierAspect = image.m_viewAspect | (hasStencil(image.m_desc.m_format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        }
+
+        cullPasses();
+        computeLifetimes();
+        allocateImages();
+        createRenderPasses();
+        createBarriers();
+        m_compiled = true;
+    }
+
+    void RenderGraph::cullPasses() {
+        // walked backwards, an image is needed while a kept pass after the current one reads what it holds
+        std::vector<bool> needed(m_images.size(), false);
+        for (size_t p = m_passes.size(); p-- > 0;) {
+            Pass& pass = m_passes[p];
+            bool keep = pass.m_sideEffects;
+            for (const auto& access : pass.m_accesses) {
+                keep |= isWrite(access.m_access) && (m_images[access.m_image].m_imported || needed[access.m_image]);
+            }
+            pass.m_culled = !keep;
+            if (!keep) {
+                m_stats.m_culledPasses++;
+                continue;
+            }
+            for (const auto& access : pass.m_accesses) {
+                // a cleared attachment does not depend on what was written before, a loaded one or a storage image does
+                needed[access.m_image] = !access.m_clear;
+            }
+        }
+        m_stats.m_passes = static_cast<uint32_t>(m_passes.size()) - m_stats.m_culledPasses;
+    }
+
+    void RenderGraph::computeLifetimes() {
+        for (uint32_t p = 0; p < m_passes.size(); p++) {
+            if (m_passes[p].m_culled) {
+                continue;
+            }
+            for (const auto& access : m_passes[p].m_accesses) {
+                Image& image = m_images[access.m_image];
+                image.m_firstPass = std::min(image.m_firstPass, p);
+                image.m_lastPass = std::max(image.m_lastPass, p);
+                image.m_usage |= usageFlags(access.m_access);
+            }
+        }
+        for (auto& image : m_images) {
+            // never leaves the render pass of its only pass
+            image.m_transient = !image.m_imported && image.m_firstPass == image.m_lastPass &&
+                                (image.m_usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) == 0;
+            if (image.m_transient) {
+                image.m_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            }
+        }
+    }
+
+    void RenderGraph::allocateImages() {
+        std::vector<RenderResource> aliased{};
+        for (RenderResource i = 0; i < m_images.size(); i++) {
+            Image& image = m_images[i];
+            if (image.m_imported || image.m_firstPass == UINT32_MAX) {
+                continue;
+            }
+            m_stats.m_images++;
+
+            const VkImageCreateInfo imageInfo = Initializers::createImageInfo(
+                    image.m_desc.m_format, image.m_usage, {image.m_desc.m_extent.width, image.m_desc.m_extent.height, 1});
+            VkImage vkImage{};
+            if (image.m_transient) {
+                // a dedicated allocation per image, lazily allocated memory is only committed if the device needs it
+                VmaAllocationCreateInfo lazyAllocInfo = {};
+                lazyAllocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+                lazyAllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+                if (vmaCreateImage(m_rDevice.getAllocator(), &imageInfo, &lazyAllocInfo, &vkImage,
+                                   &image.m_allocation, nullptr) == VK_SUCCESS) {
+                    image.m_images.push_back(vkImage);
+                    m_stats.m_transientImages++;
+                    continue;
+                }
+                // no lazily allocated memory type, it shares the blocks like the others
+                image.m_transient = false;
+            }
+            Debugger::vkCheck(vkCreateImage(m_rDevice.getDevice(), &imageInfo, nullptr, &vkImage),
+                              "Failed to create render graph image!");
+            image.m_images.push_back(vkImage);
+            aliased.push_back(i);
+        }
+
+        // the largest images first, each goes in the first block whose memory type suits it and whose images are
+        // all dead while it lives
+        std::vector<VkMemoryRequirements> requirements(m_images.size());
+        for (RenderResource i : aliased) {
+            vkGetImageMemoryRequirements(m_rDevice.getDevice(), m_images[i].m_images[0], &requirements[i]);
+            m_stats.m_bytesWithoutAliasing += requirements[i].size;
+        }
+        std::sort(aliased.begin(), aliased.end(), [&](RenderResource a, RenderResource b) {
+            return requirements[a].size > requirements[b].size;
+        });
+        for (RenderResource i : aliased) {
+            const Image& image = m_images[i];
+            auto overlaps = [&](RenderResource other) {
+                return image.m_firstPass <= m_images[other].m_lastPass && m_images[other].m_firstPass <= image.m_lastPass;
+            };
+            auto block = std::find_if(m_blocks.begin(), m_blocks.end(), [&](const MemoryBlock& candidate) {
+                return (candidate.m_requirements.memoryTypeBits & requirements[i].memoryTypeBits) != 0 &&
+                       std::none_of(candidate.m_images.begin(), candidate.m_images.end(), overlaps);
+            });
+            if (block == m_blocks.end()) {
+                m_blocks.push_back({requirements[i]});
+                block = m_blocks.end() - 1;
+            }
+            else {
+                block->m_requirements.size = std::max(block->m_requirements.size, requirements[i].size);
+                block->m_requirements.alignment = std::max(block->m_requirements.alignment, requirements[i].alignment);
+                block->m_requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+            }
+            block->m_images.push_back(i);
+            m_images[i].m_block = static_cast<uint32_t>(block - m_blocks.begin());
+        }
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        for (auto& block : m_blocks) {
+            Debugger::vkCheck(vmaAllocateMemory(m_rDevice.getAllocator(), &block.m_requirements, &allocInfo,
+                                                &block.m_allocation, nullptr),
+                              "Failed to allocate render graph memory!");
+            for (RenderResource i : block.m_images) {
+                Debugger::vkCheck(vmaBindImageMemory(m_rDevice.getAllocator(), block.m_allocation, m_images[i].m_images[0]),
+                                  "Failed to bind render graph image memory!");
+            }
+            m_stats.m_bytesAllocated += block.m_requirements.size;
+        }
+        m_stats.m_memoryBlocks = static_cast<uint32_t>(m_blocks.size());
+
+        for (auto& image : m_images) {
+            if (image.m_imported || image.m_images.empty()) {
+                continue;
+            }
+            VkImageViewCreateInfo viewInfo = Initializers::createImageViewInfo(image.m_desc.m_format, image.m_images[0],
+                                                                               image.m_viewAspect, VK_IMAGE_VIEW_TYPE_2D);
+            image.m_views.emplace_back();
+            Debugger::vkCheck(vkCreateImageView(m_rDevice.getDevice(), &viewInfo, nullptr, &image.m_views[0]),
+                              "Failed to create render graph image view!");
+        }
+    }
+
+    void RenderGraph::createRenderPasses() {
+        for (uint32_t p = 0; p < m_passes.size(); p++) {
+            Pass& pass = m_passes[p];
+            if (pass.m_culled || pass.m_type != PassType::Graphics) {
+                continue;
+            }
+
+            // the color attachments in declaration order then the depth one
+            std::vector<const Access*> attachmentAccesses{};
+            for (const auto& access : pass.m_accesses) {
+                if (access.m_access == ImageAccess::ColorAttachment) {
+                    attachmentAccesses.push_back(&access);
+                }
+            }
+            for (const auto& access : pass.m_accesses) {
+                if (access.m_access == ImageAccess::DepthAttachment) {
+                    attachmentAccesses.push_back(&access);
+                }
+            }
+            assert(!attachmentAccesses.empty() && "A graphics pass needs an attachment");
+
+            std::vector<VkAttachmentDescription> attachments{};
+            std::vector<VkAttachmentReference> colorRefs{};
+            VkAttachmentReference depthRef{};
+            size_t framebufferCount = 1;
+            for (const Access* pAccess : attachmentAccesses) {
+                const Image& image = m_images[pAccess->m_image];
+                const Usage usage = getUsage(image, pAccess->m_access, pass.m_type);
+
+                // the barrier before the pass already moved it to its layout, the render pass keeps it there
+                VkAttachmentDescription attachment = Initializers::createAttachmentDescription(image.m_desc.m_format, usage.m_layout);
+                attachment.initialLayout = usage.m_layout;
+                attachment.loadOp = pAccess->m_clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                  : image.m_firstPass < p ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.storeOp = image.m_imported || image.m_lastPass > p ? VK_ATTACHMENT_STORE_OP_STORE
+                                                                              : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+                const VkAttachmentReference ref{static_cast<uint32_t>(attachments.size()), usage.m_layout};
+                if (pAccess->m_access == ImageAccess::DepthAttachment) {
+                    depthRef = ref;
+                }
+                else {
+                    colorRefs.push_back(ref);
+                }
+                attachments.push_back(attachment);
+                pass.m_clearValues.push_back(pAccess->m_clearValue);
+                framebufferCount = std::max(framebufferCount, image.m_views.size());
+
+                assert((pass.m_extent.width == 0 || (pass.m_extent.width == image.m_desc.m_extent.width &&
+                                                     pass.m_extent.height == image.m_desc.m_extent.height))
+                       && "The attachments of a pass must have the same extent");
+                pass.m_extent = image.m_desc.m_extent;
+            }
+
+            VkSubpassDescription subpass = {};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+            subpass.pColorAttachments = colorRefs.data();
+            subpass.pDepthStencilAttachment = attachments.size() > colorRefs.size() ? &depthRef : nullptr;
+
+            // the barriers recorded before the pass synchronize it, no dependency is needed
+            std::vector<VkSubpassDescription> subpasses = { subpass };
+            std::vector<VkSubpassDependency> dependencies{};
+            VkRenderPassCreateInfo renderPassInfo = Initializers::createRenderPassInfo(attachments, subpasses, dependencies);
+            Debugger::vkCheck(vkCreateRenderPass(m_rDevice.getDevice(), &renderPassInfo, nullptr, &pass.m_renderPass),
+                              "Failed to create render graph render pass!");
+
+            pass.m_framebuffers.resize(framebufferCount);
+            for (size_t i = 0; i < framebufferCount; i++) {
+                std::vector<VkImageView> views{};
+                for (const Access* pAccess : attachmentAccesses) {
+                    const auto& imageViews = m_images[pAccess->m_image].m_views;
+                    views.push_back(imageViews[i % imageViews.size()]);
+                }
+                VkFramebufferCreateInfo framebufferInfo = Initializers::createFramebufferInfo(pass.m_renderPass, pass.m_extent, views);
+                Debugger::vkCheck(vkCreateFramebuffer(m_rDevice.getDevice(), &framebufferInfo, nullptr, &pass.m_framebuffers[i]),
+                                  "Failed to create render graph framebuffer!");
+            }
+        }
+    }
+
+    std::vector<RenderGraph::ImageState> RenderGraph::simulate(bool record) {
+        std::vector<ImageState> states(m_images.size());
+        if (record) {
+            // the content of the last frame is discarded, its last uses still have to finish. The images sharing a
+            // block wait for each other
+            for (RenderResource i = 0; i < m_images.size(); i++) {
+                const Image& image = m_images[i];
+                const ImageState& lastUse = image.m_block != UINT32_MAX ? m_blocks[image.m_block].m_lastUse : image.m_lastUse;
+                states[i].m_stages = lastUse.m_stages;
+                states[i].m_writeAccess = lastUse.m_writeAccess;
+            }
+        }
+
+        m_finalBarriers = {};
+        for (auto& pass : m_passes) {
+            pass.m_barriers = {};
+            if (pass.m_culled) {
+                continue;
+            }
+            for (const auto& access : pass.m_accesses) {
+                const Image& image = m_images[access.m_image];
+                const Usage usage = getUsage(image, access.m_access, pass.m_type);
+                ImageState& state = states[access.m_image];
+
+                const bool write = isWrite(access.m_access);
+                if (state.m_layout == usage.m_layout && state.m_writeAccess == 0 && !write) {
+                    // a read after reads
+                    state.m_stages |= usage.m_stages;
+                    continue;
+                }
+                pass.m_barriers.m_srcStages |= state.m_stages != 0 ? state.m_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                pass.m_barriers.m_dstStages |= usage.m_stages;
+                pass.m_barriers.m_barriers.push_back({access.m_image, state.m_layout, usage.m_layout,
+                                                      state.m_writeAccess, usage.m_access});
+                state = {usage.m_layout, usage.m_stages, write ? usage.m_access & writeAccesses : 0};
+            }
+        }
+
+        for (RenderResource i = 0; i < m_images.size(); i++) {
+            const Image& image = m_images[i];
+            if (!image.m_imported || image.m_finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || image.m_firstPass == UINT32_MAX) {
+                continue;
+            }
+            m_finalBarriers.m_srcStages |= states[i].m_stages;
+            m_finalBarriers.m_dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            m_finalBarriers.m_barriers.push_back({i, states[i].m_layout, image.m_finalLayout, states[i].m_writeAccess, 0});
+        }
+        return states;
+    }
+
+    void RenderGraph::createBarriers() {
+        // the first use of an image in a frame changes its layout, from then on the states do not depend on the
+        // previous frame. A first walk finds what each frame leaves the images in
+        const std::vector<ImageState> lastUses = simulate(false);
+        for (RenderResource i = 0; i < m_images.size(); i++) {
+            m_images[i].m_lastUse = lastUses[i];
+            if (m_images[i].m_block != UINT32_MAX) {
+                MemoryBlock& block = m_blocks[m_images[i].m_block];
+                block.m_lastUse.m_stages |= lastUses[i].m_stages;
+                block.m_lastUse.m_writeAccess |= lastUses[i].m_writeAccess;
+            }
+        }
+        simulate(true);
+
+        m_stats.m_barriers = static_cast<uint32_t>(m_finalBarriers.m_barriers.size());
+        for (const auto& pass : m_passes) {
+            m_stats.m_barriers += static_cast<uint32_t>(pass.m_barriers.m_barriers.size());
+        }
+    }
+
+    void RenderGraph::recordBarriers(VkCommandBuffer cmd, const BarrierBatch &batch, uint32_t imageIndex) const {
+        if (batch.m_barriers.empty()) {
+            return;
+        }
+        std::vector<VkImageMemoryBarrier> barriers(batch.m_barriers.size());
+        for (size_t i = 0; i < batch.m_barriers.size(); i++) {
+            const Barrier& barrier = batch.m_barriers[i];
+            const Image& image = m_images[barrier.m_image];
+            barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barriers[i].image = image.m_images[imageIndex % image.m_images.size()];
+            barriers[i].subresourceRange = {image.m_barrierAspect, 0, 1, 0, 1};
+            barriers[i].oldLayout = barrier.m_oldLayout;
+            barriers[i].newLayout = barrier.m_newLayout;
+            barriers[i].srcAccessMask = barrier.m_srcAccess;
+            barriers[i].dstAccessMask = barrier.m_dstAccess;
+        }
+        vkCmdPipelineBarrier(cmd, batch.m_srcStages, batch.m_dstStages, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    void RenderGraph::execute(VkCommandBuffer cmd, uint32_t imageIndex) {
+        assert(m_compiled && "The graph must be compiled before it is executed");
+        for (const auto& pass : m_passes) {
+            if (pass.m_culled) {
+                continue;
+            }
+            recordBarriers(cmd, pass.m_barriers, imageIndex);
+
+            // timestamps and queries cannot be begun inside the render pass, they surround it
+            const uint32_t scope = m_pProfiler != nullptr ? m_pProfiler->beginScope(cmd, pass.m_name) : 0;
+            if (pass.m_countFragments && m_pProfiler != nullptr) {
+                m_pProfiler->beginStatistics(cmd);
+            }
+
+            PassContext context{};
+            context.m_cmd = cmd;
+            context.m_imageIndex = imageIndex;
+            if (pass.m_type == PassType::Graphics) {
+                context.m_renderPass = pass.m_renderPass;
+                context.m_framebuffer = pass.m_framebuffers[imageIndex % pass.m_framebuffers.size()];
+                context.m_renderArea = pass.m_renderArea ? pass.m_renderArea() : pass.m_extent;
+
+                VkRenderPassBeginInfo renderPassInfo = Initializers::renderPassBeginInfo(context.m_renderPass,
+                                                                                         context.m_renderArea,
+                                                                                         context.m_framebuffer);
+                renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.m_clearValues.size());
+                renderPassInfo.pClearValues = pass.m_clearValues.data();
+                vkCmdBeginRenderPass(cmd, &renderPassInfo, pass.m_secondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                                                                          : VK_SUBPASS_CONTENTS_INLINE);
+                pass.m_execute(context);
+                vkCmdEndRenderPass(cmd);
+            }
+            else {
+                context.m_renderArea = pass.m_renderArea ? pass.m_renderArea() : VkExtent2D{};
+                pass.m_execute(context);
+            }
+
+            if (pass.m_countFragments && m_pProfiler != nullptr) {
+                m_pProfiler->endStatistics(cmd);
+            }
+            if (m_pProfiler != nullptr) {
+                m_pProfiler->endScope(cmd, scope);
+            }
+        }
+        recordBarriers(cmd, m_finalBarriers, imageIndex);
+    }
+
+    VkImageView RenderGraph::getImageView(RenderResource image) const {
+        assert(m_compiled && !m_images[image].m_views.empty() && "The image is not used by any pass");
+        return m_images[image].m_views[0];
+    }
+
+    const RenderGraph::Pass *RenderGraph::findPass(const char *name) const {
+        for (const auto& pass : m_passes) {
+            if (std::strcmp(pass.m_name, name) == 0) {
+                return &pass;
+            }
+        }
+        return nullptr;
+    }
+
+    VkRenderPass RenderGraph::getRenderPass(const char *passName) const {
+        const Pass* pPass = findPass(passName);
+        return pPass != nullptr ? pPass->m_renderPass : VK_NULL_HANDLE;
+    }
+
+    bool RenderGraph::isCulled(const char *passName) const {
+        const Pass* pPass = findPass(passName);
+        return pPass == nullptr || pPass->m_culled;
+    }
+
+    RenderGraph::Usage RenderGraph::getUsage(const Image &image, ImageAccess access, PassType type) {
+        const VkPipelineStageFlags shaderStage = type == PassType::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                                                           : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        switch (access) {
+            case ImageAccess::ColorAttachment:
+                return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+            case ImageAccess::DepthAttachment:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+            case ImageAccess::Sampled:
+                return {image.m_viewAspect == VK_IMAGE_ASPECT_DEPTH_BIT ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                                                        : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        shaderStage, VK_ACCESS_SHADER_READ_BIT};
+            case ImageAccess::Storage:
+            default:
+                return {VK_IMAGE_LAYOUT_GENERAL, shaderStage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        }
+    }
+
+    VkImageUsageFlags RenderGraph::usageFlags(ImageAccess access) {
+        switch (access) {
+            case ImageAccess::ColorAttachment:
+                return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            case ImageAccess::DepthAttachment:
+                return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            case ImageAccess::Sampled:
+                return VK_IMAGE_USAGE_SAMPLED_BIT;
+            case ImageAccess::Storage:
+            default:
+                return VK_IMAGE_USAGE_STORAGE_BIT;
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#ifndef IRIS_RENDERGRAPH_HPP
+#define IRIS_RENDERGRAPH_HPP
+
+#include "Device.hpp"
+#include "GpuProfiler.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace iris::graphics{
+    // index of an image of a render graph
+    using RenderResource = uint32_t;
+
+    // the passes of a frame and the images they read and write, in the order they run. Compiled once:
+    // - the passes nothing depends on are culled, a pass is kept when it has side effects, writes an imported image or
+    //   writes an image a kept pass reads afterwards
+    // - every graphics pass gets a single subpass render pass and its framebuffers, its attachments are loaded only
+    //   when an earlier pass wrote them and stored only when a later pass reads them
+    // - the barriers between the passes are derived from how each one uses the images: a layout change, a read after
+    //   a write or a write after anything. Reads following reads share a barrier
+    // - the images created by the graph get their memory from blocks shared by the images whose lifetimes do not
+    //   overlap. An image only used as an attachment of a single pass is transient and lazily allocated instead
+    // The images are shared by the frames in flight, the first barrier of each frame waits for the last use of the
+    // previous frame
+    class RenderGraph {
+    public:
+        enum class PassType{
+            Graphics,
+            Compute
+        };
+
+        struct ImageDesc{
+            VkFormat m_format{};
+            VkExtent2D m_extent{};
+        };
+
+        // what the execute callback of a pass records with. The render pass and framebuffer are null for compute passes
+        struct PassContext{
+            VkCommandBuffer m_cmd{};
+            VkRenderPass m_renderPass{};
+            VkFramebuffer m_framebuffer{};
+            VkExtent2D m_renderArea{};
+            uint32_t m_imageIndex{};
+        };
+
+        struct Stats{
+            uint32_t m_passes{};
+            uint32_t m_culledPasses{};
+            uint32_t m_barriers{};
+            uint32_t m_images{};
+            uint32_t m_memoryBlocks{};
+            uint32_t m_transientImages{};
+            // memory of the shared blocks against the sum of their images
+            VkDeviceSize m_bytesAllocated{};
+            VkDeviceSize m_bytesWithoutAliasing{};
+        };
+
+        // declares the images a pass uses, an image can be used once per pass
+        class PassBuilder{
+        public:
+            RenderResource createImage(const char* name, const ImageDesc& desc);
+            // the attachments are bound in the order they are declared, the depth one last. Without a clear value the
+            // content written by the earlier passes is loaded
+            void writeColor(RenderResource image);
+            void writeColor(RenderResource image, const VkClearColorValue& clearValue);
+            void writeDepth(RenderResource image);
+            void writeDepth(RenderResource image, float clearDepth);
+            // by the fragment shaders of a graphics pass, the compute shader of a compute pass
+            void readSampled(RenderResource image);
+            void writeStorage(RenderResource image);
+
+            // the extent the render pass is begun with, the images' otherwise
+            void setRenderArea(std::function<VkExtent2D()> renderArea);
+            // the execute callback only executes secondary command buffers in the render pass
+            void useSecondaryCommandBuffers();
+            // the fragment shader invocations of the pass are counted by the profiler
+            void countFragments();
+            // never culled
+            void setSideEffects();
+        private:
+            friend class RenderGraph;
+            PassBuilder(RenderGraph& graph, uint32_t pass) : m_rGraph{graph}, m_pass{pass} {}
+            RenderGraph& m_rGraph;
+            uint32_t m_pass;
+        };
+
+        // pProfiler, when set, times every pass in a scope of its name
+        RenderGraph(Device& device, GpuProfiler* pProfiler);
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+
+        // an image owned outside the graph, one per index given to execute when there are several like the swapchain
+        // ones. Its content is discarded at the start of every frame, it is left in finalLayout at the end
+        RenderResource importImage(const char* name, const ImageDesc& desc, const std::vector<VkImage>& images,
+                                   const std::vector<VkImageView>& views, VkImageLayout finalLayout);
+        // name must outlive the graph, string literals are expected. setup declares the images of the pass, execute
+        // records it every frame
+        void addPass(const char* name, PassType type, const std::function<void(PassBuilder&)>& setup,
+                     std::function<void(const PassContext&)> execute);
+
+        // culls the passes, allocates the images and builds the render passes and barriers, the graph cannot change
+        // afterwards
+        void compile();
+        // records the passes that were not culled and their barriers, imageIndex selects the imported images
+        void execute(VkCommandBuffer cmd, uint32_t imageIndex);
+
+        // once compiled
+        [[nodiscard]] VkImageView getImageView(RenderResource image) const;
+        // null for a culled or compute pass
+        [[nodiscard]] VkRenderPass getRenderPass(const char* passName) const;
+        [[nodiscard]] bool isCulled(const char* passName) const;
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+    private:
+        enum class ImageAccess{
+            ColorAttachment,
+            DepthAttachment,
+            Sampled,
+            Storage
+        };
+        struct Access{
+            RenderResource m_image{};
+            ImageAccess m_access{};
+            bool m_clear{};
+            VkClearValue m_clearValue{};
+        };
+        // what an access needs from the image
+        struct Usage{
+            VkImageLayout m_layout{};
+            VkPipelineStageFlags m_stages{};
+            VkAccessFlags m_access{};
+        };
+        // what the last accesses left the image in, the stages of the reads since the last write accumulate
+        struct ImageState{
+            VkImageLayout m_layout{VK_IMAGE_LAYOUT_UNDEFINED};
+            VkPipelineStageFlags m_stages{};
+            VkAccessFlags m_writeAccess{};
+        };
+        struct Barrier{
+            RenderResource m_image{};
+            VkImageLayout m_oldLayout{};
+            VkImageLayout m_newLayout{};
+            VkAccessFlags m_srcAccess{};
+            VkAccessFlags m_dstAccess{};
+        };
+        struct BarrierBatch{
+            VkPipelineStageFlags m_srcStages{};
+            VkPipelineStageFlags m_dstStages{};
+            std::vector<Barrier> m_barriers{};
+        };
+
+        struct Image{
+            const char* m_name{};
+            ImageDesc m_desc{};
+            // the view only has the depth aspect of a depth stencil format, the barriers have both
+            VkImageAspectFlags m_viewAspect{};
+            VkImageAspectFlags m_barrierAspect{};
+            VkImageUsageFlags m_usage{};
+            bool m_imported{};
+            bool m_transient{};
+            VkImageLayout m_finalLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+            std::vector<VkImage> m_images{};
+            std::vector<VkImageView> m_views{};
+            // the dedicated allocation of a transient image
+            VmaAllocation m_allocation{};
+            // live passes using it, in execution order
+            uint32_t m_firstPass{UINT32_MAX};
+            uint32_t m_lastPass{};
+            // the state its last use of a frame leaves it in, the first barrier of the next frame waits for it
+            ImageState m_lastUse{};
+            uint32_t m_block{UINT32_MAX};
+        };
+        struct Pass{
+            const char* m_name{};
+            PassType m_type{};
+            std::vector<Access> m_accesses{};
+            std::function<void(const PassContext&)> m_execute{};
+            std::function<VkExtent2D()> m_renderArea{};
+            bool m_secondaryCommandBuffers{};
+            bool m_countFragments{};
+            bool m_sideEffects{};
+            bool m_culled{};
+
+            VkRenderPass m_renderPass{};
+            // one per index of the imported attachments, a single one without
+            std::vector<VkFramebuffer> m_framebuffers{};
+            VkExtent2D m_extent{};
+            std::vector<VkClearValue> m_clearValues{};
+            BarrierBatch m_barriers{};
+        };
+        // images with disjoint lifetimes bound at offset 0 of the same memory
+        struct MemoryBlock{
+            VkMemoryRequirements m_requirements{};
+            std::vector<RenderResource> m_images{};
+            VmaAllocation m_allocation{};
+            // every image of the block ends the frame in it, the first use of each waits for all of them
+            ImageState m_lastUse{};
+        };
+
+        Device& m_rDevice;
+        GpuProfiler* m_pProfiler;
+
+        std::vector<Image> m_images{};
+        std::vector<Pass> m_passes{};
+        std::vector<MemoryBlock> m_blocks{};
+        BarrierBatch m_finalBarriers{};
+        bool m_compiled{};
+        Stats m_stats{};
+
+        void addAccess(uint32_t pass, const Access& access);
+        void cullPasses();
+        void computeLifetimes();
+        void allocateImages();
+        void createRenderPasses();
+        void createBarriers();
+        void recordBarriers(VkCommandBuffer cmd, const BarrierBatch& batch, uint32_t imageIndex) const;
+        [[nodiscard]] const Pass* findPass(const char* name) const;
+
+        [[nodiscard]] static bool isWrite(ImageAccess access) { return access != ImageAccess::Sampled; }
+        [[nodiscard]] static Usage getUsage(const Image& image, ImageAccess access, PassType type);
+        [[nodiscard]] static VkImageUsageFlags usageFlags(ImageAccess access);
+        // the images' states at the end of the frame, the barriers are recorded into the passes when record is set
+        std::vector<ImageState> simulate(bool record);
+    };
+}
+
+#endif //IRIS_RENDERGRAPH_HPP
@@ -6,14 +6,33 @@
 
 namespace iris::graphics{
 
-    DeferredRenderer::DeferredRenderer(Device &device, Window &window) : Renderer(device, window) {
-        m_pSwapchain = std::make_unique<Swapchain>(device, window.getExtent());
+    DeferredRenderer::DeferredRenderer(Device &device, Window &window, LightingMode lightingMode,
+                                       LatencyProfile latencyProfile)
+    : Renderer(device, window), m_lightingMode{lightingMode} {
+        m_pSwapchain = std::make_unique<Swapchain>(device, window.getExtent(), latencyProfile);
     }
 
     DeferredRenderer::~DeferredRenderer() {
         vkDeviceWaitIdle(m_rDevice.getDevice());
-        vkDestroyPipelineLayout(m_rDevice.getDevice(), m_lightPipelineLayout, nullptr);
-        vkDestroyRenderPass(m_rDevice.getDevice(), m_renderPass, nullptr);
+        m_destructionQueue.flush();
+        m_lightingPipeline.reset();
+        m_lightVolumePipeline.reset();
+        m_pUpscaler.reset();
+        vkDestroyPipelineLayout(m_rDevice.getDevice(), m_lightingPipelineLayout, nullptr);
+        vkDestroySampler(m_rDevice.getDevice(), m_nearestSampler, nullptr);
+
+        destroyTexture(m_albedoTexture);
+        destroyTexture(m_specularTexture);
+        destroyTexture(m_normalTexture);
+        destroyTexture(m_depthTexture);
+
+        if (m_pRenderGraph) {
+            // the graph owns its render passes
+            m_pRenderGraph.reset();
+        }
+        else {
+            vkDestroyRenderPass(m_rDevice.getDevice(), m_gBufferRenderPass, nullptr);
+        }
     }
 
     void DeferredRenderer::postRender() {
@@ -23,425 +42,439 @@ namespace iris::graphics{
 
     void DeferredRenderer::init() {
         createCommandBuffers();
-        initRenderPass();
-        initGPassTextures();
-        initGPassFramebuffer();
+        createFrameRing();
+        createGpuProfiler();
+        if (m_lightingMode == LightingMode::TiledCompute) {
+            VkSamplerCreateInfo samplerInfo = Initializers::createSamplerInfo(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+            Debugger::vkCheck(vkCreateSampler(m_rDevice.getDevice(), &samplerInfo, nullptr, &m_nearestSampler),
+                              "Failed to create G-buffer sampler!");
+            initRenderGraph();
+            m_dynamicResolutionSupported = true;
+        }
+        else {
+            initGPassTextures();
+            initSubpassRenderPass();
+            // the G-buffer is shared by every swapchain framebuffer
+            m_pSwapchain->createFramebuffersWithAttachments(m_gBufferRenderPass, {m_albedoTexture.m_imageView,
+                                                                                  m_normalTexture.m_imageView,
+                                                                                  m_specularTexture.m_imageView,
+                                                                                  m_depthTexture.m_imageView});
+            updateAttachmentMemoryStats({&m_albedoTexture, &m_normalTexture, &m_specularTexture, &m_depthTexture});
+        }
     }
 
     void DeferredRenderer::loadRenderer() {
-        initLightPassPipeline();
+        // the pipelines of the lighting and the materials are compiled together
+        PipelineBuildQueue buildQueue{m_rDevice};
         initGBufferDescriptorSets();
-        initMaterials();
+        if (m_lightingMode == LightingMode::TiledCompute) {
+            initLightingDescriptorSets();
+            initLightingPipeline(buildQueue);
+        }
+        else {
+            initInputAttachmentDescriptorSet();
+            initSubpassLightingPipeline(buildQueue);
+            if (m_lightingMode == LightingMode::LightVolumes) {
+                initLightVolumePipeline(buildQueue);
+            }
+        }
+        initMaterials(buildQueue);
+        buildQueue.build();
+
+        AssetsManager::setMaterialTextures(AssetsManager::findMaterial("DefaultMeshTextured"),
+                AssetsManager::findTexture("StarAmbient"), AssetsManager::findTexture("StarDiffuse"),
+                AssetsManager::findTexture("StarSpecular"),
+                *m_pGlobalPool, *m_pTexturedSetLayout);
+    }
+
+    void DeferredRenderer::recreateSizeDependentResources() {
+        if (m_lightingMode == LightingMode::TiledCompute) {
+            // the graph imported the previous swapchain images and sized its own after them
+            const float sharpness = m_pUpscaler->getSharpness();
+            retire(m_pUpscaler);
+            retire(m_pRenderGraph);
+            initRenderGraph();
+            m_pUpscaler->setSharpness(sharpness);
+            retireDescriptorSet(*m_pGlobalPool, m_lightingDescriptorSet);
+            writeLightingDescriptorSet();
+            return;
+        }
+
+        retireTexture(m_albedoTexture);
+        retireTexture(m_normalTexture);
+        retireTexture(m_specularTexture);
+        retireTexture(m_depthTexture);
+        initGPassTextures();
+        m_pSwapchain->createFramebuffersWithAttachments(m_gBufferRenderPass, {m_albedoTexture.m_imageView,
+                                                                              m_normalTexture.m_imageView,
+                                                                              m_specularTexture.m_imageView,
+                                                                              m_depthTexture.m_imageView});
+        retireDescriptorSet(*m_pGlobalPool, m_inputAttachmentDescriptorSet);
+        writeInputAttachmentDescriptorSet();
+        updateAttachmentMemoryStats({&m_albedoTexture, &m_normalTexture, &m_specularTexture, &m_depthTexture});
     }
 
     VkCommandBuffer DeferredRenderer::beginFrame() {
-        uint32_t imageIndex = m_pSwapchain->acquireNextImage(getCurrentFrame());
-        auto cmd = m_commandBuffers[getCurrentFrame()];
-        //now that we are sure that the commands finished executing, we can safely reset the command buffer to begin recording again.
-        Debugger::vkCheck(vkResetCommandBuffer(cmd, 0),
-                          "Failed to reset command buffer!");
-
-        VkCommandBufferBeginInfo beginInfo = Initializers::createCommandBufferBeginInfo();
-        Debugger::vkCheck(vkBeginCommandBuffer(cmd, &beginInfo),
-                          "Failed to begin recording command buffer!");
-
-        // renderpass begin
-        VkRenderPassBeginInfo renderPassInfo = Initializers::renderPassBeginInfo(m_renderPass,
-                                                                                 m_pSwapchain->getExtent(),
-                                                                                 m_pSwapchain->getFrameBuffer(imageIndex));
-        VkClearValue clearValue;
-        clearValue.color = { { 0.5f, 0.5f, 0.5f, 1.0f } };
-
-        //clear depth at 1
-        VkClearValue depthClear;
-        depthClear.depthStencil.depth = 1.f;
-        //connect clear values
-        renderPassInfo.clearValueCount = 2;
-
-        VkClearValue clearValues[] = { clearValue, depthClear };
-
-        renderPassInfo.pClearValues = &clearValues[0];
-
-        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_pSwapchain->getExtent().width);
-        viewport.height = static_cast<float>(m_pSwapchain->getExtent().height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        VkRect2D scissor{ {0, 0}, m_pSwapchain->getExtent() };
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-        return cmd;
+        acquireSwapchainImage();
+        // the passes begin their own render passes
+        return beginCommandBuffer();
     }
 
     void
-    DeferredRenderer::renderScene(std::vector<RenderObject> &renderObjects, GpuSceneData sceneData, Camera &camera) {
+    DeferredRenderer::renderScene(const EntityStore& entities, const TransformStore& transforms,
+                                  const std::vector<PointLight>& pointLights,
+                                  const GpuSceneData& sceneData, Camera &camera) {
         VkCommandBuffer cmd = beginFrame();
 
-        sceneData.m_projectionMatrix = camera.m_projectionMatrix;
-        sceneData.m_viewMatrix = camera.m_viewMatrix;
-
-        m_rDevice.copyToBuffer(&sceneData,
-                               m_uboSceneBuffers[getCurrentFrame()],
-                               sizeof(GpuSceneData));
-
-        camera.update(getSwapchainExtent(),
-                      utils::Timer::getDeltaTime());
-
-        std::shared_ptr<Model> lastModel = nullptr;
-        std::shared_ptr<Material> lastMaterial = nullptr;
-        for(auto & renderObject : renderObjects){
-            renderObject.updateInfo();
-            auto material = renderObject.m_pMaterial;
-            if(lastMaterial != material){
-                material->getPipeline()->bind(cmd);
-
-                vkCmdBindDescriptorSets(
-                        cmd,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        material->getPipeLineLayout(),
-                        0,
-                        1,
-                        &m_sceneDescriptorSets[getCurrentFrame()],
-                        0,
-                        nullptr
-                );
-
-                if(material->getTextureSet() != VK_NULL_HANDLE){
-                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                            material->getPipeLineLayout(), 1, 1,
-                                            &material->getTextureSet(), 0, nullptr);
-                }
-
-                lastMaterial = material;
-            }
-
-
-            vkCmdPushConstants(
-                    cmd,
-                    material->getPipeLineLayout(),
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(RenderObject::GpuObjectData),
-                    &renderObject.m_gpuObjectData);
+        updateCamera(camera);
 
+        SceneAllocations sceneAllocations = writeSceneData(cmd, sceneData, transforms, pointLights, camera);
 
-            if(lastModel != renderObject.m_pModel){
-                renderObject.m_pModel->bind(cmd);
-                lastModel = renderObject.m_pModel;
-            }
-            renderObject.m_pModel->draw(cmd);
+        recordShadows(cmd, entities, m_sceneDescriptorSet, sceneAllocations);
+        if (m_lightingMode == LightingMode::TiledCompute) {
+            m_pFrameEntities = &entities;
+            m_frameAllocations = sceneAllocations;
+            m_pRenderGraph->execute(cmd, m_imageIndex);
+        }
+        else {
+            recordSubpassPasses(cmd, entities, sceneAllocations, static_cast<uint32_t>(pointLights.size()));
         }
 
-        m_lightPipeline->bind(cmd);
-
-        m_screenQuad.bind(cmd);
-        m_screenQuad.draw(cmd);
         endFrame(cmd);
     }
 
     void DeferredRenderer::endFrame(VkCommandBuffer cmd) {
-        vkCmdEndRenderPass(cmd);
+        m_pGpuProfiler->endFrame(cmd);
         Debugger::vkCheck(vkEndCommandBuffer(cmd), "Failed to record command buffer!");
 
-        m_pSwapchain->submitCommandBuffers(&cmd, getCurrentFrame());
-        m_frameCount++;
-    }
+        m_pFrameRing->flush();
+        m_frameStats.m_frameRing = m_pFrameRing->getStats();
+        if (!m_pRenderGraph) {
+            updateAttachmentMemoryStats({&m_albedoTexture, &m_normalTexture, &m_specularTexture, &m_depthTexture});
+        }
 
-    void DeferredRenderer::createCommandBuffers() {
-        m_commandBuffers.resize(m_pSwapchain->m_cMaxImagesOnFlight);
-        VkCommandBufferAllocateInfo allocInfo = Initializers::createCommandBufferAllocateInfo(m_rDevice.getCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()));
-        Debugger::vkCheck(vkAllocateCommandBuffers(m_rDevice.getDevice(), &allocInfo, m_commandBuffers.data()),
-                          "Failed to allocate command buffers!");
+        presentFrame(cmd);
     }
 
-    void DeferredRenderer::freeCommandBuffers() {
-        vkFreeCommandBuffers(
-                m_rDevice.getDevice(),
-                m_rDevice.getCommandPool(),
-                static_cast<uint32_t>(m_commandBuffers.size()),
-                m_commandBuffers.data());
-        m_commandBuffers.clear();
+    void DeferredRenderer::recordGeometryPass(const RenderGraph::PassContext &context) {
+        recordEntities(context.m_cmd, *m_pFrameEntities, context.m_renderPass, 0, context.m_framebuffer,
+                       m_sceneDescriptorSet, m_frameAllocations);
     }
 
-    void DeferredRenderer::createImage(VkDevice device, VmaAllocator allocator,
-                                       uint32_t width, uint32_t height,
-                                       VkFormat format, VkImageUsageFlags usage,
-                                       AllocatedImage &allocatedImage) {
-        VkImageCreateInfo imageInfo = {};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent.width = width;
-        imageInfo.extent.height = height;
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
-        imageInfo.format = format;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = usage;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &allocatedImage.m_image,
-                           &allocatedImage.m_allocation, nullptr) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create image!");
-        }
+    void DeferredRenderer::recordLightingPass(const RenderGraph::PassContext &context) {
+        m_lightingPipeline->bind(context.m_cmd);
+        const auto dynamicOffsets = getSceneDynamicOffsets(m_frameAllocations);
+        vkCmdBindDescriptorSets(context.m_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightingPipelineLayout, 0, 1,
+                                &m_sceneDescriptorSet, m_cSceneDynamicOffsetCount, dynamicOffsets.data());
+        vkCmdBindDescriptorSets(context.m_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightingPipelineLayout, 1, 1,
+                                &m_lightingDescriptorSet, 0, nullptr);
+
+        // one work group per tile, the partial tiles at the right and bottom edges skip their outside pixels
+        const VkExtent2D extent = context.m_renderArea;
+        vkCmdDispatch(context.m_cmd, (extent.width + m_cLightTileSize - 1) / m_cLightTileSize,
+                      (extent.height + m_cLightTileSize - 1) / m_cLightTileSize, 1);
     }
 
-    void
-    DeferredRenderer::createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
-                                      VkImageView &imageView) {
-        VkImageViewCreateInfo viewInfo = {};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = format;
-        viewInfo.subresourceRange.aspectMask = aspectFlags;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
-
-        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create texture image view!");
-        }
+    void DeferredRenderer::recordCompositePass(const RenderGraph::PassContext &context) {
+        // the composite pass is a single draw covering every pixel, it is recorded inline
+        m_pUpscaler->record(context.m_cmd, getRenderExtent(), context.m_renderArea);
     }
 
-    void DeferredRenderer::transitionGBufferImageLayouts() {
-        m_rDevice.immediateSubmit([this](VkCommandBuffer commandBuffer) {
-            VkImageMemoryBarrier barrier = {};
-            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            barrier.subresourceRange.baseMipLevel = 0;
-            barrier.subresourceRange.levelCount = 1;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-            // Transition layouts for albedo, normal, specular, and position images
-            std::vector<VkImage> images = {m_albedoTexture.m_allocatedImage.m_image, m_normalTexture.m_allocatedImage.m_image, m_specularTexture.m_allocatedImage.m_image, m_positionTexture.m_allocatedImage.m_image};
-            for (VkImage image : images) {
-                barrier.image = image;
-                vkCmdPipelineBarrier(
-                        commandBuffer,
-                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        0, // No dependency flags
-                        0, nullptr, // No memory barriers
-                        0, nullptr, // No buffer barriers
-                        1, &barrier // Image barrier
-                );
-            }
+    void DeferredRenderer::recordSubpassPasses(VkCommandBuffer cmd, const EntityStore &entities,
+                                               const SceneAllocations &sceneAllocations, uint32_t lightCount) {
+        // both subpasses are timed together, timestamps cannot be written between them
+        const uint32_t scope = m_pGpuProfiler->beginScope(cmd, "geometry + lighting");
 
-            // Transition for depth image
-            barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-            barrier.image = m_depthTexture.m_allocatedImage.m_image;
-            vkCmdPipelineBarrier(
-                    commandBuffer,
-                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                    0,
-                    0, nullptr,
-                    0, nullptr,
-                    1, &barrier
-            );
-        });
+        VkRenderPassBeginInfo renderPassInfo = Initializers::renderPassBeginInfo(m_gBufferRenderPass,
+                                                                                 m_pSwapchain->getExtent(),
+                                                                                 m_pSwapchain->getFrameBuffer(m_imageIndex));
+        // a depth of 1 marks the pixels no geometry was drawn on, the swapchain image is fully overwritten
+        VkClearValue clearValues[5]{};
+        clearValues[3].depthStencil.depth = 1.f;
+        renderPassInfo.clearValueCount = 5;
+        renderPassInfo.pClearValues = clearValues;
+
+        // the fragment invocations count the lighting subpass too
+        m_pGpuProfiler->beginStatistics(cmd);
+        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        recordEntities(cmd, entities, m_gBufferRenderPass, 0, m_pSwapchain->getFrameBuffer(m_imageIndex),
+                       m_sceneDescriptorSet, sceneAllocations);
+
+        // the lighting subpass is a single draw, it is recorded inline
+        vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+        setViewportAndScissor(cmd);
+
+        m_lightingPipeline->bind(cmd);
+        const auto dynamicOffsets = getSceneDynamicOffsets(sceneAllocations);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_lightingPipelineLayout, 0, 1,
+                                &m_sceneDescriptorSet, m_cSceneDynamicOffsetCount, dynamicOffsets.data());
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_lightingPipelineLayout, 1, 1,
+                                &m_inputAttachmentDescriptorSet, 0, nullptr);
+
+        m_screenQuad.bind(cmd);
+        m_screenQuad.draw(cmd);
+
+        if (m_lightingMode == LightingMode::LightVolumes && lightCount > 0) {
+            // same layout, the bound sets stay valid. The boxes are built by the vertex shader, no vertex buffer
+            m_lightVolumePipeline->bind(cmd);
+            vkCmdDraw(cmd, 36, lightCount, 0, 0);
+        }
+        vkCmdEndRenderPass(cmd);
+        m_pGpuProfiler->endStatistics(cmd);
+
+        m_pGpuProfiler->endScope(cmd, scope);
     }
 
     void DeferredRenderer::initGPassTextures() {
-        VkFormat albedoFormat = VK_FORMAT_R16G16B16A16_SFLOAT;     // Albedo might be stored with standard color format
-        VkFormat normalFormat = VK_FORMAT_R16G16B16A16_SFLOAT; // Normals need high precision
-        VkFormat specularFormat = VK_FORMAT_R16G16B16A16_SFLOAT;    // Specular or roughness/metallic might also use standard color format
-        VkFormat positionFormat = VK_FORMAT_R16G16B16A16_SFLOAT; // High precision for position data
         VkFormat depthFormat = m_pSwapchain->findDepthFormat();
+        const VkExtent2D extent = m_pSwapchain->getExtent();
 
+        // the lighting subpass reads the G-buffer from tile memory, it is never stored
+        const VkImageUsageFlags readUsage = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
 
-        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), m_pSwapchain->getExtent().width, m_pSwapchain->getExtent().height, albedoFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_albedoTexture.m_allocatedImage);
-        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), m_pSwapchain->getExtent().width, m_pSwapchain->getExtent().height, normalFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_normalTexture.m_allocatedImage);
-        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), m_pSwapchain->getExtent().width, m_pSwapchain->getExtent().height, specularFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_specularTexture.m_allocatedImage);
-        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), m_pSwapchain->getExtent().width, m_pSwapchain->getExtent().height, positionFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_positionTexture.m_allocatedImage);
-        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), m_pSwapchain->getExtent().width, m_pSwapchain->getExtent().height, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, m_depthTexture.m_allocatedImage);
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, m_cAlbedoFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage, m_albedoTexture.m_allocatedImage, true);
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, m_cNormalFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage, m_normalTexture.m_allocatedImage, true);
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, m_cSpecularFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | readUsage, m_specularTexture.m_allocatedImage, true);
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | readUsage, m_depthTexture.m_allocatedImage, true);
 
-        createImageView(m_rDevice.getDevice(), m_albedoTexture.m_allocatedImage.m_image, albedoFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_albedoTexture.m_imageView);
-        createImageView(m_rDevice.getDevice(), m_normalTexture.m_allocatedImage.m_image, normalFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_normalTexture.m_imageView);
-        createImageView(m_rDevice.getDevice(), m_specularTexture.m_allocatedImage.m_image, specularFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_specularTexture.m_imageView);
-        createImageView(m_rDevice.getDevice(), m_positionTexture.m_allocatedImage.m_image, positionFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_positionTexture.m_imageView);
+        createImageView(m_rDevice.getDevice(), m_albedoTexture.m_allocatedImage.m_image, m_cAlbedoFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_albedoTexture.m_imageView);
+        createImageView(m_rDevice.getDevice(), m_normalTexture.m_allocatedImage.m_image, m_cNormalFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_normalTexture.m_imageView);
+        createImageView(m_rDevice.getDevice(), m_specularTexture.m_allocatedImage.m_image, m_cSpecularFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_specularTexture.m_imageView);
+        // only the depth is read, the stencil of a combined format is ignored
         createImageView(m_rDevice.getDevice(), m_depthTexture.m_allocatedImage.m_image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, m_depthTexture.m_imageView);
-
-        transitionGBufferImageLayouts();
     }
 
-    void DeferredRenderer::initGPassFramebuffer() {
-        // Assuming the textures are already created and have valid image views.
-        std::vector<VkImageView> attachments;
-        attachments.resize(6);
-        attachments[0] = m_albedoTexture.m_imageView;  // Albedo attachment
-        attachments[1] = m_specularTexture.m_imageView;  // Normal attachment
-        attachments[2] = m_normalTexture.m_imageView; // Specular attachment
-        attachments[3] = m_positionTexture.m_imageView; // Position attachment
-        attachments[4] = m_depthTexture.m_imageView;   // Depth attachment
-        attachments[5] = VK_NULL_HANDLE;
-
-        // Create the framebuffer for the G-buffer pass
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = m_renderPass;
-        framebufferInfo.attachmentCount = attachments.size();
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = m_pSwapchain->getExtent().width;
-        framebufferInfo.height = m_pSwapchain->getExtent().height;
-        framebufferInfo.layers = 1;
-
-
-        if (vkCreateFramebuffer(m_rDevice.getDevice(), &framebufferInfo, nullptr, &m_gBufferFramebuffer) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create G-buffer framebuffer");
-        }
-
-        m_pSwapchain->createFramebufferWithAttachments(m_renderPass, attachments.size());
+    void DeferredRenderer::initRenderGraph() {
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+        const VkFormat depthFormat = m_pSwapchain->findDepthFormat();
+        m_pRenderGraph = std::make_unique<RenderGraph>(m_rDevice, m_pGpuProfiler.get());
+        const RenderResource swapchainImage = m_pRenderGraph->importImage(
+                "swapchain", {m_pSwapchain->getSwapchainImageFormat(), extent},
+                m_pSwapchain->getImages(), m_pSwapchain->getImageViews(), m_pSwapchain->getFinalLayout());
+
+        // only the rendered region is cleared and drawn, the lighting pass never reads past it
+        m_pRenderGraph->addPass("geometry", RenderGraph::PassType::Graphics, [&](RenderGraph::PassBuilder& builder) {
+            m_albedoImage = builder.createImage("albedo", {m_cAlbedoFormat, extent});
+            m_normalImage = builder.createImage("normal", {m_cNormalFormat, extent});
+            m_specularImage = builder.createImage("specular", {m_cSpecularFormat, extent});
+            m_depthImage = builder.createImage("depth", {depthFormat, extent});
+            builder.writeColor(m_albedoImage, VkClearColorValue{});
+            builder.writeColor(m_normalImage, VkClearColorValue{});
+            builder.writeColor(m_specularImage, VkClearColorValue{});
+            // a depth of 1 marks the pixels no geometry was drawn on
+            builder.writeDepth(m_depthImage, 1.f);
+            builder.setRenderArea([this]() { return getRenderExtent(); });
+            builder.useSecondaryCommandBuffers();
+            builder.countFragments();
+        }, [this](const RenderGraph::PassContext& context) { recordGeometryPass(context); });
+
+        m_pRenderGraph->addPass("lighting", RenderGraph::PassType::Compute, [&](RenderGraph::PassBuilder& builder) {
+            builder.readSampled(m_albedoImage);
+            builder.readSampled(m_normalImage);
+            builder.readSampled(m_specularImage);
+            builder.readSampled(m_depthImage);
+            m_litImage = builder.createImage("lit", {m_cLitFormat, extent});
+            builder.writeStorage(m_litImage);
+            builder.setRenderArea([this]() { return getRenderExtent(); });
+        }, [this](const RenderGraph::PassContext& context) { recordLightingPass(context); });
+
+        m_pRenderGraph->addPass("composite", RenderGraph::PassType::Graphics, [&](RenderGraph::PassBuilder& builder) {
+            builder.readSampled(m_litImage);
+            builder.writeColor(swapchainImage);
+        }, [this](const RenderGraph::PassContext& context) { recordCompositePass(context); });
+
+        m_pRenderGraph->compile();
+
+        // the geometry pipelines are created against the graph's render pass, the ones of a graph built again at
+        // another extent are compatible with them
+        m_gBufferRenderPass = m_pRenderGraph->getRenderPass("geometry");
+        m_pUpscaler = std::make_unique<Upscaler>(m_rDevice, m_pRenderGraph->getRenderPass("composite"), 0,
+                                                 m_pRenderGraph->getImageView(m_litImage), extent);
+
+        // the graph's images never change, neither do its stats. Its blocks are fully committed
+        const RenderGraph::Stats& graphStats = m_pRenderGraph->getStats();
+        m_frameStats.m_renderGraph = graphStats;
+        m_frameStats.m_attachmentBytesAllocated = graphStats.m_bytesAllocated;
+        m_frameStats.m_attachmentBytesCommitted = graphStats.m_bytesAllocated;
     }
 
-    void DeferredRenderer::initRenderPass() {
-        // Create attachment descriptions for G-buffer components and final output
+    void DeferredRenderer::initSubpassRenderPass() {
+        // nothing of the G-buffer survives the render pass, only the swapchain image is stored
         std::vector<VkAttachmentDescription> attachments = {
-                Initializers::createAttachmentDescription(VK_FORMAT_R16G16B16A16_SFLOAT,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Albedo
-                Initializers::createAttachmentDescription(VK_FORMAT_R16G16B16A16_SFLOAT,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Normal
-                Initializers::createAttachmentDescription(VK_FORMAT_R16G16B16A16_SFLOAT,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),     // Specular
-                Initializers::createAttachmentDescription(VK_FORMAT_R16G16B16A16_SFLOAT,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Position
-                Initializers::createAttachmentDescription(m_pSwapchain->findDepthFormat(),  VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL),// Depth
-                Initializers::createAttachmentDescription(m_pSwapchain->getSwapchainImageFormat(),  VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) // Final output
+                Initializers::createAttachmentDescription(m_cAlbedoFormat,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Albedo
+                Initializers::createAttachmentDescription(m_cNormalFormat,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Normal
+                Initializers::createAttachmentDescription(m_cSpecularFormat,  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Specular
+                Initializers::createAttachmentDescription(m_pSwapchain->findDepthFormat(),  VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL), // Depth
+                Initializers::createAttachmentDescription(m_pSwapchain->getSwapchainImageFormat(), m_pSwapchain->getFinalLayout()) // Final output
         };
+        for (uint32_t i = 0; i < 4; i++) {
+            attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+        // the lighting draw covers every pixel, the ambient one in LightVolumes mode
+        attachments[4].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 
-        // Reference to G-buffer attachments in subpass 1
+        // Reference to G-buffer attachments in subpass 0
         VkAttachmentReference albedoRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
         VkAttachmentReference normalRef = {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
         VkAttachmentReference specularRef = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-        VkAttachmentReference positionRef = {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-        VkAttachmentReference depthRef = {4, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-        std::vector<VkAttachmentReference> gBufferAttachmentRefs = { albedoRef, normalRef, specularRef, positionRef };
+        VkAttachmentReference depthRef = {3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+        std::vector<VkAttachmentReference> gBufferAttachmentRefs = { albedoRef, normalRef, specularRef };
 
-        // Setup for subpass 1 (G-buffer generation)
         VkSubpassDescription gBufferSubpass = {};
         gBufferSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         gBufferSubpass.colorAttachmentCount = static_cast<uint32_t>(gBufferAttachmentRefs.size());
         gBufferSubpass.pColorAttachments = gBufferAttachmentRefs.data();
         gBufferSubpass.pDepthStencilAttachment = &depthRef;
 
-        // Reference to final color attachment in subpass 2
-        VkAttachmentReference finalColorRef = {5, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        // the same attachments read back as inputs in subpass 1
+        std::vector<VkAttachmentReference> inputRefs = {
+                {0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                {3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}
+        };
+        VkAttachmentReference finalColorRef = {4, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        // the light volumes are depth tested against the scene, in the read only layout the depth can be both an
+        // input and the depth attachment
+        VkAttachmentReference readOnlyDepthRef = {3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
 
-        // Setup for subpass 2 (lighting calculation using G-buffer)
         VkSubpassDescription lightingSubpass = {};
         lightingSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        lightingSubpass.inputAttachmentCount = static_cast<uint32_t>(inputRefs.size());
+        lightingSubpass.pInputAttachments = inputRefs.data();
         lightingSubpass.colorAttachmentCount = 1;
         lightingSubpass.pColorAttachments = &finalColorRef;
+        if (m_lightingMode == LightingMode::LightVolumes) {
+            lightingSubpass.pDepthStencilAttachment = &readOnlyDepthRef;
+        }
 
-        // Setup subpass dependencies for correct ordering and layout transitions
         std::vector<VkSubpassDependency> dependencies = {
+                // the previous frame's lighting subpass reads the G-buffer this frame overwrites, and the swapchain
+                // image is written once the acquire semaphore, waited at the color output stage, is signaled
                 {
                         .srcSubpass = VK_SUBPASS_EXTERNAL,
                         .dstSubpass = 0,
-                        .srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
                         .srcAccessMask = 0,
-                        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                        .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+                        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        .dependencyFlags = 0
                 },
+                // by region, each pixel only reads its own G-buffer texel so the tiles stay on chip
                 {
                         .srcSubpass = 0,
                         .dstSubpass = 1,
-                        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-                        .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
-                },
-                {
-                        .srcSubpass = 1,
-                        .dstSubpass = VK_SUBPASS_EXTERNAL,
-                        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+                        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
                         .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
                 }
         };
 
         std::vector<VkSubpassDescription> subpasses { gBufferSubpass, lightingSubpass };
 
-        // Create the render pass with both subpasses
         VkRenderPassCreateInfo renderPassInfo = Initializers::createRenderPassInfo(attachments, subpasses, dependencies);
-        if (vkCreateRenderPass(m_rDevice.getDevice(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create the render pass.");
-        }
+        Debugger::vkCheck(vkCreateRenderPass(m_rDevice.getDevice(), &renderPassInfo, nullptr, &m_gBufferRenderPass),
+                          "Failed to create deferred render pass!");
     }
 
-
     void DeferredRenderer::initGBufferDescriptorSets() {
-        // initialize the global descriptor sets
-        m_sceneDescriptorSets.resize(getMaximumFramesInFlight());
-        m_uboSceneBuffers.resize(getMaximumFramesInFlight());
-
+        // initialize the global descriptor set
+        // the sets pointing at the attachments are freed when those are recreated
         m_pGlobalPool = DescriptorPool::Builder(m_rDevice)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
                 .setMaxSets(100)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 40)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 10)
                 .build();
 
-        for(auto & uboBuffer : m_uboSceneBuffers)
-        {
-            uboBuffer = m_rDevice.createBuffer(sizeof(GpuSceneData),VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                               VMA_MEMORY_USAGE_CPU_TO_GPU);
-        }
+        m_pGlobalSetLayout = createSceneSetLayout();
+        createShadowMaps(*m_pGlobalSetLayout);
+        writeSceneDescriptorSet(*m_pGlobalSetLayout, *m_pGlobalPool, m_sceneDescriptorSet);
 
-        m_pGlobalSetLayout = DescriptorSetLayout::Builder(m_rDevice)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+        m_pTexturedSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
                 .build();
+    }
 
-        for (int i = 0; i < m_sceneDescriptorSets.size(); i++)
-        {
-            VkDescriptorBufferInfo sceneInfo;
-            sceneInfo.buffer = m_uboSceneBuffers[i].m_buffer;
-            sceneInfo.offset = 0;
-            sceneInfo.range = sizeof(GpuSceneData);
+    void DeferredRenderer::initLightingDescriptorSets() {
+        m_pLightingSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Albedo
+                .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Normal
+                .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Specular
+                .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Depth
+                .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)          // Lit image
+                .build();
+        writeLightingDescriptorSet();
+    }
 
-            DescriptorWriter(*m_pGlobalSetLayout, *m_pGlobalPool)
-                    .writeBuffer(0, &sceneInfo)
-                    .build(m_sceneDescriptorSets[i]);
+    void DeferredRenderer::writeLightingDescriptorSet() {
+        // in the layouts the graph leaves them in for the lighting pass
+        VkDescriptorImageInfo gBufferInfos[4];
+        const RenderResource gBufferImages[4] = { m_albedoImage, m_normalImage, m_specularImage, m_depthImage };
+        for (int i = 0; i < 4; i++) {
+            gBufferInfos[i].sampler = m_nearestSampler;
+            gBufferInfos[i].imageView = m_pRenderGraph->getImageView(gBufferImages[i]);
+            gBufferInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         }
+        gBufferInfos[3].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        VkDescriptorImageInfo litStorageInfo;
+        litStorageInfo.sampler = VK_NULL_HANDLE;
+        litStorageInfo.imageView = m_pRenderGraph->getImageView(m_litImage);
+        litStorageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        DescriptorWriter(*m_pLightingSetLayout, *m_pGlobalPool)
+                .writeImage(0, &gBufferInfos[0])
+                .writeImage(1, &gBufferInfos[1])
+                .writeImage(2, &gBufferInfos[2])
+                .writeImage(3, &gBufferInfos[3])
+                .writeImage(4, &litStorageInfo)
+                .build(m_lightingDescriptorSet);
+    }
 
-        m_pTexturedSetLayout = DescriptorSetLayout::Builder(m_rDevice)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    void DeferredRenderer::initInputAttachmentDescriptorSet() {
+        m_pInputAttachmentSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Albedo
+                .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Normal
+                .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Specular
+                .addBinding(3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Depth
                 .build();
+        writeInputAttachmentDescriptorSet();
     }
 
-    void DeferredRenderer::initMaterials() {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(RenderObject::GpuObjectData);
+    void DeferredRenderer::writeInputAttachmentDescriptorSet() {
+        // in the layouts of the lighting subpass input references
+        VkDescriptorImageInfo inputInfos[4];
+        const Texture* gBufferTextures[4] = { &m_albedoTexture, &m_normalTexture, &m_specularTexture, &m_depthTexture };
+        for (int i = 0; i < 4; i++) {
+            inputInfos[i].sampler = VK_NULL_HANDLE;
+            inputInfos[i].imageView = gBufferTextures[i]->m_imageView;
+            inputInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+        inputInfos[3].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        DescriptorWriter(*m_pInputAttachmentSetLayout, *m_pGlobalPool)
+                .writeImage(0, &inputInfos[0])
+                .writeImage(1, &inputInfos[1])
+                .writeImage(2, &inputInfos[2])
+                .writeImage(3, &inputInfos[3])
+                .build(m_inputAttachmentDescriptorSet);
+    }
 
+    void DeferredRenderer::initMaterials(PipelineBuildQueue& buildQueue) {
         VkPipelineLayoutCreateInfo texturedPipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
         const std::vector texturedDescriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout(), m_pTexturedSetLayout->getDescriptorSetLayout()};
 
         texturedPipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(texturedDescriptorSetLayouts.size());
         texturedPipelineLayoutCreateInfo.pSetLayouts = texturedDescriptorSetLayouts.data();
-        texturedPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        texturedPipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
         VkPipelineLayout texturedPipelineLayout{};
 
@@ -451,45 +484,110 @@ namespace iris::graphics{
 
         assert(texturedPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        graphics::PipelineConfigInfo texturedPipelineConfigInfo{};
+        buildQueue.add([this, texturedPipelineLayout]() {
+            graphics::PipelineConfigInfo texturedPipelineConfigInfo{};
 
-        graphics::Pipeline::defaultPipelineConfig(texturedPipelineConfigInfo);
+            graphics::Pipeline::defaultPipelineConfig(texturedPipelineConfigInfo);
 
-        texturedPipelineConfigInfo.m_renderPass = m_renderPass;
-        texturedPipelineConfigInfo.m_pipelineLayout = texturedPipelineLayout;
+            // one blend state per G-buffer attachment
+            texturedPipelineConfigInfo.m_colorBlendInfo.attachmentCount = 3;
 
-        auto texturedPipeline = std::make_shared<Pipeline>(
-                m_rDevice,
-                "../shaders/DeferredGeometry.vert.spv",
-                "../shaders/DeferredGeometry.frag.spv",
-                texturedPipelineConfigInfo);
+            texturedPipelineConfigInfo.m_renderPass = m_gBufferRenderPass;
+            texturedPipelineConfigInfo.m_pipelineLayout = texturedPipelineLayout;
 
-        AssetsManager::loadMaterial(m_rDevice, "DefaultMeshTextured", texturedPipeline, texturedPipelineLayout);
-        auto mat = AssetsManager::getMaterial("DefaultMeshTextured");
-        mat->setTexture(AssetsManager::getTexture("StarAmbient"),
-                        AssetsManager::getTexture("StarDiffuse"),
-                        AssetsManager::getTexture("StarSpecular"),
-                        *m_pGlobalPool, *m_pTexturedSetLayout);
+            return std::make_unique<Pipeline>(
+                    m_rDevice,
+                    "../shaders/DeferredGeometry.vert.spv",
+                    "../shaders/DeferredGeometry.frag.spv",
+                    texturedPipelineConfigInfo);
+        }, [this, texturedPipelineLayout](std::unique_ptr<Pipeline> pipeline) {
+            AssetsManager::loadMaterial(m_rDevice, "DefaultMeshTextured", std::move(pipeline), texturedPipelineLayout);
+        });
     }
 
-    void DeferredRenderer::initLightPassPipeline() {
+    void DeferredRenderer::initLightingPipeline(PipelineBuildQueue& buildQueue) {
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
-        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &m_lightPipelineLayout),
+        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout(), m_pLightingSetLayout->getDescriptorSetLayout()};
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &m_lightingPipelineLayout),
                           "Failed to create pipeline layout");
-        assert(m_lightPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+        assert(m_lightingPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        graphics::PipelineConfigInfo pipelineConfig{};
-        graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
-        pipelineConfig.m_bindingDescriptions = ScreenQuad::getBindingDescriptions();
-        pipelineConfig.m_attributeDescriptions = ScreenQuad::getAttributeDescriptions();
+        buildQueue.add([this]() {
+            return std::make_unique<Pipeline>(m_rDevice, "../shaders/DeferredLight.comp.spv", m_lightingPipelineLayout);
+        }, [this](std::unique_ptr<Pipeline> pipeline) { m_lightingPipeline = std::move(pipeline); });
+    }
 
-        pipelineConfig.m_renderPass = m_renderPass;
-        pipelineConfig.m_pipelineLayout = m_lightPipelineLayout;
+    void DeferredRenderer::initSubpassLightingPipeline(PipelineBuildQueue& buildQueue) {
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
+        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout(), m_pInputAttachmentSetLayout->getDescriptorSetLayout()};
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &m_lightingPipelineLayout),
+                          "Failed to create pipeline layout");
+        assert(m_lightingPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        buildQueue.add([this]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            pipelineConfig.m_bindingDescriptions = ScreenQuad::getBindingDescriptions();
+            pipelineConfig.m_attributeDescriptions = ScreenQuad::getAttributeDescriptions();
+            // the quad covers every pixel, the depth is only read as an input
+            pipelineConfig.m_depthStencilInfo.depthTestEnable = VK_FALSE;
+            pipelineConfig.m_depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+            pipelineConfig.m_renderPass = m_gBufferRenderPass;
+            pipelineConfig.m_subpass = 1;
+            pipelineConfig.m_pipelineLayout = m_lightingPipelineLayout;
+
+            return std::make_unique<Pipeline>(
+                    m_rDevice,
+                    "../shaders/DeferredComposite.vert.spv",
+                    m_lightingMode == LightingMode::LightVolumes ? "../shaders/DeferredAmbient.frag.spv"
+                                                                 : "../shaders/DeferredLight.frag.spv",
+                    pipelineConfig);
+        }, [this](std::unique_ptr<Pipeline> pipeline) { m_lightingPipeline = std::move(pipeline); });
+    }
 
-        m_lightPipeline = std::make_shared<Pipeline>(
-                m_rDevice,
-                "../shaders/DeferredLight.vert.spv",
-                "../shaders/DeferredLight.frag.spv",
-                pipelineConfig);
+    void DeferredRenderer::initLightVolumePipeline(PipelineBuildQueue& buildQueue) {
+        assert(m_lightingPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        buildQueue.add([this]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            // the box corners come from gl_VertexIndex and the light from gl_InstanceIndex
+            pipelineConfig.m_bindingDescriptions.clear();
+            pipelineConfig.m_attributeDescriptions.clear();
+
+            // only the back faces are drawn, they pass where the scene surface is in front of them. The volume is still
+            // shaded with the camera inside it and the pixels behind it are rejected before the fragment shader, the
+            // ones in front of it are discarded by the shader's radius test
+            pipelineConfig.m_rasterizationInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
+            pipelineConfig.m_depthStencilInfo.depthTestEnable = VK_TRUE;
+            pipelineConfig.m_depthStencilInfo.depthWriteEnable = VK_FALSE;
+            pipelineConfig.m_depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+            // the lights add up on top of the ambient light
+            pipelineConfig.m_colorBlendAttachment.blendEnable = VK_TRUE;
+            pipelineConfig.m_colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.m_colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.m_colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+            pipelineConfig.m_colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            pipelineConfig.m_colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.m_colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+            pipelineConfig.m_renderPass = m_gBufferRenderPass;
+            pipelineConfig.m_subpass = 1;
+            pipelineConfig.m_pipelineLayout = m_lightingPipelineLayout;
+
+            return std::make_unique<Pipeline>(
+                    m_rDevice,
+                    "../shaders/DeferredLightVolume.vert.spv",
+                    "../shaders/DeferredLightVolume.frag.spv",
+                    pipelineConfig);
+        }, [this](std::unique_ptr<Pipeline> pipeline) { m_lightVolumePipeline = std::move(pipeline); });
     }
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 #define IRIS_DEFERREDRENDERER_HPP
 
 #include "Renderer.hpp"
+#include "../Upscaler.hpp"
+#include "../PipelineBuildQueue.hpp"
 #include <vector>
 
 struct QuadVertex{
@@ -124,9 +126,27 @@ namespace iris::graphics{
         }
     };
 
+    // geometry pass into the G-buffer, then one of two lighting modes:
+    // TiledCompute lights in a compute pass over 16x16 pixel tiles that culls the scene's lights per tile, then a
+    // composite pass upscales the lit image to the swapchain. Its three passes are a render graph that owns the
+    // G-buffer and the lit image and places the barriers between them. Only this mode supports dynamic resolution,
+    // the others light the swapchain image in the geometry render pass.
+    // Subpass lights in a second subpass of the geometry render pass reading the G-buffer as input attachments with
+    // the light clusters. The G-buffer never leaves the render pass, its attachments are transient and lazily
+    // allocated where the device supports it so tile based GPUs never commit their memory.
+    // LightVolumes uses the same render pass, its second subpass draws the ambient light then every point light as a
+    // box around its radius, additively blended. Only the pixels whose surface lies in front of the box's back faces
+    // are shaded, the lighting cost follows the lights' screen coverage
     class DeferredRenderer : public Renderer{
     public:
-        DeferredRenderer(Device& device, Window& window);
+        enum class LightingMode{
+            TiledCompute,
+            Subpass,
+            LightVolumes
+        };
+
+        DeferredRenderer(Device& device, Window& window, LightingMode lightingMode = LightingMode::TiledCompute,
+                         LatencyProfile latencyProfile = LatencyProfile::Balanced);
         ~DeferredRenderer() override;
 
         void init() override;
@@ -136,34 +156,48 @@ namespace iris::graphics{
         void endFrame(VkCommandBuffer cmd) override;
         void postRender() override;
 
-        void renderScene(std::vector<RenderObject> & renderObjects, GpuSceneData sceneData, Camera & camera) override;
+        void renderScene(const EntityStore& entities, const TransformStore& transforms,
+                         const std::vector<PointLight>& pointLights,
+                         const GpuSceneData& sceneData, Camera & camera) override;
     private:
-        void createCommandBuffers() override;
-        void freeCommandBuffers() override;
-
-        // init render pass with 2 sub pass
-        VkRenderPass m_renderPass;
-        void initRenderPass();
-
-        void createImage(VkDevice device, VmaAllocator allocator,
-                         uint32_t width, uint32_t height,
-                         VkFormat format, VkImageUsageFlags usage,
-                         AllocatedImage& allocatedImage);
-        void createImageView(VkDevice device, VkImage image, VkFormat format,
-                             VkImageAspectFlags aspectFlags, VkImageView& imageView);
-
-        void transitionGBufferImageLayouts();
-        // init textures that framebuffer will attach
+        // must match the local size of DeferredLight.comp
+        static constexpr uint32_t m_cLightTileSize = 16;
+
+        LightingMode m_lightingMode;
+
+        // writes albedo, normal, specular and depth, in Subpass mode its second subpass lights the swapchain image.
+        // Owned by the render graph in TiledCompute mode
+        VkRenderPass m_gBufferRenderPass{};
+        void initSubpassRenderPass();
+
+        // TiledCompute mode: geometry, lighting then composite, which draws the lit image on the swapchain image
+        // upscaled from the render extent
+        std::unique_ptr<RenderGraph> m_pRenderGraph{};
+        RenderResource m_albedoImage{};
+        RenderResource m_normalImage{};
+        RenderResource m_specularImage{};
+        RenderResource m_depthImage{};
+        RenderResource m_litImage{};
+        void initRenderGraph();
+        // what the graph's passes record this frame, set before it is executed
+        const EntityStore* m_pFrameEntities{};
+        SceneAllocations m_frameAllocations{};
+
+        // 12 bytes per pixel besides depth: srgb albedo, octahedral normal and specular. The lighting pass rebuilds
+        // the positions from the depth and the inverse view projection
+        static constexpr VkFormat m_cAlbedoFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        static constexpr VkFormat m_cNormalFormat = VK_FORMAT_R16G16_SNORM;
+        static constexpr VkFormat m_cSpecularFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        static constexpr VkFormat m_cLitFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+        // the transient G-buffer of the Subpass and LightVolumes modes
         void initGPassTextures();
-        Texture m_albedoTexture;
-        Texture m_specularTexture;
-        Texture m_normalTexture;
-        Texture m_positionTexture;
-        Texture m_depthTexture;
-        // creating framebuffers to write the position normal and albedo
-        // it will use the renderpass so renderpass should initialise before
-        void initGPassFramebuffer();
-        VkFramebuffer m_gBufferFramebuffer;
+        Texture m_albedoTexture{};
+        Texture m_specularTexture{};
+        Texture m_normalTexture{};
+        Texture m_depthTexture{};
+        // the G-buffer is read with texelFetch, no filtering is needed. TiledCompute only
+        VkSampler m_nearestSampler{};
 
 
         std::unique_ptr<DescriptorPool> m_pGlobalPool{};
@@ -171,24 +205,54 @@ namespace iris::graphics{
         std::unique_ptr<DescriptorSetLayout> m_pGlobalSetLayout{};
         std::unique_ptr<DescriptorSetLayout> m_pTexturedSetLayout{};
 
-        std::vector<VkDescriptorSet> m_sceneDescriptorSets{};
-        std::vector<AllocatedBuffer> m_uboSceneBuffers;
+        VkDescriptorSet m_sceneDescriptorSet{};
 
 
         void initGBufferDescriptorSets();
         // different materials for the objects for now only textured material
         // materials has the pipeline and pipelinelayout information for the objects
-        void initMaterials();
+        void initMaterials(PipelineBuildQueue& buildQueue);
+
+        // the G-buffer and the lit image for the lighting pass
+        std::unique_ptr<DescriptorSetLayout> m_pLightingSetLayout{};
+        VkDescriptorSet m_lightingDescriptorSet{};
+        void initLightingDescriptorSets();
+        // points at the images of the current graph
+        void writeLightingDescriptorSet();
+
+        // the G-buffer input attachments of the Subpass lighting subpass
+        std::unique_ptr<DescriptorSetLayout> m_pInputAttachmentSetLayout{};
+        VkDescriptorSet m_inputAttachmentDescriptorSet{};
+        void initInputAttachmentDescriptorSet();
+        void writeInputAttachmentDescriptorSet();
+
+        // the scene set is bound at set 0 so the lighting pass reads the same lights as the forward shaders
+        void initLightingPipeline(PipelineBuildQueue& buildQueue);
+        // Subpass mode, a screen quad in the second subpass. Shares m_lightingPipeline and its layout, in LightVolumes
+        // mode the quad only adds the ambient light
+        void initSubpassLightingPipeline(PipelineBuildQueue& buildQueue);
+        std::unique_ptr<Pipeline> m_lightingPipeline{};
+        VkPipelineLayout m_lightingPipelineLayout{};
+        // LightVolumes mode, one instance of a box per light. Uses m_lightingPipelineLayout
+        void initLightVolumePipeline(PipelineBuildQueue& buildQueue);
+        std::unique_ptr<Pipeline> m_lightVolumePipeline{};
 
         ScreenQuad m_screenQuad{m_rDevice};
 
-        // void initLightFramebuffer(); we dont need this because swapchain going to populate this framebuffers
-        // we don't need material structure here because light pass is the same for every material
-        // we will send the vertex and index buffer of the screenQuad to the light pass
-        void initLightPassPipeline();
+        // samples the lit image for the composite pass
+        std::unique_ptr<Upscaler> m_pUpscaler{};
+
+        // the execute callbacks of the graph's passes
+        void recordGeometryPass(const RenderGraph::PassContext& context);
+        void recordLightingPass(const RenderGraph::PassContext& context);
+        void recordCompositePass(const RenderGraph::PassContext& context);
+        // Subpass and LightVolumes modes, geometry and lighting in a single render pass
+        void recordSubpassPasses(VkCommandBuffer cmd, const EntityStore& entities,
+                                 const SceneAllocations& sceneAllocations, uint32_t lightCount);
 
-        std::shared_ptr<Pipeline> m_lightPipeline;
-        VkPipelineLayout m_lightPipelineLayout;
+        // TiledCompute mode builds its graph again, the other modes their G-buffer and framebuffers. The sets
+        // pointing at the previous images are retired and written again
+        void recreateSizeDependentResources() override;
     };
 }
 
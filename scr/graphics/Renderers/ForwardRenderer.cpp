@@ -3,24 +3,27 @@
 
 namespace iris::graphics{
 
-    ForwardRenderer::ForwardRenderer(Device &device, Window& window) : Renderer(device, window) {
-        m_pSwapchain = std::make_unique<Swapchain>(device, window.getExtent());
+    ForwardRenderer::ForwardRenderer(Device &device, Window& window, LatencyProfile latencyProfile)
+    : Renderer(device, window) {
+        m_pSwapchain = std::make_unique<Swapchain>(device, window.getExtent(), latencyProfile);
     }
 
     void ForwardRenderer::init() {
         createCommandBuffers();
-        createRenderPass();
-        m_pSwapchain->createFramebuffers(m_renderPass);
+        createFrameRing();
+        createGpuProfiler();
+        initRenderGraphs();
+        m_dynamicResolutionSupported = true;
     }
 
 
     ForwardRenderer::~ForwardRenderer() {
         vkDeviceWaitIdle(m_rDevice.getDevice());
-        vkDestroyRenderPass(m_rDevice.getDevice(), m_renderPass, nullptr);
-        for (auto & uboBuffer : m_uboSceneBuffers)
-        {
-            m_rDevice.destroyBuffer(uboBuffer);
-        }
+        m_destructionQueue.flush();
+        m_pUpscaler.reset();
+        // the graphs own their render passes and images
+        m_pUpscaleGraph.reset();
+        m_pDirectGraph.reset();
     }
 
     void ForwardRenderer::postRender() {
@@ -28,254 +31,170 @@ namespace iris::graphics{
         freeCommandBuffers();
     }
 
-    void ForwardRenderer::createRenderPass() {
-        // the renderpass will use this color attachment.
-        VkAttachmentDescription colorAttachment = {};
-        //the attachment will have the format needed by the swapchain
-        colorAttachment.format = m_pSwapchain->getSwapchainImageFormat();
-        //1 sample, we won't be doing MSAA (Multisample Anti-Aliasing)
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        // we Clear when this attachment is loaded
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        // we keep the attachment stored when the renderpass ends
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        //we don't care about stencil
-        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-        //we don't know or care about the starting layout of the attachment
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-        //after the renderpass ends, the image has to be on a layout ready for display
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-        VkAttachmentReference colorAttachmentRef = {};
-        //attachment number will index into the pAttachments array in the parent renderpass itself
-        colorAttachmentRef.attachment = 0;
-        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-        VkAttachmentDescription depthAttachment = {};
-        // Depth attachment
-        depthAttachment.flags = 0;
-        depthAttachment.format = m_pSwapchain->findDepthFormat();
-        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-        VkAttachmentReference depthAttachmentRef = {};
-        depthAttachmentRef.attachment = 1;
-        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-        //we are going to create 1 subpass, which is the minimum you can do
-        VkSubpassDescription subpass = {};
-        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.colorAttachmentCount = 1;
-        subpass.pColorAttachments = &colorAttachmentRef;
-        subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-        std::vector<VkSubpassDescription> subpasses = { subpass };
-
-        //1 dependency, which is from "outside" into the subpass. And we can read or write color
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-        //dependency from outside to the subpass, making this subpass dependent on the previous renderpasses
-        VkSubpassDependency depthDependency = {};
-        depthDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        depthDependency.dstSubpass = 0;
-        depthDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-        depthDependency.srcAccessMask = 0;
-        depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-        depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-        //array of 2 dependencies, one for color, two for depth
-        std::vector<VkSubpassDependency> dependencies = { dependency, depthDependency };
-
-        //array of 2 attachments, one for the color, and other for depth
-        std::vector<VkAttachmentDescription> attachments = { colorAttachment,depthAttachment };
-
-        VkRenderPassCreateInfo renderPassInfo = Initializers::createRenderPassInfo(attachments, subpasses, dependencies);
-
-        Debugger::vkCheck(vkCreateRenderPass(m_rDevice.getDevice() , &renderPassInfo, nullptr, &m_renderPass)
-                , "Failed to create render pass!");
+    void ForwardRenderer::initRenderGraphs() {
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+        const RenderGraph::ImageDesc swapchainDesc{m_pSwapchain->getSwapchainImageFormat(), extent};
+
+        m_pDirectGraph = std::make_unique<RenderGraph>(m_rDevice, m_pGpuProfiler.get());
+        const RenderResource directSwapchainImage = m_pDirectGraph->importImage(
+                "swapchain", swapchainDesc, m_pSwapchain->getImages(), m_pSwapchain->getImageViews(),
+                m_pSwapchain->getFinalLayout());
+        addForwardPass(*m_pDirectGraph, directSwapchainImage, false);
+        m_pDirectGraph->compile();
+
+        // the materials' pipelines are created against this pass
+        m_renderPass = m_pDirectGraph->getRenderPass("forward");
+
+        if (m_dynamicResolution) {
+            initUpscaleGraph();
+        }
     }
 
-    VkCommandBuffer ForwardRenderer::beginFrame() {
-        uint32_t imageIndex = m_pSwapchain->acquireNextImage(getCurrentFrame());
-        auto cmd = m_commandBuffers[getCurrentFrame()];
-        //now that we are sure that the commands finished executing, we can safely reset the command buffer to begin recording again.
-        Debugger::vkCheck(vkResetCommandBuffer(cmd, 0),
-                          "Failed to reset command buffer!");
-
-        VkCommandBufferBeginInfo beginInfo = Initializers::createCommandBufferBeginInfo();
-        Debugger::vkCheck(vkBeginCommandBuffer(cmd, &beginInfo),
-                          "Failed to begin recording command buffer!");
-
-        // renderpass begin
-        VkRenderPassBeginInfo renderPassInfo = Initializers::renderPassBeginInfo(m_renderPass,
-                                                                                 m_pSwapchain->getExtent(),
-                                                                                 m_pSwapchain->getFrameBuffer(imageIndex));
-        VkClearValue clearValue;
-        clearValue.color = { { 0.5f, 0.5f, 0.5f, 1.0f } };
-
-        //clear depth at 1
-        VkClearValue depthClear;
-        depthClear.depthStencil.depth = 1.f;
-        //connect clear values
-        renderPassInfo.clearValueCount = 2;
-
-        VkClearValue clearValues[] = { clearValue, depthClear };
-
-        renderPassInfo.pClearValues = &clearValues[0];
-
-        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_pSwapchain->getExtent().width);
-        viewport.height = static_cast<float>(m_pSwapchain->getExtent().height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        VkRect2D scissor{ {0, 0}, m_pSwapchain->getExtent() };
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-        return cmd;
+    void ForwardRenderer::initUpscaleGraph() {
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+        const RenderGraph::ImageDesc swapchainDesc{m_pSwapchain->getSwapchainImageFormat(), extent};
+
+        m_pUpscaleGraph = std::make_unique<RenderGraph>(m_rDevice, m_pGpuProfiler.get());
+        const RenderResource upscaleSwapchainImage = m_pUpscaleGraph->importImage(
+                "swapchain", swapchainDesc, m_pSwapchain->getImages(), m_pSwapchain->getImageViews(),
+                m_pSwapchain->getFinalLayout());
+        const RenderResource sceneColorImage = addForwardPass(*m_pUpscaleGraph, upscaleSwapchainImage, true);
+        m_pUpscaleGraph->addPass("upscale", RenderGraph::PassType::Graphics, [&](RenderGraph::PassBuilder& builder) {
+            builder.readSampled(sceneColorImage);
+            // every pixel is overwritten, nothing is cleared
+            builder.writeColor(upscaleSwapchainImage);
+        }, [this](const RenderGraph::PassContext& context) {
+            m_pUpscaler->record(context.m_cmd, getRenderExtent(), context.m_renderArea);
+        });
+        m_pUpscaleGraph->compile();
+
+        m_pUpscaler = std::make_unique<Upscaler>(m_rDevice, m_pUpscaleGraph->getRenderPass("upscale"), 0,
+                                                 m_pUpscaleGraph->getImageView(sceneColorImage), extent);
+        m_pUpscaler->setSharpness(m_upscaleSharpness);
     }
 
+    void ForwardRenderer::retireUpscaleGraph() {
+        if (!m_pUpscaleGraph) {
+            return;
+        }
+        m_upscaleSharpness = m_pUpscaler->getSharpness();
+        retire(m_pUpscaler);
+        retire(m_pUpscaleGraph);
+    }
+
+    void ForwardRenderer::onDynamicResolutionChanged() {
+        if (m_dynamicResolution) {
+            initUpscaleGraph();
+        }
+        else {
+            retireUpscaleGraph();
+        }
+    }
+
+    RenderResource ForwardRenderer::addForwardPass(RenderGraph &graph, RenderResource swapchainImage, bool upscaled) {
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+        RenderResource colorImage = swapchainImage;
+        graph.addPass("forward", RenderGraph::PassType::Graphics, [&](RenderGraph::PassBuilder& builder) {
+            if (upscaled) {
+                // swapchain sized, the scene only covers the render extent of it
+                colorImage = builder.createImage("scene color", {m_pSwapchain->getSwapchainImageFormat(), extent});
+            }
+            builder.writeColor(colorImage, VkClearColorValue{{0.5f, 0.5f, 0.5f, 1.0f}});
+            // only used by this pass, the graph makes it transient
+            builder.writeDepth(builder.createImage("depth", {m_pSwapchain->findDepthFormat(), extent}), 1.f);
+            // only the rendered region is cleared and drawn
+            builder.setRenderArea([this]() { return getRenderExtent(); });
+            builder.useSecondaryCommandBuffers();
+            builder.countFragments();
+        }, [this](const RenderGraph::PassContext& context) { recordForwardPass(context); });
+        return colorImage;
+    }
+
+    void ForwardRenderer::recreateSizeDependentResources() {
+        // the graphs imported the previous swapchain images and sized their own after them
+        retireUpscaleGraph();
+        retire(m_pDirectGraph);
+        initRenderGraphs();
+    }
+
+    VkCommandBuffer ForwardRenderer::beginFrame() {
+        acquireSwapchainImage();
+        // the shadow passes are recorded before the graph begins its render passes
+        return beginCommandBuffer();
+    }
 
     void ForwardRenderer::loadRenderer() {
         initDescriptorSets();
         initMaterials();
     }
 
+    void ForwardRenderer::recordForwardPass(const RenderGraph::PassContext &context) {
+        const bool depthPrePass = m_depthPrePass && requestDepthEqualPipelines();
+        if (depthPrePass) {
+            // both recordings are executed in the same subpass, one after the other, the depth stays transient
+            recordEntities(context.m_cmd, *m_pFrameEntities, context.m_renderPass, 0, context.m_framebuffer,
+                           m_sceneDescriptorSet, m_frameAllocations,
+                           EntityPass::SharedMaterial, AssetsManager::getMaterial(m_depthOnlyMaterial));
+            recordEntities(context.m_cmd, *m_pFrameEntities, context.m_renderPass, 0, context.m_framebuffer,
+                           m_sceneDescriptorSet, m_frameAllocations, EntityPass::ColorDepthEqual);
+        }
+        else {
+            recordEntities(context.m_cmd, *m_pFrameEntities, context.m_renderPass, 0, context.m_framebuffer,
+                           m_sceneDescriptorSet, m_frameAllocations);
+        }
+        m_frameStats.m_depthPrePass = depthPrePass;
+    }
+
     void ForwardRenderer::endFrame(VkCommandBuffer cmd) {
-        vkCmdEndRenderPass(cmd);
+        m_pGpuProfiler->endFrame(cmd);
         Debugger::vkCheck(vkEndCommandBuffer(cmd), "Failed to record command buffer!");
 
-        m_pSwapchain->submitCommandBuffers(&cmd, getCurrentFrame());
-        m_frameCount++;
+        m_pFrameRing->flush();
+        m_frameStats.m_frameRing = m_pFrameRing->getStats();
+
+        presentFrame(cmd);
     }
 
-    void ForwardRenderer::renderScene(std::vector<RenderObject> & renderObjects, GpuSceneData sceneData,
-                                      Camera & camera) {
+    void ForwardRenderer::renderScene(const EntityStore& entities, const TransformStore& transforms,
+                                      const std::vector<PointLight>& pointLights,
+                                      const GpuSceneData& sceneData, Camera & camera) {
         VkCommandBuffer cmd = beginFrame();
 
-        sceneData.m_projectionMatrix = camera.m_projectionMatrix;
-        sceneData.m_viewMatrix = camera.m_viewMatrix;
-
-        m_rDevice.copyToBuffer(&sceneData,
-                               m_uboSceneBuffers[getCurrentFrame()],
-                               sizeof(GpuSceneData));
-
-        camera.update(getSwapchainExtent(),
-                        utils::Timer::getDeltaTime());
-
-        std::shared_ptr<Model> lastModel = nullptr;
-        std::shared_ptr<Material> lastMaterial = nullptr;
-        for(auto & renderObject : renderObjects){
-            renderObject.updateInfo();
-            auto material = renderObject.m_pMaterial;
-            if(lastMaterial != material){
-                material->getPipeline()->bind(cmd);
-
-                vkCmdBindDescriptorSets(
-                        cmd,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        material->getPipeLineLayout(),
-                        0,
-                        1,
-                        &m_sceneDescriptorSets[getCurrentFrame()],
-                        0,
-                        nullptr
-                );
-
-                if(material->getTextureSet() != VK_NULL_HANDLE){
-                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                            material->getPipeLineLayout(), 1, 1,
-                                            &material->getTextureSet(), 0, nullptr);
-                }
-
-                lastMaterial = material;
-            }
+        updateCamera(camera);
 
+        SceneAllocations sceneAllocations = writeSceneData(cmd, sceneData, transforms, pointLights, camera);
 
-            vkCmdPushConstants(
-                    cmd,
-                    material->getPipeLineLayout(),
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(RenderObject::GpuObjectData),
-                    &renderObject.m_gpuObjectData);
+        recordShadows(cmd, entities, m_sceneDescriptorSet, sceneAllocations);
 
+        // with dynamic resolution the scene is drawn at the render extent then upscaled to the swapchain image
+        RenderGraph& graph = m_dynamicResolution ? *m_pUpscaleGraph : *m_pDirectGraph;
+        m_pFrameEntities = &entities;
+        m_frameAllocations = sceneAllocations;
+        graph.execute(cmd, m_imageIndex);
 
-            if(lastModel != renderObject.m_pModel){
-                renderObject.m_pModel->bind(cmd);
-                lastModel = renderObject.m_pModel;
-            }
-            renderObject.m_pModel->draw(cmd);
-        }
+        // the graph's images never change between two swapchain recreations, its blocks are fully committed
+        const RenderGraph::Stats& graphStats = graph.getStats();
+        m_frameStats.m_renderGraph = graphStats;
+        m_frameStats.m_attachmentBytesAllocated = graphStats.m_bytesAllocated;
+        m_frameStats.m_attachmentBytesCommitted = graphStats.m_bytesAllocated;
+        m_frameStats.m_pipelineStates = m_pPipelineStateCache->getStats();
 
         endFrame(cmd);
     }
 
-    void ForwardRenderer::createCommandBuffers() {
-        m_commandBuffers.resize(m_pSwapchain->m_cMaxImagesOnFlight);
-        VkCommandBufferAllocateInfo allocInfo = Initializers::createCommandBufferAllocateInfo(m_rDevice.getCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()));
-        Debugger::vkCheck(vkAllocateCommandBuffers(m_rDevice.getDevice(), &allocInfo, m_commandBuffers.data()),
-                          "Failed to allocate command buffers!");
-    }
-
-    void ForwardRenderer::freeCommandBuffers() {
-        vkFreeCommandBuffers(
-                m_rDevice.getDevice(),
-                m_rDevice.getCommandPool(),
-                static_cast<uint32_t>(m_commandBuffers.size()),
-                m_commandBuffers.data());
-        m_commandBuffers.clear();
-    }
-
     void ForwardRenderer::initDescriptorSets() {
-        // initialize the global descriptor sets
-        m_sceneDescriptorSets.resize(getMaximumFramesInFlight());
-        m_uboSceneBuffers.resize(getMaximumFramesInFlight());
-
+        // initialize the global descriptor set
         m_pGlobalPool = DescriptorPool::Builder(m_rDevice)
                 .setMaxSets(100)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100)
-                .build();
-
-        for(auto & uboBuffer : m_uboSceneBuffers)
-        {
-            uboBuffer = m_rDevice.createBuffer(sizeof(GpuSceneData),VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                               VMA_MEMORY_USAGE_CPU_TO_GPU);
-        }
-
-        m_pGlobalSetLayout = DescriptorSetLayout::Builder(m_rDevice)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 40)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
                 .build();
 
-        for (int i = 0; i < m_sceneDescriptorSets.size(); i++)
-        {
-            VkDescriptorBufferInfo sceneInfo;
-            sceneInfo.buffer = m_uboSceneBuffers[i].m_buffer;
-            sceneInfo.offset = 0;
-            sceneInfo.range = sizeof(GpuSceneData);
-
-            DescriptorWriter(*m_pGlobalSetLayout, *m_pGlobalPool)
-                    .writeBuffer(0, &sceneInfo)
-                    .build(m_sceneDescriptorSets[i]);
-        }
+        m_pGlobalSetLayout = createSceneSetLayout();
+        createShadowMaps(*m_pGlobalSetLayout);
+        writeSceneDescriptorSet(*m_pGlobalSetLayout, *m_pGlobalPool, m_sceneDescriptorSet);
 
         m_pTexturedSetLayout = DescriptorSetLayout::Builder(m_rDevice)
                 .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
@@ -285,50 +204,14 @@ namespace iris::graphics{
     }
 
     void ForwardRenderer::initMaterials() {
-        // non textured pipeline
-        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
-        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout()};
-
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(RenderObject::GpuObjectData);
+        PipelineBuildQueue buildQueue{m_rDevice};
 
-        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
-
-        VkPipelineLayout defaultPipelineLayout{};
-
-        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &defaultPipelineLayout),
-                          "Failed to create pipeline layout");
-
-        assert(defaultPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
-
-        graphics::PipelineConfigInfo pipelineConfig{};
-
-        graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
-
-        pipelineConfig.m_renderPass = getRenderPass();
-        pipelineConfig.m_pipelineLayout = defaultPipelineLayout;
-
-        auto defaultPipeline = std::make_shared<Pipeline>(
-                m_rDevice,
-                "../shaders/Default.vert.spv",
-                "../shaders/Default.frag.spv",
-                pipelineConfig);
-
-        AssetsManager::loadMaterial(m_rDevice, "DefaultMeshNonTextured", defaultPipeline, defaultPipelineLayout);
-
-        // textured pipeline
+        // both permutations of Default.frag declare the textures, they share the layout with the textured set
         VkPipelineLayoutCreateInfo texturedPipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
         const std::vector texturedDescriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout(), m_pTexturedSetLayout->getDescriptorSetLayout()};
 
         texturedPipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(texturedDescriptorSetLayouts.size());
         texturedPipelineLayoutCreateInfo.pSetLayouts = texturedDescriptorSetLayouts.data();
-        texturedPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        texturedPipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
         VkPipelineLayout texturedPipelineLayout{};
 
@@ -336,27 +219,120 @@ namespace iris::graphics{
                                                  &texturedPipelineLayoutCreateInfo,
                                                  nullptr, &texturedPipelineLayout),"Failed to create pipeline layout");
 
-        assert(defaultPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+        ShaderPermutation permutation = m_permutation;
+        permutation.m_textured = false;
+        loadMaterial(buildQueue, "DefaultMeshNonTextured", permutation, texturedPipelineLayout);
+        permutation.m_textured = true;
+        loadMaterial(buildQueue, "DefaultMeshTextured", permutation, texturedPipelineLayout);
 
-        graphics::PipelineConfigInfo texturedPipelineConfigInfo{};
+        initDepthOnlyMaterial(buildQueue);
 
-        graphics::Pipeline::defaultPipelineConfig(texturedPipelineConfigInfo);
+        buildQueue.build();
+        printPermutationStats();
 
-        texturedPipelineConfigInfo.m_renderPass = getRenderPass();
-        texturedPipelineConfigInfo.m_pipelineLayout = texturedPipelineLayout;
+        // the set is statically used by the untextured permutation too, it is bound but never sampled
+        for (const char* material : {"DefaultMeshNonTextured", "DefaultMeshTextured"}) {
+            AssetsManager::setMaterialTextures(AssetsManager::findMaterial(material),
+                    AssetsManager::findTexture("StarAmbient"), AssetsManager::findTexture("StarDiffuse"),
+                    AssetsManager::findTexture("StarSpecular"),
+                    *m_pGlobalPool, *m_pTexturedSetLayout);
+        }
+    }
 
-        auto texturedPipeline = std::make_shared<Pipeline>(
-                m_rDevice,
-                "../shaders/Default.vert.spv",
-                "../shaders/DefaultTextured.frag.spv",
-                texturedPipelineConfigInfo);
+    void ForwardRenderer::printPermutationStats() const {
+        double totalMs = 0.0;
+        for (const auto& build : m_permutationBuilds) {
+            totalMs += build.m_milliseconds;
+        }
+        std::cout << "Default.frag permutations: " << m_permutationBuilds.size() << " built in " << totalMs << " ms";
+        for (const auto& build : m_permutationBuilds) {
+            std::cout << " | " << build.m_permutation.getName() << " (key " << std::hex << build.m_permutation.getKey()
+                      << std::dec << "): " << build.m_milliseconds << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    void ForwardRenderer::loadMaterial(PipelineBuildQueue& buildQueue, const std::string &name,
+                                       const ShaderPermutation& permutation, VkPipelineLayout layout) {
+        assert(layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        // every permutation is queued before the queue is built, the slot does not move while the workers write it
+        const size_t buildIndex = m_permutationBuilds.size();
+        m_permutationBuilds.push_back({permutation});
+
+        buildQueue.add([this, permutation, layout, buildIndex]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            pipelineConfig.m_renderPass = getRenderPass();
+            pipelineConfig.m_pipelineLayout = layout;
+            permutation.apply(pipelineConfig);
+
+            const auto start = std::chrono::steady_clock::now();
+            auto pipeline = std::make_unique<Pipeline>(m_rDevice, "../shaders/Default.vert.spv",
+                                                       "../shaders/Default.frag.spv", pipelineConfig);
+            m_permutationBuilds[buildIndex].m_milliseconds =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return pipeline;
+        }, [this, name, layout](std::unique_ptr<Pipeline> pipeline) {
+            AssetsManager::loadMaterial(m_rDevice, name, std::move(pipeline), layout);
+        });
+
+        // the pre-pass already wrote the depth, only the closest fragment of each pixel passes
+        DepthEqualVariant variant{name};
+        variant.m_desc.m_vertFilePath = "../shaders/Default.vert.spv";
+        variant.m_desc.m_fragFilePath = "../shaders/Default.frag.spv";
+        graphics::Pipeline::defaultPipelineConfig(variant.m_desc.m_config);
+        permutation.apply(variant.m_desc.m_config);
+        variant.m_desc.m_config.m_renderPass = getRenderPass();
+        variant.m_desc.m_config.m_pipelineLayout = layout;
+        variant.m_desc.m_config.m_depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        variant.m_desc.m_config.m_depthStencilInfo.depthWriteEnable = VK_FALSE;
+        m_depthEqualVariants.push_back(std::move(variant));
+    }
+
+    bool ForwardRenderer::requestDepthEqualPipelines() {
+        bool ready = true;
+        for (auto& variant : m_depthEqualVariants) {
+            if (variant.m_ready) {
+                continue;
+            }
+            std::shared_ptr<Pipeline> pipeline = m_pPipelineStateCache->getAsync(variant.m_desc);
+            if (pipeline == nullptr) {
+                ready = false;
+                continue;
+            }
+            // no recording thread reads the material between two frames
+            AssetsManager::getMaterial(AssetsManager::findMaterial(variant.m_material))->setDepthEqualPipeline(std::move(pipeline));
+            variant.m_ready = true;
+        }
+        return ready;
+    }
+
+    void ForwardRenderer::initDepthOnlyMaterial(PipelineBuildQueue& buildQueue) {
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
+        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout()};
+
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+
+        VkPipelineLayout depthOnlyPipelineLayout{};
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &depthOnlyPipelineLayout),
+                          "Failed to create pipeline layout");
 
-        AssetsManager::loadMaterial(m_rDevice, "DefaultMeshTextured", texturedPipeline, texturedPipelineLayout);
-        auto mat = AssetsManager::getMaterial("DefaultMeshTextured");
-        mat->setTexture(AssetsManager::getTexture("StarAmbient"),
-                        AssetsManager::getTexture("StarDiffuse"),
-                        AssetsManager::getTexture("StarSpecular"),
-                        *m_pGlobalPool, *m_pTexturedSetLayout);
+        buildQueue.add([this, depthOnlyPipelineLayout]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            pipelineConfig.m_renderPass = getRenderPass();
+            pipelineConfig.m_pipelineLayout = depthOnlyPipelineLayout;
+            // the vertex buffers stay the models' ones, only the position is fetched from them
+            pipelineConfig.m_attributeDescriptions.resize(1);
+            // the color attachment is still in the subpass, nothing is written to it
+            pipelineConfig.m_colorBlendAttachment.colorWriteMask = 0;
+
+            return std::make_unique<Pipeline>(m_rDevice, "../shaders/DepthOnly.vert.spv", "", pipelineConfig);
+        }, [this, depthOnlyPipelineLayout](std::unique_ptr<Pipeline> pipeline) {
+            m_depthOnlyMaterial = AssetsManager::loadMaterial(m_rDevice, "DepthOnly", std::move(pipeline), depthOnlyPipelineLayout);
+        });
     }
 
 }
\ No newline at end of file
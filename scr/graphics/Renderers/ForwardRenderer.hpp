@@ -5,14 +5,20 @@
 #include "../Initializers.hpp"
 #include "../Debugger.hpp"
 #include "../Descriptors.hpp"
+#include "../Upscaler.hpp"
+#include "../PipelineBuildQueue.hpp"
+#include "../ShaderPermutation.hpp"
 #include "../../utilities/Timer.hpp"
 
 
 
 namespace iris::graphics{
+    // draws the entities straight into the swapchain images. With dynamic resolution they are drawn into a scene color
+    // target at the render extent instead, then upscaled to the swapchain image. Both ways are a render graph, the
+    // upscaling one only exists while dynamic resolution is on
     class ForwardRenderer : public Renderer {
     public:
-        ForwardRenderer(Device& device, Window& window);
+        ForwardRenderer(Device& device, Window& window, LatencyProfile latencyProfile = LatencyProfile::Balanced);
         ~ForwardRenderer() override;
 
         ForwardRenderer(const ForwardRenderer &) = delete;
@@ -24,26 +30,84 @@ namespace iris::graphics{
         void loadRenderer() override;
         void endFrame(VkCommandBuffer cmd) override;
         void postRender() override;
-        void renderScene(std::vector<RenderObject> & renderObjects, GpuSceneData sceneData, Camera & camera) override;
+        void renderScene(const EntityStore& entities, const TransformStore& transforms,
+                         const std::vector<PointLight>& pointLights,
+                         const GpuSceneData& sceneData, Camera & camera) override;
 
         VkRenderPass getRenderPass(){ return m_renderPass; }
-    private:
-        void createCommandBuffers() override;
-        void freeCommandBuffers() override;
 
+        // with the depth pre-pass the entities are first drawn depth only, then the color pass shades only the
+        // fragments whose depth equals the pre-pass one, at most one per pixel. Can be switched between frames
+        void setDepthPrePass(bool enabled) { m_depthPrePass = enabled; }
+        [[nodiscard]] bool isDepthPrePassEnabled() const { return m_depthPrePass; }
+
+        // the light count and fog of the materials' permutations of Default.frag, set before loadRenderer. Its
+        // m_textured is ignored, each material picks its own
+        void setShaderPermutation(const ShaderPermutation& permutation) { m_permutation = permutation; }
+    private:
         std::unique_ptr<DescriptorPool> m_pGlobalPool{};
 
         std::unique_ptr<DescriptorSetLayout> m_pGlobalSetLayout{};
         std::unique_ptr<DescriptorSetLayout> m_pTexturedSetLayout{};
 
-        std::vector<VkDescriptorSet> m_sceneDescriptorSets{};
-        std::vector<AllocatedBuffer> m_uboSceneBuffers;
+        VkDescriptorSet m_sceneDescriptorSet{};
 
         void initDescriptorSets();
+        // the materials' pipelines are compiled together
         void initMaterials();
+        // queues a material drawing with Default.vert and the permutation of Default.frag, the material is loaded
+        // once it is built. Its depth equal variant is only described, it is created the first time the depth
+        // pre-pass is used
+        void loadMaterial(PipelineBuildQueue& buildQueue, const std::string& name, const ShaderPermutation& permutation,
+                          VkPipelineLayout layout);
 
+        ShaderPermutation m_permutation{};
+        // creation time of each permutation built by initMaterials, logged once they are all built
+        struct PermutationBuild{
+            ShaderPermutation m_permutation{};
+            double m_milliseconds{};
+        };
+        std::vector<PermutationBuild> m_permutationBuilds{};
+        void printPermutationStats() const;
+
+        bool m_depthPrePass{false};
+        struct DepthEqualVariant{
+            std::string m_material{};
+            PipelineDesc m_desc{};
+            bool m_ready{};
+        };
+        std::vector<DepthEqualVariant> m_depthEqualVariants{};
+        // asks the pipeline state cache for the variants the materials do not have yet, they are created in the
+        // background. The frames are drawn without the pre-pass until every material has its variant
+        bool requestDepthEqualPipelines();
+        // position only vertex input and no fragment shader, shared by every entity
+        MaterialHandle m_depthOnlyMaterial{};
+        void initDepthOnlyMaterial(PipelineBuildQueue& buildQueue);
+
+        // compiled at the swapchain extent, their forward render passes are compatible
+        std::unique_ptr<RenderGraph> m_pDirectGraph{};
+        std::unique_ptr<RenderGraph> m_pUpscaleGraph{};
+        void initRenderGraphs();
+        void initUpscaleGraph();
+        // the frames in flight may still use it
+        void retireUpscaleGraph();
+        void onDynamicResolutionChanged() override;
+        // the forward pass of a graph, it draws in the swapchain image or in a scene color image it creates when
+        // upscaled. Returns the image it draws in
+        RenderResource addForwardPass(RenderGraph& graph, RenderResource swapchainImage, bool upscaled);
+        // the depth pre-pass when enabled, then the color pass
+        void recordForwardPass(const RenderGraph::PassContext& context);
+        // what the graphs' passes record this frame, set before one is executed
+        const EntityStore* m_pFrameEntities{};
+        SceneAllocations m_frameAllocations{};
+        // the forward pass of the direct graph, the materials' pipelines are created against it
         VkRenderPass m_renderPass{};
-        void createRenderPass();
+        std::unique_ptr<Upscaler> m_pUpscaler{};
+        // kept while the upscaler does not exist
+        float m_upscaleSharpness{Upscaler::m_cDefaultSharpness};
+
+        // the graphs and the upscaler sampling the scene color are created again at the new extent
+        void recreateSizeDependentResources() override;
     };
 }
 
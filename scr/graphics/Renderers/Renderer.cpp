@@ -1,10 +1,661 @@
 #include "Renderer.hpp"
+#include "../Initializers.hpp"
+#include "../Debugger.hpp"
+#include "../AssetsManager.hpp"
+#include "../../utilities/Ppm.hpp"
+#include "../../utilities/ThreadPool.hpp"
+#include "../../utilities/Timer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <numeric>
 
 namespace iris::graphics{
 
     Renderer::Renderer(Device &device, Window &window) : m_rDevice{device}, m_rWindow{window} {
         auto extent = m_rWindow.getExtent();
+        m_pPipelineStateCache = std::make_unique<PipelineStateCache>(device);
+    }
+
+    Renderer::~Renderer() {
+        // already flushed by the renderers, anything retired since then
+        m_destructionQueue.flush();
+        m_rDevice.destroyBuffer(m_objectBuffer);
+    }
+
+    void Renderer::retire(std::function<void()> destroy) {
+        m_destructionQueue.push(static_cast<uint64_t>(m_frameCount), std::move(destroy));
+    }
+
+    void Renderer::retireTexture(Texture &texture) {
+        VkDevice device = m_rDevice.getDevice();
+        Device* pDevice = &m_rDevice;
+        const VkImageView imageView = texture.m_imageView;
+        const AllocatedImage allocatedImage = texture.m_allocatedImage;
+        retire([device, pDevice, imageView, allocatedImage]() mutable {
+            vkDestroyImageView(device, imageView, nullptr);
+            pDevice->destroyImage(allocatedImage);
+        });
+        texture = Texture{};
+    }
+
+    void Renderer::retireFramebuffer(VkFramebuffer &framebuffer) {
+        VkDevice device = m_rDevice.getDevice();
+        const VkFramebuffer retired = framebuffer;
+        retire([device, retired]() { vkDestroyFramebuffer(device, retired, nullptr); });
+        framebuffer = VK_NULL_HANDLE;
+    }
+
+    void Renderer::retireDescriptorSet(DescriptorPool &pool, VkDescriptorSet &set) {
+        DescriptorPool* pPool = &pool;
+        std::vector<VkDescriptorSet> retired{set};
+        retire([pPool, retired]() mutable { pPool->freeDescriptors(retired); });
+        set = VK_NULL_HANDLE;
+    }
+
+    void Renderer::acquireSwapchainImage() {
+        while (!m_pSwapchain->acquireNextImage(getCurrentFrame(), m_imageIndex)) {
+            recreateSwapchain();
+        }
+    }
+
+    void Renderer::presentFrame(VkCommandBuffer cmd) {
+        const auto frameId = static_cast<uint64_t>(m_frameCount);
+        m_latencyTracker.mark(frameId, LatencyTracker::Stage::RecordingDone);
+        latchCamera();
+        const bool upToDate = m_pSwapchain->submitCommandBuffers(&cmd, getCurrentFrame());
+        m_latencyTracker.mark(frameId, LatencyTracker::Stage::Submitted, m_pSwapchain->getSubmitTime());
+        m_latencyTracker.mark(frameId, LatencyTracker::Stage::Presented, m_pSwapchain->getPresentTime());
+        m_frameCount++;
+        if (!upToDate || m_rWindow.wasResized()) {
+            recreateSwapchain();
+        }
+    }
+
+    SaveFrameResult Renderer::saveLastFrame(const std::string &filePath) {
+        if (!m_rDevice.isHeadless()) {
+            return SaveFrameResult::NotHeadless;
+        }
+        if (m_frameCount == 0) {
+            return SaveFrameResult::NoFrame;
+        }
+        std::vector<uint8_t> rgba;
+        m_pSwapchain->readImage(m_imageIndex, rgba);
+
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+        return utils::Ppm::write(filePath, extent.width, extent.height, rgba) ? SaveFrameResult::Saved
+                                                                              : SaveFrameResult::WriteFailed;
+    }
+
+    void Renderer::updateCamera(Camera &camera) {
+        // the clusters and shadow cascades are built from the camera before the latch, a camera the latch has never
+        // updated still has its identity matrices
+        if (m_lateLatch && m_pLatchCamera == &camera) {
+            return;
+        }
+        m_pLatchCamera = &camera;
+        camera.update(getSwapchainExtent(), utils::Timer::getDeltaTime());
+    }
+
+    void Renderer::latchCamera() {
+        if (!m_lateLatch || m_pLatchCamera == nullptr || m_pLatchSceneData == nullptr) {
+            return;
+        }
+        // the frame reads the input sampled here rather than the one before it was recorded. A resize seen by the
+        // sampler recreates the swapchain once the frame is presented
+        if (m_inputSampler) {
+            m_inputSampler();
+        }
+        m_latencyTracker.mark(static_cast<uint64_t>(m_frameCount), LatencyTracker::Stage::InputSampled);
+
+        Camera& camera = *m_pLatchCamera;
+        camera.update(getSwapchainExtent(), utils::Timer::getDeltaTime());
+        m_pLatchSceneData->m_projectionMatrix = camera.m_projectionMatrix;
+        m_pLatchSceneData->m_viewMatrix = camera.m_viewMatrix;
+        m_pLatchSceneData->m_inverseViewProjection = glm::inverse(camera.m_projectionMatrix * camera.m_viewMatrix);
+        // m_recordedViewMatrix stays the one the clusters and cascades were built with
+        m_pFrameRing->flush(m_latchAllocation, sizeof(GpuSceneData));
+        m_pLatchSceneData = nullptr;
+    }
+
+    void Renderer::recreateSwapchain() {
+        // a minimized window has no extent to create a swapchain at
+        m_rWindow.waitWhileMinimized();
+        m_rWindow.resetResizedFlag();
+        m_pSwapchain->recreate(m_rWindow.getExtent(), m_destructionQueue, static_cast<uint64_t>(m_frameCount));
+        recreateSizeDependentResources();
+        m_frameStats.m_swapchainRecreations++;
     }
 
-    Renderer::~Renderer() = default;
+    void Renderer::createCommandBuffers() {
+        const uint32_t threadCount = utils::ThreadPool::instance().getConcurrency();
+        const uint32_t queueFamily = m_rDevice.getQueueFamilyIndices().m_graphicsFamily.value();
+        // buffers are re-recorded every frame and only reset together with their pool
+        VkCommandPoolCreateInfo poolInfo = Initializers::createCommandPoolInfo(queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+        m_frameCommands.resize(getMaximumFramesInFlight());
+        for (auto & frameCommands : m_frameCommands) {
+            Debugger::vkCheck(vkCreateCommandPool(m_rDevice.getDevice(), &poolInfo, nullptr, &frameCommands.m_primaryPool),
+                              "Failed to create frame command pool!");
+            VkCommandBufferAllocateInfo allocInfo = Initializers::createCommandBufferAllocateInfo(frameCommands.m_primaryPool, 1);
+            Debugger::vkCheck(vkAllocateCommandBuffers(m_rDevice.getDevice(), &allocInfo, &frameCommands.m_primaryBuffer),
+                              "Failed to allocate command buffers!");
+
+            frameCommands.m_threadPools.resize(threadCount);
+            frameCommands.m_secondaryBuffers.resize(threadCount * m_cMaxRecordingsPerFrame);
+            for (uint32_t i = 0; i < threadCount; i++) {
+                Debugger::vkCheck(vkCreateCommandPool(m_rDevice.getDevice(), &poolInfo, nullptr, &frameCommands.m_threadPools[i]),
+                                  "Failed to create thread command pool!");
+                VkCommandBufferAllocateInfo secondaryAllocInfo = Initializers::createCommandBufferAllocateInfo(
+                        frameCommands.m_threadPools[i], 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                // the buffers of a thread all come from its pool
+                for (uint32_t recording = 0; recording < m_cMaxRecordingsPerFrame; recording++) {
+                    Debugger::vkCheck(vkAllocateCommandBuffers(m_rDevice.getDevice(), &secondaryAllocInfo,
+                                                               &frameCommands.m_secondaryBuffers[recording * threadCount + i]),
+                                      "Failed to allocate secondary command buffers!");
+                }
+            }
+        }
+    }
+
+    void Renderer::freeCommandBuffers() {
+        // destroying a pool frees every command buffer allocated from it
+        for (auto & frameCommands : m_frameCommands) {
+            for (auto pool : frameCommands.m_threadPools) {
+                vkDestroyCommandPool(m_rDevice.getDevice(), pool, nullptr);
+            }
+            vkDestroyCommandPool(m_rDevice.getDevice(), frameCommands.m_primaryPool, nullptr);
+        }
+        m_frameCommands.clear();
+    }
+
+    VkCommandBuffer Renderer::beginCommandBuffer() {
+        auto & frameCommands = m_frameCommands[getCurrentFrame()];
+        // the frame's fence was waited on while acquiring the image, nothing from these pools is still executing.
+        // Every frame submitted before it has finished as well, the fences are waited on in order
+        const int completedFrames = m_frameCount + 1 - getMaximumFramesInFlight();
+        if (completedFrames > 0) {
+            m_destructionQueue.collect(static_cast<uint64_t>(completedFrames));
+        }
+        m_frameStats.m_retiredResources = m_destructionQueue.size();
+        m_pFrameRing->beginFrame(getCurrentFrame());
+        Debugger::vkCheck(vkResetCommandPool(m_rDevice.getDevice(), frameCommands.m_primaryPool, 0),
+                          "Failed to reset command pool!");
+        for (auto pool : frameCommands.m_threadPools) {
+            Debugger::vkCheck(vkResetCommandPool(m_rDevice.getDevice(), pool, 0),
+                              "Failed to reset command pool!");
+        }
+        frameCommands.m_recordingCount = 0;
+        m_frameStats.m_drawCount = 0;
+        m_frameStats.m_recordingTimeMs = 0.0;
+
+        VkCommandBufferBeginInfo beginInfo = Initializers::createCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        Debugger::vkCheck(vkBeginCommandBuffer(frameCommands.m_primaryBuffer, &beginInfo),
+                          "Failed to begin recording command buffer!");
+        m_pGpuProfiler->beginFrame(frameCommands.m_primaryBuffer, getCurrentFrame());
+        // the timestamps read back are the ones of the frame that last used this slot
+        std::chrono::steady_clock::time_point gpuDoneTime{};
+        if (m_frameCount >= getMaximumFramesInFlight() && m_pGpuProfiler->getFrameEndTime(gpuDoneTime)) {
+            m_latencyTracker.mark(static_cast<uint64_t>(m_frameCount - getMaximumFramesInFlight()),
+                                  LatencyTracker::Stage::GpuDone, gpuDoneTime);
+        }
+        m_frameStats.m_fragmentInvocations = m_pGpuProfiler->getFragmentInvocations();
+        m_frameStats.m_cpuWaitMs = m_pSwapchain->getCpuWaitMs();
+        m_frameStats.m_gpuIdleMs = m_pGpuProfiler->getIdleMilliseconds();
+        updateRenderScale();
+        return frameCommands.m_primaryBuffer;
+    }
+
+    void Renderer::updateRenderScale() {
+        const auto now = std::chrono::steady_clock::now();
+        const float cpuFrameMs = std::chrono::duration<float, std::milli>(now - m_lastFrameBegin).count();
+        const bool firstFrame = m_lastFrameBegin == std::chrono::steady_clock::time_point{};
+        m_lastFrameBegin = now;
+
+        if (m_dynamicResolution && !firstFrame) {
+            // the whole frame, the pass scopes can be nested in each other
+            const auto gpuFrameMs = static_cast<float>(m_pGpuProfiler->getFrameMilliseconds());
+            // no timings before the first frames come back or without timestamp support
+            m_renderScale = m_resolutionController.update(gpuFrameMs > 0.f ? gpuFrameMs : cpuFrameMs);
+        }
+        else if (!m_dynamicResolution) {
+            m_renderScale = 1.f;
+        }
+
+        m_frameStats.m_dynamicResolution = m_dynamicResolution;
+        m_frameStats.m_renderExtent = getRenderExtent();
+        m_frameStats.m_resolution = m_resolutionController.getStats();
+    }
+
+    VkExtent2D Renderer::getRenderExtent() {
+        const VkExtent2D extent = getSwapchainExtent();
+        if (m_renderScale >= 1.f) {
+            return extent;
+        }
+        return { std::max(1u, static_cast<uint32_t>(static_cast<float>(extent.width) * m_renderScale)),
+                 std::max(1u, static_cast<uint32_t>(static_cast<float>(extent.height) * m_renderScale)) };
+    }
+
+    void Renderer::setDynamicResolution(bool enabled) {
+        const bool wasEnabled = m_dynamicResolution;
+        m_dynamicResolution = enabled && m_dynamicResolutionSupported;
+        if (!m_dynamicResolution) {
+            m_resolutionController.reset();
+        }
+        if (m_dynamicResolution != wasEnabled) {
+            onDynamicResolutionChanged();
+        }
+    }
+
+    void Renderer::createGpuProfiler() {
+        m_pGpuProfiler = std::make_unique<GpuProfiler>(m_rDevice, getMaximumFramesInFlight());
+        m_latencyTracker.setGpuTimestampsAvailable(m_pGpuProfiler->isSupported());
+    }
+
+    void Renderer::createFrameRing() {
+        m_pFrameRing = std::make_unique<FrameRingBuffer>(m_rDevice, getMaximumFramesInFlight(), m_cFrameRingBytesPerFrame);
+        m_objectBuffer = m_rDevice.createBuffer(sizeof(GpuObjectData) * m_cMaxObjects,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+
+    void Renderer::uploadObjectData(VkCommandBuffer cmd, const TransformStore &transforms) {
+        if (transforms.size() > m_cMaxObjects) {
+            throw std::runtime_error("Too many transforms for the object buffer, increase Renderer::m_cMaxObjects!");
+        }
+
+        // the changed transforms are merged in ranges of consecutive ids, their source offsets are packed
+        constexpr VkDeviceSize objectSize = sizeof(GpuObjectData);
+        m_uploadedStamps.resize(transforms.size(), UINT32_MAX);
+        m_objectCopies.clear();
+        VkDeviceSize uploadSize = 0;
+        for (TransformId id = 0; id < transforms.size(); id++) {
+            const uint32_t stamp = transforms.getWorldStamp(id);
+            if (stamp == m_uploadedStamps[id]) {
+                continue;
+            }
+            m_uploadedStamps[id] = stamp;
+            if (!m_objectCopies.empty() && m_objectCopies.back().dstOffset + m_objectCopies.back().size == id * objectSize) {
+                m_objectCopies.back().size += objectSize;
+            }
+            else {
+                m_objectCopies.push_back({uploadSize, id * objectSize, objectSize});
+            }
+            uploadSize += objectSize;
+        }
+        if (m_objectCopies.empty()) {
+            return;
+        }
+
+        // the frames still in flight read the buffer until the copies start, the copies are done before this frame's
+        // shaders read it
+        auto recordCopies = [this](VkCommandBuffer copyCmd, VkBuffer source) {
+            vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+            vkCmdCopyBuffer(copyCmd, source, m_objectBuffer.m_buffer,
+                            static_cast<uint32_t>(m_objectCopies.size()), m_objectCopies.data());
+            VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT};
+            vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        };
+        auto packCopies = [this, &transforms](char* pDestination, VkDeviceSize sourceOffset) {
+            const auto* pObjectData = reinterpret_cast<const char*>(transforms.getObjectData().data());
+            for (VkBufferCopy& copy : m_objectCopies) {
+                std::memcpy(pDestination + copy.srcOffset, pObjectData + copy.dstOffset, copy.size);
+                copy.srcOffset += sourceOffset;
+            }
+        };
+
+        if (uploadSize <= m_cMaxRingObjectBytes) {
+            RingAllocation allocation = m_pFrameRing->allocate(uploadSize);
+            packCopies(static_cast<char*>(allocation.m_pData), allocation.m_offset);
+            recordCopies(cmd, m_pFrameRing->getBuffer());
+            return;
+        }
+
+        // submitted on its own and waited on, it runs after the frames already submitted and before this one
+        AllocatedBuffer stagingBuffer = m_rDevice.createBuffer(uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                               VMA_MEMORY_USAGE_CPU_ONLY, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        packCopies(static_cast<char*>(stagingBuffer.m_pMappedData), 0);
+        m_rDevice.immediateSubmit([&](VkCommandBuffer uploadCmd) {
+            recordCopies(uploadCmd, stagingBuffer.m_buffer);
+        });
+        m_rDevice.destroyBuffer(stagingBuffer);
+    }
+
+    SceneAllocations Renderer::writeSceneData(VkCommandBuffer cmd, const GpuSceneData &sceneData, const TransformStore &transforms,
+                                              const std::vector<PointLight>& pointLights, const Camera &camera) {
+        SceneAllocations allocations{};
+        GpuSceneData* pSceneData = m_pFrameRing->allocate<GpuSceneData>(1, allocations.m_scene);
+
+        // written straight into the mapped memory, no staging copy
+        std::memcpy(pSceneData, &sceneData, sizeof(GpuSceneData));
+        pSceneData->m_projectionMatrix = camera.m_projectionMatrix;
+        pSceneData->m_viewMatrix = camera.m_viewMatrix;
+        pSceneData->m_recordedViewMatrix = camera.m_viewMatrix;
+        pSceneData->m_inverseViewProjection = glm::inverse(camera.m_projectionMatrix * camera.m_viewMatrix);
+        m_pLatchSceneData = pSceneData;
+        m_latchAllocation = allocations.m_scene;
+
+        m_lightClusters.setProjection(camera.m_projectionMatrix, Camera::m_cNear, Camera::m_cFar);
+        m_lightClusters.assign(pointLights, camera.m_viewMatrix);
+
+        // the shaders rebuild the viewport size from the tile size, the clusters split the rendered region
+        const VkExtent2D extent = getRenderExtent();
+        pSceneData->m_clusterCounts = glm::uvec4(LightClusters::m_cTilesX, LightClusters::m_cTilesY,
+                                                 LightClusters::m_cSlices, static_cast<uint32_t>(pointLights.size()));
+        pSceneData->m_clusterParams = glm::vec4(static_cast<float>(extent.width) / LightClusters::m_cTilesX,
+                                                static_cast<float>(extent.height) / LightClusters::m_cTilesY,
+                                                m_lightClusters.getSliceScale(), m_lightClusters.getSliceBias());
+
+        uploadObjectData(cmd, transforms);
+
+        auto* pLights = m_pFrameRing->allocate<PointLight::GpuPointLightData>(pointLights.size(), allocations.m_lights);
+        for (size_t i = 0; i < pointLights.size(); i++) {
+            pLights[i] = pointLights[i].m_gpuLightData;
+        }
+
+        const auto& clusters = m_lightClusters.getClusters();
+        auto* pClusters = m_pFrameRing->allocate<GpuLightCluster>(clusters.size(), allocations.m_clusters);
+        std::memcpy(pClusters, clusters.data(), clusters.size() * sizeof(GpuLightCluster));
+
+        auto* pLightIndices = m_pFrameRing->allocate<uint32_t>(m_lightClusters.getLightIndexCount(), allocations.m_lightIndices);
+        m_lightClusters.writeLightIndices(pLightIndices);
+
+        m_frameStats.m_lightClusters = m_lightClusters.getStats();
+
+        assert(m_pShadowMaps != nullptr && "The shadow maps are created with the scene descriptor set");
+        allocations.m_shadows = m_pShadowMaps->update(*m_pFrameRing, *pSceneData, transforms, pointLights, camera,
+                                                      static_cast<float>(extent.width) / static_cast<float>(extent.height));
+        return allocations;
+    }
+
+    std::array<uint32_t, Renderer::m_cSceneDynamicOffsetCount> Renderer::getSceneDynamicOffsets(const SceneAllocations &sceneAllocations) {
+        // in binding order
+        return { sceneAllocations.m_scene.m_offset, sceneAllocations.m_lights.m_offset, sceneAllocations.m_clusters.m_offset,
+                 sceneAllocations.m_lightIndices.m_offset, sceneAllocations.m_shadows.m_offset };
+    }
+
+    std::unique_ptr<DescriptorSetLayout> Renderer::createSceneSetLayout() {
+        return DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+                .build();
+    }
+
+    void Renderer::writeSceneDescriptorSet(DescriptorSetLayout &layout, DescriptorPool &pool, VkDescriptorSet &set) {
+        VkDescriptorBufferInfo sceneInfo;
+        sceneInfo.buffer = m_pFrameRing->getBuffer();
+        sceneInfo.offset = 0;
+        sceneInfo.range = sizeof(GpuSceneData);
+
+        VkDescriptorBufferInfo storageInfo;
+        storageInfo.buffer = m_pFrameRing->getBuffer();
+        storageInfo.offset = 0;
+        // the range of a dynamic whole size binding ends at the end of the buffer, whatever the offset
+        storageInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo objectInfo{m_objectBuffer.m_buffer, 0, VK_WHOLE_SIZE};
+
+        VkDescriptorImageInfo shadowAtlasInfo{};
+        shadowAtlasInfo.sampler = m_pShadowMaps->getSampler();
+        shadowAtlasInfo.imageView = m_pShadowMaps->getAtlasView();
+        shadowAtlasInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        DescriptorWriter(layout, pool)
+                .writeBuffer(0, &sceneInfo)
+                .writeBuffer(1, &objectInfo)
+                .writeBuffer(2, &storageInfo)
+                .writeBuffer(3, &storageInfo)
+                .writeBuffer(4, &storageInfo)
+                .writeBuffer(5, &storageInfo)
+                .writeImage(6, &shadowAtlasInfo)
+                .build(set);
+    }
+
+    void Renderer::createShadowMaps(DescriptorSetLayout &sceneSetLayout) {
+        m_pShadowMaps = std::make_unique<ShadowMaps>(m_rDevice, sceneSetLayout.getDescriptorSetLayout());
+    }
+
+    void Renderer::recordShadows(VkCommandBuffer cmd, const EntityStore &entities,
+                                 VkDescriptorSet sceneDescriptorSet, const SceneAllocations &sceneAllocations) {
+        const auto dynamicOffsets = getSceneDynamicOffsets(sceneAllocations);
+        const uint32_t scope = m_pGpuProfiler->beginScope(cmd, "shadows");
+        m_pShadowMaps->record(cmd, entities, sceneDescriptorSet, m_cSceneDynamicOffsetCount, dynamicOffsets.data());
+        m_pGpuProfiler->endScope(cmd, scope);
+        m_frameStats.m_shadows = m_pShadowMaps->getStats();
+    }
+
+    void Renderer::recordEntities(VkCommandBuffer cmd, const EntityStore &entities,
+                                  VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+                                  VkDescriptorSet sceneDescriptorSet, const SceneAllocations& sceneAllocations,
+                                  EntityPass pass, const Material* pSharedMaterial) {
+        assert((pass != EntityPass::SharedMaterial || pSharedMaterial != nullptr) && "A shared material pass needs its material");
+        const auto recordingStart = std::chrono::high_resolution_clock::now();
+
+        auto & frameCommands = m_frameCommands[getCurrentFrame()];
+        assert(frameCommands.m_recordingCount < m_cMaxRecordingsPerFrame && "Too many entity recordings in a frame");
+        const size_t threadCount = frameCommands.m_threadPools.size();
+        const size_t firstBuffer = frameCommands.m_recordingCount * threadCount;
+        frameCommands.m_recordingCount++;
+        std::vector<VkCommandBuffer> recordedBuffers(threadCount, VK_NULL_HANDLE);
+        std::vector<uint32_t> drawCounts(threadCount, 0);
+
+        const auto dynamicOffsets = getSceneDynamicOffsets(sceneAllocations);
+        const VkQueryPipelineStatisticFlags statisticFlags = m_pGpuProfiler->getStatisticFlags();
+
+        // larger chunks leave the threads above the limit without one
+        size_t minChunkSize = m_cMinEntitiesPerRecordingThread;
+        if (m_recordingThreads > 0) {
+            minChunkSize = std::max(minChunkSize, (entities.size() + m_recordingThreads - 1) / m_recordingThreads);
+        }
+        utils::ThreadPool::instance().parallelFor(entities.size(), minChunkSize,
+                [&](size_t first, size_t last, size_t threadIndex) {
+            // each chunk index owns its pool, so no two threads ever record from the same pool
+            VkCommandBuffer secondary = frameCommands.m_secondaryBuffers[firstBuffer + threadIndex];
+
+            VkCommandBufferInheritanceInfo inheritanceInfo = Initializers::createCommandBufferInheritanceInfo(renderPass, subpass, framebuffer);
+            // the pipeline statistics query may be active while the buffer executes
+            inheritanceInfo.pipelineStatistics = statisticFlags;
+            VkCommandBufferBeginInfo beginInfo = Initializers::createCommandBufferBeginInfo(
+                    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+            Debugger::vkCheck(vkBeginCommandBuffer(secondary, &beginInfo),
+                              "Failed to begin recording secondary command buffer!");
+            // dynamic state is not inherited from the primary command buffer
+            setViewportAndScissor(secondary);
+            drawCounts[threadIndex] = drawEntities(secondary, entities, first, last, sceneDescriptorSet, dynamicOffsets.data(),
+                                                   pass, pSharedMaterial);
+            Debugger::vkCheck(vkEndCommandBuffer(secondary), "Failed to record secondary command buffer!");
+
+            recordedBuffers[threadIndex] = secondary;
+        });
+
+        // chunks are numbered in draw list order, executing them by index keeps the submission order
+        recordedBuffers.erase(std::remove(recordedBuffers.begin(), recordedBuffers.end(), VK_NULL_HANDLE),
+                              recordedBuffers.end());
+        if (!recordedBuffers.empty()) {
+            vkCmdExecuteCommands(cmd, static_cast<uint32_t>(recordedBuffers.size()), recordedBuffers.data());
+        }
+
+        m_frameStats.m_drawCount += std::accumulate(drawCounts.begin(), drawCounts.end(), 0u);
+        m_frameStats.m_recordingTimeMs += std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - recordingStart).count();
+    }
+
+    uint32_t Renderer::drawEntities(VkCommandBuffer cmd, const EntityStore &entities, size_t first, size_t last,
+                                    VkDescriptorSet sceneDescriptorSet, const uint32_t* dynamicOffsets,
+                                    EntityPass pass, const Material* pSharedMaterial) {
+        const auto & models = entities.getModels();
+        const auto & materials = entities.getMaterials();
+        const auto & transformIds = entities.getTransformIds();
+
+        if(pass == EntityPass::SharedMaterial){
+            // one pipeline for every entity, only the models change
+            pSharedMaterial->getPipeline()->bind(cmd);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pSharedMaterial->getPipeLineLayout(), 0, 1,
+                                    &sceneDescriptorSet, m_cSceneDynamicOffsetCount, dynamicOffsets);
+        }
+
+        // handles are compared as integers, the assets are only resolved when the state actually changes
+        ModelHandle lastModel{};
+        MaterialHandle lastMaterial{};
+        Model* pModel = nullptr;
+        uint32_t drawCount = 0;
+        for(size_t i = first; i < last; i++){
+            if(pass != EntityPass::SharedMaterial && lastMaterial != materials[i]){
+                Material* pMaterial = AssetsManager::getMaterial(materials[i]);
+                if(pMaterial == nullptr){
+                    continue;
+                }
+                if(pass == EntityPass::ColorDepthEqual){
+                    assert(pMaterial->getDepthEqualPipeline() != nullptr && "The material has no depth equal pipeline");
+                    pMaterial->getDepthEqualPipeline()->bind(cmd);
+                }
+                else{
+                    pMaterial->getPipeline()->bind(cmd);
+                }
+
+                vkCmdBindDescriptorSets(
+                        cmd,
+                        VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        pMaterial->getPipeLineLayout(),
+                        0,
+                        1,
+                        &sceneDescriptorSet,
+                        m_cSceneDynamicOffsetCount,
+                        dynamicOffsets
+                );
+
+                if(pMaterial->getTextureSet() != VK_NULL_HANDLE){
+                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            pMaterial->getPipeLineLayout(), 1, 1,
+                                            &pMaterial->getTextureSet(), 0, nullptr);
+                }
+
+                lastMaterial = materials[i];
+            }
+
+            // a model that failed to resolve is not cached, the next entity looks its own up again
+            if(pModel == nullptr || lastModel != models[i]){
+                pModel = AssetsManager::getModel(models[i]);
+                if(pModel == nullptr){
+                    continue;
+                }
+                pModel->bind(cmd);
+                lastModel = models[i];
+            }
+            // the vertex shader fetches the entity's matrices at gl_InstanceIndex
+            pModel->draw(cmd, transformIds[i]);
+            drawCount++;
+        }
+        return drawCount;
+    }
+
+    void Renderer::createImage(VkDevice device, VmaAllocator allocator,
+                               uint32_t width, uint32_t height,
+                               VkFormat format, VkImageUsageFlags usage,
+                               AllocatedImage &allocatedImage, bool lazilyAllocated) {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = width;
+        imageInfo.extent.height = height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if (lazilyAllocated) {
+            // a dedicated allocation per image, its commitment is then the image's own
+            VmaAllocationCreateInfo lazyAllocInfo = {};
+            lazyAllocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+            lazyAllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            if (vmaCreateImage(allocator, &imageInfo, &lazyAllocInfo, &allocatedImage.m_image,
+                               &allocatedImage.m_allocation, nullptr) == VK_SUCCESS) {
+                return;
+            }
+            // desktop GPUs usually have no lazily allocated memory type, the image gets regular memory
+        }
+
+        if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &allocatedImage.m_image,
+                           &allocatedImage.m_allocation, nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+    }
+
+    void Renderer::createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+                                   VkImageView &imageView) {
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspectFlags;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+    }
+
+    void Renderer::updateAttachmentMemoryStats(std::initializer_list<const Texture*> attachments) {
+        m_frameStats.m_attachmentBytesAllocated = 0;
+        m_frameStats.m_attachmentBytesCommitted = 0;
+        for (const Texture* pTexture : attachments) {
+            if (pTexture->m_allocatedImage.m_allocation == VK_NULL_HANDLE) {
+                continue;
+            }
+            VmaAllocationInfo allocationInfo{};
+            vmaGetAllocationInfo(m_rDevice.getAllocator(), pTexture->m_allocatedImage.m_allocation, &allocationInfo);
+            VkMemoryPropertyFlags memoryFlags{};
+            vmaGetMemoryTypeProperties(m_rDevice.getAllocator(), allocationInfo.memoryType, &memoryFlags);
+
+            VkDeviceSize committedBytes = allocationInfo.size;
+            if (memoryFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                vkGetDeviceMemoryCommitment(m_rDevice.getDevice(), allocationInfo.deviceMemory, &committedBytes);
+            }
+            m_frameStats.m_attachmentBytesAllocated += allocationInfo.size;
+            m_frameStats.m_attachmentBytesCommitted += committedBytes;
+        }
+    }
+
+    void Renderer::destroyTexture(Texture &texture) {
+        vkDestroyImageView(m_rDevice.getDevice(), texture.m_imageView, nullptr);
+        m_rDevice.destroyImage(texture.m_allocatedImage);
+    }
+
+    void Renderer::setViewportAndScissor(VkCommandBuffer cmd) {
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        const VkExtent2D extent = getRenderExtent();
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{ {0, 0}, extent };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+    }
 }
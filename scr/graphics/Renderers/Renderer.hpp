@@ -4,9 +4,81 @@
 #include "../FrameBuffer.hpp"
 #include "../Swapchain.hpp"
 #include "../Objects.hpp"
+#include "../EntityStore.hpp"
+#include "../FrameRingBuffer.hpp"
+#include "../LightClusters.hpp"
+#include "../Descriptors.hpp"
+#include "../GpuProfiler.hpp"
+#include "../ShadowMaps.hpp"
+#include "../DynamicResolution.hpp"
+#include "../RenderGraph.hpp"
+#include "../PipelineStateCache.hpp"
+#include "../LatencyTracker.hpp"
+
+#include <array>
+#include <chrono>
+#include <initializer_list>
+#include <functional>
 
 
 namespace iris::graphics{
+    struct FrameStats{
+        FrameRingBuffer::Stats m_frameRing{};
+        LightClusters::Stats m_lightClusters{};
+        double m_recordingTimeMs{};
+        uint32_t m_drawCount{};
+        // memory of the renderer's intermediate attachments, the committed bytes are below the allocated ones when
+        // lazily allocated memory was never needed
+        VkDeviceSize m_attachmentBytesAllocated{};
+        VkDeviceSize m_attachmentBytesCommitted{};
+        // counted by pipeline statistics around the passes that draw the entities, lags a few frames like the GPU
+        // timings. 0 when the device cannot count them
+        uint64_t m_fragmentInvocations{};
+        bool m_depthPrePass{};
+        ShadowMaps::Stats m_shadows{};
+        // the scene is rendered at m_renderExtent then upscaled to the swapchain
+        bool m_dynamicResolution{};
+        VkExtent2D m_renderExtent{};
+        DynamicResolution::Stats m_resolution{};
+        // the compiled graph of the renderers built on one, 0 passes otherwise
+        RenderGraph::Stats m_renderGraph{};
+        // the time the CPU waited for a frame in flight and a swapchain image, and the time the GPU idled between the
+        // last two finished frames. The GPU idle time lags like the GPU timings and stays 0 without timestamps
+        double m_cpuWaitMs{};
+        double m_gpuIdleMs{};
+        // the pipelines created on first use, 0 pipelines when the renderer asked for none
+        PipelineStateCache::Stats m_pipelineStates{};
+        // the times the swapchain was recreated, and the resources still waiting for the frames using them to finish
+        uint32_t m_swapchainRecreations{};
+        size_t m_retiredResources{};
+    };
+
+    enum class SaveFrameResult{
+        Saved,
+        NotHeadless,
+        NoFrame,
+        WriteFailed
+    };
+
+    // frame ring allocations of the scene descriptor set
+    struct SceneAllocations{
+        RingAllocation m_scene{};
+        RingAllocation m_lights{};
+        RingAllocation m_clusters{};
+        RingAllocation m_lightIndices{};
+        RingAllocation m_shadows{};
+    };
+
+    // how recordEntities binds the pipelines of the entities
+    enum class EntityPass{
+        // each material's pipeline
+        Color,
+        // each material's depth equal variant, a depth pre-pass already wrote the depth of the scene
+        ColorDepthEqual,
+        // a single material for every entity, a depth only one or the visibility one
+        SharedMaterial
+    };
+
     class Renderer {
     public:
         Renderer(Device& device, Window& window);
@@ -20,22 +92,214 @@ namespace iris::graphics{
         virtual void endFrame(VkCommandBuffer cmd) = 0;
         // cleans resources after rendering is done
         virtual void postRender() = 0;
-        virtual void renderScene(std::vector<RenderObject> & renderObjects, GpuSceneData sceneData, Camera & camera) = 0;
+        virtual void renderScene(const EntityStore& entities, const TransformStore& transforms,
+                                 const std::vector<PointLight>& pointLights,
+                                 const GpuSceneData& sceneData, Camera & camera) = 0;
 
         virtual void init() = 0;
 
-        int getMaximumFramesInFlight(){ return m_pSwapchain->m_cMaxImagesOnFlight; }
-        int getCurrentFrame(){ return m_frameCount % m_pSwapchain->m_cMaxImagesOnFlight;}
+        // chosen by the swapchain's latency profile
+        int getMaximumFramesInFlight(){ return static_cast<int>(m_pSwapchain->getFramesInFlight()); }
+        int getCurrentFrame(){ return m_frameCount % getMaximumFramesInFlight();}
         VkExtent2D getSwapchainExtent(){ return m_pSwapchain->getExtent(); }
+        // the extent the scene is rendered at, the swapchain one scaled by the dynamic resolution
+        VkExtent2D getRenderExtent();
+
+        // the render scale follows the GPU time of the frames, the controller's target frame time and gains can be
+        // changed through getResolutionController. Ignored by the renderers drawing the scene straight into the
+        // swapchain images
+        void setDynamicResolution(bool enabled);
+        [[nodiscard]] bool isDynamicResolutionEnabled() const { return m_dynamicResolution; }
+        [[nodiscard]] bool isDynamicResolutionSupported() const { return m_dynamicResolutionSupported; }
+        DynamicResolution& getResolutionController() { return m_resolutionController; }
+        [[nodiscard]] const FrameStats& getFrameStats() const { return m_frameStats; }
+        // GPU time of the passes of the last frame the GPU finished
+        [[nodiscard]] const std::vector<GpuProfiler::ScopeTiming>& getGpuTimings() const { return m_pGpuProfiler->getTimings(); }
+        // GPU time of that whole frame
+        [[nodiscard]] double getGpuFrameMilliseconds() const { return m_pGpuProfiler->getFrameMilliseconds(); }
+
+        // the recording, submission, GPU end and presentation of the frames are marked by the renderer, the input and
+        // simulation stages by the caller through markLatency before renderScene
+        void markLatency(LatencyTracker::Stage stage) { m_latencyTracker.mark(static_cast<uint64_t>(m_frameCount), stage); }
+        [[nodiscard]] const LatencyTracker& getLatencyTracker() const { return m_latencyTracker; }
+
+        // the camera is updated right before the frame is submitted, from the input polled there, and its matrices
+        // are written over the ones the frame was recorded with. On by default
+        void setLateLatch(bool enabled) { m_lateLatch = enabled; }
+        [[nodiscard]] bool isLateLatchEnabled() const { return m_lateLatch; }
+        // called by the latch to sample the input before the camera is updated, the renderer polls nothing itself
+        void setInputSampler(std::function<void()> sampler) { m_inputSampler = std::move(sampler); }
+        // the entities are recorded by at most threads threads, 0 uses every thread of the pool
+        void setRecordingThreads(uint32_t threads) { m_recordingThreads = threads; }
+
+        // writes the image of the last submitted frame as a binary PPM, once the GPU finished it. Only a headless
+        // device renders into images that can be read back
+        SaveFrameResult saveLastFrame(const std::string& filePath);
     protected:
         Device& m_rDevice;
         Window& m_rWindow;
         std::unique_ptr<Swapchain> m_pSwapchain;
+        // the pipelines that are only needed once a feature is switched on, created when first asked for
+        std::unique_ptr<PipelineStateCache> m_pPipelineStateCache;
+
+        // recordEntities can be called this many times per frame, a depth pre-pass then the color pass
+        static constexpr uint32_t m_cMaxRecordingsPerFrame = 2;
+        // every frame in flight owns a pool for its primary command buffer and one pool per recording thread for the
+        // secondary command buffers, the pools are reset as a whole once the frame's fence has been waited on.
+        // The secondary buffer of recording r on thread t is at r * threadCount + t
+        struct FrameCommands{
+            VkCommandPool m_primaryPool{};
+            VkCommandBuffer m_primaryBuffer{};
+            std::vector<VkCommandPool> m_threadPools{};
+            std::vector<VkCommandBuffer> m_secondaryBuffers{};
+            uint32_t m_recordingCount{};
+        };
+        std::vector<FrameCommands> m_frameCommands{};
+        void createCommandBuffers();
+        void freeCommandBuffers();
+        // resets the command pools, the ring region and the timestamp queries of the current frame and begins its
+        // primary command buffer
+        VkCommandBuffer beginCommandBuffer();
+
+        std::unique_ptr<GpuProfiler> m_pGpuProfiler;
+        void createGpuProfiler();
+
+        // set by the renderers whose scene targets are sampled by an upscale pass, they are allocated at the swapchain
+        // extent and the scene only covers the top left getRenderExtent() of them
+        bool m_dynamicResolutionSupported{};
+        bool m_dynamicResolution{};
+        DynamicResolution m_resolutionController{};
+        float m_renderScale{1.f};
+        std::chrono::steady_clock::time_point m_lastFrameBegin{};
+        // feeds the GPU time of the last finished frame to the controller, the CPU time between two frames when the
+        // device has no timestamps. Called once the frame's timings have been read back
+        void updateRenderScale();
+
+        // transient per frame data: scene constants, lights, changed object matrices... Sized for a frame's changes,
+        // not for uploading the whole scene
+        static constexpr VkDeviceSize m_cFrameRingBytesPerFrame = 8 * 1024 * 1024;
+        std::unique_ptr<FrameRingBuffer> m_pFrameRing;
+        // and the object buffer, which is filled through it
+        void createFrameRing();
+
+        // the object matrices stay in a device local buffer, a frame only copies the ones whose world matrix changed
+        // since they were last copied. Up to m_cMaxRingObjectBytes of them go through the frame ring, a bigger upload,
+        // every matrix on the first frame, gets a staging buffer of its own
+        static constexpr uint32_t m_cMaxObjects = 128 * 1024;
+        static constexpr VkDeviceSize m_cMaxRingObjectBytes = m_cFrameRingBytesPerFrame / 4;
+        static_assert(LightClusters::m_cMaxLightIndices * sizeof(uint32_t) + m_cMaxRingObjectBytes < m_cFrameRingBytesPerFrame,
+                      "The frame ring cannot hold the light lists and the object matrices of a frame");
+        AllocatedBuffer m_objectBuffer{};
+        // by TransformId, the world stamp of the transform when its matrices were copied
+        std::vector<uint32_t> m_uploadedStamps{};
+        std::vector<VkBufferCopy> m_objectCopies{};
+        // records the copies of the changed matrices, outside of any render pass
+        void uploadObjectData(VkCommandBuffer cmd, const TransformStore& transforms);
+
+        // copies the scene constants into the frame ring and uploads the changed object matrices with cmd, the camera
+        // matrices are taken from camera. The point lights are assigned to the light clusters of the camera and
+        // uploaded with the cluster light lists, the shadow maps are fitted to the camera
+        SceneAllocations writeSceneData(VkCommandBuffer cmd, const GpuSceneData& sceneData, const TransformStore& transforms,
+                                        const std::vector<PointLight>& pointLights, const Camera& camera);
+        LightClusters m_lightClusters{};
+
+        // binding 1, the object matrices, is the object buffer. Every other buffer binding of the scene set points at
+        // the frame ring, the frame's allocations are selected with dynamic offsets: 0 scene constants, 2 point
+        // lights, 3 light clusters, 4 cluster light indices, 5 shadow matrices. Binding 6 is the shadow atlas
+        static constexpr uint32_t m_cSceneDynamicOffsetCount = 5;
+        [[nodiscard]] static std::array<uint32_t, m_cSceneDynamicOffsetCount> getSceneDynamicOffsets(const SceneAllocations& sceneAllocations);
+        std::unique_ptr<DescriptorSetLayout> createSceneSetLayout();
+        // the shadow maps must exist before it, they are created with the scene set layout
+        void writeSceneDescriptorSet(DescriptorSetLayout& layout, DescriptorPool& pool, VkDescriptorSet& set);
+
+        // shared by every renderer, their lighting shaders sample the atlas through the scene set
+        std::unique_ptr<ShadowMaps> m_pShadowMaps;
+        void createShadowMaps(DescriptorSetLayout& sceneSetLayout);
+        // renders the shadow slices of the frame, before the passes sampling them and outside of any render pass
+        void recordShadows(VkCommandBuffer cmd, const EntityStore& entities,
+                           VkDescriptorSet sceneDescriptorSet, const SceneAllocations& sceneAllocations);
+
+        // below this many objects a thread costs more to wake up than the recording it takes over
+        static constexpr size_t m_cMinEntitiesPerRecordingThread = 256;
+        uint32_t m_recordingThreads{};
+        // records the draws of the entities into secondary command buffers on the worker threads and executes them
+        // in cmd, the render pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+        // sceneDescriptorSet is bound with the offsets of the scene allocations. pSharedMaterial is only used by
+        // EntityPass::SharedMaterial
+        void recordEntities(VkCommandBuffer cmd, const EntityStore& entities,
+                            VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+                            VkDescriptorSet sceneDescriptorSet, const SceneAllocations& sceneAllocations,
+                            EntityPass pass = EntityPass::Color, const Material* pSharedMaterial = nullptr);
+        // draws the entities in [first, last) of the dense arrays and returns how many were drawn, the ones whose model
+        // or material is gone are skipped
+        uint32_t drawEntities(VkCommandBuffer cmd, const EntityStore& entities, size_t first, size_t last,
+                          VkDescriptorSet sceneDescriptorSet, const uint32_t* dynamicOffsets,
+                          EntityPass pass, const Material* pSharedMaterial);
+        // covers the render extent
+        void setViewportAndScissor(VkCommandBuffer cmd);
+
+        // intermediate attachments of the renderers. A lazily allocated image only gets memory committed when the
+        // device actually needs it, it falls back to regular memory where there is no lazily allocated memory type
+        void createImage(VkDevice device, VmaAllocator allocator,
+                         uint32_t width, uint32_t height,
+                         VkFormat format, VkImageUsageFlags usage,
+                         AllocatedImage& allocatedImage, bool lazilyAllocated = false);
+        void createImageView(VkDevice device, VkImage image, VkFormat format,
+                             VkImageAspectFlags aspectFlags, VkImageView& imageView);
+        void destroyTexture(Texture& texture);
+        // allocated and actually committed bytes of the attachments, the committed bytes of lazily allocated memory
+        // are asked to the driver
+        void updateAttachmentMemoryStats(std::initializer_list<const Texture*> attachments);
+
+        // the resources replaced while frames in flight may still use them, destroyed once those frames have finished
+        DeferredDestructionQueue m_destructionQueue{};
+        // destroyed after the frames submitted so far. What is retired may point at the renderers' own objects, they
+        // flush the queue once the device is idle in their destructors
+        void retire(std::function<void()> destroy);
+        void retireTexture(Texture& texture);
+        void retireFramebuffer(VkFramebuffer& framebuffer);
+        // the pool must be created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+        void retireDescriptorSet(DescriptorPool& pool, VkDescriptorSet& set);
+        template<typename T>
+        void retire(std::unique_ptr<T>& pObject) {
+            // a copyable owner for the std::function
+            std::shared_ptr<T> pRetired = std::move(pObject);
+            retire([pRetired]() mutable { pRetired.reset(); });
+        }
+
+        // the scene constants of the frame are in the frame ring, the recorded commands read them at their dynamic
+        // offset. Until the submission they can still be written: the camera matrices are latched there. The light
+        // clusters and shadow cascades keep the view the frame was recorded with, in its own field
+        bool m_lateLatch{true};
+        std::function<void()> m_inputSampler{};
+        GpuSceneData* m_pLatchSceneData{};
+        RingAllocation m_latchAllocation{};
+        Camera* m_pLatchCamera{};
+        // updates the camera now without late latching, or leaves it to latchCamera once it has been updated a first
+        // time. Called before the scene data of the frame is written
+        void updateCamera(Camera& camera);
+        // samples the input, updates the camera and writes its matrices into the frame's scene constants
+        void latchCamera();
+
+        // acquires the next swapchain image into m_imageIndex, the swapchain is recreated as long as it is out of date
+        void acquireSwapchainImage();
+        // latches the camera, submits cmd and presents the image. The swapchain is recreated once presented when it no
+        // longer matches the window
+        void presentFrame(VkCommandBuffer cmd);
+        // no device wait: the previous swapchain and the replaced resources are retired
+        void recreateSwapchain();
+        // rebuilds what depends on the swapchain extent: the swapchain framebuffers and the attachments, and the
+        // descriptor sets pointing at them. The render passes and pipelines are kept, the formats do not change
+        virtual void recreateSizeDependentResources() = 0;
+        // called between frames when dynamic resolution is switched, for the renderers that only need their scene
+        // targets while it is on
+        virtual void onDynamicResolutionChanged() {}
 
-        std::vector<VkCommandBuffer> m_commandBuffers{};
-        virtual void createCommandBuffers() = 0;
-        virtual void freeCommandBuffers() = 0;
+        FrameStats m_frameStats{};
+        // by frame id, the m_frameCount the frame is recorded at
+        LatencyTracker m_latencyTracker{};
 
+        uint32_t m_imageIndex{0};
         int m_frameCount{0};
     };
 }
@@ -0,0 +1,407 @@
+#include "VisibilityRenderer.hpp"
+#include "../Initializers.hpp"
+#include "../Debugger.hpp"
+#include "../AssetsManager.hpp"
+#include "../../utilities/Timer.hpp"
+
+#include <algorithm>
+
+namespace iris::graphics{
+
+    VisibilityRenderer::VisibilityRenderer(Device &device, Window &window, LatencyProfile latencyProfile)
+    : Renderer(device, window) {
+        if (!device.getEnabledFeatures().geometryShader) {
+            throw std::runtime_error("The visibility renderer needs the geometryShader feature for gl_PrimitiveID!");
+        }
+        m_pSwapchain = std::make_unique<Swapchain>(device, window.getExtent(), latencyProfile);
+    }
+
+    VisibilityRenderer::~VisibilityRenderer() {
+        vkDeviceWaitIdle(m_rDevice.getDevice());
+        m_destructionQueue.flush();
+        m_resolvePipeline.reset();
+        vkDestroyPipelineLayout(m_rDevice.getDevice(), m_resolvePipelineLayout, nullptr);
+
+        destroyTexture(m_visibilityTexture);
+        destroyTexture(m_depthTexture);
+
+        vkDestroyRenderPass(m_rDevice.getDevice(), m_renderPass, nullptr);
+    }
+
+    void VisibilityRenderer::postRender() {
+        vkDeviceWaitIdle(m_rDevice.getDevice());
+        freeCommandBuffers();
+    }
+
+    void VisibilityRenderer::init() {
+        createCommandBuffers();
+        createFrameRing();
+        createGpuProfiler();
+        // before the engine loads its models so they are uploaded there, never while a frame is recorded
+        AssetsManager::enableGeometryPool(m_rDevice, m_cMaxVertices, m_cMaxIndices);
+        initAttachments();
+        initRenderPass();
+        // the id and depth attachments are shared by every swapchain framebuffer
+        m_pSwapchain->createFramebuffersWithAttachments(m_renderPass, {m_visibilityTexture.m_imageView,
+                                                                       m_depthTexture.m_imageView});
+        updateAttachmentMemoryStats({&m_visibilityTexture, &m_depthTexture});
+    }
+
+    void VisibilityRenderer::loadRenderer() {
+        // the visibility and resolve pipelines are compiled together
+        PipelineBuildQueue buildQueue{m_rDevice};
+        initDescriptorSets();
+        initResolvePipeline(buildQueue);
+        initMaterials(buildQueue);
+        buildQueue.build();
+    }
+
+    void VisibilityRenderer::recreateSizeDependentResources() {
+        retireTexture(m_visibilityTexture);
+        retireTexture(m_depthTexture);
+        initAttachments();
+        m_pSwapchain->createFramebuffersWithAttachments(m_renderPass, {m_visibilityTexture.m_imageView,
+                                                                       m_depthTexture.m_imageView});
+        retireDescriptorSet(*m_pGlobalPool, m_resolveDescriptorSet);
+        writeResolveDescriptorSet();
+        updateAttachmentMemoryStats({&m_visibilityTexture, &m_depthTexture});
+    }
+
+    VkCommandBuffer VisibilityRenderer::beginFrame() {
+        acquireSwapchainImage();
+        // the render pass is begun by recordPasses
+        return beginCommandBuffer();
+    }
+
+    void VisibilityRenderer::renderScene(const EntityStore &entities, const TransformStore &transforms,
+                                         const std::vector<PointLight> &pointLights,
+                                         const GpuSceneData &sceneData, Camera &camera) {
+        if (transforms.size() > m_cMaxTransforms) {
+            throw std::runtime_error("Too many transforms for the visibility ids!");
+        }
+        VkCommandBuffer cmd = beginFrame();
+
+        updateCamera(camera);
+
+        SceneAllocations sceneAllocations = writeSceneData(cmd, sceneData, transforms, pointLights, camera);
+        RingAllocation drawInfos = writeDrawInfos(entities, transforms);
+
+        recordShadows(cmd, entities, m_sceneDescriptorSet, sceneAllocations);
+        recordPasses(cmd, entities, sceneAllocations, drawInfos);
+
+        endFrame(cmd);
+    }
+
+    void VisibilityRenderer::endFrame(VkCommandBuffer cmd) {
+        m_pGpuProfiler->endFrame(cmd);
+        Debugger::vkCheck(vkEndCommandBuffer(cmd), "Failed to record command buffer!");
+
+        m_pFrameRing->flush();
+        m_frameStats.m_frameRing = m_pFrameRing->getStats();
+        updateAttachmentMemoryStats({&m_visibilityTexture, &m_depthTexture});
+
+        presentFrame(cmd);
+    }
+
+    void VisibilityRenderer::recordPasses(VkCommandBuffer cmd, const EntityStore &entities,
+                                          const SceneAllocations &sceneAllocations, const RingAllocation &drawInfos) {
+        // both subpasses are timed together, timestamps cannot be written between them
+        const uint32_t scope = m_pGpuProfiler->beginScope(cmd, "visibility + resolve");
+
+        VkRenderPassBeginInfo renderPassInfo = Initializers::renderPassBeginInfo(m_renderPass,
+                                                                                 m_pSwapchain->getExtent(),
+                                                                                 m_pSwapchain->getFrameBuffer(m_imageIndex));
+        // all bits set is the id of the pixels no geometry was drawn on, the swapchain image is fully overwritten
+        VkClearValue clearValues[3]{};
+        clearValues[0].color.uint32[0] = UINT32_MAX;
+        clearValues[1].depthStencil.depth = 1.f;
+        renderPassInfo.clearValueCount = 3;
+        renderPassInfo.pClearValues = clearValues;
+
+        // the fragment invocations count the resolve subpass too
+        m_pGpuProfiler->beginStatistics(cmd);
+        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        recordEntities(cmd, entities, m_renderPass, 0, m_pSwapchain->getFrameBuffer(m_imageIndex),
+                       m_sceneDescriptorSet, sceneAllocations,
+                       EntityPass::SharedMaterial, AssetsManager::getMaterial(m_visibilityMaterial));
+
+        // the resolve subpass is a single draw, it is recorded inline
+        vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+        setViewportAndScissor(cmd);
+
+        m_resolvePipeline->bind(cmd);
+        const auto dynamicOffsets = getSceneDynamicOffsets(sceneAllocations);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_resolvePipelineLayout, 0, 1,
+                                &m_sceneDescriptorSet, m_cSceneDynamicOffsetCount, dynamicOffsets.data());
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_resolvePipelineLayout, 1, 1,
+                                &m_resolveDescriptorSet, 1, &drawInfos.m_offset);
+
+        // the untextured pixels and the background are resolved first, then one draw per texture set discards the
+        // pixels that are not its own. The shader declares the textures, the untextured draw keeps the first set bound
+        m_screenQuad.bind(cmd);
+        VkDescriptorSet boundSet = VK_NULL_HANDLE;
+        for (uint32_t material = 0; material <= m_resolveTextureSets.size(); material++) {
+            const VkDescriptorSet textureSet = m_resolveTextureSets.empty()
+                                               ? VK_NULL_HANDLE : m_resolveTextureSets[std::max(material, 1u) - 1];
+            if (textureSet != boundSet) {
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_resolvePipelineLayout, 2, 1,
+                                        &textureSet, 0, nullptr);
+                boundSet = textureSet;
+            }
+            vkCmdPushConstants(cmd, m_resolvePipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &material);
+            m_screenQuad.draw(cmd);
+        }
+        vkCmdEndRenderPass(cmd);
+        m_pGpuProfiler->endStatistics(cmd);
+
+        m_pGpuProfiler->endScope(cmd, scope);
+    }
+
+    RingAllocation VisibilityRenderer::writeDrawInfos(const EntityStore &entities, const TransformStore &transforms) {
+        RingAllocation allocation{};
+        // the transform ids without an entity are never written in the id attachment, their entries are left as is
+        auto* pDrawInfos = m_pFrameRing->allocate<GpuDrawInfo>(transforms.size(), allocation);
+
+        const auto & models = entities.getModels();
+        const auto & materials = entities.getMaterials();
+        const auto & transformIds = entities.getTransformIds();
+
+        // handles are compared as integers, the assets are only resolved when they change
+        ModelHandle lastModel{};
+        MaterialHandle lastMaterial{};
+        const MeshRange* pRange = nullptr;
+        uint32_t material = 0;
+        m_resolveTextureSets.clear();
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (lastModel != models[i]) {
+                pRange = AssetsManager::getMeshRange(models[i]);
+                lastModel = models[i];
+            }
+            if (lastMaterial != materials[i]) {
+                const Material* pMaterial = AssetsManager::getMaterial(materials[i]);
+                material = pMaterial != nullptr && pMaterial->getTextureSet() != VK_NULL_HANDLE
+                           ? getResolveMaterial(pMaterial->getTextureSet()) : 0;
+                lastMaterial = materials[i];
+            }
+            if (pRange == nullptr) {
+                continue;
+            }
+            pDrawInfos[transformIds[i]] = {pRange->m_firstIndex, pRange->m_vertexOffset, material, 0};
+        }
+        return allocation;
+    }
+
+    uint32_t VisibilityRenderer::getResolveMaterial(VkDescriptorSet textureSet) {
+        // a handful of materials, materials sharing their textures share a draw
+        auto it = std::find(m_resolveTextureSets.begin(), m_resolveTextureSets.end(), textureSet);
+        if (it == m_resolveTextureSets.end()) {
+            m_resolveTextureSets.push_back(textureSet);
+            return static_cast<uint32_t>(m_resolveTextureSets.size());
+        }
+        return static_cast<uint32_t>(it - m_resolveTextureSets.begin()) + 1;
+    }
+
+    void VisibilityRenderer::initAttachments() {
+        VkFormat depthFormat = m_pSwapchain->findDepthFormat();
+        const VkExtent2D extent = m_pSwapchain->getExtent();
+
+        // the resolve subpass reads the ids from tile memory, neither attachment is ever stored
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, m_cVisibilityFormat,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                    m_visibilityTexture.m_allocatedImage, true);
+        createImage(m_rDevice.getDevice(), m_rDevice.getAllocator(), extent.width, extent.height, depthFormat,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                    m_depthTexture.m_allocatedImage, true);
+
+        createImageView(m_rDevice.getDevice(), m_visibilityTexture.m_allocatedImage.m_image, m_cVisibilityFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_visibilityTexture.m_imageView);
+        createImageView(m_rDevice.getDevice(), m_depthTexture.m_allocatedImage.m_image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, m_depthTexture.m_imageView);
+    }
+
+    void VisibilityRenderer::initRenderPass() {
+        // only the swapchain image is stored
+        std::vector<VkAttachmentDescription> attachments = {
+                Initializers::createAttachmentDescription(m_cVisibilityFormat, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL), // Ids
+                Initializers::createAttachmentDescription(m_pSwapchain->findDepthFormat(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL), // Depth
+                Initializers::createAttachmentDescription(m_pSwapchain->getSwapchainImageFormat(), m_pSwapchain->getFinalLayout()) // Final output
+        };
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // the resolve draw covers every pixel
+        attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+        VkAttachmentReference visibilityRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference depthRef = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        VkSubpassDescription visibilitySubpass = {};
+        visibilitySubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        visibilitySubpass.colorAttachmentCount = 1;
+        visibilitySubpass.pColorAttachments = &visibilityRef;
+        visibilitySubpass.pDepthStencilAttachment = &depthRef;
+
+        VkAttachmentReference visibilityInputRef = {0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkAttachmentReference finalColorRef = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+        VkSubpassDescription resolveSubpass = {};
+        resolveSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        resolveSubpass.inputAttachmentCount = 1;
+        resolveSubpass.pInputAttachments = &visibilityInputRef;
+        resolveSubpass.colorAttachmentCount = 1;
+        resolveSubpass.pColorAttachments = &finalColorRef;
+
+        std::vector<VkSubpassDependency> dependencies = {
+                // the previous frame's resolve subpass reads the ids this frame overwrites, and the swapchain image is
+                // written once the acquire semaphore, waited at the color output stage, is signaled
+                {
+                        .srcSubpass = VK_SUBPASS_EXTERNAL,
+                        .dstSubpass = 0,
+                        .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                        .srcAccessMask = 0,
+                        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        .dependencyFlags = 0
+                },
+                // by region, each pixel only reads its own id so the tiles stay on chip
+                {
+                        .srcSubpass = 0,
+                        .dstSubpass = 1,
+                        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                        .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+                }
+        };
+
+        std::vector<VkSubpassDescription> subpasses { visibilitySubpass, resolveSubpass };
+
+        VkRenderPassCreateInfo renderPassInfo = Initializers::createRenderPassInfo(attachments, subpasses, dependencies);
+        Debugger::vkCheck(vkCreateRenderPass(m_rDevice.getDevice(), &renderPassInfo, nullptr, &m_renderPass),
+                          "Failed to create visibility render pass!");
+    }
+
+    void VisibilityRenderer::initDescriptorSets() {
+        // the resolve set is freed when the id attachment is recreated
+        m_pGlobalPool = DescriptorPool::Builder(m_rDevice)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+                .setMaxSets(100)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 40)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 10)
+                .build();
+
+        m_pGlobalSetLayout = createSceneSetLayout();
+        createShadowMaps(*m_pGlobalSetLayout);
+        writeSceneDescriptorSet(*m_pGlobalSetLayout, *m_pGlobalPool, m_sceneDescriptorSet);
+
+        m_pTexturedSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .build();
+
+        m_pResolveSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)         // Vertices
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)         // Indices
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT) // Draw infos
+                .addBinding(3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)       // Ids
+                .build();
+        writeResolveDescriptorSet();
+    }
+
+    void VisibilityRenderer::writeResolveDescriptorSet() {
+
+        const GeometryPool* pGeometryPool = AssetsManager::getGeometryPool();
+        assert(pGeometryPool != nullptr && "The geometry pool is enabled by init");
+        VkDescriptorBufferInfo vertexInfo{pGeometryPool->getVertexBuffer(), 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo indexInfo{pGeometryPool->getIndexBuffer(), 0, VK_WHOLE_SIZE};
+        // the frame's draw infos are selected with the dynamic offset
+        VkDescriptorBufferInfo drawInfo{m_pFrameRing->getBuffer(), 0, VK_WHOLE_SIZE};
+
+        VkDescriptorImageInfo visibilityInfo;
+        visibilityInfo.sampler = VK_NULL_HANDLE;
+        visibilityInfo.imageView = m_visibilityTexture.m_imageView;
+        visibilityInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        DescriptorWriter(*m_pResolveSetLayout, *m_pGlobalPool)
+                .writeBuffer(0, &vertexInfo)
+                .writeBuffer(1, &indexInfo)
+                .writeBuffer(2, &drawInfo)
+                .writeImage(3, &visibilityInfo)
+                .build(m_resolveDescriptorSet);
+    }
+
+    void VisibilityRenderer::initMaterials(PipelineBuildQueue& buildQueue) {
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
+        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout()};
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+
+        VkPipelineLayout visibilityPipelineLayout{};
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &visibilityPipelineLayout),
+                          "Failed to create pipeline layout");
+
+        buildQueue.add([this, visibilityPipelineLayout]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            pipelineConfig.m_renderPass = m_renderPass;
+            pipelineConfig.m_subpass = 0;
+            pipelineConfig.m_pipelineLayout = visibilityPipelineLayout;
+            // the vertex buffers stay the models' ones, only the position is fetched from them
+            pipelineConfig.m_attributeDescriptions.resize(1);
+
+            return std::make_unique<Pipeline>(m_rDevice,
+                                              "../shaders/Visibility.vert.spv",
+                                              "../shaders/Visibility.frag.spv",
+                                              pipelineConfig);
+        }, [this, visibilityPipelineLayout](std::unique_ptr<Pipeline> pipeline) {
+            m_visibilityMaterial = AssetsManager::loadMaterial(m_rDevice, "Visibility", std::move(pipeline), visibilityPipelineLayout);
+        });
+
+        // the scene's materials, the resolve pass samples the textures of each entity's one
+        AssetsManager::loadMaterial(m_rDevice, "DefaultMeshNonTextured", nullptr, VK_NULL_HANDLE);
+        const MaterialHandle texturedMaterial = AssetsManager::loadMaterial(m_rDevice, "DefaultMeshTextured", nullptr, VK_NULL_HANDLE);
+        AssetsManager::setMaterialTextures(texturedMaterial,
+                AssetsManager::findTexture("StarAmbient"), AssetsManager::findTexture("StarDiffuse"),
+                AssetsManager::findTexture("StarSpecular"),
+                *m_pGlobalPool, *m_pTexturedSetLayout);
+    }
+
+    void VisibilityRenderer::initResolvePipeline(PipelineBuildQueue& buildQueue) {
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = Initializers::createPipelineLayoutInfo();
+        const std::vector descriptorSetLayouts{m_pGlobalSetLayout->getDescriptorSetLayout(),
+                                               m_pResolveSetLayout->getDescriptorSetLayout(),
+                                               m_pTexturedSetLayout->getDescriptorSetLayout()};
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
+        // the resolve draw's material, its pixels are the only ones it shades
+        VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t)};
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutCreateInfo, nullptr, &m_resolvePipelineLayout),
+                          "Failed to create pipeline layout");
+        assert(m_resolvePipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        buildQueue.add([this]() {
+            graphics::PipelineConfigInfo pipelineConfig{};
+            graphics::Pipeline::defaultPipelineConfig(pipelineConfig);
+            pipelineConfig.m_bindingDescriptions = ScreenQuad::getBindingDescriptions();
+            pipelineConfig.m_attributeDescriptions = ScreenQuad::getAttributeDescriptions();
+            // the resolve subpass has no depth attachment
+            pipelineConfig.m_depthStencilInfo.depthTestEnable = VK_FALSE;
+            pipelineConfig.m_depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+            pipelineConfig.m_renderPass = m_renderPass;
+            pipelineConfig.m_subpass = 1;
+            pipelineConfig.m_pipelineLayout = m_resolvePipelineLayout;
+
+            return std::make_unique<Pipeline>(
+                    m_rDevice,
+                    "../shaders/DeferredComposite.vert.spv",
+                    "../shaders/VisibilityResolve.frag.spv",
+                    pipelineConfig);
+        }, [this](std::unique_ptr<Pipeline> pipeline) { m_resolvePipeline = std::move(pipeline); });
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef IRIS_VISIBILITYRENDERER_HPP
+#define IRIS_VISIBILITYRENDERER_HPP
+
+#include "Renderer.hpp"
+#include "DeferredRenderer.hpp"
+
+#include <vector>
+
+namespace iris::graphics{
+    // the geometry pass writes only depth and two 32 bit ids per pixel: the transform id of the draw and the triangle
+    // of the draw. A fullscreen subpass then reads the id, fetches the triangle's three
+    // vertices from the geometry pool holding every loaded model, rebuilds the pixel's perspective correct barycentrics
+    // and shades it once. Every fragment of the geometry pass is a single integer write whatever the overdraw, and the
+    // id attachment never leaves the render pass
+    class VisibilityRenderer : public Renderer{
+    public:
+        VisibilityRenderer(Device& device, Window& window, LatencyProfile latencyProfile = LatencyProfile::Balanced);
+        ~VisibilityRenderer() override;
+
+        VisibilityRenderer(const VisibilityRenderer &) = delete;
+        VisibilityRenderer &operator=(const VisibilityRenderer &) = delete;
+
+        void init() override;
+
+        VkCommandBuffer beginFrame() override;
+        void loadRenderer() override;
+        void endFrame(VkCommandBuffer cmd) override;
+        void postRender() override;
+
+        void renderScene(const EntityStore& entities, const TransformStore& transforms,
+                         const std::vector<PointLight>& pointLights,
+                         const GpuSceneData& sceneData, Camera & camera) override;
+    private:
+        // the transform id in r and the triangle in g, unpacked so neither limits the other. A transform id of all bits
+        // set, the clear value, marks the pixels no geometry was drawn on
+        static constexpr VkFormat m_cVisibilityFormat = VK_FORMAT_R32G32_UINT;
+        static constexpr uint32_t m_cMaxTransforms = UINT32_MAX - 1;
+
+        // the models are appended to the assets' geometry pool when they are loaded
+        static constexpr uint32_t m_cMaxVertices = 1024 * 1024;
+        static constexpr uint32_t m_cMaxIndices = 4 * 1024 * 1024;
+
+        // one per transform id in the frame ring, read by the resolve pass for the id of each pixel
+        struct GpuDrawInfo{
+            uint32_t m_firstIndex;
+            uint32_t m_vertexOffset;
+            // 0 when untextured, else the resolve draw of the entity's texture set
+            uint32_t m_material;
+            uint32_t m_padding;
+        };
+
+        // the texture sets of the frame's textured materials, the resolve pass draws once for each
+        std::vector<VkDescriptorSet> m_resolveTextureSets{};
+        // fills the draw info of every entity's transform id
+        RingAllocation writeDrawInfos(const EntityStore& entities, const TransformStore& transforms);
+        // 1 + the resolve draw of the set, added when the frame uses it first
+        uint32_t getResolveMaterial(VkDescriptorSet textureSet);
+
+        // subpass 0 draws the ids and depth, subpass 1 resolves them on the swapchain image
+        VkRenderPass m_renderPass{};
+        void initRenderPass();
+
+        // transient, lazily allocated where the device supports it
+        Texture m_visibilityTexture{};
+        Texture m_depthTexture{};
+        void initAttachments();
+
+        std::unique_ptr<DescriptorPool> m_pGlobalPool{};
+        std::unique_ptr<DescriptorSetLayout> m_pGlobalSetLayout{};
+        std::unique_ptr<DescriptorSetLayout> m_pTexturedSetLayout{};
+        VkDescriptorSet m_sceneDescriptorSet{};
+        // geometry buffers, draw infos and the id input attachment
+        std::unique_ptr<DescriptorSetLayout> m_pResolveSetLayout{};
+        VkDescriptorSet m_resolveDescriptorSet{};
+        void initDescriptorSets();
+        // points at the current id attachment
+        void writeResolveDescriptorSet();
+
+        // position only, writes the ids. Shared by every entity
+        MaterialHandle m_visibilityMaterial{};
+        // the scene's materials have no pipeline, the resolve pass only binds their textures
+        void initMaterials(PipelineBuildQueue& buildQueue);
+
+        ScreenQuad m_screenQuad{m_rDevice};
+        std::unique_ptr<Pipeline> m_resolvePipeline{};
+        VkPipelineLayout m_resolvePipelineLayout{};
+        void initResolvePipeline(PipelineBuildQueue& buildQueue);
+
+        void recordPasses(VkCommandBuffer cmd, const EntityStore& entities,
+                          const SceneAllocations& sceneAllocations, const RingAllocation& drawInfos);
+
+        // the id and depth attachments, the framebuffers and the resolve set are created again at the new extent
+        void recreateSizeDependentResources() override;
+    };
+}
+
+#endif //IRIS_VISIBILITYRENDERER_HPP
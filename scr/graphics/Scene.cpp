@@ -1,6 +1,8 @@
 #include "Scene.hpp"
 #include "AssetsManager.hpp"
 
+#include <random>
+
 namespace iris::graphics{
 
     Scene::Scene(Renderer &renderer) : m_rRenderer{renderer} {
@@ -8,21 +10,23 @@ namespace iris::graphics{
         utils::Timer::init();
 
         m_sceneData.m_ambientLightColor = {1.f, 1.f, 1.f, .02f};
+        m_sceneData.m_sunDirection = glm::vec4(glm::normalize(glm::vec3(0.5f, 2.f, 1.f)), 0.f);
+        m_sceneData.m_sunColor = {1.f, 0.95f, 0.85f, .5f};
     }
 
 
     Scene::~Scene() {
-        m_renderObjects.clear();
         m_PointLights.clear();
     }
 
     void Scene::update() {
-
+        m_transforms.update();
     }
 
     void Scene::draw() {
         update();
-        m_rRenderer.renderScene(m_renderObjects, m_sceneData, m_camera);
+        m_rRenderer.markLatency(LatencyTracker::Stage::SimulationDone);
+        m_rRenderer.renderScene(m_entities, m_transforms, m_PointLights, m_sceneData, m_camera);
     }
 
     void Scene::loadScene() {
@@ -31,35 +35,85 @@ namespace iris::graphics{
     }
 
     void Scene::initObjects() {
-        //RenderObject plane{};
-        //plane.m_pModel = AssetsManager::getModel("Plane");
-        //plane.m_pMaterial = AssetsManager::getMaterial("DefaultMeshNonTextured");
-        //plane.m_transform.m_translation = {0.0f, 0.0f, 0.0f};
-        //plane.m_transform.m_scale = {0.5f, 0.5f, 0.5f};
-        //m_renderObjects.push_back(plane);
-
-        //RenderObject star{};
-        //star.m_pModel = AssetsManager::getModel("Star");
-        //star.m_pMaterial = AssetsManager::getMaterial("DefaultMeshNonTextured");
-        //star.m_transform.m_translation = {-0.3f, 0.2f, 0.0f};
-        //star.m_transform.m_scale = {0.5f, 0.5f, 0.5f};
-        //m_renderObjects.push_back(star);
-
-        RenderObject texturedStar{};
-        texturedStar.m_pModel = AssetsManager::getModel("Star");
-        texturedStar.m_pMaterial = AssetsManager::getMaterial("DefaultMeshTextured");
-        texturedStar.m_transform.m_translation = {0.3f, 0.2f, 0.0f};
-        texturedStar.m_transform.m_scale = {0.5f, 0.5f, 0.5f};
-        texturedStar.m_transform.m_rotation = {180.0f, 0.0f, 0.0f};
-        m_renderObjects.push_back(texturedStar);
+        //Transform planeTransform{};
+        //planeTransform.m_translation = {0.0f, 0.0f, 0.0f};
+        //planeTransform.m_scale = {0.5f, 0.5f, 0.5f};
+        //createEntity(AssetsManager::findModel("Plane"), AssetsManager::findMaterial("DefaultMeshNonTextured"), planeTransform);
+
+        //Transform starTransform{};
+        //starTransform.m_translation = {-0.3f, 0.2f, 0.0f};
+        //starTransform.m_scale = {0.5f, 0.5f, 0.5f};
+        //createEntity(AssetsManager::findModel("Star"), AssetsManager::findMaterial("DefaultMeshNonTextured"), starTransform);
+
+        Transform texturedStarTransform{};
+        texturedStarTransform.m_translation = {0.3f, 0.2f, 0.0f};
+        texturedStarTransform.m_scale = {0.5f, 0.5f, 0.5f};
+        texturedStarTransform.m_rotation = {180.0f, 0.0f, 0.0f};
+
+        createEntity(AssetsManager::findModel("Star"), AssetsManager::findMaterial("DefaultMeshTextured"),
+                     texturedStarTransform);
+    }
+
+    EntityId Scene::createEntity(ModelHandle model, MaterialHandle material, const Transform &transform,
+                                 EntityId parent) {
+        const TransformId parentTransform = m_entities.isAlive(parent) ? m_entities.getTransformId(parent)
+                                                                       : TransformStore::m_cNoParent;
+        const TransformId transformId = m_transforms.create(transform, parentTransform);
+        if(Model* pModel = AssetsManager::getModel(model)){
+            m_transforms.setLocalBounds(transformId, pModel->getBounds());
+        }
+
+        return m_entities.create(model, material, transformId);
+    }
+
+    void Scene::destroyEntity(EntityId entity) {
+        m_transforms.destroy(m_entities.getTransformId(entity));
+        m_entities.destroy(entity);
+    }
+
+    void Scene::createRandomLights(uint32_t count) {
+        std::mt19937 generator{42};
+        std::uniform_real_distribution<float> positionDistribution{-10.f, 10.f};
+        std::uniform_real_distribution<float> colorDistribution{0.f, 1.f};
+        std::uniform_real_distribution<float> intensityDistribution{0.005f, 0.05f};
+        m_PointLights.reserve(m_PointLights.size() + count);
+        for(uint32_t i = 0; i < count; i++){
+            m_PointLights.emplace_back(glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator)),
+                                       glm::vec3(colorDistribution(generator), colorDistribution(generator), colorDistribution(generator)),
+                                       intensityDistribution(generator));
+        }
+    }
+
+    void Scene::createOverdrawLayers(uint32_t layers) {
+        constexpr int gridSize = 5;
+        constexpr float gridSpacing = 0.25f;
+        constexpr float layerSpacing = 0.05f;
+        const ModelHandle star = AssetsManager::findModel("Star");
+        const MaterialHandle material = AssetsManager::findMaterial("DefaultMeshTextured");
+
+        // from the origin towards the camera, the layers are planes facing it
+        const glm::vec3 towardsCamera = glm::normalize(m_camera.m_transform.m_translation);
+        const glm::vec3 right = glm::normalize(glm::cross(towardsCamera, glm::vec3(0.f, 1.f, 0.f)));
+        const glm::vec3 up = glm::cross(right, towardsCamera);
+        for(uint32_t layer = 0; layer < layers; layer++){
+            // the first layer is the farthest, the last one goes through the origin
+            const glm::vec3 layerCenter = -towardsCamera * (static_cast<float>(layers - 1 - layer) * layerSpacing);
+            for(int y = 0; y < gridSize; y++){
+                for(int x = 0; x < gridSize; x++){
+                    Transform transform{};
+                    transform.m_translation = layerCenter
+                            + right * (static_cast<float>(x - gridSize / 2) * gridSpacing)
+                            + up * (static_cast<float>(y - gridSize / 2) * gridSpacing);
+                    transform.m_scale = {0.3f, 0.3f, 0.3f};
+                    transform.m_rotation = {180.0f, 0.0f, 0.0f};
+                    createEntity(star, material, transform);
+                }
+            }
+        }
     }
 
     void Scene::initLights() {
         m_PointLights.emplace_back(glm::vec3(1,1,1), glm::vec4(1,1,0,1));
         m_PointLights.emplace_back(glm::vec3(-1,1,-1), glm::vec4(0,1,1,1));
-        for(int i = 0; i < m_PointLights.size(); i++){
-            m_sceneData.m_lights[i] = m_PointLights[i].m_gpuLightData;
-        }
-        m_sceneData.m_numLights = m_PointLights.size();
     }
 }
\ No newline at end of file
@@ -16,12 +16,28 @@ namespace iris::graphics{
         void loadScene();
         void update();
         void draw();
+
+        // children follow the transform of their parent
+        EntityId createEntity(ModelHandle model, MaterialHandle material, const Transform& transform,
+                              EntityId parent = EntityId{});
+        // the entity must not have children anymore
+        void destroyEntity(EntityId entity);
+        // scatters count small lights around the scene, used to measure the frame time against the light count
+        void createRandomLights(uint32_t count);
+        // stacks layers grids of stars behind each other along the starting view direction, created back to front so
+        // every layer is shaded over the previous ones without a depth pre-pass
+        void createOverdrawLayers(uint32_t layers);
+
+        [[nodiscard]] TransformStore& getTransforms() { return m_transforms; }
+        [[nodiscard]] const TransformStore& getTransforms() const { return m_transforms; }
+        [[nodiscard]] const EntityStore& getEntities() const { return m_entities; }
     private:
         Renderer& m_rRenderer;
 
         GpuSceneData m_sceneData{};
         Camera m_camera{};
-        std::vector<RenderObject> m_renderObjects{};
+        TransformStore m_transforms{};
+        EntityStore m_entities{};
         std::vector<PointLight> m_PointLights{};
 
         // this will stay on scene
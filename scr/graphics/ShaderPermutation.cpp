@@ -0,0 +1,33 @@
+#include "ShaderPermutation.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace iris::graphics{
+
+    uint64_t ShaderPermutation::getKey() const {
+        uint32_t fogDensityBits{};
+        if (m_fog) {
+            std::memcpy(&fogDensityBits, &m_fogDensity, sizeof(fogDensityBits));
+        }
+        assert(m_maxLights < (1u << 30) && "The light count must fit in the 30 bits left by the two flags");
+        const uint64_t flags = (m_textured ? 1u : 0u) | (m_fog ? 2u : 0u) | (static_cast<uint64_t>(m_maxLights) << 2);
+        return flags | (static_cast<uint64_t>(fogDensityBits) << 32);
+    }
+
+    std::string ShaderPermutation::getName() const {
+        std::string name = m_textured ? "textured" : "untextured";
+        name += m_maxLights == 0 ? ", every light" : ", " + std::to_string(m_maxLights) + " lights";
+        if (m_fog) {
+            name += ", fog " + std::to_string(m_fogDensity);
+        }
+        return name;
+    }
+
+    void ShaderPermutation::apply(PipelineConfigInfo &configInfo) const {
+        Pipeline::setSpecializationConstant(configInfo, m_cTexturedId, static_cast<uint32_t>(m_textured));
+        Pipeline::setSpecializationConstant(configInfo, m_cMaxLightsId, m_maxLights);
+        Pipeline::setSpecializationConstant(configInfo, m_cFogId, static_cast<uint32_t>(m_fog));
+        Pipeline::setSpecializationConstant(configInfo, m_cFogDensityId, m_fogDensity);
+    }
+}
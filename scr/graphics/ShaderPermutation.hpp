@@ -0,0 +1,36 @@
+#ifndef IRIS_SHADERPERMUTATION_HPP
+#define IRIS_SHADERPERMUTATION_HPP
+
+#include "Pipeline.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace iris::graphics{
+    // the specialization constants of Default.frag. Every permutation is a pipeline built from the same SPIR-V, the
+    // branches on the constants are folded when it is created and a light loop of a fixed count can be unrolled
+    struct ShaderPermutation{
+        // the material's set 1 textures are sampled
+        bool m_textured{};
+        // at most this many lights of the fragment's cluster are shaded, 0 shades all of them
+        uint32_t m_maxLights{};
+        // exponential squared fog towards the ambient color
+        bool m_fog{};
+        float m_fogDensity{0.02f};
+
+        // the constant_id of each value in Default.frag
+        static constexpr uint32_t m_cTexturedId = 0;
+        static constexpr uint32_t m_cMaxLightsId = 1;
+        static constexpr uint32_t m_cFogId = 2;
+        static constexpr uint32_t m_cFogDensityId = 3;
+
+        // equal for the permutations building the same pipeline, the fog density only counts with the fog
+        [[nodiscard]] uint64_t getKey() const;
+        // "textured, 8 lights, fog" like, for the logs
+        [[nodiscard]] std::string getName() const;
+        // sets the constants in the config of a pipeline drawing with Default.frag
+        void apply(PipelineConfigInfo& configInfo) const;
+    };
+}
+
+#endif //IRIS_SHADERPERMUTATION_HPP
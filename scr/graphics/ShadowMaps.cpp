@@ -0,0 +1,570 @@
+#include "ShadowMaps.hpp"
+#include "Initializers.hpp"
+#include "Debugger.hpp"
+#include "AssetsManager.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace iris::graphics{
+
+    ShadowMaps::ShadowMaps(Device &device, VkDescriptorSetLayout sceneSetLayout) : m_rDevice{device} {
+        createAtlases();
+        createRenderPass();
+        createPipeline(sceneSetLayout);
+
+        m_slices.resize(m_cCascadeCount + m_cMaxShadowedPointLights * m_cPointFaces);
+        for (uint32_t cascade = 0; cascade < m_cCascadeCount; cascade++) {
+            m_slices[cascade].m_rect = {{static_cast<int32_t>(cascade * m_cCascadeSize), 0},
+                                        {m_cCascadeSize, m_cCascadeSize}};
+            m_slices[cascade].m_active = true;
+        }
+        const uint32_t facesPerRow = m_cAtlasSize / m_cPointFaceSize;
+        for (uint32_t face = 0; face < m_cMaxShadowedPointLights * m_cPointFaces; face++) {
+            m_slices[m_cCascadeCount + face].m_rect = {
+                    {static_cast<int32_t>((face % facesPerRow) * m_cPointFaceSize),
+                     static_cast<int32_t>(m_cCascadeSize + (face / facesPerRow) * m_cPointFaceSize)},
+                    {m_cPointFaceSize, m_cPointFaceSize}};
+        }
+    }
+
+    ShadowMaps::~ShadowMaps() {
+        m_pipeline.reset();
+        vkDestroyPipelineLayout(m_rDevice.getDevice(), m_pipelineLayout, nullptr);
+        vkDestroyFramebuffer(m_rDevice.getDevice(), m_framebuffer, nullptr);
+        vkDestroyFramebuffer(m_rDevice.getDevice(), m_staticFramebuffer, nullptr);
+        vkDestroyRenderPass(m_rDevice.getDevice(), m_renderPass, nullptr);
+        vkDestroySampler(m_rDevice.getDevice(), m_sampler, nullptr);
+        vkDestroyImageView(m_rDevice.getDevice(), m_atlasView, nullptr);
+        vkDestroyImageView(m_rDevice.getDevice(), m_staticAtlasView, nullptr);
+        m_rDevice.destroyImage(m_atlas);
+        m_rDevice.destroyImage(m_staticAtlas);
+    }
+
+    void ShadowMaps::createAtlases() {
+        // no stencil, the atlases are copied and sampled through their depth aspect only
+        m_depthFormat = m_rDevice.findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+                                                      VK_IMAGE_TILING_OPTIMAL,
+                                                      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {m_cAtlasSize, m_cAtlasSize, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = m_depthFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                          VK_IMAGE_USAGE_SAMPLED_BIT;
+        Debugger::vkCheck(vmaCreateImage(m_rDevice.getAllocator(), &imageInfo, &allocInfo, &m_atlas.m_image,
+                                         &m_atlas.m_allocation, nullptr), "Failed to create shadow atlas!");
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        Debugger::vkCheck(vmaCreateImage(m_rDevice.getAllocator(), &imageInfo, &allocInfo, &m_staticAtlas.m_image,
+                                         &m_staticAtlas.m_allocation, nullptr), "Failed to create static shadow atlas!");
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_depthFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        viewInfo.image = m_atlas.m_image;
+        Debugger::vkCheck(vkCreateImageView(m_rDevice.getDevice(), &viewInfo, nullptr, &m_atlasView),
+                          "Failed to create shadow atlas view!");
+        viewInfo.image = m_staticAtlas.m_image;
+        Debugger::vkCheck(vkCreateImageView(m_rDevice.getDevice(), &viewInfo, nullptr, &m_staticAtlasView),
+                          "Failed to create static shadow atlas view!");
+
+        // hardware comparison, a linear filter blends the results of the 4 texels around the sample
+        VkSamplerCreateInfo samplerInfo = Initializers::createSamplerInfo(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        Debugger::vkCheck(vkCreateSampler(m_rDevice.getDevice(), &samplerInfo, nullptr, &m_sampler),
+                          "Failed to create shadow sampler!");
+
+        // nothing is in shadow until the first slices are rendered
+        m_rDevice.immediateSubmit([this](VkCommandBuffer cmd) {
+            transitionAtlas(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            VkClearDepthStencilValue clearValue{1.0f, 0};
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+            vkCmdClearDepthStencilImage(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
+            transitionAtlas(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            transitionAtlas(cmd, m_staticAtlas.m_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+        });
+    }
+
+    void ShadowMaps::createRenderPass() {
+        // the slices not drawn this frame keep their depth, the layout transitions are barriers around the pass
+        VkAttachmentDescription depthAttachment = Initializers::createAttachmentDescription(
+                m_depthFormat, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depthAttachmentRef = {};
+        depthAttachmentRef.attachment = 0;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 0;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        std::vector<VkAttachmentDescription> attachments = { depthAttachment };
+        std::vector<VkSubpassDescription> subpasses = { subpass };
+        std::vector<VkSubpassDependency> dependencies{};
+
+        VkRenderPassCreateInfo renderPassInfo = Initializers::createRenderPassInfo(attachments, subpasses, dependencies);
+        Debugger::vkCheck(vkCreateRenderPass(m_rDevice.getDevice(), &renderPassInfo, nullptr, &m_renderPass),
+                          "Failed to create shadow render pass!");
+
+        const VkExtent2D extent{m_cAtlasSize, m_cAtlasSize};
+        const std::vector<VkImageView> framebufferAttachments{m_atlasView};
+        VkFramebufferCreateInfo framebufferInfo = Initializers::createFramebufferInfo(m_renderPass, extent, framebufferAttachments);
+        Debugger::vkCheck(vkCreateFramebuffer(m_rDevice.getDevice(), &framebufferInfo, nullptr, &m_framebuffer),
+                          "Failed to create shadow framebuffer!");
+        const std::vector<VkImageView> staticFramebufferAttachments{m_staticAtlasView};
+        VkFramebufferCreateInfo staticFramebufferInfo = Initializers::createFramebufferInfo(m_renderPass, extent, staticFramebufferAttachments);
+        Debugger::vkCheck(vkCreateFramebuffer(m_rDevice.getDevice(), &staticFramebufferInfo, nullptr, &m_staticFramebuffer),
+                          "Failed to create static shadow framebuffer!");
+    }
+
+    void ShadowMaps::createPipeline(VkDescriptorSetLayout sceneSetLayout) {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(glm::mat4);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = Initializers::createPipelineLayoutInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &sceneSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout),
+                          "Failed to create pipeline layout");
+
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfig(pipelineConfig);
+        pipelineConfig.m_renderPass = m_renderPass;
+        pipelineConfig.m_pipelineLayout = m_pipelineLayout;
+        pipelineConfig.m_attributeDescriptions.resize(1);
+        pipelineConfig.m_colorBlendInfo.attachmentCount = 0;
+        // pushes the depth of the casters away from the light, the surfaces do not shadow themselves
+        pipelineConfig.m_rasterizationInfo.depthBiasEnable = VK_TRUE;
+        pipelineConfig.m_rasterizationInfo.depthBiasConstantFactor = 1.25f;
+        pipelineConfig.m_rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+
+        m_pipeline = std::make_unique<Pipeline>(m_rDevice, "../shaders/Shadow.vert.spv", "", pipelineConfig);
+    }
+
+    RingAllocation ShadowMaps::update(FrameRingBuffer &frameRing, const GpuSceneData &sceneData,
+                                      const TransformStore &transforms, const std::vector<PointLight> &pointLights,
+                                      const Camera &camera, float aspect) {
+        m_frame++;
+        // against the matrices of the last frame, the static slices hold what was rendered with them
+        trackCasters(transforms);
+
+        RingAllocation allocation{};
+        GpuShadowData* pShadowData = frameRing.allocate<GpuShadowData>(1, allocation);
+        fitCascades(sceneData, camera, aspect, *pShadowData);
+
+        assignPointLights(pointLights, glm::vec3(glm::inverse(camera.m_viewMatrix)[3]));
+        // +x, -x, +y, -y, +z, -z like the face the shaders pick from the major axis of the direction to the light
+        static const glm::vec3 faceDirections[6] = {{1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f},
+                                                    {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+        static const glm::vec3 faceUps[6] = {{0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f},
+                                             {0.f, 0.f, -1.f}, {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}};
+        m_stats.m_shadowedPointLights = 0;
+        for (uint32_t slot = 0; slot < m_cMaxShadowedPointLights; slot++) {
+            const PointLightSlot& lightSlot = m_pointLightSlots[slot];
+            pShadowData->m_pointLightIndices[slot / 4][slot % 4] = lightSlot.m_lightIndex;
+            const bool active = lightSlot.m_lightIndex != UINT32_MAX;
+            m_stats.m_shadowedPointLights += active ? 1 : 0;
+
+            const glm::vec3 position{lightSlot.m_sphere};
+            const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(90.f), 1.f, m_cPointNear,
+                                                               std::max(lightSlot.m_sphere.w, m_cPointNear * 2.f));
+            for (uint32_t face = 0; face < m_cPointFaces; face++) {
+                const uint32_t index = slot * m_cPointFaces + face;
+                Slice& slice = m_slices[m_cCascadeCount + index];
+                slice.m_active = active;
+                if (active) {
+                    setSliceMatrix(slice, projection * glm::lookAt(position, position + faceDirections[face], faceUps[face]));
+                }
+                pShadowData->m_pointFaceMatrices[index] = slice.m_viewProjection;
+            }
+        }
+
+        for (size_t i = 0; i < m_slices.size(); i++) {
+            const VkRect2D& rect = m_slices[i].m_rect;
+            const glm::vec4 uvRect = glm::vec4(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height) /
+                                     static_cast<float>(m_cAtlasSize);
+            if (i < m_cCascadeCount) {
+                pShadowData->m_cascadeRects[i] = uvRect;
+            }
+            else {
+                pShadowData->m_pointFaceRects[i - m_cCascadeCount] = uvRect;
+            }
+        }
+        return allocation;
+    }
+
+    void ShadowMaps::fitCascades(const GpuSceneData &sceneData, const Camera &camera, float aspect,
+                                 GpuShadowData &shadowData) {
+        const glm::vec3 sunDirection = glm::normalize(glm::vec3(sceneData.m_sunDirection));
+        const glm::mat4 inverseView = glm::inverse(camera.m_viewMatrix);
+        const float tanHalfFovY = std::tan(glm::radians(Camera::m_cFieldOfView) * 0.5f);
+        const float tanHalfFovX = tanHalfFovY * aspect;
+        const float cornerSlopeSquared = tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY;
+
+        // a rotation only, the cascade centers are snapped to texel steps in it
+        const glm::vec3 up = std::abs(sunDirection.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+        const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.f), -sunDirection, up);
+        const glm::mat4 inverseLightRotation = glm::inverse(lightRotation);
+
+        float splitNear = Camera::m_cNear;
+        for (uint32_t cascade = 0; cascade < m_cCascadeCount; cascade++) {
+            const float ratio = static_cast<float>(cascade + 1) / m_cCascadeCount;
+            const float logSplit = Camera::m_cNear * std::pow(m_cShadowDistance / Camera::m_cNear, ratio);
+            const float uniformSplit = Camera::m_cNear + (m_cShadowDistance - Camera::m_cNear) * ratio;
+            const float splitFar = glm::mix(uniformSplit, logSplit, m_cSplitLambda);
+
+            // sphere around the frustum slice centered on the view axis, its radius does not change when the camera
+            // turns. Equidistant from the near and the far corners unless the far corners alone are further
+            float centerDepth = 0.5f * (splitFar + splitNear) * (1.f + cornerSlopeSquared);
+            centerDepth = std::min(centerDepth, splitFar);
+            float radius = std::sqrt((splitFar - centerDepth) * (splitFar - centerDepth) +
+                                     splitFar * splitFar * cornerSlopeSquared);
+            radius = std::ceil(radius * 16.f) / 16.f * m_cCascadePadding;
+
+            const float snapStep = 2.f * radius / m_cCascadeSize * m_cSnapTexels;
+            const glm::vec4 centerWorld = inverseView * glm::vec4(0.f, 0.f, -centerDepth, 1.f);
+            glm::vec3 centerLight{lightRotation * centerWorld};
+            centerLight = glm::floor(centerLight / snapStep) * snapStep;
+            const glm::vec3 center{inverseLightRotation * glm::vec4(centerLight, 1.f)};
+
+            const glm::mat4 view = glm::lookAt(center + sunDirection * m_cCasterDistance, center, up);
+            const glm::mat4 projection = glm::orthoRH_ZO(-radius, radius, -radius, radius, 0.f, m_cCasterDistance + radius);
+            setSliceMatrix(m_slices[cascade], projection * view);
+
+            shadowData.m_cascadeMatrices[cascade] = m_slices[cascade].m_viewProjection;
+            shadowData.m_cascadeSplits[cascade / 4][cascade % 4] = splitFar;
+            shadowData.m_cascadeTexelSizes[cascade / 4][cascade % 4] = 2.f * radius / m_cCascadeSize;
+            splitNear = splitFar;
+        }
+    }
+
+    void ShadowMaps::assignPointLights(const std::vector<PointLight> &pointLights, const glm::vec3 &cameraPosition) {
+        m_lightDistances.clear();
+        for (uint32_t i = 0; i < pointLights.size(); i++) {
+            const auto& light = pointLights[i].m_gpuLightData;
+            m_lightDistances.emplace_back(glm::distance(light.m_lightPosition, cameraPosition) - light.m_radius, i);
+        }
+        const size_t count = std::min<size_t>(m_cMaxShadowedPointLights, m_lightDistances.size());
+        std::partial_sort(m_lightDistances.begin(), m_lightDistances.begin() + count, m_lightDistances.end());
+
+        // the chosen lights already in a slot keep it, the others take the freed slots
+        std::array<bool, m_cMaxShadowedPointLights> kept{};
+        std::array<bool, m_cMaxShadowedPointLights> placed{};
+        for (size_t i = 0; i < count; i++) {
+            for (uint32_t slot = 0; slot < m_cMaxShadowedPointLights; slot++) {
+                if (m_pointLightSlots[slot].m_lightIndex == m_lightDistances[i].second) {
+                    kept[slot] = true;
+                    placed[i] = true;
+                }
+            }
+        }
+        uint32_t freeSlot = 0;
+        for (uint32_t slot = 0; slot < m_cMaxShadowedPointLights; slot++) {
+            if (!kept[slot]) {
+                m_pointLightSlots[slot].m_lightIndex = UINT32_MAX;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (placed[i]) {
+                continue;
+            }
+            while (kept[freeSlot]) {
+                freeSlot++;
+            }
+            m_pointLightSlots[freeSlot].m_lightIndex = m_lightDistances[i].second;
+            kept[freeSlot] = true;
+        }
+        // a moved light changes the matrices of its faces
+        for (auto& lightSlot : m_pointLightSlots) {
+            if (lightSlot.m_lightIndex != UINT32_MAX) {
+                const auto& light = pointLights[lightSlot.m_lightIndex].m_gpuLightData;
+                lightSlot.m_sphere = glm::vec4(light.m_lightPosition, light.m_radius);
+            }
+        }
+    }
+
+    void ShadowMaps::setSliceMatrix(Slice &slice, const glm::mat4 &viewProjection) {
+        if (slice.m_viewProjection != viewProjection) {
+            slice.m_viewProjection = viewProjection;
+            slice.m_staticValid = false;
+        }
+    }
+
+    void ShadowMaps::trackCasters(const TransformStore &transforms) {
+        if (m_casters.size() < transforms.size()) {
+            m_casters.resize(transforms.size());
+        }
+        for (TransformId id = 0; id < transforms.size(); id++) {
+            CasterState& caster = m_casters[id];
+            const uint32_t stamp = transforms.getWorldStamp(id);
+            const BoundingBox& bounds = transforms.getWorldBounds(id);
+            if (!caster.m_tracked) {
+                // a new caster starts static, it appears in the slices it touches
+                caster = {stamp, bounds, 0, true};
+                invalidate(bounds);
+                continue;
+            }
+
+            // a destroyed transform keeps its stamp, its bounds are emptied
+            const bool moved = stamp != caster.m_stamp || bounds.m_min != caster.m_bounds.m_min ||
+                               bounds.m_max != caster.m_bounds.m_max;
+            if (moved) {
+                // a static caster leaves the static atlas where it was
+                if (isStatic(id)) {
+                    invalidate(caster.m_bounds);
+                }
+                caster.m_stamp = stamp;
+                caster.m_bounds = bounds;
+                caster.m_lastMovedFrame = m_frame;
+            }
+            else if (m_frame - caster.m_lastMovedFrame == m_cStaticAfterFrames) {
+                // it stopped long enough ago, it joins the static atlas where it is now
+                invalidate(caster.m_bounds);
+            }
+        }
+    }
+
+    void ShadowMaps::invalidate(const BoundingBox &bounds) {
+        if (!bounds.isValid()) {
+            return;
+        }
+        for (auto& slice : m_slices) {
+            if (slice.m_staticValid && intersects(bounds, slice.m_viewProjection)) {
+                slice.m_staticValid = false;
+            }
+        }
+    }
+
+    bool ShadowMaps::intersects(const BoundingBox &bounds, const glm::mat4 &viewProjection) {
+        if (!bounds.isValid()) {
+            return false;
+        }
+        // outside when the 8 corners are all beyond the same clip plane, the planes are tested in clip space so the
+        // corners behind a perspective eye are handled too
+        uint32_t outsideAll = 0x3f;
+        for (uint32_t corner = 0; corner < 8; corner++) {
+            const glm::vec4 clip = viewProjection * glm::vec4((corner & 1) ? bounds.m_max.x : bounds.m_min.x,
+                                                              (corner & 2) ? bounds.m_max.y : bounds.m_min.y,
+                                                              (corner & 4) ? bounds.m_max.z : bounds.m_min.z, 1.f);
+            uint32_t outside = 0;
+            outside |= clip.x < -clip.w ? 0x01 : 0;
+            outside |= clip.x > clip.w ? 0x02 : 0;
+            outside |= clip.y < -clip.w ? 0x04 : 0;
+            outside |= clip.y > clip.w ? 0x08 : 0;
+            outside |= clip.z < 0.f ? 0x10 : 0;
+            outside |= clip.z > clip.w ? 0x20 : 0;
+            outsideAll &= outside;
+        }
+        return outsideAll == 0;
+    }
+
+    void ShadowMaps::record(VkCommandBuffer cmd, const EntityStore &entities, VkDescriptorSet sceneDescriptorSet,
+                            uint32_t dynamicOffsetCount, const uint32_t *dynamicOffsets) {
+        m_stats.m_staticSlicesRendered = 0;
+        m_stats.m_staticDraws = 0;
+        m_stats.m_dynamicDraws = 0;
+        m_stats.m_slicesRestored = 0;
+
+        // the dynamic casters are sorted into the slices they touch, the static ones are culled only when a slice is
+        // rendered again
+        m_staticCasters.clear();
+        for (auto& slice : m_slices) {
+            slice.m_dynamicCasters.clear();
+        }
+        const auto& transformIds = entities.getTransformIds();
+        for (uint32_t i = 0; i < entities.size(); i++) {
+            const TransformId id = transformIds[i];
+            if (isStatic(id)) {
+                m_staticCasters.push_back(i);
+                continue;
+            }
+            for (auto& slice : m_slices) {
+                if (slice.m_active && intersects(m_casters[id].m_bounds, slice.m_viewProjection)) {
+                    slice.m_dynamicCasters.push_back(i);
+                }
+            }
+        }
+        m_stats.m_staticCasters = static_cast<uint32_t>(m_staticCasters.size());
+        m_stats.m_dynamicCasters = static_cast<uint32_t>(entities.size() - m_staticCasters.size());
+
+        VkRenderPassBeginInfo staticPassInfo = Initializers::renderPassBeginInfo(m_renderPass, {m_cAtlasSize, m_cAtlasSize},
+                                                                                 m_staticFramebuffer);
+        VkRenderPassBeginInfo dynamicPassInfo = Initializers::renderPassBeginInfo(m_renderPass, {m_cAtlasSize, m_cAtlasSize},
+                                                                                  m_framebuffer);
+        // the atlases are loaded, the slices are cleared one by one
+        staticPassInfo.clearValueCount = 0;
+        staticPassInfo.pClearValues = nullptr;
+        dynamicPassInfo.clearValueCount = 0;
+        dynamicPassInfo.pClearValues = nullptr;
+
+        // static casters into the invalid slices of the static atlas
+        m_restoreCopies.clear();
+        bool staticPassBegun = false;
+        for (auto& slice : m_slices) {
+            if (!slice.m_active || slice.m_staticValid) {
+                continue;
+            }
+            if (!staticPassBegun) {
+                vkCmdBeginRenderPass(cmd, &staticPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+                m_pipeline->bind(cmd);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                                        &sceneDescriptorSet, dynamicOffsetCount, dynamicOffsets);
+                staticPassBegun = true;
+            }
+            VkClearAttachment clearAttachment{};
+            clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            clearAttachment.clearValue.depthStencil = {1.0f, 0};
+            VkClearRect clearRect{slice.m_rect, 0, 1};
+            vkCmdClearAttachments(cmd, 1, &clearAttachment, 1, &clearRect);
+
+            m_stats.m_staticDraws += drawCasters(cmd, entities, slice, m_staticCasters.data(), m_staticCasters.size());
+            m_stats.m_staticSlicesRendered++;
+            slice.m_staticValid = true;
+            // the sampled atlas gets the new static depth below
+            slice.m_hadDynamicCasters = true;
+        }
+        if (staticPassBegun) {
+            vkCmdEndRenderPass(cmd);
+        }
+
+        // the static depth goes back into the slices that had or will have dynamic casters drawn over it
+        for (auto& slice : m_slices) {
+            if (!slice.m_active || (!slice.m_hadDynamicCasters && slice.m_dynamicCasters.empty())) {
+                continue;
+            }
+            VkImageCopy copy{};
+            copy.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+            copy.srcOffset = {slice.m_rect.offset.x, slice.m_rect.offset.y, 0};
+            copy.dstSubresource = copy.srcSubresource;
+            copy.dstOffset = copy.srcOffset;
+            copy.extent = {slice.m_rect.extent.width, slice.m_rect.extent.height, 1};
+            m_restoreCopies.push_back(copy);
+            slice.m_hadDynamicCasters = !slice.m_dynamicCasters.empty();
+        }
+        m_stats.m_slicesRestored = static_cast<uint32_t>(m_restoreCopies.size());
+        if (m_restoreCopies.empty()) {
+            // the sampled atlas is already what this frame needs
+            return;
+        }
+
+        transitionAtlas(cmd, m_staticAtlas.m_image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        transitionAtlas(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdCopyImage(cmd, m_staticAtlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       m_atlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(m_restoreCopies.size()), m_restoreCopies.data());
+        transitionAtlas(cmd, m_staticAtlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+        transitionAtlas(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+        // dynamic casters over the restored static depth
+        vkCmdBeginRenderPass(cmd, &dynamicPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        m_pipeline->bind(cmd);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                                &sceneDescriptorSet, dynamicOffsetCount, dynamicOffsets);
+        for (const auto& slice : m_slices) {
+            if (slice.m_active && !slice.m_dynamicCasters.empty()) {
+                m_stats.m_dynamicDraws += drawCasters(cmd, entities, slice, slice.m_dynamicCasters.data(),
+                                                      slice.m_dynamicCasters.size());
+            }
+        }
+        vkCmdEndRenderPass(cmd);
+
+        transitionAtlas(cmd, m_atlas.m_image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    uint32_t ShadowMaps::drawCasters(VkCommandBuffer cmd, const EntityStore &entities, const Slice &slice,
+                                     const uint32_t *pEntities, size_t count) {
+        VkViewport viewport{};
+        viewport.x = static_cast<float>(slice.m_rect.offset.x);
+        viewport.y = static_cast<float>(slice.m_rect.offset.y);
+        viewport.width = static_cast<float>(slice.m_rect.extent.width);
+        viewport.height = static_cast<float>(slice.m_rect.extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &slice.m_rect);
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &slice.m_viewProjection);
+
+        const auto& models = entities.getModels();
+        const auto& transformIds = entities.getTransformIds();
+        ModelHandle lastModel{};
+        Model* pModel = nullptr;
+        uint32_t drawCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t entity = pEntities[i];
+            if (!intersects(m_casters[transformIds[entity]].m_bounds, slice.m_viewProjection)) {
+                continue;
+            }
+            if (pModel == nullptr || lastModel != models[entity]) {
+                pModel = AssetsManager::getModel(models[entity]);
+                if (pModel == nullptr) {
+                    continue;
+                }
+                pModel->bind(cmd);
+                lastModel = models[entity];
+            }
+            pModel->draw(cmd, transformIds[entity]);
+            drawCount++;
+        }
+        return drawCount;
+    }
+
+    void ShadowMaps::transitionAtlas(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                     VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                                     VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef IRIS_SHADOWMAPS_HPP
+#define IRIS_SHADOWMAPS_HPP
+
+#include "Objects.hpp"
+#include "EntityStore.hpp"
+#include "FrameRingBuffer.hpp"
+#include "Pipeline.hpp"
+#include "../../shaders/ShadowLimits.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace iris::graphics{
+    // must match the ShadowBuffer of Shadows.glsl, the scalars per cascade and per light are packed four to a vec4
+    struct GpuShadowData{
+        glm::mat4 m_cascadeMatrices[SHADOW_CASCADE_COUNT];
+        glm::vec4 m_cascadeRects[SHADOW_CASCADE_COUNT];                  // xy offset and zw size of the slice in atlas uv
+        glm::vec4 m_cascadeSplits[(SHADOW_CASCADE_COUNT + 3) / 4];       // view depth where each cascade ends
+        glm::vec4 m_cascadeTexelSizes[(SHADOW_CASCADE_COUNT + 3) / 4];   // world size of a texel of each cascade, receivers are offset by it
+        glm::uvec4 m_pointLightIndices[(SHADOW_MAX_POINT_LIGHTS + 3) / 4]; // index in the light buffer of each shadowed point light, ~0 for none
+        glm::mat4 m_pointFaceMatrices[SHADOW_MAX_POINT_LIGHTS * SHADOW_POINT_FACES];
+        glm::vec4 m_pointFaceRects[SHADOW_MAX_POINT_LIGHTS * SHADOW_POINT_FACES];
+    };
+
+    // directional cascades and point light cube faces, all slices of one depth atlas the shaders sample with a
+    // comparison sampler. Casters are split by whether they moved recently: the static ones are rendered into a second
+    // atlas that is kept from frame to frame, a slice of it is only rendered again when its matrix changes or a static
+    // caster touching it appears, moves or disappears. Every frame the slices holding dynamic casters get their static
+    // depth copied back in the sampled atlas and the dynamic casters are drawn on top, the other slices are untouched
+    class ShadowMaps {
+    public:
+        static constexpr uint32_t m_cAtlasSize = 4096;
+        // the cascades fill the first row of the atlas, the point light faces the rows below. The counts are the
+        // shaders' too, see ShadowLimits.h
+        static constexpr uint32_t m_cCascadeCount = SHADOW_CASCADE_COUNT;
+        static constexpr uint32_t m_cCascadeSize = 1024;
+        static constexpr uint32_t m_cMaxShadowedPointLights = SHADOW_MAX_POINT_LIGHTS;
+        static constexpr uint32_t m_cPointFaces = SHADOW_POINT_FACES;
+        static constexpr uint32_t m_cPointFaceSize = 512;
+        static_assert(m_cCascadeCount * m_cCascadeSize <= m_cAtlasSize, "The cascades do not fit in a row of the atlas");
+        static_assert(m_cCascadeSize + (m_cMaxShadowedPointLights * m_cPointFaces + m_cAtlasSize / m_cPointFaceSize - 1) /
+                      (m_cAtlasSize / m_cPointFaceSize) * m_cPointFaceSize <= m_cAtlasSize,
+                      "The point light faces do not fit below the cascades");
+        // a caster that has not moved for this many frames is drawn in the static atlas
+        static constexpr uint64_t m_cStaticAfterFrames = 8;
+        // the cascades cover the view up to this depth, past it nothing is shadowed by the sun
+        static constexpr float m_cShadowDistance = 40.0f;
+        // blend of the logarithmic and the uniform split of the cascades
+        static constexpr float m_cSplitLambda = 0.75f;
+        // the cascades move by steps of this many texels so their matrices only change once in a while, the
+        // padding keeps the view covered whatever the step
+        static constexpr float m_cSnapTexels = 16.0f;
+        static constexpr float m_cCascadePadding = 1.1f;
+        // casters this far towards the sun from the center of a cascade still shadow it
+        static constexpr float m_cCasterDistance = 50.0f;
+        static constexpr float m_cPointNear = 0.05f;
+
+        struct Stats{
+            uint32_t m_staticCasters{};      // casters kept in the static atlas
+            uint32_t m_dynamicCasters{};     // casters that moved recently, drawn every frame
+            uint32_t m_staticSlicesRendered{};
+            uint32_t m_staticDraws{};
+            uint32_t m_dynamicDraws{};
+            uint32_t m_slicesRestored{};     // slices whose static depth was copied back in the sampled atlas
+            uint32_t m_shadowedPointLights{};
+        };
+
+        ShadowMaps(Device& device, VkDescriptorSetLayout sceneSetLayout);
+        ~ShadowMaps();
+
+        ShadowMaps(const ShadowMaps &) = delete;
+        ShadowMaps &operator=(const ShadowMaps &) = delete;
+
+        // fits the cascades to the camera, picks the point lights closest to the camera, invalidates the static slices
+        // touched by casters that moved and writes the shadow data of the frame into the frame ring
+        RingAllocation update(FrameRingBuffer& frameRing, const GpuSceneData& sceneData,
+                              const TransformStore& transforms, const std::vector<PointLight>& pointLights,
+                              const Camera& camera, float aspect);
+        // renders the invalid static slices and the dynamic casters, leaves the sampled atlas ready for the fragment
+        // shaders. Outside of any render pass, sceneDescriptorSet is bound for the object matrices
+        void record(VkCommandBuffer cmd, const EntityStore& entities,
+                    VkDescriptorSet sceneDescriptorSet, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets);
+
+        [[nodiscard]] VkImageView getAtlasView() const { return m_atlasView; }
+        [[nodiscard]] VkSampler getSampler() const { return m_sampler; }
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+    private:
+        Device& m_rDevice;
+
+        VkFormat m_depthFormat{};
+        // the sampled atlas rests in DEPTH_STENCIL_READ_ONLY_OPTIMAL between frames, the static one in
+        // DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        AllocatedImage m_atlas{};
+        VkImageView m_atlasView{};
+        AllocatedImage m_staticAtlas{};
+        VkImageView m_staticAtlasView{};
+        VkSampler m_sampler{};
+        void createAtlases();
+
+        // depth only, loads and stores the atlas, the slices are cleared one by one
+        VkRenderPass m_renderPass{};
+        VkFramebuffer m_framebuffer{};
+        VkFramebuffer m_staticFramebuffer{};
+        void createRenderPass();
+
+        // position only, the slice matrix is a push constant, depth biased
+        std::unique_ptr<Pipeline> m_pipeline{};
+        VkPipelineLayout m_pipelineLayout{};
+        void createPipeline(VkDescriptorSetLayout sceneSetLayout);
+
+        struct Slice{
+            VkRect2D m_rect{};
+            glm::mat4 m_viewProjection{0.f};
+            // the faces of an unused point light slot are neither rendered nor sampled
+            bool m_active{};
+            // the static atlas holds the static casters of this matrix
+            bool m_staticValid{};
+            // dynamic casters were drawn over it last frame, the static depth has to be restored
+            bool m_hadDynamicCasters{};
+            // entity indices of the dynamic casters drawn this frame
+            std::vector<uint32_t> m_dynamicCasters{};
+        };
+        // the cascades then 6 faces per point light slot
+        std::vector<Slice> m_slices{};
+        void setSliceMatrix(Slice& slice, const glm::mat4& viewProjection);
+        void invalidate(const BoundingBox& bounds);
+        [[nodiscard]] static bool intersects(const BoundingBox& bounds, const glm::mat4& viewProjection);
+
+        // movements of every transform, a transform is static once it has not moved for m_cStaticAfterFrames
+        struct CasterState{
+            uint32_t m_stamp{};
+            BoundingBox m_bounds{};
+            uint64_t m_lastMovedFrame{};
+            bool m_tracked{};
+        };
+        std::vector<CasterState> m_casters{};
+        uint64_t m_frame{m_cStaticAfterFrames};
+        void trackCasters(const TransformStore& transforms);
+        // entity indices of the static casters, rebuilt by record
+        std::vector<uint32_t> m_staticCasters{};
+        [[nodiscard]] bool isStatic(TransformId id) const {
+            return id >= m_casters.size() || m_frame - m_casters[id].m_lastMovedFrame >= m_cStaticAfterFrames;
+        }
+
+        // light buffer index and sphere of the light of each point light slot, slots keep their light while it is
+        // chosen so its static slices stay valid
+        struct PointLightSlot{
+            uint32_t m_lightIndex{UINT32_MAX};
+            glm::vec4 m_sphere{0.f};
+        };
+        std::array<PointLightSlot, m_cMaxShadowedPointLights> m_pointLightSlots{};
+        // distance from the camera to the sphere of each light and its index
+        std::vector<std::pair<float, uint32_t>> m_lightDistances{};
+        void assignPointLights(const std::vector<PointLight>& pointLights, const glm::vec3& cameraPosition);
+
+        void fitCascades(const GpuSceneData& sceneData, const Camera& camera, float aspect, GpuShadowData& shadowData);
+
+        // returns the number of casters drawn, the ones outside the slice are skipped
+        uint32_t drawCasters(VkCommandBuffer cmd, const EntityStore& entities, const Slice& slice,
+                             const uint32_t* pEntities, size_t count);
+        void transitionAtlas(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                             VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                             VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const;
+
+        std::vector<VkImageCopy> m_restoreCopies{};
+
+        Stats m_stats{};
+    };
+}
+
+#endif //IRIS_SHADOWMAPS_HPP
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <limits>
 #include "Swapchain.hpp"
 #include "Debugger.hpp"
@@ -9,8 +12,16 @@ namespace iris::graphics{
     //Constructor and destructor//
     //////////////////////////////
 
-    Swapchain::Swapchain(Device &device, VkExtent2D extent) : m_rDevice{device}, m_windowExtent{extent} {
-        createSwapchain();
+    Swapchain::Swapchain(Device &device, VkExtent2D extent, LatencyProfile latencyProfile)
+    : m_rDevice{device}, m_latencyProfile{latencyProfile}, m_windowExtent{extent} {
+        m_framesInFlight = latencyProfile == LatencyProfile::LowLatency ? 1
+                         : latencyProfile == LatencyProfile::Balanced ? 2 : 3;
+        if (m_rDevice.isHeadless()) {
+            createOffscreenImages();
+        }
+        else {
+            createSwapchain(VK_NULL_HANDLE);
+        }
         createImageViews();
         createDepthResources();
         createSyncObjects();
@@ -22,8 +33,13 @@ namespace iris::graphics{
         }
         m_swapchainImageViews.clear();
 
-        vkDestroySwapchainKHR(m_rDevice.getDevice(), m_swapchain, nullptr);
-
+        if (m_swapchain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(m_rDevice.getDevice(), m_swapchain, nullptr);
+        }
+        for (size_t i = 0; i < m_offscreenImageMemories.size(); i++) {
+            vkDestroyImage(m_rDevice.getDevice(), m_swapchainImages[i], nullptr);
+            vkFreeMemory(m_rDevice.getDevice(), m_offscreenImageMemories[i], nullptr);
+        }
 
         for (int i = 0; i < m_depthImages.size(); i++) {
             vkDestroyImageView(m_rDevice.getDevice(), m_depthImageViews[i], nullptr);
@@ -36,7 +52,7 @@ namespace iris::graphics{
         }
 
         // cleanup synchronization objects
-        for (size_t i = 0; i < m_cMaxImagesOnFlight; i++) {
+        for (size_t i = 0; i < m_framesInFlight; i++) {
             vkDestroySemaphore(m_rDevice.getDevice(), m_renderSemaphores[i], nullptr);
             vkDestroySemaphore(m_rDevice.getDevice(), m_presentSemaphores[i], nullptr);
             vkDestroyFence(m_rDevice.getDevice(), m_inFlightFences[i], nullptr);
@@ -47,13 +63,21 @@ namespace iris::graphics{
     //  Private methods //
     /////////////////////
 
-    void Swapchain::createSwapchain() {
+    void Swapchain::createSwapchain(VkSwapchainKHR oldSwapchain) {
         SwapChainSupportDetails swapChainSupport = m_rDevice.getSwapChainSupport();
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.m_formats);
         VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.m_presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.m_capabilities);
 
+        // an image the presentation engine holds, one being rendered and one more per extra frame in flight. The low
+        // latency profile queues as few as possible
         uint32_t imageCount = swapChainSupport.m_capabilities.minImageCount + 1;
+        if (m_latencyProfile == LatencyProfile::LowLatency) {
+            imageCount = swapChainSupport.m_capabilities.minImageCount;
+        }
+        else if (m_latencyProfile != LatencyProfile::Balanced) {
+            imageCount = std::max(imageCount, m_framesInFlight + 1);
+        }
         if (swapChainSupport.m_capabilities.maxImageCount > 0 &&
             imageCount > swapChainSupport.m_capabilities.maxImageCount) {
             imageCount = swapChainSupport.m_capabilities.maxImageCount;
@@ -89,7 +113,8 @@ namespace iris::graphics{
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
 
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // the presentation engine can reuse the resources of the old one and finish presenting its images
+        createInfo.oldSwapchain = oldSwapchain;
 
         Debugger::vkCheck(vkCreateSwapchainKHR(m_rDevice.getDevice(), &createInfo, nullptr, &m_swapchain),
                           "Failed to create swapchain!");
@@ -107,6 +132,38 @@ namespace iris::graphics{
         m_swapChainExtent = extent;
     }
 
+    void Swapchain::createOffscreenImages() {
+        // one image per frame in flight, the format the surface is usually given
+        m_swapchainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        m_swapChainExtent = m_windowExtent;
+        m_swapchainImages.resize(m_framesInFlight);
+        m_offscreenImageMemories.resize(m_framesInFlight);
+
+        for (uint32_t i = 0; i < m_framesInFlight; i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = m_swapChainExtent.width;
+            imageInfo.extent.height = m_swapChainExtent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = m_swapchainImageFormat;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.flags = 0;
+
+            m_rDevice.createImageWithInfo(
+                    imageInfo,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    m_swapchainImages[i],
+                    m_offscreenImageMemories[i]);
+        }
+    }
+
     void Swapchain::createImageViews() {
         m_swapchainImageViews.resize(getImagesCount());
         for (size_t i = 0; i < m_swapchainImages.size(); i++) {
@@ -168,9 +225,9 @@ namespace iris::graphics{
     }
 
     void Swapchain::createSyncObjects() {
-        m_presentSemaphores.resize(m_cMaxImagesOnFlight);
-        m_renderSemaphores.resize(m_cMaxImagesOnFlight);
-        m_inFlightFences.resize(m_cMaxImagesOnFlight);
+        m_presentSemaphores.resize(m_framesInFlight);
+        m_renderSemaphores.resize(m_framesInFlight);
+        m_inFlightFences.resize(m_framesInFlight);
         m_imagesInFlight.resize(getImagesCount(), VK_NULL_HANDLE);
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -180,7 +237,7 @@ namespace iris::graphics{
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < m_cMaxImagesOnFlight; i++) {
+        for (size_t i = 0; i < m_framesInFlight; i++) {
             if (vkCreateSemaphore(m_rDevice.getDevice(), &semaphoreInfo, nullptr, &m_presentSemaphores[i]) != VK_SUCCESS ||
                 vkCreateSemaphore(m_rDevice.getDevice(), &semaphoreInfo, nullptr, &m_renderSemaphores[i]) != VK_SUCCESS ||
                 vkCreateFence(m_rDevice.getDevice(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
@@ -202,19 +259,19 @@ namespace iris::graphics{
     }
 
     VkPresentModeKHR Swapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-        for (const auto &availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                std::cout << "Present mode: Mailbox" << std::endl;
-                return availablePresentMode;
-            }
-        }
+        auto isAvailable = [&availablePresentModes](VkPresentModeKHR presentMode) {
+            return std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end();
+        };
 
-        // for (const auto &availablePresentMode : availablePresentModes) {
-        //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-        //     std::cout << "Present mode: Immediate" << std::endl;
-        //     return availablePresentMode;
-        //   }
-        // }
+        if (m_latencyProfile == LatencyProfile::Benchmark && isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+            std::cout << "Present mode: Immediate" << std::endl;
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        // a low latency frame is presented on the vblank following its submission, without replacing a queued one
+        if (m_latencyProfile != LatencyProfile::LowLatency && isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) {
+            std::cout << "Present mode: Mailbox" << std::endl;
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        }
 
         std::cout << "Present mode: V-Sync" << std::endl;
         return VK_PRESENT_MODE_FIFO_KHR;
@@ -241,7 +298,67 @@ namespace iris::graphics{
     /////////////////////
 
 
-    uint32_t Swapchain::acquireNextImage(int currentFrame) {
+    void Swapchain::recreate(VkExtent2D extent, DeferredDestructionQueue &destructionQueue, uint64_t frameCount) {
+        m_windowExtent = extent;
+        const VkFormat previousFormat = m_swapchainImageFormat;
+        const VkSwapchainKHR oldSwapchain = m_swapchain;
+        std::vector<VkImageView> oldImageViews = std::move(m_swapchainImageViews);
+        std::vector<VkImage> oldDepthImages = std::move(m_depthImages);
+        std::vector<VkImageView> oldDepthImageViews = std::move(m_depthImageViews);
+        std::vector<VkDeviceMemory> oldDepthImageMemories = std::move(m_depthImageMemories);
+        std::vector<VkFramebuffer> oldFramebuffers = std::move(m_swapchainFramebuffers);
+        std::vector<VkImage> oldOffscreenImages = m_rDevice.isHeadless() ? std::move(m_swapchainImages) : std::vector<VkImage>{};
+        std::vector<VkDeviceMemory> oldOffscreenImageMemories = std::move(m_offscreenImageMemories);
+        m_swapchainImages.clear();
+        m_offscreenImageMemories.clear();
+        m_swapchainImageViews.clear();
+        m_depthImages.clear();
+        m_depthImageViews.clear();
+        m_depthImageMemories.clear();
+        m_swapchainFramebuffers.clear();
+
+        if (m_rDevice.isHeadless()) {
+            createOffscreenImages();
+        }
+        else {
+            createSwapchain(oldSwapchain);
+        }
+        // the render passes and pipelines built for the previous images are kept
+        if (m_swapchainImageFormat != previousFormat) {
+            throw std::runtime_error("The swapchain format changed while recreating it!");
+        }
+        createImageViews();
+        createDepthResources();
+        // the new images were never rendered to
+        m_imagesInFlight.assign(getImagesCount(), VK_NULL_HANDLE);
+
+        VkDevice device = m_rDevice.getDevice();
+        destructionQueue.push(frameCount, [device, oldSwapchain, oldImageViews, oldDepthImages, oldDepthImageViews,
+                                           oldDepthImageMemories, oldFramebuffers, oldOffscreenImages,
+                                           oldOffscreenImageMemories]() {
+            for (auto framebuffer : oldFramebuffers) {
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            }
+            for (size_t i = 0; i < oldDepthImages.size(); i++) {
+                vkDestroyImageView(device, oldDepthImageViews[i], nullptr);
+                vkDestroyImage(device, oldDepthImages[i], nullptr);
+                vkFreeMemory(device, oldDepthImageMemories[i], nullptr);
+            }
+            for (auto imageView : oldImageViews) {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
+            for (size_t i = 0; i < oldOffscreenImages.size(); i++) {
+                vkDestroyImage(device, oldOffscreenImages[i], nullptr);
+                vkFreeMemory(device, oldOffscreenImageMemories[i], nullptr);
+            }
+            if (oldSwapchain != VK_NULL_HANDLE) {
+                vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+            }
+        });
+    }
+
+    bool Swapchain::acquireNextImage(int currentFrame, uint32_t& imageIndex) {
+        const auto waitBegin = std::chrono::steady_clock::now();
         vkWaitForFences(
                 m_rDevice.getDevice(),
                 1,
@@ -249,15 +366,42 @@ namespace iris::graphics{
                 VK_TRUE,
                 std::numeric_limits<uint64_t>::max());
 
-        Debugger::vkCheck(vkAcquireNextImageKHR(
-                                  m_rDevice.getDevice(),
-                                  m_swapchain,
-                                  std::numeric_limits<uint64_t>::max(),
-                                  m_presentSemaphores[currentFrame],  // must be a not signaled semaphore
+        // the offscreen images are used in turn, the fence just waited on was the one of the frame that last used it
+        if (m_rDevice.isHeadless()) {
+            m_swapchainImageIndex = static_cast<uint32_t>(currentFrame) % getImagesCount();
+            m_imagesInFlight[m_swapchainImageIndex] = m_inFlightFences[currentFrame];
+            m_cpuWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitBegin).count();
+            imageIndex = m_swapchainImageIndex;
+            return true;
+        }
+
+        const VkResult result = vkAcquireNextImageKHR(
+                m_rDevice.getDevice(),
+                m_swapchain,
+                std::numeric_limits<uint64_t>::max(),
+                m_presentSemaphores[currentFrame],  // must be a not signaled semaphore
                 VK_NULL_HANDLE,
-                                  &m_swapchainImageIndex)
-                , "Failed to acquire next image!");
-        return m_swapchainImageIndex;
+                &m_swapchainImageIndex);
+        // the semaphore was not signaled, it can be given to the next acquisition. A suboptimal image can still be
+        // presented, the swapchain is recreated once it has been
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            m_cpuWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitBegin).count();
+            return false;
+        }
+        if (result != VK_SUBOPTIMAL_KHR) {
+            Debugger::vkCheck(result, "Failed to acquire next image!");
+        }
+
+        // another frame in flight may still be rendering to the image
+        VkFence& imageFence = m_imagesInFlight[m_swapchainImageIndex];
+        if (imageFence != VK_NULL_HANDLE && imageFence != m_inFlightFences[currentFrame]) {
+            vkWaitForFences(m_rDevice.getDevice(), 1, &imageFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        imageFence = m_inFlightFences[currentFrame];
+
+        m_cpuWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitBegin).count();
+        imageIndex = m_swapchainImageIndex;
+        return true;
     }
 
     void Swapchain::createFramebuffers(VkRenderPass renderPass) {
@@ -267,49 +411,37 @@ namespace iris::graphics{
             std::vector<VkImageView> attachments = {m_swapchainImageViews[i], m_depthImageViews[i]};
 
             VkFramebufferCreateInfo framebufferInfo = Initializers::createFramebufferInfo(renderPass,
-                                                                                          m_windowExtent,
+                                                                                          m_swapChainExtent,
                                                                                           attachments);
             Debugger::vkCheck(vkCreateFramebuffer(m_rDevice.getDevice(), &framebufferInfo, nullptr, &m_swapchainFramebuffers[i]),
                               "Failed to create framebuffer!");
         }
     }
 
-    void Swapchain::createFramebufferWithAttachments(VkRenderPass renderPass, int attachmentsCount) {
+    void Swapchain::createFramebuffersWithAttachments(VkRenderPass renderPass, const std::vector<VkImageView>& attachments) {
         m_swapchainFramebuffers.resize(getImagesCount());
 
-
         for (size_t i = 0; i < getImagesCount(); i++) {
-            std::vector<VkImageView> attachments;
-            for(int i = 0; i < attachmentsCount; i++){
-                if(i != attachmentsCount - 1){
-                    attachments.push_back(VK_NULL_HANDLE);
-                }
-                else{
-                    attachments.push_back(m_swapchainImageViews[i]);
-                }
-            }
+            std::vector<VkImageView> framebufferAttachments = attachments;
+            framebufferAttachments.push_back(m_swapchainImageViews[i]);
+
             VkFramebufferCreateInfo framebufferInfo = Initializers::createFramebufferInfo(renderPass,
-                                                                                          m_windowExtent,
-                                                                                          attachments);
+                                                                                          m_swapChainExtent,
+                                                                                          framebufferAttachments);
             Debugger::vkCheck(vkCreateFramebuffer(m_rDevice.getDevice(), &framebufferInfo, nullptr, &m_swapchainFramebuffers[i]),
                               "Failed to create framebuffer!");
         }
-
-
     }
 
-    void Swapchain::submitCommandBuffers(const VkCommandBuffer *buffers, int currentFrameIndex) {
-        if (m_imagesInFlight[currentFrameIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(m_rDevice.getDevice(), 1, &m_imagesInFlight[currentFrameIndex], VK_TRUE, UINT64_MAX);
-        }
-        m_imagesInFlight[currentFrameIndex] = m_inFlightFences[currentFrameIndex];
-
+    bool Swapchain::submitCommandBuffers(const VkCommandBuffer *buffers, int currentFrameIndex) {
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+        // nothing was acquired nor is presented without a surface
+        const bool headless = m_rDevice.isHeadless();
         VkSemaphore waitSemaphores[] = {m_presentSemaphores[currentFrameIndex]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = headless ? 0 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
@@ -317,7 +449,7 @@ namespace iris::graphics{
         submitInfo.pCommandBuffers = buffers;
 
         VkSemaphore signalSemaphores[] = {m_renderSemaphores[currentFrameIndex]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(m_rDevice.getDevice(), 1, &m_inFlightFences[currentFrameIndex]);
@@ -326,6 +458,11 @@ namespace iris::graphics{
             VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        m_submitTime = std::chrono::steady_clock::now();
+        if (headless) {
+            m_presentTime = m_submitTime;
+            return true;
+        }
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -339,7 +476,60 @@ namespace iris::graphics{
 
         presentInfo.pImageIndices = &m_swapchainImageIndex;
 
-        Debugger::vkCheck(vkQueuePresentKHR(m_rDevice.getPresentQueue(), &presentInfo),
-                          "Failed to present image!");
+        const VkResult result = vkQueuePresentKHR(m_rDevice.getPresentQueue(), &presentInfo);
+        m_presentTime = std::chrono::steady_clock::now();
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            return false;
+        }
+        Debugger::vkCheck(result, "Failed to present image!");
+        return true;
+    }
+
+    void Swapchain::readImage(uint32_t imageIndex, std::vector<uint8_t>& rgba) {
+        assert(m_rDevice.isHeadless() && "Only the offscreen images can be read back!");
+        // the frame that rendered to the image has to be complete
+        if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(m_rDevice.getDevice(), 1, &m_imagesInFlight[imageIndex], VK_TRUE,
+                            std::numeric_limits<uint64_t>::max());
+        }
+
+        const size_t pixelCount = static_cast<size_t>(m_swapChainExtent.width) * m_swapChainExtent.height;
+        AllocatedBuffer readbackBuffer = m_rDevice.createBuffer(pixelCount * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                VMA_MEMORY_USAGE_GPU_TO_CPU,
+                                                                VMA_ALLOCATION_CREATE_MAPPED_BIT);
+        const VkImage image = m_swapchainImages[imageIndex];
+        const VkExtent2D extent = m_swapChainExtent;
+        m_rDevice.immediateSubmit([=](VkCommandBuffer cmd) {
+            // the last pass left the image in getFinalLayout()
+            VkBufferImageCopy copyRegion = {};
+            copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copyRegion.imageSubresource.layerCount = 1;
+            copyRegion.imageExtent = {extent.width, extent.height, 1};
+            vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.m_buffer, 1,
+                                   &copyRegion);
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = readbackBuffer.m_buffer;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr,
+                                 1, &barrier, 0, nullptr);
+        });
+        vmaInvalidateAllocation(m_rDevice.getAllocator(), readbackBuffer.m_allocation, 0, VK_WHOLE_SIZE);
+
+        // the images are BGRA
+        const auto* pPixels = static_cast<const uint8_t*>(readbackBuffer.m_pMappedData);
+        rgba.resize(pixelCount * 4);
+        for (size_t i = 0; i < pixelCount; i++) {
+            rgba[i * 4 + 0] = pPixels[i * 4 + 2];
+            rgba[i * 4 + 1] = pPixels[i * 4 + 1];
+            rgba[i * 4 + 2] = pPixels[i * 4 + 0];
+            rgba[i * 4 + 3] = pPixels[i * 4 + 3];
+        }
+        m_rDevice.destroyBuffer(readbackBuffer);
     }
 }
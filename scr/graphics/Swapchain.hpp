@@ -2,25 +2,60 @@
 #define IRIS_SWAPCHAIN_HPP
 
 #include "Device.hpp"
+#include "DeferredDestructionQueue.hpp"
+
+#include <chrono>
 
 namespace iris::graphics{
+    // how many frames the CPU records ahead of the GPU and how the images are presented
+    enum class LatencyProfile{
+        // one frame in flight, FIFO and the fewest images. The CPU updates the scene before waiting for the previous
+        // frame, it waits late and records with the freshest state, the GPU idles while the frame is recorded
+        LowLatency,
+        // two frames in flight, MAILBOX when available
+        Balanced,
+        // three frames in flight and MAILBOX, the CPU and GPU overlap as long as the GPU keeps up
+        Throughput,
+        // three frames in flight and IMMEDIATE, no vsync: the frame rate is only bound by the CPU and GPU
+        Benchmark
+    };
+
     class Swapchain {
     public:
-        explicit Swapchain(Device& device, VkExtent2D extent);
+        Swapchain(Device& device, VkExtent2D extent, LatencyProfile latencyProfile = LatencyProfile::Balanced);
         ~Swapchain();
 
         Swapchain(const Swapchain &) = delete;
         Swapchain& operator=(const Swapchain &) = delete;
 
-        const int m_cMaxImagesOnFlight = 2;
+        [[nodiscard]] uint32_t getFramesInFlight() const { return m_framesInFlight; }
+        [[nodiscard]] LatencyProfile getLatencyProfile() const { return m_latencyProfile; }
 
         unsigned int getImagesCount() { return m_swapchainImages.size(); }
         VkExtent2D getExtent() { return m_swapChainExtent; }
 
-        uint32_t acquireNextImage(int currentFrame);
-        void submitCommandBuffers(const VkCommandBuffer *buffers, int currentFrameIndex);
+        // waits for the frame's fence, acquires an image then waits for the frame that last rendered to that image.
+        // False when the swapchain is out of date, it has to be recreated before acquiring again
+        bool acquireNextImage(int currentFrame, uint32_t& imageIndex);
+        // the time the CPU was blocked by the last acquireNextImage
+        [[nodiscard]] double getCpuWaitMs() const { return m_cpuWaitMs; }
+        // false when the presentation found the swapchain out of date or suboptimal, the image was submitted anyway
+        bool submitCommandBuffers(const VkCommandBuffer *buffers, int currentFrameIndex);
+        // when the last submitCommandBuffers returned from the submission and from the presentation
+        [[nodiscard]] std::chrono::steady_clock::time_point getSubmitTime() const { return m_submitTime; }
+        [[nodiscard]] std::chrono::steady_clock::time_point getPresentTime() const { return m_presentTime; }
+        // a new swapchain at extent created from the current one, which is retired with its views, depth images and
+        // framebuffers into destructionQueue at frameCount: the frames in flight may still use them. The
+        // framebuffers have to be created again
+        void recreate(VkExtent2D extent, DeferredDestructionQueue& destructionQueue, uint64_t frameCount);
 
         [[nodiscard]] VkFormat getSwapchainImageFormat() const { return m_swapchainImageFormat; }
+        // the layout the last pass leaves the color image in: presented, or copied out when the device is headless
+        [[nodiscard]] VkImageLayout getFinalLayout() const {
+            return m_rDevice.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        }
+        // copies a color image rendered by a completed frame into tightly packed 8 bit RGBA, headless only
+        void readImage(uint32_t imageIndex, std::vector<uint8_t>& rgba);
         [[nodiscard]] VkFormat findDepthFormat() const {
             return m_rDevice.findSupportedFormat(
                     {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
@@ -29,12 +64,21 @@ namespace iris::graphics{
         }
 
         void createFramebuffers(VkRenderPass renderPass);
-        // for deferred rendering
-        void createFramebufferWithAttachments(VkRenderPass renderPass, int attachmentsCount);
+        // the attachments, shared by every framebuffer, followed by the swapchain image
+        void createFramebuffersWithAttachments(VkRenderPass renderPass, const std::vector<VkImageView>& attachments);
         VkFramebuffer getFrameBuffer(int index) { return m_swapchainFramebuffers[index]; }
+        // the color images in acquisition index order, for passes that build their own framebuffers
+        [[nodiscard]] const std::vector<VkImage>& getImages() const { return m_swapchainImages; }
+        [[nodiscard]] const std::vector<VkImageView>& getImageViews() const { return m_swapchainImageViews; }
     private:
         Device& m_rDevice;
 
+        LatencyProfile m_latencyProfile;
+        uint32_t m_framesInFlight{};
+        double m_cpuWaitMs{};
+        std::chrono::steady_clock::time_point m_submitTime{};
+        std::chrono::steady_clock::time_point m_presentTime{};
+
         VkSwapchainKHR m_swapchain{};
         uint32_t m_swapchainImageIndex{};
 
@@ -46,8 +90,10 @@ namespace iris::graphics{
         std::vector<VkDeviceMemory> m_depthImageMemories;
         VkFormat m_swapChainDepthFormat;
 
-        // color attachments for forward rendering
+        // color attachments for forward rendering. Without a surface they are offscreen images the swapchain
+        // owns, acquired in turn and never presented
         std::vector<VkImage> m_swapchainImages;
+        std::vector<VkDeviceMemory> m_offscreenImageMemories;
         std::vector<VkImageView> m_swapchainImageViews;
         VkFormat m_swapchainImageFormat;
 
@@ -56,10 +102,14 @@ namespace iris::graphics{
 
         std::vector<VkSemaphore> m_presentSemaphores;
         std::vector<VkSemaphore> m_renderSemaphores;
+        // one per frame in flight
         std::vector<VkFence> m_inFlightFences;
+        // one per image, the fence of the frame that last rendered to it. The images are not acquired in the order of
+        // the frames and there can be more of them
         std::vector<VkFence> m_imagesInFlight;
 
-        void createSwapchain();
+        void createSwapchain(VkSwapchainKHR oldSwapchain);
+        void createOffscreenImages();
         void createImageViews();
         void createDepthResources();
         void createSyncObjects();
@@ -0,0 +1,411 @@
+#include "TransformStore.hpp"
+#include "../utilities/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define IRIS_TRANSFORM_SIMD
+#include <xmmintrin.h>
+#endif
+
+namespace iris::graphics{
+
+    TransformId TransformStore::create(const Transform &transform, TransformId parent) {
+        assert((parent == m_cNoParent || parent < m_parents.size()) && "Parent transform does not exist");
+
+        TransformId id;
+        if (!m_freeIds.empty()) {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        else {
+            id = static_cast<TransformId>(m_objectData.size());
+            m_translations.emplace_back();
+            m_rotations.emplace_back();
+            m_scales.emplace_back();
+            m_parents.emplace_back();
+            m_localData.emplace_back();
+            m_objectData.emplace_back();
+            m_localBounds.emplace_back();
+            m_worldBounds.emplace_back();
+            m_dirtyFlags.push_back(0);
+            m_worldStamps.push_back(0);
+        }
+
+        m_translations[id] = transform.m_translation;
+        m_rotations[id] = eulerToQuaternion(transform.m_rotation);
+        m_scales[id] = transform.m_scale;
+        m_parents[id] = parent;
+        m_localBounds[id] = BoundingBox{};
+
+        m_hierarchyChanged = true;
+        markDirty(id);
+        return id;
+    }
+
+    void TransformStore::destroy(TransformId id) {
+        assert(std::find(m_parents.begin(), m_parents.end(), id) == m_parents.end() && "Transform still has children");
+
+        // a destroyed transform stays in the arrays as an empty root until its id is reused
+        m_parents[id] = m_cNoParent;
+        m_localBounds[id] = BoundingBox{};
+        m_worldBounds[id] = BoundingBox{};
+        m_hierarchyChanged = true;
+        m_freeIds.push_back(id);
+    }
+
+    void TransformStore::setParent(TransformId id, TransformId parent) {
+        for (TransformId ancestor = parent; ancestor != m_cNoParent; ancestor = m_parents[ancestor]) {
+            assert(ancestor != id && "A transform cannot be parented to its own subtree");
+        }
+
+        m_parents[id] = parent;
+        m_hierarchyChanged = true;
+        markDirty(id);
+    }
+
+    void TransformStore::setTranslation(TransformId id, const glm::vec3 &translation) {
+        m_translations[id] = translation;
+        markDirty(id);
+    }
+
+    void TransformStore::setRotation(TransformId id, const glm::quat &rotation) {
+        // the matrix build expects unit quaternions
+        m_rotations[id] = glm::normalize(rotation);
+        markDirty(id);
+    }
+
+    void TransformStore::setRotation(TransformId id, const glm::vec3 &eulerRotation) {
+        m_rotations[id] = eulerToQuaternion(eulerRotation);
+        markDirty(id);
+    }
+
+    void TransformStore::setScale(TransformId id, const glm::vec3 &scale) {
+        m_scales[id] = scale;
+        markDirty(id);
+    }
+
+    void TransformStore::setLocalBounds(TransformId id, const BoundingBox &bounds) {
+        m_localBounds[id] = bounds;
+        markDirty(id);
+    }
+
+    void TransformStore::markDirty(TransformId id) {
+        if (m_dirtyFlags[id] == 0) {
+            m_dirtyFlags[id] = 1;
+            m_dirtyIds.push_back(id);
+        }
+    }
+
+    glm::quat TransformStore::eulerToQuaternion(const glm::vec3 &eulerRotation) {
+        return glm::angleAxis(eulerRotation.y, glm::vec3{0.f, 1.f, 0.f}) *
+               glm::angleAxis(eulerRotation.x, glm::vec3{1.f, 0.f, 0.f}) *
+               glm::angleAxis(eulerRotation.z, glm::vec3{0.f, 0.f, 1.f});
+    }
+
+    void TransformStore::update() {
+        m_stats.m_matricesBuilt = static_cast<uint32_t>(m_dirtyIds.size());
+        if (m_dirtyIds.empty()) {
+            m_stats.m_worldMatricesUpdated = 0;
+            m_stats.m_buildTimeMs = 0.0;
+            return;
+        }
+
+        const auto buildStart = std::chrono::high_resolution_clock::now();
+
+        if (m_hierarchyChanged) {
+            rebuildBreadthFirstOrder();
+        }
+
+        // every id is at most once in the list, the threads never write the same matrices
+        utils::ThreadPool::instance().parallelFor(m_dirtyIds.size(), m_cMinTransformsPerThread,
+                [this](size_t first, size_t last, size_t) {
+            buildMatrices(m_dirtyIds.data() + first, last - first);
+        });
+
+        propagateWorldMatrices();
+
+        for (TransformId id : m_dirtyIds) {
+            m_dirtyFlags[id] = 0;
+        }
+        m_dirtyIds.clear();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - buildStart).count();
+        m_stats.m_levelCount = m_levelCount;
+        m_stats.m_buildTimeMs = seconds * 1000.0;
+        m_stats.m_matricesPerSecond = m_stats.m_matricesBuilt / seconds;
+    }
+
+    void TransformStore::rebuildBreadthFirstOrder() {
+        const auto count = static_cast<uint32_t>(m_parents.size());
+
+        // children of every id packed in one array, in id order
+        std::vector<uint32_t> childBegin(count + 1, 0);
+        for (TransformId parent : m_parents) {
+            if (parent != m_cNoParent) {
+                childBegin[parent + 1]++;
+            }
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            childBegin[i + 1] += childBegin[i];
+        }
+        std::vector<TransformId> children(childBegin[count]);
+        std::vector<uint32_t> childCursor(childBegin.begin(), childBegin.end() - 1);
+        for (TransformId id = 0; id < count; id++) {
+            if (m_parents[id] != m_cNoParent) {
+                children[childCursor[m_parents[id]]++] = id;
+            }
+        }
+
+        m_breadthFirstOrder.clear();
+        m_breadthFirstOrder.reserve(count);
+        for (TransformId id = 0; id < count; id++) {
+            if (m_parents[id] == m_cNoParent) {
+                m_breadthFirstOrder.push_back(id);
+            }
+        }
+
+        m_slots.resize(count);
+        m_levels.resize(count);
+        m_firstChildSlots.resize(count);
+        m_childCounts.resize(count);
+
+        // appending the children of every slot while walking the order gives the breadth first order
+        m_levelCount = m_breadthFirstOrder.empty() ? 0 : 1;
+        uint32_t levelEnd = static_cast<uint32_t>(m_breadthFirstOrder.size());
+        for (uint32_t slot = 0; slot < m_breadthFirstOrder.size(); slot++) {
+            if (slot == levelEnd) {
+                levelEnd = static_cast<uint32_t>(m_breadthFirstOrder.size());
+                m_levelCount++;
+            }
+
+            const TransformId id = m_breadthFirstOrder[slot];
+            m_slots[id] = slot;
+            m_levels[id] = m_levelCount - 1;
+            m_firstChildSlots[slot] = static_cast<uint32_t>(m_breadthFirstOrder.size());
+            m_childCounts[slot] = childBegin[id + 1] - childBegin[id];
+            m_breadthFirstOrder.insert(m_breadthFirstOrder.end(),
+                                       children.begin() + childBegin[id], children.begin() + childBegin[id + 1]);
+        }
+        assert(m_breadthFirstOrder.size() == count && "Transform hierarchy has a cycle");
+
+        m_dirtySlotsPerLevel.resize(m_levelCount);
+        m_hierarchyChanged = false;
+    }
+
+    void TransformStore::propagateWorldMatrices() {
+        m_updateIndex++;
+        for (TransformId id : m_dirtyIds) {
+            m_worldStamps[id] = m_updateIndex;
+            m_dirtySlotsPerLevel[m_levels[id]].push_back(m_slots[id]);
+        }
+
+        // a level only reads the world matrices of the level above, which are final once its parallelFor returned
+        uint32_t worldMatricesUpdated = 0;
+        for (uint32_t level = 0; level < m_levelCount; level++) {
+            auto & dirtySlots = m_dirtySlotsPerLevel[level];
+            if (dirtySlots.empty()) {
+                continue;
+            }
+
+            utils::ThreadPool::instance().parallelFor(dirtySlots.size(), m_cMinTransformsPerThread,
+                    [this, &dirtySlots](size_t first, size_t last, size_t) {
+                for (size_t i = first; i < last; i++) {
+                    updateWorld(m_breadthFirstOrder[dirtySlots[i]]);
+                }
+            });
+
+            // the whole subtree below a dirty transform moves with it
+            if (level + 1 < m_levelCount) {
+                auto & nextDirtySlots = m_dirtySlotsPerLevel[level + 1];
+                for (uint32_t slot : dirtySlots) {
+                    const uint32_t firstChild = m_firstChildSlots[slot];
+                    for (uint32_t child = firstChild; child < firstChild + m_childCounts[slot]; child++) {
+                        uint32_t& stamp = m_worldStamps[m_breadthFirstOrder[child]];
+                        if (stamp != m_updateIndex) {
+                            stamp = m_updateIndex;
+                            nextDirtySlots.push_back(child);
+                        }
+                    }
+                }
+            }
+
+            worldMatricesUpdated += static_cast<uint32_t>(dirtySlots.size());
+            dirtySlots.clear();
+        }
+        m_stats.m_worldMatricesUpdated = worldMatricesUpdated;
+    }
+
+    void TransformStore::updateWorld(TransformId id) {
+        const TransformId parent = m_parents[id];
+        GpuObjectData& world = m_objectData[id];
+        if (parent == m_cNoParent) {
+            world = m_localData[id];
+        }
+        else {
+            // the inverse transpose of a product is the product of the inverse transposes
+            world.m_modelMatrix = m_objectData[parent].m_modelMatrix * m_localData[id].m_modelMatrix;
+            world.m_normalMatrix = m_objectData[parent].m_normalMatrix * m_localData[id].m_normalMatrix;
+        }
+        m_worldBounds[id] = m_localBounds[id].transformed(world.m_modelMatrix);
+    }
+
+    void TransformStore::buildMatrices(const TransformId *pIds, size_t count) {
+        size_t i = 0;
+#ifdef IRIS_TRANSFORM_SIMD
+        // one transform per lane, the columns are transposed back into the per object matrices at the end
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 two = _mm_set1_ps(2.f);
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            const TransformId id0 = pIds[i], id1 = pIds[i + 1], id2 = pIds[i + 2], id3 = pIds[i + 3];
+            const glm::quat& q0 = m_rotations[id0];
+            const glm::quat& q1 = m_rotations[id1];
+            const glm::quat& q2 = m_rotations[id2];
+            const glm::quat& q3 = m_rotations[id3];
+            const glm::vec3& s0 = m_scales[id0];
+            const glm::vec3& s1 = m_scales[id1];
+            const glm::vec3& s2 = m_scales[id2];
+            const glm::vec3& s3 = m_scales[id3];
+            const glm::vec3& t0 = m_translations[id0];
+            const glm::vec3& t1 = m_translations[id1];
+            const glm::vec3& t2 = m_translations[id2];
+            const glm::vec3& t3 = m_translations[id3];
+
+            const __m128 qx = _mm_set_ps(q3.x, q2.x, q1.x, q0.x);
+            const __m128 qy = _mm_set_ps(q3.y, q2.y, q1.y, q0.y);
+            const __m128 qz = _mm_set_ps(q3.z, q2.z, q1.z, q0.z);
+            const __m128 qw = _mm_set_ps(q3.w, q2.w, q1.w, q0.w);
+
+            const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+            const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+            const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+            // rotation matrix columns
+            const __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+            const __m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+            const __m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+            const __m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+            const __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+            const __m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+            const __m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+            const __m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+            const __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+            const __m128 sx = _mm_set_ps(s3.x, s2.x, s1.x, s0.x);
+            const __m128 sy = _mm_set_ps(s3.y, s2.y, s1.y, s0.y);
+            const __m128 sz = _mm_set_ps(s3.z, s2.z, s1.z, s0.z);
+            const __m128 invSx = _mm_div_ps(one, sx);
+            const __m128 invSy = _mm_div_ps(one, sy);
+            const __m128 invSz = _mm_div_ps(one, sz);
+
+            GpuObjectData* pData[4] = { &m_localData[id0], &m_localData[id1], &m_localData[id2], &m_localData[id3] };
+
+            // writes one column of the matrix of each of the 4 transforms
+            auto storeColumn = [&pData](__m128 x, __m128 y, __m128 z, __m128 w, bool normal, int column) {
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                const __m128 columns[4] = { x, y, z, w };
+                for (int lane = 0; lane < 4; lane++) {
+                    glm::mat4& matrix = normal ? pData[lane]->m_normalMatrix : pData[lane]->m_modelMatrix;
+                    _mm_storeu_ps(&matrix[column].x, columns[lane]);
+                }
+            };
+
+            storeColumn(_mm_mul_ps(r00, sx), _mm_mul_ps(r01, sx), _mm_mul_ps(r02, sx), zero, false, 0);
+            storeColumn(_mm_mul_ps(r10, sy), _mm_mul_ps(r11, sy), _mm_mul_ps(r12, sy), zero, false, 1);
+            storeColumn(_mm_mul_ps(r20, sz), _mm_mul_ps(r21, sz), _mm_mul_ps(r22, sz), zero, false, 2);
+            storeColumn(_mm_set_ps(t3.x, t2.x, t1.x, t0.x), _mm_set_ps(t3.y, t2.y, t1.y, t0.y),
+                        _mm_set_ps(t3.z, t2.z, t1.z, t0.z), one, false, 3);
+
+            // inverse transpose of the upper 3x3 = rotation with inverted scale
+            storeColumn(_mm_mul_ps(r00, invSx), _mm_mul_ps(r01, invSx), _mm_mul_ps(r02, invSx), zero, true, 0);
+            storeColumn(_mm_mul_ps(r10, invSy), _mm_mul_ps(r11, invSy), _mm_mul_ps(r12, invSy), zero, true, 1);
+            storeColumn(_mm_mul_ps(r20, invSz), _mm_mul_ps(r21, invSz), _mm_mul_ps(r22, invSz), zero, true, 2);
+            storeColumn(zero, zero, zero, one, true, 3);
+        }
+#endif
+        for (; i < count; i++) {
+            buildMatricesScalar(pIds[i]);
+        }
+    }
+
+    void TransformStore::buildMatricesScalar(TransformId id) {
+        const glm::mat3 rotation = glm::mat3_cast(m_rotations[id]);
+        const glm::vec3& scale = m_scales[id];
+        const glm::vec3 invScale = 1.0f / scale;
+
+        GpuObjectData& data = m_localData[id];
+        data.m_modelMatrix = glm::mat4{
+                glm::vec4{rotation[0] * scale.x, 0.f},
+                glm::vec4{rotation[1] * scale.y, 0.f},
+                glm::vec4{rotation[2] * scale.z, 0.f},
+                glm::vec4{m_translations[id], 1.f}};
+        data.m_normalMatrix = glm::mat4{
+                glm::vec4{rotation[0] * invScale.x, 0.f},
+                glm::vec4{rotation[1] * invScale.y, 0.f},
+                glm::vec4{rotation[2] * invScale.z, 0.f},
+                glm::vec4{0.f, 0.f, 0.f, 1.f}};
+    }
+
+    void TransformStore::benchmark(size_t transformCount, int iterations) {
+        std::cout << "transform benchmark: " << transformCount << " transforms, " << iterations << " iterations, "
+                  << utils::ThreadPool::instance().getConcurrency() << " threads"
+#ifdef IRIS_TRANSFORM_SIMD
+                  << " (simd)"
+#endif
+                  << std::endl;
+
+        for (bool hierarchy : {false, true}) {
+            TransformStore store{};
+            std::mt19937 generator{42};
+            std::uniform_real_distribution<float> distribution{-10.f, 10.f};
+            for (size_t i = 0; i < transformCount; i++) {
+                Transform transform{};
+                transform.m_translation = {distribution(generator), distribution(generator), distribution(generator)};
+                transform.m_rotation = {distribution(generator), distribution(generator), distribution(generator)};
+                transform.m_scale = glm::vec3{1.f + distribution(generator) * 0.05f};
+
+                TransformId parent = m_cNoParent;
+                if (hierarchy && i > 0) {
+                    parent = std::uniform_int_distribution<TransformId>{0, static_cast<TransformId>(i - 1)}(generator);
+                }
+                store.create(transform, parent);
+            }
+            store.update();
+
+            std::vector<TransformId> allIds(transformCount);
+            for (size_t i = 0; i < transformCount; i++) {
+                allIds[i] = static_cast<TransformId>(i);
+            }
+
+            if (!hierarchy) {
+                // single thread, same kernel as the parallel update
+                const auto singleStart = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    store.buildMatrices(allIds.data(), allIds.size());
+                }
+                const double singleSeconds = std::chrono::duration<double>(
+                        std::chrono::high_resolution_clock::now() - singleStart).count();
+                std::cout << "  local matrices, single thread: "
+                          << static_cast<double>(transformCount) * iterations / singleSeconds / 1e6 << " M/s" << std::endl;
+            }
+
+            double updateSeconds = 0.0;
+            for (int i = 0; i < iterations; i++) {
+                for (TransformId id : allIds) {
+                    store.setTranslation(id, store.getTranslation(id) + glm::vec3{0.001f});
+                }
+                store.update();
+                updateSeconds += store.getStats().m_buildTimeMs / 1000.0;
+            }
+
+            std::cout << (hierarchy ? "  hierarchy of " : "  flat, ") << store.getStats().m_levelCount << " levels, "
+                      << "local + world update: "
+                      << static_cast<double>(transformCount) * iterations / updateSeconds / 1e6 << " M/s" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef IRIS_TRANSFORMSTORE_HPP
+#define IRIS_TRANSFORMSTORE_HPP
+
+#include "BoundingBox.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace iris::graphics{
+    struct Transform{
+        glm::vec3 m_translation{};
+        glm::vec3 m_scale{1.f, 1.f, 1.f};
+        // euler angles in radians, applied in y, x, z order
+        glm::vec3 m_rotation{};
+    };
+
+    struct GpuObjectData{
+        glm::mat4 m_modelMatrix{1.f };
+        glm::mat4 m_normalMatrix{1.f };
+    };
+
+    // index of a transform in the store, it is also the index of its matrices in the object buffer the shaders read
+    using TransformId = uint32_t;
+
+    // keeps local translations, rotations and scales in separate arrays. Setting a component marks the transform dirty
+    // and update() rebuilds the local matrices of the dirty transforms and the world matrices of their subtrees only,
+    // so transforms that do not move cost nothing
+    class TransformStore {
+    public:
+        static constexpr TransformId m_cNoParent = UINT32_MAX;
+
+        struct Stats{
+            uint32_t m_matricesBuilt{};     // local matrices built during the last update
+            uint32_t m_worldMatricesUpdated{};
+            uint32_t m_levelCount{};        // depth of the hierarchy
+            double m_buildTimeMs{};
+            double m_matricesPerSecond{};
+        };
+
+        TransformId create(const Transform& transform, TransformId parent = m_cNoParent);
+        // the id is reused by a later create, the transform must not have children anymore
+        void destroy(TransformId id);
+        // the transform keeps its local values, it moves with its new parent from now on
+        void setParent(TransformId id, TransformId parent);
+        [[nodiscard]] TransformId getParent(TransformId id) const { return m_parents[id]; }
+
+        void setTranslation(TransformId id, const glm::vec3& translation);
+        void setRotation(TransformId id, const glm::quat& rotation);
+        void setRotation(TransformId id, const glm::vec3& eulerRotation);
+        void setScale(TransformId id, const glm::vec3& scale);
+
+        [[nodiscard]] const glm::vec3& getTranslation(TransformId id) const { return m_translations[id]; }
+        [[nodiscard]] const glm::quat& getRotation(TransformId id) const { return m_rotations[id]; }
+        [[nodiscard]] const glm::vec3& getScale(TransformId id) const { return m_scales[id]; }
+
+        // object space bounds, the world bounds follow the transform
+        void setLocalBounds(TransformId id, const BoundingBox& bounds);
+        [[nodiscard]] const BoundingBox& getWorldBounds(TransformId id) const { return m_worldBounds[id]; }
+        // changes every time the world matrix of the transform is rebuilt, compared with a previous value it tells
+        // whether the transform moved since then
+        [[nodiscard]] uint32_t getWorldStamp(TransformId id) const { return m_worldStamps[id]; }
+
+        // rebuilds the matrices of the transforms changed since the last call, in parallel and 4 at a time with SIMD,
+        // then propagates the world matrices down the dirty subtrees one hierarchy level at a time
+        void update();
+
+        [[nodiscard]] size_t size() const { return m_objectData.size(); }
+        // world matrices, contiguous and indexed by TransformId. The renderer copies the ones whose world stamp changed
+        // into its object buffer
+        [[nodiscard]] const std::vector<GpuObjectData>& getObjectData() const { return m_objectData; }
+        [[nodiscard]] const Stats& getStats() const { return m_stats; }
+
+        // same rotation as the euler angles of a Transform
+        static glm::quat eulerToQuaternion(const glm::vec3& eulerRotation);
+
+        // rebuilds transformCount random transforms iterations times and prints the matrices built per second, once
+        // with every transform a root and once with each transform parented to a random earlier one
+        static void benchmark(size_t transformCount, int iterations);
+    private:
+        std::vector<glm::vec3> m_translations{};
+        std::vector<glm::quat> m_rotations{};
+        std::vector<glm::vec3> m_scales{};
+        std::vector<TransformId> m_parents{};
+        std::vector<GpuObjectData> m_localData{};
+        std::vector<GpuObjectData> m_objectData{};
+        std::vector<BoundingBox> m_localBounds{};
+        std::vector<BoundingBox> m_worldBounds{};
+
+        std::vector<TransformId> m_freeIds{};
+
+        std::vector<uint8_t> m_dirtyFlags{};
+        std::vector<TransformId> m_dirtyIds{};
+        void markDirty(TransformId id);
+
+        // breadth first order of the hierarchy, rebuilt when a parent changes. Levels are contiguous ranges of slots
+        // and the children of a slot are contiguous in the next level
+        bool m_hierarchyChanged{false};
+        std::vector<TransformId> m_breadthFirstOrder{};   // slot -> id
+        std::vector<uint32_t> m_slots{};                  // id -> slot
+        std::vector<uint32_t> m_levels{};                 // id -> depth
+        std::vector<uint32_t> m_firstChildSlots{};        // slot -> slot of its first child
+        std::vector<uint32_t> m_childCounts{};            // slot -> number of children
+        uint32_t m_levelCount{};
+        void rebuildBreadthFirstOrder();
+
+        // a transform whose stamp equals the current update index gets its world matrix rebuilt this update
+        uint32_t m_updateIndex{0};
+        std::vector<uint32_t> m_worldStamps{};
+        std::vector<std::vector<uint32_t>> m_dirtySlotsPerLevel{};
+        void propagateWorldMatrices();
+        void updateWorld(TransformId id);
+
+        // below this many transforms a thread costs more to wake up than the matrices it builds
+        static constexpr size_t m_cMinTransformsPerThread = 2048;
+        void buildMatrices(const TransformId* pIds, size_t count);
+        void buildMatricesScalar(TransformId id);
+
+        Stats m_stats{};
+    };
+}
+
+#endif //IRIS_TRANSFORMSTORE_HPP
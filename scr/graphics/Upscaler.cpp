@@ -0,0 +1,98 @@
+#include "Upscaler.hpp"
+#include "Initializers.hpp"
+#include "Debugger.hpp"
+
+#include <cassert>
+
+namespace iris::graphics{
+
+    Upscaler::Upscaler(Device &device, VkRenderPass renderPass, uint32_t subpass, VkImageView sourceView,
+                       VkExtent2D sourceExtent) : m_rDevice{device}, m_sourceExtent{sourceExtent} {
+        createDescriptorSet(sourceView);
+        createPipeline(renderPass, subpass);
+    }
+
+    Upscaler::~Upscaler() {
+        m_pipeline.reset();
+        vkDestroyPipelineLayout(m_rDevice.getDevice(), m_pipelineLayout, nullptr);
+        vkDestroySampler(m_rDevice.getDevice(), m_sampler, nullptr);
+    }
+
+    void Upscaler::createDescriptorSet(VkImageView sourceView) {
+        VkSamplerCreateInfo samplerInfo = Initializers::createSamplerInfo(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+        Debugger::vkCheck(vkCreateSampler(m_rDevice.getDevice(), &samplerInfo, nullptr, &m_sampler),
+                          "Failed to create upscale sampler!");
+
+        m_pPool = DescriptorPool::Builder(m_rDevice)
+                .setMaxSets(1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+                .build();
+
+        m_pSetLayout = DescriptorSetLayout::Builder(m_rDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .build();
+
+        VkDescriptorImageInfo sourceInfo;
+        sourceInfo.sampler = m_sampler;
+        sourceInfo.imageView = sourceView;
+        sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        DescriptorWriter(*m_pSetLayout, *m_pPool)
+                .writeImage(0, &sourceInfo)
+                .build(m_descriptorSet);
+    }
+
+    void Upscaler::createPipeline(VkRenderPass renderPass, uint32_t subpass) {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstants);
+
+        const VkDescriptorSetLayout setLayout = m_pSetLayout->getDescriptorSetLayout();
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = Initializers::createPipelineLayoutInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        Debugger::vkCheck(vkCreatePipelineLayout(m_rDevice.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout),
+                          "Failed to create pipeline layout");
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfig(pipelineConfig);
+        // the triangle is built by the vertex shader from gl_VertexIndex, no vertex buffer
+        pipelineConfig.m_bindingDescriptions.clear();
+        pipelineConfig.m_attributeDescriptions.clear();
+        pipelineConfig.m_depthStencilInfo.depthTestEnable = VK_FALSE;
+        pipelineConfig.m_depthStencilInfo.depthWriteEnable = VK_FALSE;
+        pipelineConfig.m_renderPass = renderPass;
+        pipelineConfig.m_subpass = subpass;
+        pipelineConfig.m_pipelineLayout = m_pipelineLayout;
+
+        m_pipeline = std::make_unique<Pipeline>(m_rDevice, "../shaders/Upscale.vert.spv", "../shaders/Upscale.frag.spv",
+                                                pipelineConfig);
+    }
+
+    void Upscaler::record(VkCommandBuffer cmd, VkExtent2D renderExtent, VkExtent2D targetExtent) const {
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(targetExtent.width);
+        viewport.height = static_cast<float>(targetExtent.height);
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{ {0, 0}, targetExtent };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        PushConstants constants{};
+        constants.m_uvScale[0] = static_cast<float>(renderExtent.width) / static_cast<float>(m_sourceExtent.width);
+        constants.m_uvScale[1] = static_cast<float>(renderExtent.height) / static_cast<float>(m_sourceExtent.height);
+        // at the target resolution the filter is a copy, there is nothing to sharpen
+        const bool scaled = renderExtent.width != targetExtent.width || renderExtent.height != targetExtent.height;
+        constants.m_sharpness = scaled ? m_sharpness : 0.0f;
+
+        m_pipeline->bind(cmd);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                                &m_descriptorSet, 0, nullptr);
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &constants);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef IRIS_UPSCALER_HPP
+#define IRIS_UPSCALER_HPP
+
+#include "Device.hpp"
+#include "Pipeline.hpp"
+#include "Descriptors.hpp"
+
+#include <memory>
+
+namespace iris::graphics{
+    // draws the region of a source image a frame was rendered in over the whole target, a fullscreen triangle with a
+    // bilinear filter. The source is larger than the region whenever the render resolution is below the target one,
+    // the filter is kept inside the region so the stale pixels around it never bleed in. A sharpening of the
+    // neighbouring source texels, kept within their range so edges do not ring, can be added on top
+    class Upscaler {
+    public:
+        // the source view must be in SHADER_READ_ONLY_OPTIMAL when recorded. The pipeline is built for the subpass
+        // of renderPass, with depth test and write off whether the subpass has a depth attachment
+        Upscaler(Device& device, VkRenderPass renderPass, uint32_t subpass, VkImageView sourceView, VkExtent2D sourceExtent);
+        ~Upscaler();
+
+        Upscaler(const Upscaler &) = delete;
+        Upscaler &operator=(const Upscaler &) = delete;
+
+        // inside the render pass, the viewport and scissor are set to the target extent
+        void record(VkCommandBuffer cmd, VkExtent2D renderExtent, VkExtent2D targetExtent) const;
+
+        // 0 is a plain bilinear filter, 1 the strongest sharpening
+        static constexpr float m_cDefaultSharpness = 0.25f;
+        void setSharpness(float sharpness) { m_sharpness = sharpness; }
+        [[nodiscard]] float getSharpness() const { return m_sharpness; }
+    private:
+        // must match Upscale.frag
+        struct PushConstants{
+            float m_uvScale[2];
+            float m_sharpness;
+        };
+
+        Device& m_rDevice;
+        VkExtent2D m_sourceExtent{};
+        float m_sharpness{m_cDefaultSharpness};
+
+        VkSampler m_sampler{};
+        std::unique_ptr<DescriptorPool> m_pPool{};
+        std::unique_ptr<DescriptorSetLayout> m_pSetLayout{};
+        VkDescriptorSet m_descriptorSet{};
+        void createDescriptorSet(VkImageView sourceView);
+
+        std::unique_ptr<Pipeline> m_pipeline{};
+        VkPipelineLayout m_pipelineLayout{};
+        void createPipeline(VkRenderPass renderPass, uint32_t subpass);
+    };
+}
+
+#endif //IRIS_UPSCALER_HPP
@@ -4,12 +4,15 @@
 #include <iostream>
 
 namespace iris::graphics{
-    Window::Window(int width, int height, std::string windowName)
-    : m_width{width}, m_height{height}, m_name{std::move(windowName)}
+    Window::Window(int width, int height, std::string windowName, bool headless)
+    : m_width{width}, m_height{height}, m_name{std::move(windowName)}, m_headless{headless}
     {
+        if (m_headless) {
+            return;
+        }
         glfwInit();
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
         m_pWindow = glfwCreateWindow(m_width, m_height,
                                      m_name.c_str(), nullptr, nullptr);
@@ -21,14 +24,18 @@ namespace iris::graphics{
         glfwSetWindowUserPointer(m_pWindow, this);
         glfwSetCursorPosCallback(m_pWindow, mouseCallback);
         glfwSetKeyCallback(m_pWindow, keyCallback);
+        glfwSetFramebufferSizeCallback(m_pWindow, framebufferResizeCallback);
     }
 
     bool Window::shouldCloseWindow() {
-        return glfwWindowShouldClose(m_pWindow);
+        // a headless run is bounded by its frame count
+        return !m_headless && glfwWindowShouldClose(m_pWindow);
     }
 
     void Window::pollWindowEvents() {
-        glfwPollEvents();
+        if (!m_headless) {
+            glfwPollEvents();
+        }
     }
 
     int Window::getWidth() const {
@@ -43,12 +50,31 @@ namespace iris::graphics{
         return {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height) };
     }
 
+    void Window::waitWhileMinimized() {
+        while (m_width == 0 || m_height == 0) {
+            glfwWaitEvents();
+        }
+    }
+
     void Window::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
+        if (m_headless) {
+            throw std::runtime_error("a headless window has no surface");
+        }
         if (glfwCreateWindowSurface(instance, m_pWindow, nullptr, surface) != VK_SUCCESS) {
             throw std::runtime_error("failed to create window surface");
         }
     }
 
+    void Window::framebufferResizeCallback(GLFWwindow *window, int width, int height) {
+        auto* pWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        pWindow->m_width = width;
+        pWindow->m_height = height;
+        pWindow->m_resized = true;
+        if (width > 0 && height > 0 && pWindow->m_resizeCallback) {
+            pWindow->m_resizeCallback();
+        }
+    }
+
     void Window::mouseCallback(GLFWwindow *window, double xPos, double yPos) {
         m_sMouseInfo.m_xPos = xPos;
         m_sMouseInfo.m_yPos = yPos;
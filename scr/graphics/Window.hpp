@@ -1,6 +1,7 @@
 #ifndef IRIS_WINDOW_HPP
 #define IRIS_WINDOW_HPP
 
+#include <functional>
 #include <string>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -8,7 +9,10 @@
 namespace iris::graphics{
     class Window {
     public:
-        Window(int width, int height, std::string  windowName);
+        // a headless window never initialises GLFW, it only carries the extent the offscreen images are created at
+        Window(int width, int height, std::string  windowName, bool headless = false);
+
+        [[nodiscard]] bool isHeadless() const { return m_headless; }
 
         bool shouldCloseWindow();
         void pollWindowEvents();
@@ -17,6 +21,15 @@ namespace iris::graphics{
         int getHeight() const;
         VkExtent2D getExtent();
 
+        // set when the framebuffer was resized, until the swapchain is recreated for it
+        [[nodiscard]] bool wasResized() const { return m_resized; }
+        void resetResizedFlag() { m_resized = false; }
+        // blocks while the framebuffer has no area, when the window is minimized
+        void waitWhileMinimized();
+        // called from the event processing when the framebuffer is resized to a non zero size. Some platforms block
+        // the event processing for the whole of an interactive resize, a frame drawn from it keeps the window updating
+        void setResizeCallback(std::function<void()> callback) { m_resizeCallback = std::move(callback); }
+
         void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
         inline static struct MouseInfo{
@@ -30,12 +43,16 @@ namespace iris::graphics{
             int m_mods;
         } m_sKeyInfo{};
     private:
-        GLFWwindow * m_pWindow;
+        GLFWwindow * m_pWindow{};
+        bool m_headless{};
 
         int m_width;
         int m_height;
         std::string m_name;
+        bool m_resized{};
+        std::function<void()> m_resizeCallback{};
 
+        static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
         static void mouseCallback(GLFWwindow* window, double xPos, double yPos);
         static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     };
@@ -0,0 +1,78 @@
+#ifndef IRIS_PPM_HPP
+#define IRIS_PPM_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace iris::utils
+{
+    // binary PPM images (P6), 8 bits per channel and no alpha
+    class Ppm
+    {
+    public:
+        uint32_t m_width{};
+        uint32_t m_height{};
+        std::vector<uint8_t> m_rgb{};
+
+        // the alpha of rgba is dropped
+        static bool write(const std::string& filePath, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgba)
+        {
+            std::ofstream file{filePath, std::ios::binary};
+            if (!file) {
+                return false;
+            }
+            file << "P6\n" << width << ' ' << height << "\n255\n";
+            for (size_t i = 0; i + 3 < rgba.size(); i += 4) {
+                file.write(reinterpret_cast<const char*>(&rgba[i]), 3);
+            }
+            return static_cast<bool>(file);
+        }
+
+        // false when the file cannot be read or is not an 8 bit P6 image
+        static bool read(const std::string& filePath, Ppm& image)
+        {
+            std::ifstream file{filePath, std::ios::binary};
+            std::string magic;
+            uint32_t maxValue = 0;
+            if (!(file >> magic >> image.m_width >> image.m_height >> maxValue) || magic != "P6" || maxValue != 255) {
+                return false;
+            }
+            // a single whitespace separates the header from the pixels
+            file.get();
+            image.m_rgb.resize(static_cast<size_t>(image.m_width) * image.m_height * 3);
+            file.read(reinterpret_cast<char*>(image.m_rgb.data()), static_cast<std::streamsize>(image.m_rgb.size()));
+            return static_cast<bool>(file);
+        }
+
+        // fraction of the channels of the two images that differ by more than tolerance, 1 when their sizes differ.
+        // GPUs do not round the same way, a few off by one channels are expected between two devices
+        static double difference(const Ppm& a, const Ppm& b, int tolerance)
+        {
+            if (a.m_width != b.m_width || a.m_height != b.m_height || a.m_rgb.empty()) {
+                return 1.0;
+            }
+            size_t differing = 0;
+            for (size_t i = 0; i < a.m_rgb.size(); i++) {
+                differing += std::abs(static_cast<int>(a.m_rgb[i]) - static_cast<int>(b.m_rgb[i])) > tolerance;
+            }
+            return static_cast<double>(differing) / static_cast<double>(a.m_rgb.size());
+        }
+
+        // true when every pixel has the color of the first one, a frame where nothing but the clear color was drawn
+        static bool isUniform(const Ppm& image)
+        {
+            for (size_t i = 3; i + 2 < image.m_rgb.size(); i += 3) {
+                if (image.m_rgb[i] != image.m_rgb[0] || image.m_rgb[i + 1] != image.m_rgb[1] ||
+                    image.m_rgb[i + 2] != image.m_rgb[2]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
+
+#endif //IRIS_PPM_HPP
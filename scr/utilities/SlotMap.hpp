@@ -0,0 +1,121 @@
+#ifndef IRIS_SLOTMAP_HPP
+#define IRIS_SLOTMAP_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace iris::utils
+{
+    // 32 bit reference into a SlotMap: the low bits index the slot, the high bits hold the generation the slot had when
+    // the handle was made. Tag only keeps handles of different kinds from being mixed up, the value 0 is never handed out
+    template<typename Tag>
+    class Handle
+    {
+    public:
+        static constexpr uint32_t m_cIndexBits = 20;
+        static constexpr uint32_t m_cIndexMask = (1u << m_cIndexBits) - 1;
+        static constexpr uint32_t m_cGenerationMask = (1u << (32 - m_cIndexBits)) - 1;
+
+        Handle() = default;
+        Handle(uint32_t index, uint32_t generation) : m_value{(generation << m_cIndexBits) | index} {}
+
+        [[nodiscard]] uint32_t getIndex() const { return m_value & m_cIndexMask; }
+        [[nodiscard]] uint32_t getGeneration() const { return m_value >> m_cIndexBits; }
+        [[nodiscard]] uint32_t getValue() const { return m_value; }
+        [[nodiscard]] bool isNull() const { return m_value == 0; }
+
+        bool operator==(const Handle& other) const { return m_value == other.m_value; }
+        bool operator!=(const Handle& other) const { return m_value != other.m_value; }
+    private:
+        uint32_t m_value{0};
+    };
+
+    // owns its items, one slot per item. Removing an item bumps the generation of its slot so the handles still
+    // pointing there are detected as stale, then the slot is reused by a later insert
+    template<typename T, typename Tag = T>
+    class SlotMap
+    {
+    public:
+        using HandleType = Handle<Tag>;
+
+        HandleType insert(std::unique_ptr<T> item)
+        {
+            uint32_t index;
+            if (!m_freeSlots.empty()) {
+                index = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else {
+                index = static_cast<uint32_t>(m_slots.size());
+                assert(index <= HandleType::m_cIndexMask && "Slot map is full");
+                m_slots.emplace_back();
+            }
+
+            Slot& slot = m_slots[index];
+            slot.m_pItem = std::move(item);
+            return HandleType{index, slot.m_generation};
+        }
+
+        bool remove(HandleType handle)
+        {
+            if (!contains(handle)) {
+                return false;
+            }
+
+            Slot& slot = m_slots[handle.getIndex()];
+            slot.m_pItem.reset();
+            // generation 0 is skipped when wrapping so no handle ever equals the null handle
+            slot.m_generation = (slot.m_generation + 1) & HandleType::m_cGenerationMask;
+            if (slot.m_generation == 0) {
+                slot.m_generation = 1;
+            }
+            m_freeSlots.push_back(handle.getIndex());
+            return true;
+        }
+
+        [[nodiscard]] bool contains(HandleType handle) const
+        {
+            return handle.getIndex() < m_slots.size() &&
+                   m_slots[handle.getIndex()].m_generation == handle.getGeneration() &&
+                   m_slots[handle.getIndex()].m_pItem != nullptr;
+        }
+
+        // nullptr for a stale or null handle
+        [[nodiscard]] T* get(HandleType handle) const
+        {
+            return contains(handle) ? m_slots[handle.getIndex()].m_pItem.get() : nullptr;
+        }
+
+        template<typename Function>
+        void forEach(Function&& function)
+        {
+            for (auto& slot : m_slots) {
+                if (slot.m_pItem) {
+                    function(*slot.m_pItem);
+                }
+            }
+        }
+
+        void clear()
+        {
+            for (uint32_t i = 0; i < m_slots.size(); i++) {
+                if (m_slots[i].m_pItem) {
+                    remove(HandleType{i, m_slots[i].m_generation});
+                }
+            }
+        }
+    private:
+        struct Slot
+        {
+            std::unique_ptr<T> m_pItem{};
+            uint32_t m_generation{1};
+        };
+
+        std::vector<Slot> m_slots{};
+        std::vector<uint32_t> m_freeSlots{};
+    };
+}
+
+#endif //IRIS_SLOTMAP_HPP
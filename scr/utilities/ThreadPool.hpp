@@ -0,0 +1,150 @@
+#ifndef IRIS_THREADPOOL_HPP
+#define IRIS_THREADPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace iris::utils
+{
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(unsigned int workerCount = defaultWorkerCount())
+        {
+            for (unsigned int i = 0; i < workerCount; i++) {
+                m_workers.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_condition.notify_all();
+            for (auto & worker : m_workers) {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // pool shared by the whole engine, the main thread is not counted as a worker
+        static ThreadPool& instance()
+        {
+            static ThreadPool pool{};
+            return pool;
+        }
+
+        static unsigned int defaultWorkerCount()
+        {
+            const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        // number of threads that can work on a parallelFor at the same time, including the calling thread
+        [[nodiscard]] unsigned int getConcurrency() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+        // runs on a worker, or on the calling thread before returning when the pool has none (a single core machine)
+        void enqueue(std::function<void()> task)
+        {
+            if (m_workers.empty()) {
+                task();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push(std::move(task));
+            }
+            m_condition.notify_one();
+        }
+
+        // splits [0, count) into at most getConcurrency() contiguous chunks of at least minChunkSize elements and
+        // calls function(begin, end, chunkIndex) once per chunk. Chunk indices are unique inside a call, so they can
+        // be used to pick per thread resources. The calling thread works on the chunks too and the call returns when
+        // every chunk is done.
+        template<typename Function>
+        void parallelFor(size_t count, size_t minChunkSize, Function&& function)
+        {
+            if (count == 0) {
+                return;
+            }
+
+            size_t chunkCount = std::min<size_t>(getConcurrency(), (count + std::max<size_t>(minChunkSize, 1) - 1) / std::max<size_t>(minChunkSize, 1));
+            if (chunkCount <= 1) {
+                function(size_t{0}, count, size_t{0});
+                return;
+            }
+            const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+            chunkCount = (count + chunkSize - 1) / chunkSize;
+
+            // the state outlives the call because a worker may only pick its task up after every chunk was claimed
+            auto state = std::make_shared<ParallelForState>();
+            state->m_pendingChunks = chunkCount;
+
+            auto runChunks = [state, chunkCount, chunkSize, count, pFunction = &function]() {
+                size_t chunk;
+                while ((chunk = state->m_nextChunk.fetch_add(1)) < chunkCount) {
+                    const size_t begin = chunk * chunkSize;
+                    (*pFunction)(begin, std::min(count, begin + chunkSize), chunk);
+
+                    std::lock_guard<std::mutex> lock(state->m_mutex);
+                    if (--state->m_pendingChunks == 0) {
+                        state->m_done.notify_all();
+                    }
+                }
+            };
+
+            for (size_t i = 1; i < chunkCount; i++) {
+                enqueue(runChunks);
+            }
+            runChunks();
+
+            std::unique_lock<std::mutex> lock(state->m_mutex);
+            state->m_done.wait(lock, [&state] { return state->m_pendingChunks == 0; });
+        }
+
+    private:
+        struct ParallelForState
+        {
+            std::atomic<size_t> m_nextChunk{0};
+            size_t m_pendingChunks{0};
+            std::mutex m_mutex;
+            std::condition_variable m_done;
+        };
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping = false;
+
+        void workerLoop()
+        {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                    if (m_stopping && m_tasks.empty()) {
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop();
+                }
+                task();
+            }
+        }
+    };
+}
+
+#endif //IRIS_THREADPOOL_HPP
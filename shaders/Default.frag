@@ -1,28 +1,39 @@
 //glsl version 4.5
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_control_flow_attributes : enable
+
+// specialization constants, see ShaderPermutation. The branches on them are folded when the pipeline is created
+layout(constant_id = 0) const bool TEXTURED = false;
+// at most this many lights of the cluster are shaded, 0 for all of them. A fixed count is unrolled
+layout(constant_id = 1) const uint MAX_LIGHTS = 0;
+layout(constant_id = 2) const bool FOG = false;
+layout(constant_id = 3) const float FOG_DENSITY = 0.02;
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 texCoord;
 
-struct PointLight {
-    vec4 position; // ignore w
-    vec4 color;  // w is intensity
-};
+#include "SceneData.glsl"
+#include "Lights.glsl"
+
+#include "Shadows.glsl"
 
-layout(set = 0, binding = 0) uniform SceneBuffer{
-    mat4 projectionMatrix;
-    mat4 viewMatrix;
-    vec4 ambientLightColor;
-    int numLights;
-    PointLight pointLights[50];
-} sceneData;
+// only sampled by the textured permutation, the pipeline layout of both has the set
+layout(set = 1, binding = 0) uniform sampler2D ambient;
+layout(set = 1, binding = 1) uniform sampler2D diffuse;
+layout(set = 1, binding = 2) uniform sampler2D specular;
 
-layout(push_constant) uniform Push{
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+// adds the contribution of the light to the diffuse and specular light of the fragment
+void shadeLight(uint lightIndex, vec3 cameraPos, vec3 surfaceNormal, inout vec3 diffuseLight, inout vec3 specLight)
+{
+    PointLight light = lightBuffer.lights[lightIndex];
+    vec3 directionToLight = light.position.xyz - fragPosWorld;
+    float attenuation = attenuate(directionToLight, light.position.w) * pointShadow(lightIndex, fragPosWorld, surfaceNormal);
+    vec3 viewDir = normalize(cameraPos - fragPosWorld);
+    shadePointLight(light, directionToLight, attenuation, surfaceNormal, viewDir, diffuseLight, specLight);
+}
 
 //output write
 layout (location = 0) out vec4 outColor;
@@ -33,30 +44,41 @@ void main()
     vec3 surfaceNormal = normalize(fragNormalWorld);
 
     vec3 ambientLight = sceneData.ambientLightColor.xyz * sceneData.ambientLightColor.w;
-    vec3 diffuse = vec3(0,0,0);
-    vec3 speculer = vec3(0,0,0);
-
-    for(int i = 0; i < sceneData.numLights; ++i){
-        vec4 lightPos = sceneData.pointLights[i].position;
-        vec4 lightColor = sceneData.pointLights[i].color;
-        vec3 directionToLight = lightPos.xyz - fragPosWorld;
-        float attenuation = 1.0f / dot(directionToLight, directionToLight); // distance squared
-        float cosAngIncidence = dot(surfaceNormal, directionToLight);
-        cosAngIncidence = clamp(cosAngIncidence, 0, 1);
-
-        // diffuse
-        vec3 finalLightColor = lightColor.xyz * lightColor.w * attenuation;
-        diffuse += finalLightColor * max(dot(surfaceNormal, normalize(directionToLight)),0);
-        // specular
-        vec3 viewDir = normalize(cameraPos - fragPosWorld);
-        vec3 halfAngle = normalize(directionToLight + viewDir);
-        float blinnTerm = dot(surfaceNormal, halfAngle);
-        blinnTerm = clamp(blinnTerm, 0, 1);
-        blinnTerm = cosAngIncidence != 0.0 ? blinnTerm : 0.0;
-        blinnTerm = pow(blinnTerm, 32.0);
-        speculer += lightColor.xyz * attenuation * blinnTerm;
+    vec3 diffuseLight = vec3(0,0,0);
+    vec3 specLight = vec3(0,0,0);
+
+    // only the lights touching this fragment's cluster
+    uvec2 cluster = clusterBuffer.clusters[findCluster(fragPosWorld)];
+    if (MAX_LIGHTS == 0) {
+        for(uint i = cluster.x; i < cluster.x + cluster.y; ++i){
+            shadeLight(lightIndexBuffer.indices[i], cameraPos, surfaceNormal, diffuseLight, specLight);
+        }
+    }
+    else {
+        [[unroll]] for(uint i = 0; i < MAX_LIGHTS; ++i){
+            if (i < cluster.y) {
+                shadeLight(lightIndexBuffer.indices[cluster.x + i], cameraPos, surfaceNormal, diffuseLight, specLight);
+            }
+        }
     }
 
-    // I dont add the specular light to calculations because it looks bad
-    outColor = vec4((diffuse + speculer + ambientLight) * fragColor, 1.0);
-}
\ No newline at end of file
+    // the sun, shadowed by the cascades
+    float sunLight = max(dot(surfaceNormal, sceneData.sunDirection.xyz), 0.0) * sunShadow(fragPosWorld, surfaceNormal);
+    diffuseLight += sceneData.sunColor.xyz * sceneData.sunColor.w * sunLight;
+
+    vec3 ambientColor = ambientLight;
+    vec3 diffuseColor = diffuseLight;
+    vec3 specularColor = specLight;
+    if (TEXTURED) {
+        ambientColor *= texture(ambient,texCoord).xyz;
+        diffuseColor *= texture(diffuse,texCoord).xyz;
+        specularColor *= texture(specular,texCoord).xyz;
+    }
+    vec3 color = (diffuseColor + specularColor + ambientColor) * fragColor;
+
+    if (FOG) {
+        float fogDistance = FOG_DENSITY * length(cameraPos - fragPosWorld);
+        color = mix(sceneData.ambientLightColor.xyz, color, exp(-fogDistance * fogDistance));
+    }
+    outColor = vec4(color, 1.0);
+}
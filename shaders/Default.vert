@@ -1,5 +1,6 @@
 //we will be using glsl version 4.5 syntax
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 color;
@@ -11,30 +12,28 @@ layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout (location = 3) out vec2 texCoord;
 
-struct PointLight {
-    vec4 position; // ignore w
-    vec4 color;  // w is intensity
-};
+// computed exactly like in DepthOnly.vert so the color pass passes the equal depth test after a depth pre-pass
+invariant gl_Position;
 
-layout(set = 0, binding = 0) uniform SceneBuffer{
-    mat4 projectionMatrix;
-    mat4 viewMatrix;
-    vec4 ambientLightColor;
-    int numLights;
-    PointLight pointLights[10];
-} sceneData;
+#include "SceneData.glsl"
 
-layout(push_constant) uniform Push{
+struct ObjectData {
     mat4 modelMatrix;
     mat4 normalMatrix;
-} push;
+};
+
+// one entry per draw, the draw's first instance is its index in the array
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer{
+    ObjectData objects[];
+} objectBuffer;
 
 
 void main()
 {
-    vec4 positionWorld = push.modelMatrix * vec4(pos, 1.0f);
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(pos, 1.0f);
     gl_Position = (sceneData.projectionMatrix * sceneData.viewMatrix) * positionWorld;
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
     texCoord = uv;
@@ -0,0 +1,44 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// first draw of the light volume lighting subpass: the ambient light and the sun on every pixel, the point lights are
+// then added by their volumes
+
+layout(location = 0) in vec2 texCoord;
+
+#include "SceneData.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;   // octahedral
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput depthInput;    // 1 where no geometry was drawn
+
+layout(location = 0) out vec4 outColor;
+
+#include "GBuffer.glsl"
+
+// no point light is shaded here
+#define SHADOWS_SUN_ONLY
+#include "Shadows.glsl"
+
+void main()
+{
+    float depth = subpassLoad(depthInput).r;
+    if (depth >= 1.0) {
+        // the forward renderer's clear color
+        outColor = vec4(0.5, 0.5, 0.5, 1.0);
+        return;
+    }
+
+    // back to world space, as in DeferredLight.frag
+    vec2 viewportSize = sceneData.clusterParams.xy * vec2(sceneData.clusterCounts.xy);
+    vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+    vec4 positionWorld = sceneData.inverseViewProjection * vec4(ndc, depth, 1.0);
+    vec3 position = positionWorld.xyz / positionWorld.w;
+    vec3 surfaceNormal = decodeNormal(subpassLoad(normalInput).xy);
+
+    // the sun, shadowed by the cascades
+    float sunLight = max(dot(surfaceNormal, sceneData.sunDirection.xyz), 0.0) * sunShadow(position, surfaceNormal);
+    vec3 light = sceneData.ambientLightColor.xyz * sceneData.ambientLightColor.w +
+                 sceneData.sunColor.xyz * sceneData.sunColor.w * sunLight;
+    outColor = vec4(subpassLoad(albedoInput).rgb * light, 1.0);
+}
@@ -1,15 +1,63 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
-layout(location = 0) in vec2 texCoord; // Interpolated texture coordinate from vertex shader
+// lighting subpass of the deferred renderer: the G-buffer is read from the input attachments at this pixel and lit
+// with the lights of the pixel's cluster, the same cluster lists as the forward shaders
 
-layout(location = 0) out vec4 outColor; // Output color of the fragment
+layout(location = 0) in vec2 texCoord;
 
-layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput colorMap;
-layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput normalMap;
-layout(input_attachment_index = 2, set = 0, binding = 2) uniform subpassInput specularMap;
-layout(input_attachment_index = 3, set = 0, binding = 3) uniform subpassInput positionMap;
+#include "SceneData.glsl"
+#include "Lights.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;   // octahedral
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput specularInput;
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput depthInput;    // 1 where no geometry was drawn
+
+layout(location = 0) out vec4 outColor;
+
+#include "GBuffer.glsl"
+
+#include "Shadows.glsl"
 
 void main()
 {
-    outColor = vec4(subpassLoad(colorMap).rgb, 1.0);
-}
\ No newline at end of file
+    float depth = subpassLoad(depthInput).r;
+    if (depth >= 1.0) {
+        // the forward renderer's clear color
+        outColor = vec4(0.5, 0.5, 0.5, 1.0);
+        return;
+    }
+
+    // back from the pixel center and its depth to world space, the viewport is the cluster grid's extent
+    vec2 viewportSize = sceneData.clusterParams.xy * vec2(sceneData.clusterCounts.xy);
+    vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+    vec4 positionWorld = sceneData.inverseViewProjection * vec4(ndc, depth, 1.0);
+    vec3 position = positionWorld.xyz / positionWorld.w;
+
+    vec3 albedo = subpassLoad(albedoInput).rgb;
+    vec3 specular = subpassLoad(specularInput).rgb;
+    vec3 surfaceNormal = decodeNormal(subpassLoad(normalInput).xy);
+    vec3 cameraPos = vec3(inverse(sceneData.viewMatrix)[3]);
+    vec3 viewDir = normalize(cameraPos - position);
+
+    vec3 diffuseLight = vec3(0.0);
+    vec3 specLight = vec3(0.0);
+    // only the lights touching this pixel's cluster
+    uvec2 cluster = clusterBuffer.clusters[findCluster(position)];
+    for (uint i = cluster.x; i < cluster.x + cluster.y; ++i) {
+        uint lightIndex = lightIndexBuffer.indices[i];
+        PointLight light = lightBuffer.lights[lightIndex];
+
+        vec3 directionToLight = light.position.xyz - position;
+        float attenuation = attenuate(directionToLight, light.position.w) * pointShadow(lightIndex, position, surfaceNormal);
+        shadePointLight(light, directionToLight, attenuation, surfaceNormal, viewDir, diffuseLight, specLight);
+    }
+
+    // the sun, shadowed by the cascades
+    float sunLight = max(dot(surfaceNormal, sceneData.sunDirection.xyz), 0.0) * sunShadow(position, surfaceNormal);
+    diffuseLight += sceneData.sunColor.xyz * sceneData.sunColor.w * sunLight;
+
+    vec3 ambientLight = sceneData.ambientLightColor.xyz * sceneData.ambientLightColor.w;
+    outColor = vec4(albedo * (ambientLight + diffuseLight) + specular * specLight, 1.0);
+}
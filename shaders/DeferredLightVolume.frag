@@ -0,0 +1,53 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// shades the pixels covered by a light volume with that light only, added on top of the ambient light and the other
+// volumes
+
+layout(location = 0) flat in uint lightIndex;
+
+#include "SceneData.glsl"
+#include "Lights.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;   // octahedral
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput specularInput;
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput depthInput;
+
+layout(location = 0) out vec4 outColor;
+
+#include "GBuffer.glsl"
+
+#include "Shadows.glsl"
+
+void main()
+{
+    PointLight light = lightBuffer.lights[lightIndex];
+
+    // back to world space, as in DeferredLight.frag
+    vec2 viewportSize = sceneData.clusterParams.xy * vec2(sceneData.clusterCounts.xy);
+    vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+    vec4 positionWorld = sceneData.inverseViewProjection * vec4(ndc, subpassLoad(depthInput).r, 1.0);
+    vec3 position = positionWorld.xyz / positionWorld.w;
+
+    // the box corners and the surfaces in front of the volume are outside the radius
+    vec3 directionToLight = light.position.xyz - position;
+    float distanceSquared = dot(directionToLight, directionToLight);
+    float radiusSquared = light.position.w * light.position.w;
+    if (distanceSquared >= radiusSquared) {
+        discard;
+    }
+
+    vec3 albedo = subpassLoad(albedoInput).rgb;
+    vec3 specular = subpassLoad(specularInput).rgb;
+    vec3 surfaceNormal = decodeNormal(subpassLoad(normalInput).xy);
+    float attenuation = attenuate(directionToLight, light.position.w) * pointShadow(lightIndex, position, surfaceNormal);
+    vec3 cameraPos = vec3(inverse(sceneData.viewMatrix)[3]);
+    vec3 viewDir = normalize(cameraPos - position);
+
+    vec3 diffuseLight = vec3(0.0);
+    vec3 specLight = vec3(0.0);
+    shadePointLight(light, directionToLight, attenuation, surfaceNormal, viewDir, diffuseLight, specLight);
+
+    outColor = vec4(albedo * diffuseLight + specular * specLight, 0.0);
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// one instance per point light: a box around the light's radius, the corners are built from the vertex index
+
+#include "SceneData.glsl"
+#include "Lights.glsl"
+
+layout(location = 0) flat out uint lightIndex;
+
+// corner i has x, y and z at -1 or 1 from its bits 0, 1 and 2. Counter clockwise seen from outside, the projection
+// flips y so the outside faces are clockwise on screen, the pipelines' front face
+const uint cubeIndices[36] = uint[](
+    4, 6, 2, 4, 2, 0,   // -x
+    1, 3, 7, 1, 7, 5,   // +x
+    1, 5, 4, 1, 4, 0,   // -y
+    2, 6, 7, 2, 7, 3,   // +y
+    2, 3, 1, 2, 1, 0,   // -z
+    4, 5, 7, 4, 7, 6    // +z
+);
+
+void main()
+{
+    PointLight light = lightBuffer.lights[gl_InstanceIndex];
+    uint corner = cubeIndices[gl_VertexIndex];
+    vec3 offset = vec3(corner & 1u, (corner >> 1u) & 1u, (corner >> 2u) & 1u) * 2.0 - 1.0;
+    vec4 positionWorld = vec4(light.position.xyz + offset * light.position.w, 1.0);
+    gl_Position = (sceneData.projectionMatrix * sceneData.viewMatrix) * positionWorld;
+    lightIndex = gl_InstanceIndex;
+}
@@ -0,0 +1,25 @@
+// the octahedral normal encoding of the G-buffer, written by DeferredGeometry.frag and read by the lighting shaders
+#ifndef IRIS_GBUFFER_GLSL
+#define IRIS_GBUFFER_GLSL
+
+vec2 octahedralWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// projects the unit normal on the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+vec2 encodeNormal(vec3 normal)
+{
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+    return normal.z >= 0.0 ? normal.xy : octahedralWrap(normal.xy);
+}
+
+vec3 decodeNormal(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = clamp(-normal.z, 0.0, 1.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normalize(normal);
+}
+
+#endif //IRIS_GBUFFER_GLSL
@@ -0,0 +1,48 @@
+// the point lights, their light lists and their shading, shared by the lighting shaders of every renderer, see
+// PointLight::GpuPointLightData and LightClusters
+#ifndef IRIS_LIGHTS_GLSL
+#define IRIS_LIGHTS_GLSL
+
+struct PointLight {
+    vec4 position; // w is the radius
+    vec4 color;  // w is intensity
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer LightBuffer{
+    PointLight lights[];
+} lightBuffer;
+
+// offset and count of each cluster's lights in the light index list
+layout(std430, set = 0, binding = 3) readonly buffer ClusterBuffer{
+    uvec2 clusters[];
+} clusterBuffer;
+
+layout(std430, set = 0, binding = 4) readonly buffer LightIndexBuffer{
+    uint indices[];
+} lightIndexBuffer;
+
+// inverse square falloff brought smoothly to zero at the light radius, the light lists only hold lights within it
+float attenuate(vec3 directionToLight, float radius)
+{
+    float distanceSquared = dot(directionToLight, directionToLight);
+    float falloff = clamp(1.0 - pow(distanceSquared / (radius * radius), 2.0), 0.0, 1.0);
+    return falloff * falloff / distanceSquared;
+}
+
+// adds the Lambert diffuse and Blinn-Phong specular of the light to the surface's. The attenuation includes the
+// light's shadow, viewDir is normalized
+void shadePointLight(PointLight light, vec3 directionToLight, float attenuation, vec3 surfaceNormal, vec3 viewDir,
+                     inout vec3 diffuseLight, inout vec3 specLight)
+{
+    vec3 lightDir = normalize(directionToLight);
+    float cosAngIncidence = clamp(dot(surfaceNormal, lightDir), 0.0, 1.0);
+    diffuseLight += light.color.xyz * light.color.w * attenuation * cosAngIncidence;
+
+    vec3 halfAngle = normalize(lightDir + viewDir);
+    float blinnTerm = clamp(dot(surfaceNormal, halfAngle), 0.0, 1.0);
+    blinnTerm = cosAngIncidence != 0.0 ? blinnTerm : 0.0;
+    blinnTerm = pow(blinnTerm, 32.0);
+    specLight += light.color.xyz * attenuation * blinnTerm;
+}
+
+#endif //IRIS_LIGHTS_GLSL
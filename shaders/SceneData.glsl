@@ -0,0 +1,31 @@
+// the frame's scene constants, see GpuSceneData
+#ifndef IRIS_SCENEDATA_GLSL
+#define IRIS_SCENEDATA_GLSL
+
+layout(set = 0, binding = 0) uniform SceneBuffer{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec4 ambientLightColor;
+    uvec4 clusterCounts; // clusters in x, y and z, w is the number of lights
+    vec4 clusterParams;  // xy is the tile size in pixels, z and w map a view depth to its slice
+    mat4 inverseViewProjection; // rebuilds world positions from the depth buffer
+    vec4 sunDirection;  // xyz towards the sun
+    vec4 sunColor;      // w is intensity
+    mat4 recordedViewMatrix; // the view the light clusters and shadow cascades were built with, not late latched
+} sceneData;
+
+// the light clusters were built with the view the frame was recorded with, the position is placed in them with that
+// view rather than the latched one it is drawn with
+uint findCluster(vec3 positionWorld)
+{
+    vec4 positionView = sceneData.recordedViewMatrix * vec4(positionWorld, 1.0);
+    vec4 positionClip = sceneData.projectionMatrix * positionView;
+    vec2 viewportSize = sceneData.clusterParams.xy * vec2(sceneData.clusterCounts.xy);
+    vec2 pixel = max((positionClip.xy / positionClip.w * 0.5 + 0.5) * viewportSize, vec2(0.0));
+    uvec3 cluster = uvec3(pixel / sceneData.clusterParams.xy,
+                          max(log(-positionView.z) * sceneData.clusterParams.z + sceneData.clusterParams.w, 0.0));
+    cluster = min(cluster, sceneData.clusterCounts.xyz - 1);
+    return cluster.x + sceneData.clusterCounts.x * (cluster.y + sceneData.clusterCounts.y * cluster.z);
+}
+
+#endif //IRIS_SCENEDATA_GLSL
@@ -0,0 +1,26 @@
+#version 450
+
+// shadow slices, only the position of the vertices is fetched
+layout(location = 0) in vec3 pos;
+
+// view projection of the slice being drawn
+layout(push_constant) uniform SliceConstants{
+    mat4 viewProjection;
+} slice;
+
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+// one entry per draw, the draw's first instance is its index in the array
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer{
+    ObjectData objects[];
+} objectBuffer;
+
+
+void main()
+{
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    gl_Position = slice.viewProjection * (object.modelMatrix * vec4(pos, 1.0f));
+}
@@ -0,0 +1,11 @@
+// shared by ShadowMaps.hpp and Shadows.glsl, plain defines so both the C++ and the GLSL preprocessor read them
+#ifndef IRIS_SHADOWLIMITS_H
+#define IRIS_SHADOWLIMITS_H
+
+// the cascades fill the first row of the atlas, the point light faces the rows below
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_MAX_POINT_LIGHTS 8
+// +x, -x, +y, -y, +z, -z
+#define SHADOW_POINT_FACES 6
+
+#endif //IRIS_SHADOWLIMITS_H
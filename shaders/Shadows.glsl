@@ -0,0 +1,89 @@
+// shadow sampling shared by the lighting shaders, see ShadowMaps. The scene data is declared before, and the light
+// buffer too unless SHADOWS_SUN_ONLY is defined
+#ifndef IRIS_SHADOWS_GLSL
+#define IRIS_SHADOWS_GLSL
+
+#include "ShadowLimits.h"
+
+// the per cascade and per light scalars are packed four to a vec4
+#define SHADOW_VEC4_COUNT(count) (((count) + 3) / 4)
+
+// matrices of the shadow slices, all in one depth atlas, see ShadowMaps
+layout(std430, set = 0, binding = 5) readonly buffer ShadowBuffer{
+    mat4 cascadeMatrices[SHADOW_CASCADE_COUNT];
+    vec4 cascadeRects[SHADOW_CASCADE_COUNT];                 // xy offset and zw size of the slice in atlas uv
+    vec4 cascadeSplits[SHADOW_VEC4_COUNT(SHADOW_CASCADE_COUNT)];     // view depth where each cascade ends
+    vec4 cascadeTexelSizes[SHADOW_VEC4_COUNT(SHADOW_CASCADE_COUNT)]; // world size of a texel of each cascade
+    uvec4 pointLightIndices[SHADOW_VEC4_COUNT(SHADOW_MAX_POINT_LIGHTS)]; // light buffer index of each shadowed point light, ~0 for none
+    mat4 pointFaceMatrices[SHADOW_MAX_POINT_LIGHTS * SHADOW_POINT_FACES]; // the faces of each shadowed point light
+    vec4 pointFaceRects[SHADOW_MAX_POINT_LIGHTS * SHADOW_POINT_FACES];
+} shadowData;
+
+layout(set = 0, binding = 6) uniform sampler2DShadow shadowAtlas;
+
+// 1 lit, 0 in shadow. Four filtered comparisons around the position, kept inside the slice so its neighbours in the
+// atlas never bleed in
+float sampleShadow(mat4 shadowMatrix, vec4 rect, vec3 positionWorld)
+{
+    vec4 clip = shadowMatrix * vec4(positionWorld, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    if (clip.w <= 0.0 || any(greaterThan(abs(ndc.xy), vec2(1.0))) || ndc.z > 1.0) {
+        return 1.0;
+    }
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = rect.xy + (ndc.xy * 0.5 + 0.5) * rect.zw;
+    vec2 minUv = rect.xy + texel;
+    vec2 maxUv = rect.xy + rect.zw - texel;
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = vec2((i & 1) == 0 ? -0.5 : 0.5, (i & 2) == 0 ? -0.5 : 0.5) * texel;
+        lit += texture(shadowAtlas, vec3(clamp(uv + offset, minUv, maxUv), ndc.z));
+    }
+    return lit * 0.25;
+}
+
+// the cascade covering the view depth of the position, which is pushed off its surface by a texel of that cascade. The
+// splits are depths of the view the frame was recorded with
+float sunShadow(vec3 positionWorld, vec3 normal)
+{
+    float viewDepth = -(sceneData.recordedViewMatrix * vec4(positionWorld, 1.0)).z;
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        if (viewDepth < shadowData.cascadeSplits[i / 4][i % 4]) {
+            vec3 offsetPosition = positionWorld + normal * shadowData.cascadeTexelSizes[i / 4][i % 4];
+            return sampleShadow(shadowData.cascadeMatrices[i], shadowData.cascadeRects[i], offsetPosition);
+        }
+    }
+    return 1.0;
+}
+
+#ifndef SHADOWS_SUN_ONLY
+// 1 for the lights without a shadow slot. The face is picked from the major axis of the direction from the light
+float pointShadow(uint lightIndex, vec3 positionWorld, vec3 normal)
+{
+    for (uint slot = 0; slot < SHADOW_MAX_POINT_LIGHTS; slot++) {
+        if (shadowData.pointLightIndices[slot / 4][slot % 4] != lightIndex) {
+            continue;
+        }
+        vec3 direction = positionWorld - lightBuffer.lights[lightIndex].position.xyz;
+        vec3 absDirection = abs(direction);
+        uint face;
+        if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z) {
+            face = direction.x > 0.0 ? 0 : 1;
+        }
+        else if (absDirection.y >= absDirection.z) {
+            face = direction.y > 0.0 ? 2 : 3;
+        }
+        else {
+            face = direction.z > 0.0 ? 4 : 5;
+        }
+        uint index = slot * SHADOW_POINT_FACES + face;
+        // world size of a texel of the 90 degree face at the distance of the position
+        float texelSize = 2.0 * length(direction) / (shadowData.pointFaceRects[index].z * float(textureSize(shadowAtlas, 0).x));
+        return sampleShadow(shadowData.pointFaceMatrices[index], shadowData.pointFaceRects[index],
+                            positionWorld + normal * texelSize);
+    }
+    return 1.0;
+}
+#endif
+
+#endif //IRIS_SHADOWS_GLSL
@@ -0,0 +1,36 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord; // 0..1 over the target
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sourceImage;
+
+layout(push_constant) uniform UpscaleConstants{
+    vec2 uvScale;    // the region the frame was rendered in, in source uv
+    float sharpness; // 0 plain bilinear
+} constants;
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(sourceImage, 0));
+    // the filter never reaches past the rendered region, the source pixels around it are stale
+    vec2 minUv = 0.5 * texel;
+    vec2 maxUv = constants.uvScale - 0.5 * texel;
+    vec2 uv = clamp(texCoord * constants.uvScale, minUv, maxUv);
+    vec3 color = texture(sourceImage, uv).rgb;
+
+    if (constants.sharpness > 0.0) {
+        // unsharp mask over the cross of neighbours one source texel away, clamped to their range so the edges
+        // do not get a halo
+        vec3 north = texture(sourceImage, clamp(uv - vec2(0.0, texel.y), minUv, maxUv)).rgb;
+        vec3 south = texture(sourceImage, clamp(uv + vec2(0.0, texel.y), minUv, maxUv)).rgb;
+        vec3 west = texture(sourceImage, clamp(uv - vec2(texel.x, 0.0), minUv, maxUv)).rgb;
+        vec3 east = texture(sourceImage, clamp(uv + vec2(texel.x, 0.0), minUv, maxUv)).rgb;
+        vec3 minColor = min(color, min(min(north, south), min(west, east)));
+        vec3 maxColor = max(color, max(max(north, south), max(west, east)));
+        vec3 sharpened = color + constants.sharpness * (4.0 * color - north - south - west - east);
+        color = clamp(sharpened, minColor, maxColor);
+    }
+    outColor = vec4(color, 1.0);
+}
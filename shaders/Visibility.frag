@@ -0,0 +1,14 @@
+#version 450
+
+// writes nothing but the id of the visible triangle, the resolve pass does all the shading
+
+layout(location = 0) flat in uint transformId;
+
+// transform id and triangle, see VisibilityRenderer::m_cVisibilityFormat
+layout(location = 0) out uvec2 outId;
+
+void main()
+{
+    // gl_PrimitiveID counts the triangles from the start of the draw, the index order of the model
+    outId = uvec2(transformId, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,29 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// geometry pass of the visibility renderer, only the position of the vertices is fetched
+layout(location = 0) in vec3 pos;
+
+// the draw's first instance is its transform id, written with the triangle in the pixel's ids
+layout(location = 0) flat out uint transformId;
+
+#include "SceneData.glsl"
+
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+// one entry per draw, the draw's first instance is its index in the array
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer{
+    ObjectData objects[];
+} objectBuffer;
+
+
+void main()
+{
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(pos, 1.0f);
+    gl_Position = (sceneData.projectionMatrix * sceneData.viewMatrix) * positionWorld;
+    transformId = gl_InstanceIndex;
+}
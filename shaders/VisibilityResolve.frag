@@ -0,0 +1,178 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// resolve subpass of the visibility renderer: the ids of the pixel give the transform and the triangle drawn there,
+// the triangle's vertices are fetched from the geometry buffers and interpolated with the pixel's barycentrics, then
+// the pixel is lit with the lights of its cluster like in the forward shaders
+
+layout(location = 0) in vec2 texCoord;
+
+const uint NO_GEOMETRY = 0xFFFFFFFFu;
+// Model::Vertex as floats: position, color, normal and uv
+const uint VERTEX_FLOATS = 11;
+
+#include "SceneData.glsl"
+#include "Lights.glsl"
+
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer{
+    ObjectData objects[];
+} objectBuffer;
+
+// every drawn model, Model::Vertex is 44 bytes so the vertices are read as plain floats
+layout(std430, set = 1, binding = 0) readonly buffer VertexBuffer{
+    float vertices[];
+} vertexBuffer;
+
+layout(std430, set = 1, binding = 1) readonly buffer IndexBuffer{
+    uint indices[];
+} indexBuffer;
+
+// by transform id: first index and vertex offset of the model in the geometry buffers, its material's resolve draw or
+// 0 when untextured
+layout(std430, set = 1, binding = 2) readonly buffer DrawBuffer{
+    uvec4 draws[];
+} drawBuffer;
+
+layout(input_attachment_index = 0, set = 1, binding = 3) uniform usubpassInput visibilityInput;
+
+layout(set = 2, binding = 0) uniform sampler2D ambient;
+layout(set = 2, binding = 1) uniform sampler2D diffuse;
+layout(set = 2, binding = 2) uniform sampler2D specular;
+
+// the textures bound are this material's, the pixels of the other ones are left to their own draw
+layout(push_constant) uniform ResolveMaterial{
+    uint material;
+} resolveMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+struct Vertex {
+    vec3 position;
+    vec3 color;
+    vec3 normal;
+    vec2 uv;
+};
+
+Vertex fetchVertex(uint index)
+{
+    uint base = index * VERTEX_FLOATS;
+    Vertex vertex;
+    vertex.position = vec3(vertexBuffer.vertices[base + 0], vertexBuffer.vertices[base + 1], vertexBuffer.vertices[base + 2]);
+    vertex.color = vec3(vertexBuffer.vertices[base + 3], vertexBuffer.vertices[base + 4], vertexBuffer.vertices[base + 5]);
+    vertex.normal = vec3(vertexBuffer.vertices[base + 6], vertexBuffer.vertices[base + 7], vertexBuffer.vertices[base + 8]);
+    vertex.uv = vec2(vertexBuffer.vertices[base + 9], vertexBuffer.vertices[base + 10]);
+    return vertex;
+}
+
+float cross2(vec2 a, vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+// barycentrics of ndc in the triangle of clip space corners c0, c1 and c2, the screen space ones are divided by the
+// corners' w and renormalized so they interpolate like the rasterizer's perspective correct varyings
+vec3 barycentrics(vec2 ndc, vec4 c0, vec4 c1, vec4 c2)
+{
+    vec3 inverseW = 1.0 / vec3(c0.w, c1.w, c2.w);
+    vec2 n0 = c0.xy * inverseW.x;
+    vec2 n1 = c1.xy * inverseW.y;
+    vec2 n2 = c2.xy * inverseW.z;
+
+    float area = cross2(n1 - n0, n2 - n0);
+    float lambda1 = cross2(ndc - n0, n2 - n0) / area;
+    float lambda2 = cross2(n1 - n0, ndc - n0) / area;
+
+    vec3 perspective = vec3(1.0 - lambda1 - lambda2, lambda1, lambda2) * inverseW;
+    return perspective / (perspective.x + perspective.y + perspective.z);
+}
+
+#include "Shadows.glsl"
+
+void main()
+{
+    // transform id and triangle
+    uvec2 id = subpassLoad(visibilityInput).rg;
+    uint material = id.x == NO_GEOMETRY ? 0 : drawBuffer.draws[id.x].z;
+    if (material != resolveMaterial.material) {
+        discard;
+    }
+    if (id.x == NO_GEOMETRY) {
+        // the forward renderer's clear color
+        outColor = vec4(0.5, 0.5, 0.5, 1.0);
+        return;
+    }
+
+    uint transformId = id.x;
+    uint triangle = id.y;
+    uvec4 draw = drawBuffer.draws[transformId];
+    ObjectData object = objectBuffer.objects[transformId];
+
+    uint firstIndex = draw.x + triangle * 3;
+    Vertex v0 = fetchVertex(indexBuffer.indices[firstIndex + 0] + draw.y);
+    Vertex v1 = fetchVertex(indexBuffer.indices[firstIndex + 1] + draw.y);
+    Vertex v2 = fetchVertex(indexBuffer.indices[firstIndex + 2] + draw.y);
+
+    // the corners transformed like in Visibility.vert
+    mat4 viewProjection = sceneData.projectionMatrix * sceneData.viewMatrix;
+    vec3 p0 = (object.modelMatrix * vec4(v0.position, 1.0)).xyz;
+    vec3 p1 = (object.modelMatrix * vec4(v1.position, 1.0)).xyz;
+    vec3 p2 = (object.modelMatrix * vec4(v2.position, 1.0)).xyz;
+    vec4 c0 = viewProjection * vec4(p0, 1.0);
+    vec4 c1 = viewProjection * vec4(p1, 1.0);
+    vec4 c2 = viewProjection * vec4(p2, 1.0);
+
+    // the viewport is the cluster grid's extent
+    vec2 viewportSize = sceneData.clusterParams.xy * vec2(sceneData.clusterCounts.xy);
+    vec2 pixelSize = 2.0 / viewportSize;
+    vec2 ndc = gl_FragCoord.xy * pixelSize - 1.0;
+    vec3 weights = barycentrics(ndc, c0, c1, c2);
+
+    vec3 position = p0 * weights.x + p1 * weights.y + p2 * weights.z;
+    vec3 color = v0.color * weights.x + v1.color * weights.y + v2.color * weights.z;
+    vec3 normal = v0.normal * weights.x + v1.normal * weights.y + v2.normal * weights.z;
+    vec3 surfaceNormal = normalize(mat3(object.normalMatrix) * normal);
+
+    vec3 cameraPos = vec3(inverse(sceneData.viewMatrix)[3]);
+    vec3 viewDir = normalize(cameraPos - position);
+
+    vec3 diffuseLight = vec3(0.0);
+    vec3 specLight = vec3(0.0);
+    // only the lights touching this pixel's cluster
+    uvec2 cluster = clusterBuffer.clusters[findCluster(position)];
+    for (uint i = cluster.x; i < cluster.x + cluster.y; ++i) {
+        uint lightIndex = lightIndexBuffer.indices[i];
+        PointLight light = lightBuffer.lights[lightIndex];
+
+        vec3 directionToLight = light.position.xyz - position;
+        float attenuation = attenuate(directionToLight, light.position.w) * pointShadow(lightIndex, position, surfaceNormal);
+        shadePointLight(light, directionToLight, attenuation, surfaceNormal, viewDir, diffuseLight, specLight);
+    }
+
+    // the sun, shadowed by the cascades
+    float sunLight = max(dot(surfaceNormal, sceneData.sunDirection.xyz), 0.0) * sunShadow(position, surfaceNormal);
+    diffuseLight += sceneData.sunColor.xyz * sceneData.sunColor.w * sunLight;
+
+    vec3 ambientLight = sceneData.ambientLightColor.xyz * sceneData.ambientLightColor.w;
+    if (draw.z == 0) {
+        outColor = vec4((diffuseLight + specLight + ambientLight) * color, 1.0);
+        return;
+    }
+
+    // there are no quads of neighbouring fragments of the same triangle to take the uv derivatives from, the
+    // barycentrics are evaluated one pixel to the right and one below instead
+    vec2 uv = v0.uv * weights.x + v1.uv * weights.y + v2.uv * weights.z;
+    vec3 weightsX = barycentrics(ndc + vec2(pixelSize.x, 0.0), c0, c1, c2);
+    vec3 weightsY = barycentrics(ndc + vec2(0.0, pixelSize.y), c0, c1, c2);
+    vec2 uvDx = v0.uv * weightsX.x + v1.uv * weightsX.y + v2.uv * weightsX.z - uv;
+    vec2 uvDy = v0.uv * weightsY.x + v1.uv * weightsY.y + v2.uv * weightsY.z - uv;
+
+    vec3 ambientColor = textureGrad(ambient, uv, uvDx, uvDy).xyz * ambientLight;
+    vec3 diffuseColor = textureGrad(diffuse, uv, uvDx, uvDy).xyz * diffuseLight;
+    vec3 specularColor = textureGrad(specular, uv, uvDx, uvDy).xyz * specLight;
+    outColor = vec4((diffuseColor + specularColor + ambientColor) * color, 1.0);
+}